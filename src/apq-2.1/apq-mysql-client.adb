@@ -145,6 +145,28 @@ package body APQ.MySQL.Client is
       return Interfaces.C.int;
    pragma import(C,mysql_options_char,"c_mysql_options_char");
 
+   function mysql_stmt_prepare(connection : MYSQL; query : System.Address) return MYSQL_STMT;
+   pragma import(C,mysql_stmt_prepare,"c_mysql_stmt_prepare");
+
+   function mysql_stmt_execute(stmt : MYSQL_STMT; count : Interfaces.C.unsigned; values, lengths : System.Address)
+      return Interfaces.C.int;
+   pragma import(C,mysql_stmt_execute,"c_mysql_stmt_execute");
+
+   function mysql_stmt_errno(stmt : MYSQL_STMT) return Result_Type;
+   pragma import(C,mysql_stmt_errno,"c_mysql_stmt_errno");
+
+   function mysql_stmt_error(stmt : MYSQL_STMT) return Interfaces.C.Strings.chars_ptr;
+   pragma import(C,mysql_stmt_error,"c_mysql_stmt_error");
+
+   function mysql_stmt_field_count(stmt : MYSQL_STMT) return Field_Count_Type;
+   pragma import(C,mysql_stmt_field_count,"c_mysql_stmt_field_count");
+
+   function mysql_stmt_insert_id(stmt : MYSQL_STMT) return MySQL_Oid_Type;
+   pragma import(C,mysql_stmt_insert_id,"c_mysql_stmt_insert_id");
+
+   procedure mysql_stmt_close(stmt : MYSQL_STMT);
+   pragma import(C,mysql_stmt_close,"c_mysql_stmt_close");
+
 
    procedure Free(Results : in out MYSQL_RES) is
    begin
@@ -221,6 +243,27 @@ package body APQ.MySQL.Client is
       end if;
    end Post_Error;
 
+   procedure Post_Error(Q : in out Query_Type; Stmt : MYSQL_STMT) is
+      use Interfaces.C, Interfaces.C.Strings;
+   begin
+      Q.Error_Code := mysql_stmt_errno(Stmt);
+      Replace_String(Q.Error_Message,To_Ada(Value(mysql_stmt_error(Stmt))));
+   end Post_Error;
+
+   -- Close the cached prepared statements.  This must be done before the
+   -- connection is closed.
+
+   procedure Close_Statements(C : in out Connection_Type) is
+   begin
+      for X in 1..C.Statement_Count loop
+         if C.Stmts(X) /= Null_Stmt then
+            mysql_stmt_close(C.Stmts(X));
+            C.Stmts(X) := Null_Stmt;
+         end if;
+      end loop;
+      Clear_Statements(C);
+   end Close_Statements;
+
    procedure Clear_Results(Q : in out Query_Type) is
    begin
       if Q.Results /= Null_Result then
@@ -627,6 +670,7 @@ package body APQ.MySQL.Client is
       --end if;
 
       if C.Connection /= Null_Connection then
+         Close_Statements(C);
          C.Connection := mysql_close(C.Connection);
          if C.Trace_Mode = Trace_APQ or else C.Trace_Mode = Trace_Full then
             -- KB: trace can be on even though file is not open
@@ -801,6 +845,113 @@ package body APQ.MySQL.Client is
       end;
    end Execute_Checked;
 
+   -- Run the query as a server-side prepared statement with the bound
+   -- parameters (?).  The statement is prepared the first time its SQL
+   -- text is seen on this connection and reused after that.  Statements
+   -- that return rows are not supported: use Execute for queries.
+
+   procedure Execute_Prepared(Query : in out Query_Type; Connection : in out Root_Connection_Type'Class) is
+      use Interfaces.C, Interfaces.C.Strings;
+      Index :  Natural;
+      Stmt :   MYSQL_STMT;
+      R :      int;
+   begin
+
+      if not Is_Connected(Connection_Type(Connection)) then
+         raise Not_Connected;
+      end if;
+
+      Clear_Results(Query);
+      Query.Rewound := True;
+
+      declare
+         A_Query :   String := To_String(Query);
+      begin
+         if Connection_Type(Connection).Trace_On then
+            if Connection_Type(Connection).Trace_Mode = Trace_APQ
+            or Connection_Type(Connection).Trace_Mode = Trace_Full then
+               if is_open( Connection.Trace_Ada ) then
+                  Ada.Text_IO.Put_Line(Connection.Trace_Ada,"-- SQL PREPARED QUERY:");
+                  Ada.Text_IO.Put_Line(Connection.Trace_Ada,A_Query);
+                  Ada.Text_IO.Put_Line(Connection.Trace_Ada,";");
+               end if;
+            end if;
+         end if;
+
+         Index := Statement_Index(Connection,A_Query);
+         if Index = 0 then
+            if Connection.Statement_Count >= Max_Statements then
+               Close_Statements(Connection_Type(Connection));
+            end if;
+            declare
+               C_Query :   char_array := To_C(A_Query);
+            begin
+               Stmt := mysql_stmt_prepare(Connection_Type(Connection).Connection,C_Query'Address);
+            end;
+            if Stmt = Null_Stmt then
+               Post_Error(Query,Connection_Type(Connection));
+               raise SQL_Error;
+            end if;
+            if mysql_stmt_errno(Stmt) /= CR_NO_ERROR then
+               Post_Error(Query,Stmt);
+               mysql_stmt_close(Stmt);
+               raise SQL_Error;
+            end if;
+            if mysql_stmt_field_count(Stmt) /= 0 then
+               mysql_stmt_close(Stmt);
+               Query.Error_Code := CR_UNKNOWN_ERROR;
+               Replace_String(Query.Error_Message,"prepared statements cannot return rows");
+               raise SQL_Error;
+            end if;
+            Add_Statement(Connection,A_Query,Index);
+            Connection_Type(Connection).Stmts(Index) := Stmt;
+         end if;
+         Stmt := Connection_Type(Connection).Stmts(Index);
+      end;
+
+      declare
+         -- The values are copied with their exact length so that a value
+         -- holding a NUL is sent whole.  The trailing NUL is not counted in
+         -- the length; it only keeps an empty value from being a null array.
+         type Length_Array is array(Positive range <>) of unsigned_long;
+         type Address_Array is array(Positive range <>) of System.Address;
+         type Buffer_Array is array(Positive range <>) of char_array_access;
+         N :         Natural := Parameters(Query);
+         Buffers :   Buffer_Array(1..Natural'Max(N,1)) := (others => null);
+         Values :    Address_Array(1..Natural'Max(N,1)) := (others => System.Null_Address);
+         Lengths :   Length_Array(1..Natural'Max(N,1)) := (others => 0);
+      begin
+         for X in 1..N loop
+            if Query.Params(X) /= null then
+               Buffers(X) := new char_array'(To_C(Query.Params(X).all,Append_Nul => True));
+               Values(X) := Buffers(X).all'Address;
+               Lengths(X) := Query.Params(X).all'Length;
+            end if;
+         end loop;
+         R := mysql_stmt_execute(Stmt,unsigned(N),Values'Address,Lengths'Address);
+         for X in Buffers'Range loop
+            Free(Buffers(X));
+         end loop;
+      end;
+
+      if R /= 0 then
+         Post_Error(Query,Stmt);
+         if Connection_Type(Connection).Trace_On then
+            if is_open( Connection_Type(Connection).Trace_Ada ) then
+               Ada.Text_IO.Put_Line(Connection_Type(Connection).Trace_Ada,"-- Error " &
+                  Result_Type'Image(Query.Error_Code) & " : " & Error_Message(Query));
+               Ada.Text_IO.New_Line(Connection_Type(Connection).Trace_Ada);
+            end if;
+         end if;
+         raise SQL_Error;
+      end if;
+
+      Clear_Error(Query,Connection_Type(Connection));
+      Query.Tuple_Index := Tuple_Index_Type'First;
+      Query.Row_ID := Row_ID_Type(mysql_stmt_insert_id(Stmt));
+
+   end Execute_Prepared;
+
    function Error_Message(Query : Query_Type) return String is
    begin
       return To_String(Query.Error_Message);
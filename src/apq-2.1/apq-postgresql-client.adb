@@ -534,6 +534,7 @@ package body APQ.PostgreSQL.Client is
       Notice_Uninstall(C.Connection);     -- Disconnect callback notices
       PQfinish(C.Connection);             -- Now release the connection
       C.Connection  := Null_Connection;
+      Clear_Statements(C);                -- The server dropped its prepared statements
       C.Abort_State := False;             -- Clear abort state
       C.Notify_Proc := null;              -- De-register the notify procedure
 
@@ -595,6 +596,7 @@ package body APQ.PostgreSQL.Client is
          Free_Ptr(C.Options);
          Free_Ptr(C.Error_Message);
          Free_Ptr(C.Notice);
+         Clear_Statements(C);
       end if;
    end Internal_Reset;
 
@@ -653,6 +655,209 @@ package body APQ.PostgreSQL.Client is
       end if;
    end Free;
 
+   function Status_Of(R : PQ_Result) return Result_Type is
+      function PQresultStatus(R : PQ_Result) return Result_Type;
+      pragma Import(C,PQresultStatus,"PQresultStatus");
+   begin
+      return PQresultStatus(R);
+   end Status_Of;
+
+   -- Discard any rows a Sequential_Fetch query has not read yet.  If rows
+   -- are still arriving, the server is asked to cancel the query so that
+   -- a large result set is not transferred only to be thrown away.  The
+   -- results that have already arrived are read first: if the query is
+   -- over, a cancel request could only reach the next command sent on
+   -- this connection.  The connection cannot run another command until
+   -- this is done.
+
+   procedure Drain_Stream(Q : in out Query_Type) is
+      type PG_Cancel is new System.Address;
+      function PQgetResult(C : PG_Conn) return PQ_Result;
+      pragma Import(C,PQgetResult,"PQgetResult");
+      function PQconsumeInput(C : PG_Conn) return int;
+      pragma Import(C,PQconsumeInput,"PQconsumeInput");
+      function PQisBusy(C : PG_Conn) return int;
+      pragma Import(C,PQisBusy,"PQisBusy");
+      function PQgetCancel(C : PG_Conn) return PG_Cancel;
+      pragma Import(C,PQgetCancel,"PQgetCancel");
+      function PQcancel(Cancel : PG_Cancel; Errbuf : System.Address; Errbufsize : int) return int;
+      pragma Import(C,PQcancel,"PQcancel");
+      procedure PQfreeCancel(Cancel : PG_Cancel);
+      pragma Import(C,PQfreeCancel,"PQfreeCancel");
+      Errbuf :   char_array(0..255);
+      Cancel :   PG_Cancel;
+      R :        PQ_Result;
+      Finished : Boolean := False;
+   begin
+      Free(Q.Next_Result);
+      if Q.Stream_Conn /= Null_Connection then
+         if PQconsumeInput(Q.Stream_Conn) /= 0 then
+            while PQisBusy(Q.Stream_Conn) = 0 loop
+               R := PQgetResult(Q.Stream_Conn);
+               if R = Null_Result then
+                  Finished := True;
+                  exit;
+               end if;
+               Free(R);
+            end loop;
+         end if;
+         if not Finished then
+            Cancel := PQgetCancel(Q.Stream_Conn);
+            if Cancel /= PG_Cancel(System.Null_Address) then
+               if PQcancel(Cancel,Errbuf'Address,Errbuf'Length) = 0 then
+                  null;       -- the rows will be read and discarded instead
+               end if;
+               PQfreeCancel(Cancel);
+            end if;
+            loop
+               R := PQgetResult(Q.Stream_Conn);
+               exit when R = Null_Result;
+               Free(R);
+            end loop;
+         end if;
+         Q.Stream_Conn := Null_Connection;
+         Q.Async := False;
+      end if;
+   end Drain_Stream;
+
+   -- Read the next row of a Sequential_Fetch query so that End_of_Query
+   -- can answer without waiting on the caller's next Fetch.  Once the
+   -- final (rowless) result arrives, the connection is free again.
+
+   procedure Read_Ahead(Q : in out Query_Type) is
+      function PQgetResult(C : PG_Conn) return PQ_Result;
+      pragma Import(C,PQgetResult,"PQgetResult");
+      R : PQ_Result;
+   begin
+      Q.Next_Result := PQgetResult(Q.Stream_Conn);
+      if Q.Next_Result = Null_Result or else Status_Of(Q.Next_Result) /= Single_Tuple then
+         loop
+            exit when Q.Next_Result = Null_Result;
+            R := PQgetResult(Q.Stream_Conn);
+            exit when R = Null_Result;
+            Free(R);
+         end loop;
+         Q.Stream_Conn := Null_Connection;
+      end if;
+   end Read_Ahead;
+
+   -- Zero based row within Result.  A Sequential_Fetch result holds only
+   -- the current row.
+
+   function Row_Number(Q : Query_Type) return int is
+   begin
+      if Q.Mode = Sequential_Fetch then
+         return 0;
+      end if;
+      return int(Q.Tuple_Index) - 1;
+   end Row_Number;
+
+   -- Begin reading a Sequential_Fetch query that was just sent to the
+   -- server.  If it could not be sent, Result holds the error.
+
+   procedure Start_Stream(Query : in out Query_Type; Conn : PG_Conn; Sent : Boolean) is
+      function PQsetSingleRowMode(C : PG_Conn) return int;
+      pragma Import(C,PQsetSingleRowMode,"PQsetSingleRowMode");
+      function PQgetResult(C : PG_Conn) return PQ_Result;
+      pragma Import(C,PQgetResult,"PQgetResult");
+      function PQmakeEmptyPGresult(C : PG_Conn; Status : Result_Type) return PQ_Result;
+      pragma Import(C,PQmakeEmptyPGresult,"PQmakeEmptyPGresult");
+   begin
+      if not Sent then
+         Query.Result := PQmakeEmptyPGresult(Conn,Fatal_Error);
+         return;
+      end if;
+      if PQsetSingleRowMode(Conn) = 0 then
+         -- All rows arrive in one result as with PQexec.  Read it as a
+         -- Random_Fetch result, or Fetch would find no Single_Tuple rows.
+         Query.Mode := Random_Fetch;
+         Query.Result := PQgetResult(Conn);
+         Query.Stream_Conn := Conn;
+         Drain_Stream(Query);
+         return;
+      end if;
+      Query.Stream_Conn := Conn;
+      Query.Result := PQgetResult(Conn);
+      if Query.Result /= Null_Result and then Status_Of(Query.Result) = Single_Tuple then
+         Read_Ahead(Query);
+      else
+         Drain_Stream(Query);
+      end if;
+   end Start_Stream;
+
+   -- The server name of a cached prepared statement
+
+   function Statement_Name(Index : Positive) return String is
+      Image : String := Positive'Image(Index);
+   begin
+      return "apq_stmt_" & Image(Image'First+1..Image'Last);
+   end Statement_Name;
+
+   function PQputCopyData(C : PG_Conn; Buffer : System.Address; Nbytes : int) return int;
+   pragma Import(C,PQputCopyData,"PQputCopyData");
+
+   function PQputCopyEnd(C : PG_Conn; Errormsg : System.Address) return int;
+   pragma Import(C,PQputCopyEnd,"PQputCopyEnd");
+
+   function PQgetResult(C : PG_Conn) return PQ_Result;
+   pragma Import(C,PQgetResult,"PQgetResult");
+
+   -- Finish a COPY FROM STDIN.  The final result replaces Result.  An
+   -- error message makes the server reject all of the data.
+
+   procedure End_Copy(Q : in out Query_Type; Error : String) is
+      C_Error :   char_array := To_C(Error);
+      Z :         int;
+      R :         PQ_Result;
+   begin
+      if Error'Length > 0 then
+         Z := PQputCopyEnd(Q.Copy_Conn,C_Error'Address);
+      else
+         Z := PQputCopyEnd(Q.Copy_Conn,System.Null_Address);
+      end if;
+      if Z /= 1 then
+         null;       -- the result below holds the error
+      end if;
+      Free(Q.Result);
+      Q.Result := PQgetResult(Q.Copy_Conn);
+      loop
+         exit when Q.Result = Null_Result;
+         R := PQgetResult(Q.Copy_Conn);
+         exit when R = Null_Result;
+         Free(R);
+      end loop;
+      Q.Copy_Conn := Null_Connection;
+      Free_Ptr(Q.Copy_Buffer);
+      Q.Copy_Length := 0;
+   end End_Copy;
+
+   -- Give up on an unfinished COPY so the connection can be used again
+
+   procedure Abort_Copy(Q : in out Query_Type) is
+   begin
+      if Q.Copy_Conn /= Null_Connection then
+         End_Copy(Q,"copy abandoned");
+         Free(Q.Result);
+      end if;
+   end Abort_Copy;
+
+   -- Send the buffered COPY data.  On failure, Result holds the message.
+
+   procedure Flush_Copy(Q : in out Query_Type) is
+      function PQmakeEmptyPGresult(C : PG_Conn; Status : Result_Type) return PQ_Result;
+      pragma Import(C,PQmakeEmptyPGresult,"PQmakeEmptyPGresult");
+      Length : Natural := Q.Copy_Length;
+   begin
+      if Length > 0 then
+         Q.Copy_Length := 0;
+         if PQputCopyData(Q.Copy_Conn,Q.Copy_Buffer.all'Address,int(Length)) /= 1 then
+            Free(Q.Result);
+            Q.Result := PQmakeEmptyPGresult(Q.Copy_Conn,Fatal_Error);
+            raise SQL_Error;
+         end if;
+      end if;
+   end Flush_Copy;
+
    procedure Append_Quoted(Q : in out Query_Type; Connection : Root_Connection_Type'Class; SQL : String; After : String := "") is
       function PQescapeString(to, from : System.Address; length : size_t) return size_t;
       pragma Import(C,PQescapeString,"PQescapeString");
@@ -668,6 +873,12 @@ package body APQ.PostgreSQL.Client is
    procedure Adjust(Q : in out Query_Type) is
    begin
       Q.Result := Null_Result;
+      Q.Next_Result := Null_Result;
+      Q.Stream_Conn := Null_Connection;
+      Q.Async := False;
+      Q.Copy_Conn := Null_Connection;
+      Q.Copy_Buffer := null;
+      Q.Copy_Length := 0;
       Adjust(Root_Query_Type(Q));
    end Adjust;
 
@@ -759,6 +970,8 @@ package body APQ.PostgreSQL.Client is
    procedure Execute(Query : in out Query_Type; Connection : in out Root_Connection_Type'Class) is
       function PQexec(C : PG_Conn; Q : System.Address) return PQ_Result;
       pragma Import(C,PQexec,"PQexec");
+      function PQsendQuery(C : PG_Conn; Q : System.Address) return int;
+      pragma Import(C,PQsendQuery,"PQsendQuery");
       R : Result_Type;
    begin
 
@@ -770,9 +983,11 @@ package body APQ.PostgreSQL.Client is
          raise Abort_State;
       end if;
 
+      Abort_Copy(Query);
       if Query.Result /= Null_Result then
          Free(Query.Result);
       end if;
+      Drain_Stream(Query);
 
       declare
          A_Query :   String := To_String(Query);
@@ -789,7 +1004,17 @@ package body APQ.PostgreSQL.Client is
             end if;
          end if;
 
-         Query.Result := PQexec(Internal_Connection(Connection_Type(Connection)),C_Query'Address);
+         if Query.Mode = Sequential_Fetch then
+            -- KB: stream the rows one at a time instead of buffering the
+            -- whole result set in the client
+            declare
+               Conn : PG_Conn := Internal_Connection(Connection_Type(Connection));
+            begin
+               Start_Stream(Query,Conn,PQsendQuery(Conn,C_Query'Address) /= 0);
+            end;
+         else
+            Query.Result := PQexec(Internal_Connection(Connection_Type(Connection)),C_Query'Address);
+         end if;
 
          if Connection.Trace_On then
             if Connection.Trace_Mode = Trace_APQ or Connection.Trace_Mode = Trace_Full then
@@ -806,7 +1031,7 @@ package body APQ.PostgreSQL.Client is
       if Query.Result /= Null_Result then
          Query.Tuple_Index := First_Tuple_Index;
          R := Result(Query);
-         if R /= Command_OK and R /= Tuples_OK then
+         if R /= Command_OK and R /= Tuples_OK and R /= Single_Tuple then
 --            if Connection.Trace_On then
 --               Ada.Text_IO.Put_Line(Connection.Trace_Ada,"-- Error " & 
 --                  Result_Type'Image(Query.Error_Code) & " : " & Error_Message(Query));
@@ -852,6 +1077,495 @@ package body APQ.PostgreSQL.Client is
       end;
    end Execute_Checked;
 
+   -- Run the query as a server-side prepared statement with the bound
+   -- parameters ($1, $2, ...).  The statement is prepared the first time
+   -- its SQL text is seen on this connection and reused after that, so
+   -- the server does not parse and plan it again, and the parameters
+   -- never need quoting.
+
+   procedure Execute_Prepared(Query : in out Query_Type; Connection : in out Root_Connection_Type'Class) is
+      use Interfaces.C.Strings;
+      function PQexec(C : PG_Conn; Q : System.Address) return PQ_Result;
+      pragma Import(C,PQexec,"PQexec");
+      function PQprepare(C : PG_Conn; Name, Q : System.Address; NParams : int; Types : System.Address)
+         return PQ_Result;
+      pragma Import(C,PQprepare,"PQprepare");
+      function PQexecPrepared(C : PG_Conn; Name : System.Address; NParams : int;
+         Values, Lengths, Formats : System.Address; Result_Format : int) return PQ_Result;
+      pragma Import(C,PQexecPrepared,"PQexecPrepared");
+      function PQsendQueryPrepared(C : PG_Conn; Name : System.Address; NParams : int;
+         Values, Lengths, Formats : System.Address; Result_Format : int) return int;
+      pragma Import(C,PQsendQueryPrepared,"PQsendQueryPrepared");
+      Conn :   PG_Conn;
+      Index :  Natural;
+      R :      Result_Type;
+   begin
+
+      if not Is_Connected(Connection) then
+         raise Not_Connected;
+      end if;
+
+      if In_Abort_State(Connection) then
+         raise Abort_State;
+      end if;
+
+      Abort_Copy(Query);
+      Free(Query.Result);
+      Drain_Stream(Query);
+      Query.Rewound := True;
+      Conn := Internal_Connection(Connection_Type(Connection));
+
+      declare
+         A_Query :   String := To_String(Query);
+      begin
+         if Connection.Trace_On then
+            if Connection.Trace_Mode = Trace_APQ or Connection.Trace_Mode = Trace_Full then
+               if is_open( Connection.Trace_Ada ) then
+                  Ada.Text_IO.Put_Line(Connection.Trace_Ada,"-- SQL PREPARED QUERY:");
+                  Ada.Text_IO.Put_Line(Connection.Trace_Ada,A_Query);
+                  Ada.Text_IO.Put_Line(Connection.Trace_Ada,";");
+               end if;
+            end if;
+         end if;
+
+         Index := Statement_Index(Connection,A_Query);
+         if Index = 0 then
+            if Connection.Statement_Count >= Max_Statements then
+               declare
+                  C_Deallocate : char_array := To_C("DEALLOCATE ALL");
+               begin
+                  Query.Result := PQexec(Conn,C_Deallocate'Address);
+                  Free(Query.Result);
+               end;
+               Clear_Statements(Connection);
+            end if;
+            declare
+               C_Query :   char_array := To_C(A_Query);
+               C_Name :    char_array := To_C(Statement_Name(Connection.Statement_Count+1));
+            begin
+               Query.Result := PQprepare(Conn,C_Name'Address,C_Query'Address,0,System.Null_Address);
+            end;
+            if Query.Result = Null_Result or else Result(Query) /= Command_OK then
+               raise SQL_Error;
+            end if;
+            Free(Query.Result);
+            Add_Statement(Connection,A_Query,Index);
+         end if;
+      end;
+
+      declare
+         -- The values are copied with their exact length.  libpq ends a
+         -- text parameter at its first NUL, so a value holding a NUL is
+         -- sent in binary format with its length instead.  For bytea that
+         -- is the raw bytes; other types reject the value on the server
+         -- rather than having it cut short.
+         type Int_Array is array(Positive range <>) of int;
+         type Address_Array is array(Positive range <>) of System.Address;
+         type Buffer_Array is array(Positive range <>) of char_array_access;
+         N :         Natural := Parameters(Query);
+         Buffers :   Buffer_Array(1..Natural'Max(N,1)) := (others => null);
+         Values :    Address_Array(1..Natural'Max(N,1)) := (others => System.Null_Address);
+         Lengths :   Int_Array(1..Natural'Max(N,1)) := (others => 0);
+         Formats :   Int_Array(1..Natural'Max(N,1)) := (others => 0);
+         C_Name :    char_array := To_C(Statement_Name(Index));
+      begin
+         for X in 1..N loop
+            if Query.Params(X) /= null then
+               Buffers(X) := new char_array'(To_C(Query.Params(X).all,Append_Nul => True));
+               Values(X) := Buffers(X).all'Address;
+               Lengths(X) := int(Query.Params(X).all'Length);
+               if Ada.Strings.Fixed.Index(Query.Params(X).all,(1 => Ada.Characters.Latin_1.NUL)) > 0 then
+                  Formats(X) := 1;
+               end if;
+            end if;
+         end loop;
+         if Query.Mode = Sequential_Fetch then
+            Start_Stream(Query,Conn,PQsendQueryPrepared(Conn,C_Name'Address,int(N),Values'Address,
+               Lengths'Address,Formats'Address,0) /= 0);
+         else
+            Query.Result := PQexecPrepared(Conn,C_Name'Address,int(N),Values'Address,
+               Lengths'Address,Formats'Address,0);
+         end if;
+         for X in Buffers'Range loop
+            Free(Buffers(X));
+         end loop;
+      end;
+
+      if Query.Result = Null_Result then
+         raise SQL_Error;
+      end if;
+      Query.Tuple_Index := First_Tuple_Index;
+      R := Result(Query);
+      if R /= Command_OK and R /= Tuples_OK and R /= Single_Tuple then
+         raise SQL_Error;
+      end if;
+
+   end Execute_Prepared;
+
+   -- Start a COPY ... FROM STDIN.  The rows are sent with Put_Copy_Data
+   -- or Put_Copy_File.  They are collected in a large buffer so that
+   -- PQputCopyData is called once per Copy_Buffer_Size characters.
+   -- Put_Copy_End finishes the copy.
+
+   procedure Copy_In(Query : in out Query_Type; Connection : in out Root_Connection_Type'Class) is
+      function PQexec(C : PG_Conn; Q : System.Address) return PQ_Result;
+      pragma Import(C,PQexec,"PQexec");
+      Conn : PG_Conn;
+   begin
+
+      if not Is_Connected(Connection) then
+         raise Not_Connected;
+      end if;
+
+      if In_Abort_State(Connection) then
+         raise Abort_State;
+      end if;
+
+      Abort_Copy(Query);
+      Free(Query.Result);
+      Drain_Stream(Query);
+      Conn := Internal_Connection(Connection_Type(Connection));
+
+      declare
+         A_Query :   String := To_String(Query);
+         C_Query :   char_array := To_C(A_Query);
+      begin
+         if Connection.Trace_On then
+            if Connection.Trace_Mode = Trace_APQ or Connection.Trace_Mode = Trace_Full then
+               if is_open( Connection.Trace_Ada ) then
+                  Ada.Text_IO.Put_Line(Connection.Trace_Ada,"-- SQL QUERY:");
+                  Ada.Text_IO.Put_Line(Connection.Trace_Ada,A_Query);
+                  Ada.Text_IO.Put_Line(Connection.Trace_Ada,";");
+               end if;
+            end if;
+         end if;
+         Query.Result := PQexec(Conn,C_Query'Address);
+      end;
+
+      if Query.Result = Null_Result or else Result(Query) /= Copy_In then
+         raise SQL_Error;
+      end if;
+      Query.Copy_Conn := Conn;
+      Query.Copy_Buffer := new String(1..Copy_Buffer_Size);
+      Query.Copy_Length := 0;
+   end Copy_In;
+
+   procedure Put_Copy_Data(Query : in out Query_Type; Data : String) is
+   begin
+      if Query.Copy_Conn = Null_Connection then
+         raise Failed;                 -- No COPY in progress
+      end if;
+      if Query.Copy_Length + Data'Length > Query.Copy_Buffer'Length then
+         Flush_Copy(Query);
+      end if;
+      if Data'Length > Query.Copy_Buffer'Length then
+         if PQputCopyData(Query.Copy_Conn,Data'Address,int(Data'Length)) /= 1 then
+            raise SQL_Error;
+         end if;
+      else
+         Query.Copy_Buffer(Query.Copy_Length+1..Query.Copy_Length+Data'Length) := Data;
+         Query.Copy_Length := Query.Copy_Length + Data'Length;
+      end if;
+   end Put_Copy_Data;
+
+   procedure Put_Copy_File(Query : in out Query_Type; Pathname : String) is
+      use Ada.Streams, Ada.Streams.Stream_IO;
+      F :         Ada.Streams.Stream_IO.File_Type;
+      Buffer :    Stream_Element_Array_Ptr;
+      Last :      Stream_Element_Offset;
+   begin
+      if Query.Copy_Conn = Null_Connection then
+         raise Failed;                 -- No COPY in progress
+      end if;
+      Flush_Copy(Query);
+      Open(F,In_File,Pathname);
+      Buffer := new Stream_Element_Array(1..Copy_Buffer_Size);
+      loop
+         Read(F,Buffer.all,Last);
+         exit when Last < Buffer'First;
+         if PQputCopyData(Query.Copy_Conn,Buffer.all'Address,int(Last)) /= 1 then
+            Close(F);
+            Free(Buffer);
+            raise SQL_Error;
+         end if;
+      end loop;
+      Close(F);
+      Free(Buffer);
+   end Put_Copy_File;
+
+   procedure Put_Copy_End(Query : in out Query_Type; Error : String := "") is
+   begin
+      if Query.Copy_Conn = Null_Connection then
+         raise Failed;                 -- No COPY in progress
+      end if;
+      begin
+         Flush_Copy(Query);
+      exception
+         when SQL_Error =>
+            End_Copy(Query,"copy data could not be sent");
+            raise;
+      end;
+      End_Copy(Query,Error);
+      if Query.Result = Null_Result or else Result(Query) /= Command_OK then
+         raise SQL_Error;
+      end if;
+   end Put_Copy_End;
+
+   function Is_Copying(Query : Query_Type) return Boolean is
+   begin
+      return Query.Copy_Conn /= Null_Connection;
+   end Is_Copying;
+
+   -- Run a COPY ... TO STDOUT and write the data to a file.  The rows are
+   -- gathered into a large buffer before writing.  The file is created
+   -- only once the server has accepted the COPY, and is deleted if the
+   -- COPY fails part way, so a failed export never looks like a good one.
+
+   procedure Copy_Out(Query : in out Query_Type; Connection : in out Root_Connection_Type'Class; Pathname : String) is
+      use Ada.Streams, Ada.Streams.Stream_IO;
+      function PQexec(C : PG_Conn; Q : System.Address) return PQ_Result;
+      pragma Import(C,PQexec,"PQexec");
+      function PQgetCopyData(C : PG_Conn; Buffer : System.Address; Async : int) return int;
+      pragma Import(C,PQgetCopyData,"PQgetCopyData");
+      procedure PQfreemem(Ptr : System.Address);
+      pragma Import(C,PQfreemem,"PQfreemem");
+      Conn :      PG_Conn;
+      F :         Ada.Streams.Stream_IO.File_Type;
+      Buffer :    Stream_Element_Array_Ptr;
+      Used :      Stream_Element_Offset := 0;
+      Row :       aliased System.Address;
+      Held :      Boolean := False;          -- Row must be freed
+      N :         int;
+      R :         PQ_Result;
+   begin
+
+      if not Is_Connected(Connection) then
+         raise Not_Connected;
+      end if;
+
+      if In_Abort_State(Connection) then
+         raise Abort_State;
+      end if;
+
+      Abort_Copy(Query);
+      Free(Query.Result);
+      Drain_Stream(Query);
+      Conn := Internal_Connection(Connection_Type(Connection));
+
+      declare
+         A_Query :   String := To_String(Query);
+         C_Query :   char_array := To_C(A_Query);
+      begin
+         if Connection.Trace_On then
+            if Connection.Trace_Mode = Trace_APQ or Connection.Trace_Mode = Trace_Full then
+               if is_open( Connection.Trace_Ada ) then
+                  Ada.Text_IO.Put_Line(Connection.Trace_Ada,"-- SQL QUERY:");
+                  Ada.Text_IO.Put_Line(Connection.Trace_Ada,A_Query);
+                  Ada.Text_IO.Put_Line(Connection.Trace_Ada,";");
+               end if;
+            end if;
+         end if;
+         Query.Result := PQexec(Conn,C_Query'Address);
+      end;
+
+      if Query.Result = Null_Result or else Result(Query) /= Copy_Out then
+         raise SQL_Error;
+      end if;
+
+      begin
+         Create(F,Out_File,Pathname);
+         Buffer := new Stream_Element_Array(1..Copy_Buffer_Size);
+         loop
+            N := PQgetCopyData(Conn,Row'Address,0);
+            exit when N < 0;             -- -1 at the end, -2 on an error
+            Held := True;
+            declare
+               Row_Data : Stream_Element_Array(1..Stream_Element_Offset(N));
+               for Row_Data'Address use Row;
+               pragma Import(Ada,Row_Data);
+            begin
+               if Used + Row_Data'Length > Buffer'Length then
+                  Write(F,Buffer(1..Used));
+                  Used := 0;
+               end if;
+               if Row_Data'Length > Buffer'Length then
+                  Write(F,Row_Data);
+               else
+                  Buffer(Used+1..Used+Row_Data'Length) := Row_Data;
+                  Used := Used + Row_Data'Length;
+               end if;
+            end;
+            PQfreemem(Row);
+            Held := False;
+         end loop;
+         if Used > 0 then
+            Write(F,Buffer(1..Used));
+         end if;
+         Free(Buffer);
+      exception when others =>
+         -- The file could not be written.  Read the rest of the COPY OUT
+         -- data so the connection can run another command, then let the
+         -- caller see the original error.
+         if Held then
+            PQfreemem(Row);
+         end if;
+         Free(Buffer);
+         if Is_Open(F) then
+            begin
+               Delete(F);
+            exception when others =>
+               null;
+            end;
+         end if;
+         loop
+            N := PQgetCopyData(Conn,Row'Address,0);
+            exit when N < 0;
+            PQfreemem(Row);
+         end loop;
+         loop
+            R := PQgetResult(Conn);
+            exit when R = Null_Result;
+            Free(R);
+         end loop;
+         raise;
+      end;
+
+      Free(Query.Result);
+      Query.Result := PQgetResult(Conn);
+      loop
+         exit when Query.Result = Null_Result;
+         R := PQgetResult(Conn);
+         exit when R = Null_Result;
+         Free(R);
+      end loop;
+      if Query.Result = Null_Result or else Result(Query) /= Command_OK then
+         -- the server stopped part way: the file holds only some rows
+         Delete(F);
+         raise SQL_Error;
+      end if;
+      Close(F);
+   end Copy_Out;
+
+   -- Send a query without waiting for the result.  The connection is busy
+   -- until Wait collects the result.
+
+   procedure Execute_Async(Query : in out Query_Type; Connection : in out Root_Connection_Type'Class) is
+      function PQsendQuery(C : PG_Conn; Q : System.Address) return int;
+      pragma Import(C,PQsendQuery,"PQsendQuery");
+      function PQmakeEmptyPGresult(C : PG_Conn; Status : Result_Type) return PQ_Result;
+      pragma Import(C,PQmakeEmptyPGresult,"PQmakeEmptyPGresult");
+   begin
+      if not Is_Connected(Connection) then
+         raise Not_Connected;
+      end if;
+
+      if In_Abort_State(Connection) then
+         raise Abort_State;
+      end if;
+
+      Abort_Copy(Query);
+      if Query.Result /= Null_Result then
+         Free(Query.Result);
+      end if;
+      Drain_Stream(Query);
+
+      declare
+         A_Query :   String := To_String(Query);
+         C_Query :   char_array := To_C(A_Query);
+         Conn :      PG_Conn := Internal_Connection(Connection_Type(Connection));
+      begin
+         if Connection.Trace_On then
+            if Connection.Trace_Mode = Trace_APQ or Connection.Trace_Mode = Trace_Full then
+               if is_open( Connection.Trace_Ada ) then
+                  Ada.Text_IO.Put_Line(Connection.Trace_Ada,"-- SQL QUERY (ASYNC):");
+                  Ada.Text_IO.Put_Line(Connection.Trace_Ada,A_Query);
+                  Ada.Text_IO.Put_Line(Connection.Trace_Ada,";");
+               end if;
+            end if;
+         end if;
+
+         if PQsendQuery(Conn,C_Query'Address) = 0 then
+            Query.Result := PQmakeEmptyPGresult(Conn,Fatal_Error);
+            raise SQL_Error;
+         end if;
+         Query.Stream_Conn := Conn;
+         Query.Async := True;
+      end;
+   end Execute_Async;
+
+   -- True if Wait would not block.  This reads whatever the server has sent
+   -- so far.
+
+   function Is_Ready(Query : Query_Type) return Boolean is
+      function PQconsumeInput(C : PG_Conn) return int;
+      pragma Import(C,PQconsumeInput,"PQconsumeInput");
+      function PQisBusy(C : PG_Conn) return int;
+      pragma Import(C,PQisBusy,"PQisBusy");
+   begin
+      if not Query.Async then
+         return True;
+      end if;
+      if PQconsumeInput(Query.Stream_Conn) = 0 then
+         return True;      -- the connection failed: Wait reports the error
+      end if;
+      return PQisBusy(Query.Stream_Conn) = 0;
+   end Is_Ready;
+
+   function Is_Async(Query : Query_Type) return Boolean is
+   begin
+      return Query.Async;
+   end Is_Async;
+
+   -- Collect the result of Execute_Async, blocking until it arrives.  As
+   -- with PQexec, the last result is kept when there are several.
+
+   procedure Wait(Query : in out Query_Type) is
+      R :      PQ_Result;
+      Status : Result_Type;
+   begin
+      if not Query.Async then
+         return;
+      end if;
+      loop
+         R := PQgetResult(Query.Stream_Conn);
+         exit when R = Null_Result;
+         if Query.Result /= Null_Result then
+            Free(Query.Result);
+         end if;
+         Query.Result := R;
+      end loop;
+      Query.Stream_Conn := Null_Connection;
+      Query.Async := False;
+      Query.Tuple_Index := First_Tuple_Index;
+      Query.Rewound := True;
+
+      if Query.Result = Null_Result then
+         raise SQL_Error;
+      end if;
+      Status := Status_Of(Query.Result);
+      if Status /= Command_OK and Status /= Tuples_OK then
+         raise SQL_Error;
+      end if;
+   end Wait;
+
+   -- Move the result of one query to another, so a result collected on
+   -- one connection can be read through another query.  The error
+   -- message is part of the result and moves with it.
+
+   procedure Take_Result(Query : in out Query_Type; From : in out Query_Type) is
+   begin
+      Abort_Copy(Query);
+      if Query.Result /= Null_Result then
+         Free(Query.Result);
+      end if;
+      Drain_Stream(Query);
+      Query.Result := From.Result;
+      Query.Tuple_Index := From.Tuple_Index;
+      Query.Rewound := From.Rewound;
+      Query.Mode := Random_Fetch;
+      From.Result := Null_Result;
+   end Take_Result;
+
    function Tuples(Q : Query_Type) return Tuple_Count_Type is
       use Interfaces.C;
       function PQntuples(R : PQ_Result) return int;
@@ -860,6 +1574,13 @@ package body APQ.PostgreSQL.Client is
       if Q.Result = Null_Result then
          raise No_Result;
       end if;
+      if Q.Mode = Sequential_Fetch then
+         -- The total is not known until the last row: count those fetched
+         if Q.Rewound then
+            return 0;
+         end if;
+         return Tuple_Count_Type(Q.Tuple_Index);
+      end if;
       return Tuple_Count_Type(PQntuples(Q.Result));
    end Tuples;
 
@@ -941,7 +1662,7 @@ package body APQ.PostgreSQL.Client is
       pragma Import(C,PQgetvalue,"PQgetvalue");
       function PQgetisnull(R : PQ_Result; tup_num, field_num : int) return int;
       pragma Import(C,PQgetisnull,"PQgetisnull");
-      C_TX :   int := int(Query.Tuple_Index) - 1;   -- Make zero based tuple #
+      C_TX :   int := Row_Number(Query);            -- Make zero based tuple #
       C_CX :   int := int(CX) - 1;              -- Field index
    begin
       if Query.Result = Null_Result then
@@ -970,7 +1691,7 @@ package body APQ.PostgreSQL.Client is
       use Interfaces.C.Strings;
       function PQgetisnull(R : PQ_Result; tup_num, field_num : int) return int;
       pragma Import(C,PQgetisnull,"PQgetisnull");
-      C_TX :   int := int(Q.Tuple_Index) - 1;      -- Make zero based tuple #
+      C_TX :   int := Row_Number(Q);               -- Make zero based tuple #
       C_CX :   int := int(CX) - 1;                 -- Field index
    begin
       if Q.Result = Null_Result then
@@ -982,14 +1703,57 @@ package body APQ.PostgreSQL.Client is
       return PQgetisnull(Q.Result,C_TX,C_CX) /= 0;
    end Is_Null;
 
+   procedure Set_Fetch_Mode(Q : in out Query_Type; Mode : Fetch_Mode_Type) is
+   begin
+      -- Results of the old mode cannot be read in the new one
+      Free(Q.Result);
+      Drain_Stream(Q);
+      Q.Tuple_Index := First_Tuple_Index;
+      Q.Rewound := True;
+      Set_Fetch_Mode(Root_Query_Type(Q),Mode);
+   end Set_Fetch_Mode;
+
    procedure Rewind(Q : in out Query_Type) is
    begin
+      if Q.Mode = Sequential_Fetch and then not Q.Rewound then
+         raise No_Tuple;      -- rows already read are gone
+      end if;
       Q.Rewound := True;
       Q.Tuple_Index := First_Tuple_Index;
    end Rewind;
 
    procedure Fetch(Q : in out Query_Type) is
    begin
+      if Q.Mode = Sequential_Fetch then
+         if Q.Result = Null_Result then
+            raise No_Result;
+         end if;
+         if Q.Rewound then
+            Q.Rewound := False;
+            if Status_Of(Q.Result) /= Single_Tuple then
+               raise No_Tuple;
+            end if;
+            return;
+         end if;
+         if Q.Next_Result = Null_Result then
+            raise No_Tuple;
+         end if;
+         Free(Q.Result);
+         Q.Result := Q.Next_Result;
+         Q.Next_Result := Null_Result;
+         case Status_Of(Q.Result) is
+         when Single_Tuple =>
+            Q.Tuple_Index := Q.Tuple_Index + 1;
+            if Q.Stream_Conn /= Null_Connection then
+               Read_Ahead(Q);
+            end if;
+         when Tuples_OK =>
+            raise No_Tuple;
+         when others =>
+            raise SQL_Error;
+         end case;
+         return;
+      end if;
       if not Q.Rewound then
          Q.Tuple_Index := Q.Tuple_Index + 1;
       else
@@ -1001,6 +1765,15 @@ package body APQ.PostgreSQL.Client is
    procedure Fetch(Q : in out Query_Type; TX : Tuple_Index_Type) is
       NT : Tuple_Count_Type := Tuples(Q); -- May raise No_Result
    begin
+      if Q.Mode = Sequential_Fetch then
+         -- Only the next row can be fetched
+         if ( Q.Rewound and TX = First_Tuple_Index ) or else
+            ( not Q.Rewound and TX = Q.Tuple_Index + 1 ) then
+            Fetch(Q);
+            return;
+         end if;
+         raise No_Tuple;
+      end if;
       if NT < 1 then
          raise No_Tuple;
       end if;
@@ -1023,6 +1796,14 @@ package body APQ.PostgreSQL.Client is
    function End_of_Query(Q : Query_Type) return Boolean is
       NT : Tuple_Count_Type := Tuples(Q); -- May raise No_Result
    begin
+      if Q.Mode = Sequential_Fetch then
+         if Q.Rewound then
+            return Status_Of(Q.Result) /= Single_Tuple;
+         end if;
+         -- An error is not the end: the next Fetch will report it
+         return Q.Next_Result = Null_Result or else Status_Of(Q.Next_Result) = Tuples_OK;
+      end if;
+
       if NT < 1 then
          return True;      -- There are no tuples to return
       end if;
@@ -1518,7 +2299,9 @@ package body APQ.PostgreSQL.Client is
 
    procedure Clear(Q : in out Query_Type) is
    begin
+      Abort_Copy(Q);
       Free(Q.Result);
+      Drain_Stream(Q);
       Clear(Root_Query_Type(Q));
    end Clear;
 
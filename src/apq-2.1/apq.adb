@@ -239,6 +239,7 @@ package body APQ is
       Q.Count := 0;
       Q.Tuple_Index := Tuple_Index_Type'First;
       Q.Rewound := True;
+      Clear_Parameters(Q);
    end Clear;
 
    function Fetch_Mode(Q : Root_Query_Type) return Fetch_Mode_Type is
@@ -330,6 +331,8 @@ package body APQ is
       Q.Alloc := 0;
       Q.Collection := null;
       Q.Tuple_Index := Tuple_Index_Type'First;
+      Q.Params := null;
+      Q.Param_Count := 0;
    end Adjust;
 
    function To_String(Query : Root_Query_Type) return String is
@@ -495,6 +498,94 @@ package body APQ is
       raise Is_Abstract;
    end Execute_Checked;
 
+   -- Parameter values for Execute_Prepared.  A parameter that is never
+   -- bound, or bound with Bind_Null, is NULL.
+
+   procedure Bind_Slot(Q : in out Root_Query_Type; PX : Positive) is
+   begin
+      if Q.Params = null then
+         Q.Params := new String_Ptr_Array(1..Positive'Max(PX,16));
+      elsif PX > Q.Params'Last then
+         declare
+            New_Array : String_Ptr_Array_Access := new String_Ptr_Array(1..PX+16);
+         begin
+            New_Array(1..Q.Params'Last) := Q.Params.all;
+            Free(Q.Params);
+            Q.Params := New_Array;
+         end;
+      end if;
+      Free_Ptr(Q.Params(PX));
+      if PX > Q.Param_Count then
+         Q.Param_Count := PX;
+      end if;
+   end Bind_Slot;
+
+   procedure Bind(Q : in out Root_Query_Type; PX : Positive; Value : String) is
+   begin
+      Bind_Slot(Q,PX);
+      Q.Params(PX) := new String'(Value);
+   end Bind;
+
+   procedure Bind_Null(Q : in out Root_Query_Type; PX : Positive) is
+   begin
+      Bind_Slot(Q,PX);
+   end Bind_Null;
+
+   function Parameters(Q : Root_Query_Type) return Natural is
+   begin
+      return Q.Param_Count;
+   end Parameters;
+
+   procedure Clear_Parameters(Q : in out Root_Query_Type) is
+   begin
+      if Q.Params /= null then
+         for X in Q.Params'Range loop
+            Free_Ptr(Q.Params(X));
+         end loop;
+         Free(Q.Params);
+      end if;
+      Q.Param_Count := 0;
+   end Clear_Parameters;
+
+   procedure Execute_Prepared(Query : in out Root_Query_Type; Connection : in out Root_Connection_Type'Class) is
+   begin
+      raise Is_Abstract;
+   end Execute_Prepared;
+
+   -- The prepared statement cache.  Statements are found by their SQL
+   -- text; the index names the statement on the server.
+
+   function Statement_Index(C : Root_Connection_Type; SQL : String) return Natural is
+   begin
+      for X in 1..C.Statement_Count loop
+         if C.Statements(X).all = SQL then
+            return X;
+         end if;
+      end loop;
+      return 0;
+   end Statement_Index;
+
+   procedure Add_Statement(C : in out Root_Connection_Type; SQL : String; Index : out Positive) is
+   begin
+      if C.Statements = null then
+         C.Statements := new String_Ptr_Array(1..Max_Statements);
+      end if;
+      C.Statement_Count := C.Statement_Count + 1;    -- caller clears a full cache
+      C.Statements(C.Statement_Count) := new String'(SQL);
+      Index := C.Statement_Count;
+   end Add_Statement;
+
+   procedure Clear_Statements(C : in out Root_Connection_Type) is
+   begin
+      if C.Statements /= null then
+         for X in 1..C.Statement_Count loop
+            Free_Ptr(C.Statements(X));
+         end loop;
+         Free(C.Statements);
+      end if;
+      C.Statement_Count := 0;
+   end Clear_Statements;
+
    procedure Begin_Work(Query : in out Root_Query_Type; Connection : in out Root_Connection_Type'Class) is
    begin
       raise Is_Abstract;
@@ -29,6 +29,7 @@
 #include <mysql.h>
 #include <errmsg.h>
 #include <string.h>
+#include <stdlib.h>
 
 #define IS_OK(z) (!(z) ? 1 : 0)
 
@@ -344,4 +345,77 @@ c_mysql_real_escape_string(MYSQL *mysql,char *to,const char *from,unsigned long
 	return mysql_real_escape_string(mysql,to,from,length);
 }
 
+/*
+ * Prepared statements.  The statement is always returned (unless out
+ * of memory) so that the caller can read a prepare error from it.
+ */
+EXPORT MYSQL_STMT *
+c_mysql_stmt_prepare(MYSQL *mysql,const char *query) {
+	MYSQL_STMT *stmt = mysql_stmt_init(mysql);
+
+	if ( stmt )
+		mysql_stmt_prepare(stmt,query,strlen(query));
+	return stmt;
+}
+
+/*
+ * Bind count string values (a NULL pointer is an SQL NULL) and execute.
+ * Parameters not given a value are NULL.  Returns zero on success.
+ */
+EXPORT int
+c_mysql_stmt_execute(MYSQL_STMT *stmt,unsigned count,char **values,unsigned long *lengths) {
+	unsigned long params = mysql_stmt_param_count(stmt);
+	MYSQL_BIND *bind = 0;
+	unsigned long x;
+	int rc;
+
+	if ( params > 0 ) {
+		bind = (MYSQL_BIND *) calloc(params,sizeof *bind);
+		if ( !bind )
+			return 1;
+		for ( x=0; x<params; ++x ) {
+			if ( x >= count || !values[x] ) {
+				bind[x].buffer_type = MYSQL_TYPE_NULL;
+			} else	{
+				bind[x].buffer_type = MYSQL_TYPE_STRING;
+				bind[x].buffer = values[x];
+				bind[x].buffer_length = lengths[x];
+				bind[x].length = &lengths[x];
+			}
+		}
+		if ( mysql_stmt_bind_param(stmt,bind) ) {
+			free(bind);
+			return 1;
+		}
+	}
+	rc = mysql_stmt_execute(stmt);
+	free(bind);
+	return rc;
+}
+
+EXPORT unsigned
+c_mysql_stmt_errno(MYSQL_STMT *stmt) {
+	return mysql_stmt_errno(stmt);
+}
+
+EXPORT const char *
+c_mysql_stmt_error(MYSQL_STMT *stmt) {
+	return mysql_stmt_error(stmt);
+}
+
+EXPORT unsigned
+c_mysql_stmt_field_count(MYSQL_STMT *stmt) {
+	return mysql_stmt_field_count(stmt);
+}
+
+EXPORT my_ulonglong
+c_mysql_stmt_insert_id(MYSQL_STMT *stmt) {
+	return mysql_stmt_insert_id(stmt);
+}
+
+EXPORT void
+c_mysql_stmt_close(MYSQL_STMT *stmt) {
+	mysql_stmt_close(stmt);
+}
+
 /* End $Source: /home/cvsroot/bush/src/apq-2.1/c_mysql.c,v $ */
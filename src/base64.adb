@@ -220,4 +220,238 @@ package body Base64 is
     end loop;
   end Decode_Stream;
 
+  ----------------------------------------------------------------------
+  -- Table-driven block routines
+  ----------------------------------------------------------------------
+
+  use type Interfaces.Unsigned_32;
+
+  subtype Twelve_Bits is Interfaces.Unsigned_32 range 0 .. 4095;
+
+  type Pair_Array is array (Twelve_Bits) of String(1 .. 2);
+
+  function Make_Pair_Table return Pair_Array is
+  -- The two characters for every 12-bit value, so that a 3-octet group
+  -- is encoded with two lookups.
+    Table : Pair_Array;
+  begin
+    for I in Table'range loop
+      Table(I) := To_String(Six_Bits(I / 64)) & To_String(Six_Bits(I mod 64));
+    end loop;
+    return Table;
+  end Make_Pair_Table;
+
+  Pair_Table : constant Pair_Array := Make_Pair_Table;
+
+  function Octet(C : Character) return Interfaces.Unsigned_32 is
+  begin
+    return Character'pos(C);
+  end Octet;
+  pragma Inline(Octet);
+
+  Bad_Bits : constant Interfaces.Unsigned_32 := 16#8000_0000#;
+  -- Set in a decode table entry for a character not in the alphabet
+
+  type Decode_Array is array (Character) of Interfaces.Unsigned_32;
+
+  function Make_Decode_Table(Shift : Natural) return Decode_Array is
+  -- The value of each character shifted to its position in a 4-character
+  -- group, so that a group is decoded by or'ing four lookups.
+    Table : Decode_Array := (others => Bad_Bits);
+  begin
+    for I in To_String'range loop
+      Table(To_String(I)) := Interfaces.Shift_Left(Interfaces.Unsigned_32(I), Shift);
+    end loop;
+    return Table;
+  end Make_Decode_Table;
+
+  Decode_0 : constant Decode_Array := Make_Decode_Table(18);
+  Decode_1 : constant Decode_Array := Make_Decode_Table(12);
+  Decode_2 : constant Decode_Array := Make_Decode_Table(6);
+  Decode_3 : constant Decode_Array := Make_Decode_Table(0);
+
+  function Encoded_Length(Length      : Natural;
+                          Line_Breaks : Boolean := False) return Natural is
+    Chars : constant Natural := 4 * ((Length + 2) / 3);
+  begin
+    if Line_Breaks then
+      return Chars + (Chars + Characters_Per_Line - 1) / Characters_Per_Line;
+    end if;
+    return Chars;
+  end Encoded_Length;
+
+  procedure Encode_Block(Source      : in     String;
+                         Target      :    out String;
+                         Last        :    out Natural;
+                         Line_Breaks : in     Boolean := False) is
+    Tail      : constant Natural := Source'length mod 3;
+    Full_End  : constant Integer := Source'last - Tail + 1;
+    -- one past the last complete 3-octet group
+    Si        : Integer := Source'first;
+    Line_Start: Integer;
+    Line_End  : Integer;
+    W         : Interfaces.Unsigned_32;
+
+    procedure Encode_Group(I : Integer) is
+    begin
+      W := Interfaces.Shift_Left(Octet(Source(I)), 16) or
+           Interfaces.Shift_Left(Octet(Source(I + 1)), 8) or
+           Octet(Source(I + 2));
+      Target(Last + 1 .. Last + 2) := Pair_Table(Interfaces.Shift_Right(W, 12));
+      Target(Last + 3 .. Last + 4) := Pair_Table(W and 16#FFF#);
+      Last := Last + 4;
+    end Encode_Group;
+    pragma Inline(Encode_Group);
+
+  begin
+    Last := Target'first - 1;
+    while Si < Full_End loop
+      Line_Start := Si;
+      if Line_Breaks then
+        Line_End := Integer'min(Si + Octets_Per_Line, Full_End);
+      else
+        Line_End := Full_End;
+      end if;
+      -- two groups per pass
+      while Si + 6 <= Line_End loop
+        Encode_Group(Si);
+        Encode_Group(Si + 3);
+        Si := Si + 6;
+      end loop;
+      if Si < Line_End then
+        Encode_Group(Si);
+        Si := Si + 3;
+      end if;
+      if Line_Breaks and then
+         (Si - Line_Start = Octets_Per_Line or else Tail = 0) then
+        Last := Last + 1;
+        Target(Last) := Ascii.Lf;
+      end if;
+    end loop;
+    if Tail > 0 then
+      W := Interfaces.Shift_Left(Octet(Source(Si)), 16);
+      if Tail = 2 then
+        W := W or Interfaces.Shift_Left(Octet(Source(Si + 1)), 8);
+      end if;
+      Target(Last + 1 .. Last + 2) := Pair_Table(Interfaces.Shift_Right(W, 12));
+      if Tail = 2 then
+        Target(Last + 3) := To_String(Six_Bits(Interfaces.Shift_Right(W, 6) and 63));
+      else
+        Target(Last + 3) := '=';
+      end if;
+      Target(Last + 4) := '=';
+      Last := Last + 4;
+      if Line_Breaks then
+        Last := Last + 1;
+        Target(Last) := Ascii.Lf;
+      end if;
+    end if;
+  end Encode_Block;
+
+  function Encode_String(Source : String) return String is
+    Result : String(1 .. Encoded_Length(Source'length));
+    Last   : Natural;
+  begin
+    Encode_Block(Source, Result, Last);
+    return Result;
+  end Encode_String;
+
+  function Decoded_Length(Length : Natural) return Natural is
+  begin
+    return 3 * ((Length + 3) / 4);
+  end Decoded_Length;
+
+  procedure Decode_Block(State   : in out Decoder_State;
+                         Source  : in     String;
+                         Target  :    out String;
+                         Last    :    out Natural) is
+    Si     : Integer := Source'first;
+    W1, W2 : Interfaces.Unsigned_32;
+    V      : Interfaces.Unsigned_32;
+
+    procedure Put_Group(W : Interfaces.Unsigned_32) is
+    begin
+      Target(Last + 1) := Character'val(Interfaces.Shift_Right(W, 16) and 255);
+      Target(Last + 2) := Character'val(Interfaces.Shift_Right(W, 8) and 255);
+      Target(Last + 3) := Character'val(W and 255);
+      Last := Last + 3;
+    end Put_Group;
+    pragma Inline(Put_Group);
+
+  begin
+    Last := Target'first - 1;
+    if State.Done then
+      return;
+    end if;
+    while Si <= Source'last loop
+      if State.Count = 0 then
+        -- Whole groups of valid characters, two groups per pass.  A bad
+        -- character in either group leaves them to the character loop.
+        while Si + 7 <= Source'last loop
+          W1 := Decode_0(Source(Si))     or Decode_1(Source(Si + 1)) or
+                Decode_2(Source(Si + 2)) or Decode_3(Source(Si + 3));
+          W2 := Decode_0(Source(Si + 4)) or Decode_1(Source(Si + 5)) or
+                Decode_2(Source(Si + 6)) or Decode_3(Source(Si + 7));
+          exit when ((W1 or W2) and Bad_Bits) /= 0;
+          Put_Group(W1);
+          Put_Group(W2);
+          Si := Si + 8;
+        end loop;
+        while Si + 3 <= Source'last loop
+          W1 := Decode_0(Source(Si))     or Decode_1(Source(Si + 1)) or
+                Decode_2(Source(Si + 2)) or Decode_3(Source(Si + 3));
+          exit when (W1 and Bad_Bits) /= 0;
+          Put_Group(W1);
+          Si := Si + 4;
+        end loop;
+        exit when Si > Source'last;
+      end if;
+      -- one character at a time
+      V := Decode_3(Source(Si));
+      if (V and Bad_Bits) = 0 then
+        State.Bits := Interfaces.Shift_Left(State.Bits, 6) or V;
+        State.Count := State.Count + 1;
+        if State.Count = 4 then
+          Put_Group(State.Bits);
+          State.Bits := 0;
+          State.Count := 0;
+        end if;
+      elsif Source(Si) = '=' then
+        State.Done := True;
+        exit; -- terminator encountered
+      end if; -- silently ignore whitespace, lf, garbage, ...
+      Si := Si + 1;
+    end loop;
+  end Decode_Block;
+
+  procedure Decode_Finish(State   : in out Decoder_State;
+                          Target  :    out String;
+                          Last    :    out Natural) is
+  begin
+    Last := Target'first - 1;
+    case State.Count is
+      when 2 =>    -- dddddd dd....
+        Last := Last + 1;
+        Target(Last) := Character'val(Interfaces.Shift_Right(State.Bits, 4) and 255);
+      when 3 =>    -- dddddd dddddd dddd..
+        Last := Last + 2;
+        Target(Last - 1) := Character'val(Interfaces.Shift_Right(State.Bits, 10) and 255);
+        Target(Last) := Character'val(Interfaces.Shift_Right(State.Bits, 2) and 255);
+      when others => -- a single character is not a whole octet
+        null;
+    end case;
+    State := (Bits => 0, Count => 0, Done => False);
+  end Decode_Finish;
+
+  function Decode_String(Source : String) return String is
+    State  : Decoder_State;
+    Result : String(1 .. Decoded_Length(Source'length));
+    Last   : Natural;
+    Extra  : Natural;
+  begin
+    Decode_Block(State, Source, Result, Last);
+    Decode_Finish(State, Result(Last + 1 .. Result'last), Extra);
+    return Result(1 .. Extra);
+  end Decode_String;
+
 end Base64;
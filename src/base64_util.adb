@@ -0,0 +1,208 @@
+------------------------------------------------------------------------------
+-- BASE64 UTIL                                                              --
+--                                                                          --
+-- Part of SparForte                                                        --
+-- Designed and Programmed by Ken O. Burtch                                 --
+------------------------------------------------------------------------------
+--                                                                          --
+--            Copyright (C) 2001-2020 Free Software Foundation              --
+--                                                                          --
+-- This is free software;  you can  redistribute it  and/or modify it under --
+-- terms of the  GNU General Public License as published  by the Free Soft- --
+-- ware  Foundation;  either version 2,  or (at your option) any later ver- --
+-- sion.  This is distributed in the hope that it will be useful, but WITH- --
+-- OUT ANY WARRANTY;  without even the  implied warranty of MERCHANTABILITY --
+-- or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License --
+-- for  more details.  You should have  received  a copy of the GNU General --
+-- Public License  distributed with this;  see file COPYING.  If not, write --
+-- to  the Free Software Foundation,  59 Temple Place - Suite 330,  Boston, --
+-- MA 02111-1307, USA.                                                      --
+--                                                                          --
+-- This is maintained at http://www.sparforte.com                           --
+--                                                                          --
+------------------------------------------------------------------------------
+
+with interfaces.c,
+     spar_os,
+     base64;
+use  interfaces.c,
+     spar_os,
+     base64;
+
+package body base64_util is
+
+encodeBlockSize : constant := Octets_Per_Line * 1024;
+-- the amount of a file encoded at one time.  Must be a multiple of the
+-- line length so lines are not broken between blocks.
+
+decodeBlockSize : constant := 65536;
+-- the amount of a file decoded at one time
+
+-- Strings are converted a block at a time, the same as files, so that a
+-- large value is not copied to the stack.
+
+procedure ToBase64( s : unbounded_string; result : out unbounded_string ) is
+  len     : constant natural := length( s );
+  outBuf  : string( 1..Encoded_Length( encodeBlockSize ) );
+  first   : positive := 1;
+  last    : natural;
+  outLast : natural;
+begin
+  result := null_unbounded_string;
+  while first <= len loop
+     last := natural'min( first + encodeBlockSize - 1, len );
+     Encode_Block( slice( s, first, last ), outBuf, outLast );
+     append( result, outBuf( 1..outLast ) );
+     first := last + 1;
+  end loop;
+end ToBase64;
+
+procedure FromBase64( s : unbounded_string; result : out unbounded_string ) is
+  len     : constant natural := length( s );
+  outBuf  : string( 1..Decoded_Length( decodeBlockSize ) + 2 );
+  state   : Decoder_State;
+  first   : positive := 1;
+  last    : natural;
+  outLast : natural;
+begin
+  result := null_unbounded_string;
+  while first <= len and not state.Done loop
+     last := natural'min( first + decodeBlockSize - 1, len );
+     Decode_Block( state, slice( s, first, last ), outBuf, outLast );
+     append( result, outBuf( 1..outLast ) );
+     first := last + 1;
+  end loop;
+  Decode_Finish( state, outBuf, outLast );
+  append( result, outBuf( 1..outLast ) );
+end FromBase64;
+
+-- Read until the buffer is full or the end of the file is reached.
+
+procedure readBlock( fd : aFileDescriptor; buffer : in out string;
+  last : out natural; errno : out integer ) is
+  amountRead : size_t;
+begin
+  last := buffer'first - 1;
+  errno := 0;
+  while last < buffer'last loop
+<<reread>>
+     read( amountRead, fd, buffer( last+1 )'address, size_t( buffer'last - last ) );
+     exit when amountRead = 0;
+     -- KB: 2012/02/15: see spar_os-tty for an explaination of this kludge
+     if amountRead not in 0..size_t'last-1 then
+        if C_errno = EAGAIN or C_errno = EINTR then
+           goto reread;
+        end if;
+        errno := C_errno;
+        return;
+     end if;
+     last := last + integer( amountRead );
+  end loop;
+end readBlock;
+
+-- Write all of the buffer.
+
+procedure writeBlock( fd : aFileDescriptor; buffer : string;
+  errno : out integer ) is
+  amountWritten : size_t;
+  first : natural := buffer'first;
+begin
+  errno := 0;
+  while first <= buffer'last loop
+<<rewrite>>
+     write( amountWritten, fd, buffer( first )'address, size_t( buffer'last - first + 1 ) );
+     if amountWritten not in 0..size_t'last-1 then
+        if C_errno = EAGAIN or C_errno = EINTR then
+           goto rewrite;
+        end if;
+        errno := C_errno;
+        return;
+     end if;
+     first := first + integer( amountWritten );
+  end loop;
+end writeBlock;
+
+-- Open the source and target files.  On an error, both are closed.
+
+procedure openFiles( fromPath, toPath : string; fromFd, toFd : out aFileDescriptor;
+  errno : out integer ) is
+  closeResult : int;
+begin
+  errno := 0;
+  toFd := -1;
+  fromFd := open( fromPath & ASCII.NUL, O_RDONLY, 8#644# );
+  if fromFd < 0 then
+     errno := C_errno;
+     return;
+  end if;
+  toFd := open( toPath & ASCII.NUL, O_WRONLY+O_TRUNC+O_CREAT, 8#644# );
+  if toFd < 0 then
+     errno := C_errno;
+     closeResult := close( fromFd );
+  end if;
+end openFiles;
+
+procedure closeFiles( fromFd, toFd : aFileDescriptor; errno : in out integer ) is
+  closeResult : int;
+begin
+  closeResult := close( fromFd );
+  -- close EINTR is a diagnostic message.  Do not handle.
+  closeResult := close( toFd );
+  if closeResult < 0 and errno = 0 then
+     -- for the target file, a close error may be a failed write
+     if C_errno /= EINTR then
+        errno := C_errno;
+     end if;
+  end if;
+end closeFiles;
+
+procedure EncodeBase64File( fromPath, toPath : string; errno : out integer ) is
+  fromFd  : aFileDescriptor;
+  toFd    : aFileDescriptor;
+  inBuf   : string( 1..encodeBlockSize );
+  outBuf  : string( 1..Encoded_Length( encodeBlockSize, line_breaks => true ) );
+  inLast  : natural;
+  outLast : natural;
+begin
+  openFiles( fromPath, toPath, fromFd, toFd, errno );
+  if errno /= 0 then
+     return;
+  end if;
+  loop
+     readBlock( fromFd, inBuf, inLast, errno );
+     exit when errno /= 0 or inLast = 0;
+     Encode_Block( inBuf( 1..inLast ), outBuf, outLast, line_breaks => true );
+     writeBlock( toFd, outBuf( 1..outLast ), errno );
+     exit when errno /= 0 or inLast < inBuf'last;
+  end loop;
+  closeFiles( fromFd, toFd, errno );
+end EncodeBase64File;
+
+procedure DecodeBase64File( fromPath, toPath : string; errno : out integer ) is
+  fromFd  : aFileDescriptor;
+  toFd    : aFileDescriptor;
+  inBuf   : string( 1..decodeBlockSize );
+  outBuf  : string( 1..Decoded_Length( decodeBlockSize ) + 2 );
+  state   : Decoder_State;
+  inLast  : natural;
+  outLast : natural;
+begin
+  openFiles( fromPath, toPath, fromFd, toFd, errno );
+  if errno /= 0 then
+     return;
+  end if;
+  loop
+     readBlock( fromFd, inBuf, inLast, errno );
+     exit when errno /= 0 or inLast = 0;
+     Decode_Block( state, inBuf( 1..inLast ), outBuf, outLast );
+     writeBlock( toFd, outBuf( 1..outLast ), errno );
+     exit when errno /= 0 or inLast < inBuf'last or state.Done;
+  end loop;
+  if errno = 0 then
+     Decode_Finish( state, outBuf, outLast );
+     writeBlock( toFd, outBuf( 1..outLast ), errno );
+  end if;
+  closeFiles( fromFd, toFd, errno );
+end DecodeBase64File;
+
+end base64_util;
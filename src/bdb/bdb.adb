@@ -15,15 +15,23 @@ package body bdb is
 -- Like Interfaces.C.To_Ada except doesn't use ASCII.NUL as end of string
 ------------------------------------------------------------------------------
 
+-- This version converts a slice of the buffer starting at first.  The
+-- slice is converted in one call, as bulk gets return many of them.
+
+function to_unbounded_string( buffer : char_array; first, buffer_len : size_t ) return unbounded_string is
+begin
+  if buffer_len = 0 then
+     return null_unbounded_string;
+  end if;
+  return to_unbounded_string( Interfaces.C.To_Ada(
+     buffer( first..first + buffer_len - 1 ), Trim_Nul => false ) );
+end to_unbounded_string;
+
+-- This version converts the first buffer_len characters.
+
 function to_unbounded_string( buffer : char_array; buffer_len : size_t ) return unbounded_string is
-  i : interfaces.C.size_t := 0;
-  s : unbounded_string;
 begin
-    while i < buffer_len loop
-      s := s & Interfaces.C.To_Ada( buffer(i) );
-      i := i + 1;
-    end loop;
-  return s;
+  return to_unbounded_string( buffer, 0, buffer_len );
 end to_unbounded_string;
 
 -- TO CHAR ARRAY
@@ -180,6 +188,19 @@ end to_char_array;
     flags : key_range_flags );
   pragma import( C, C_key_range, "C_key_range" );
 
+  procedure C_db_perf_stats( db_err : in out db_error;
+    dbh : db_handle;
+    txn : db_transaction;
+    stats : in out berkeley_stats );
+  pragma import( C, C_db_perf_stats, "C_db_perf_stats" );
+
+  procedure C_db_compact( db_err : in out db_error;
+    dbh : db_handle;
+    txn : db_transaction;
+    pages_free, pages_truncated : system.address;
+    flags : compact_flags );
+  pragma import( C, C_db_compact, "C_db_compact" );
+
 procedure C_db_cursor( db_err : in out db_error; dbh : db_handle;
   txn : db_transaction; cursor : in out db_cursor; flags : cursor_flags );
 pragma import( C, C_db_cursor, "C_db_cursor" );
@@ -193,6 +214,30 @@ pragma import( C, C_db_cursor, "C_db_cursor" );
                       flags : c_get_flags );
   pragma import( C, C_dbc_c_get, "C_dbc_c_get" );
 
+  procedure C_dbc_c_get_multiple_key( err : in out db_error;
+                      dbc    : db_cursor;
+                      key    : system.address;
+                      key_length : interfaces.C.size_t;
+                      buffer : system.address;
+                      buffer_size : interfaces.C.size_t;
+                      needed : in out interfaces.C.size_t;
+                      flags : c_get_flags );
+  pragma import( C, C_dbc_c_get_multiple_key, "C_dbc_c_get_multiple_key" );
+
+  procedure C_multiple_key_init( pointer : in out system.address;
+                      buffer : system.address;
+                      buffer_size : interfaces.C.size_t );
+  pragma import( C, C_multiple_key_init, "C_multiple_key_init" );
+
+  procedure C_multiple_key_next( found : in out interfaces.C.int;
+                      pointer : in out system.address;
+                      buffer : system.address;
+                      key_offset : in out interfaces.C.size_t;
+                      key_length : in out interfaces.C.size_t;
+                      data_offset : in out interfaces.C.size_t;
+                      data_length : in out interfaces.C.size_t );
+  pragma import( C, C_multiple_key_next, "C_multiple_key_next" );
+
   procedure C_dbc_c_close( err : in out db_error; cursor : db_cursor );
   pragma import( C, C_dbc_c_close, "C_dbc_c_close" );
 
@@ -845,6 +890,28 @@ begin
   greater := long_float( c_greater );
 end key_range;
 
+procedure stat( session : in out berkeley_session; stats : out berkeley_stats ) is
+  c_stats : berkeley_stats;
+begin
+  C_db_perf_stats( session.err, session.dbh, session.txn, c_stats );
+  if session.will_raise and then session.err /= DB_OK then
+     raise_error( gnat.source_info.source_location, session );
+  end if;
+  stats := c_stats;
+end stat;
+
+procedure compact( session : in out berkeley_session; pages_freed, pages_truncated : out long_float; flags : compact_flags := DB_COMPACT_FREE_SPACE ) is
+   c_free, c_truncated : interfaces.C.double := 0.0;
+begin
+  C_db_compact( session.err, session.dbh, session.txn,
+    c_free'address, c_truncated'address, flags );
+  if session.will_raise and then session.err /= DB_OK then
+     raise_error( gnat.source_info.source_location, session );
+  end if;
+  pages_freed     := long_float( c_free );
+  pages_truncated := long_float( c_truncated );
+end compact;
+
 
 ------------------------------------------------------------------------------
 --
@@ -887,6 +954,110 @@ begin
   data := to_unbounded_string( session.data_buffer.all, session.data_length );
 end get;
 
+-- NEW BERKELEY BULK BUFFER
+--
+-- Allocate a buffer for bulk gets.  Berkeley DB requires a multiple of 1024
+-- bytes, so the size is rounded up.
+------------------------------------------------------------------------------
+
+procedure new_berkeley_bulk_buffer( bulk : out berkeley_bulk_buffer; size : size_t ) is
+  rounded : constant size_t := ( ( size + 1023 ) / 1024 ) * 1024;
+begin
+  bulk.size := size_t'max( rounded, 1024 );
+  bulk.buffer := new char_array( 0 .. bulk.size-1 );
+  bulk.pointer := system.null_address;
+end new_berkeley_bulk_buffer;
+
+
+-- FREE BERKELEY BULK BUFFER
+--
+-- Release memory allocated by new berkeley bulk buffer.
+------------------------------------------------------------------------------
+
+procedure free_berkeley_bulk_buffer( bulk : in out berkeley_bulk_buffer ) is
+  use char_array_ptr_Conv;
+begin
+  if bulk.buffer /= null then
+     free( bulk.buffer );
+  end if;
+  bulk.size := 0;
+  bulk.pointer := system.null_address;
+end free_berkeley_bulk_buffer;
+
+function bulk_buffer_size( bulk : berkeley_bulk_buffer ) return size_t is
+begin
+  return bulk.size;
+end bulk_buffer_size;
+
+
+-- GET MULTIPLE KEY (CURSOR)
+--
+-- Fill the bulk buffer with the key/data pairs from the cursor position (or
+-- the position specified in the flags).  If a single pair is too big for
+-- the buffer, the buffer is grown to fit it.
+------------------------------------------------------------------------------
+
+procedure get_multiple_key( session : in out berkeley_session;
+  cursor : in out berkeley_cursor; key : string;
+  bulk : in out berkeley_bulk_buffer; flags : c_get_flags := DB_C_GET_NEXT ) is
+  needed : size_t := 0;
+begin
+  to_char_array( key, session.key_buffer.all, session.key_length );
+  for attempt in 1..2 loop
+      C_dbc_c_get_multiple_key( session.err,
+               cursor.cursor,
+               char_array_ptr_Conv.to_address( session.key_buffer ),
+               session.key_length,
+               char_array_ptr_Conv.to_address( bulk.buffer ),
+               bulk.size,
+               needed,
+               flags );
+      exit when session.err /= DB_BUFFER_SMALL or attempt = 2;
+      free_berkeley_bulk_buffer( bulk );
+      new_berkeley_bulk_buffer( bulk, needed );
+  end loop;
+  bulk.pointer := system.null_address;
+  if session.err = DB_OK then
+     C_multiple_key_init( bulk.pointer,
+        char_array_ptr_Conv.to_address( bulk.buffer ),
+        bulk.size );
+  elsif session.will_raise then
+     raise_error( gnat.source_info.source_location, session );
+  end if;
+end get_multiple_key;
+
+
+-- NEXT MULTIPLE KEY
+--
+-- Return the next key/data pair from a bulk buffer.  found is false when
+-- all pairs have been returned.
+------------------------------------------------------------------------------
+
+procedure next_multiple_key( bulk : in out berkeley_bulk_buffer;
+  key, data : out unbounded_string; found : out boolean ) is
+  c_found     : interfaces.C.int := 0;
+  key_offset  : size_t := 0;
+  key_length  : size_t := 0;
+  data_offset : size_t := 0;
+  data_length : size_t := 0;
+begin
+  C_multiple_key_next( c_found,
+     bulk.pointer,
+     char_array_ptr_Conv.to_address( bulk.buffer ),
+     key_offset,
+     key_length,
+     data_offset,
+     data_length );
+  found := c_found /= 0;
+  if found then
+     key  := to_unbounded_string( bulk.buffer.all, key_offset, key_length );
+     data := to_unbounded_string( bulk.buffer.all, data_offset, data_length );
+  else
+     key  := null_unbounded_string;
+     data := null_unbounded_string;
+  end if;
+end next_multiple_key;
+
 -- CLOSE (CURSOR)
 --
 -- Destroy a cursor.
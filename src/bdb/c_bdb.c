@@ -495,6 +495,88 @@ void C_dbc_c_get( int *err,
 
 }
 
+// C_dbc_c_get_multiple_key
+//
+// Bulk get as many key/data pairs as will fit in the buffer via the cursor.
+// The key is only read when positioning the cursor (for example, with
+// DB_SET_RANGE).  If the buffer is too small for even one pair, the error
+// is DB_BUFFER_SMALL and needed is the size required.
+
+void C_dbc_c_get_multiple_key( int *err,
+  DBC *cursh,
+  char *key,
+  size_t key_length,
+  char *buffer,
+  size_t buffer_size,
+  size_t *needed,
+  u_int32_t flags ) {
+
+  DBT key_dbt, data_dbt;
+
+  memset(&key_dbt, 0, sizeof(DBT));
+  memset(&data_dbt, 0, sizeof(DBT));
+
+  key_dbt.data = key;
+  key_dbt.size = key_length;
+
+  data_dbt.data = buffer;
+  data_dbt.ulen = buffer_size;
+  data_dbt.flags = DB_DBT_USERMEM;
+
+  *err = cursh->c_get( cursh, &key_dbt, &data_dbt, flags | DB_MULTIPLE_KEY );
+  *needed = data_dbt.size;
+}
+
+// C_multiple_key_init
+//
+// Start walking the key/data pairs in a bulk get buffer
+
+void C_multiple_key_init( void **pointer, char *buffer, size_t buffer_size ) {
+
+  DBT data_dbt;
+
+  memset(&data_dbt, 0, sizeof(DBT));
+  data_dbt.data = buffer;
+  data_dbt.ulen = buffer_size;
+
+  DB_MULTIPLE_INIT( *pointer, &data_dbt );
+}
+
+// C_multiple_key_next
+//
+// Return the offsets of the next key/data pair in a bulk get buffer.  found
+// is zero when there are no more pairs.
+
+void C_multiple_key_next( int *found,
+  void **pointer,
+  char *buffer,
+  size_t *key_offset,
+  size_t *key_length,
+  size_t *data_offset,
+  size_t *data_length ) {
+
+  DBT data_dbt;
+  void *retkey, *retdata;
+  u_int32_t retklen, retdlen;
+
+  *found = 0;
+  if ( *pointer == NULL )
+     return;
+
+  memset(&data_dbt, 0, sizeof(DBT));
+  data_dbt.data = buffer;
+
+  DB_MULTIPLE_KEY_NEXT( *pointer, &data_dbt, retkey, retklen, retdata, retdlen );
+  if ( *pointer == NULL )
+     return;
+
+  *found = 1;
+  *key_offset = (char *) retkey - buffer;
+  *key_length = retklen;
+  *data_offset = (char *) retdata - buffer;
+  *data_length = retdlen;
+}
+
 // C_dbc_c_close
 //
 // Destory the cursor
@@ -890,23 +972,96 @@ void C_txn_commit( int *err,
 }
 
 
-/*
-void C_db_compact(
-    int *db_err,
+// C_db_compact
+//
+// Compact a database, returning the number of pages freed and the number
+// of pages returned to the file system.
+
+void C_db_compact( int *db_err,
     DB *dbh,
     DB_TXN *txnid,
-    char *start_key,
-    const int  start_key_length,
-    char *stop_key,
-    const int  stop_key_length,
-    char *data,
-    int  *data_length,
+    double *pages_free,
+    double *pages_truncated,
     u_int32_t flags ) {
 
- *db_err = int
-DB->compact(DB *db, DB_TXN *txnid,
-DBT *start, DBT *stop, DB_COMPACT *c_data, u_int32_t flags, DBT *end);
+  DB_COMPACT c_data;
+
+  memset(&c_data, 0, sizeof(DB_COMPACT));
+
+  *db_err = dbh->compact( dbh, txnid, NULL, NULL, &c_data, flags, NULL );
+
+  *pages_free = c_data.compact_pages_free;
+  *pages_truncated = c_data.compact_pages_truncated;
+}
+
+// C_db_perf_stats
+//
+// Gather the database statistics (DB->stat, without walking the database)
+// and the cache, lock and log statistics of its environment.  The lock
+// and log statistics are zero if those subsystems are not in use.  The
+// layout must match bdb.berkeley_stats.
+
+typedef struct {
+  double cache_bytes;
+  double cache_hits;
+  double cache_misses;
+  double pages_read;
+  double pages_written;
+  double lock_waits;
+  double deadlocks;
+  double log_bytes;
+  double records;
+  double pages;
+} bdb_perf_stats;
+
+void C_db_perf_stats( int *db_err, DB *dbh, DB_TXN *txnid, bdb_perf_stats *stats ) {
+
+  DB_ENV *env;
+  DBTYPE type;
+  void *sp;
+  DB_MPOOL_STAT *msp;
+  DB_LOCK_STAT *lsp;
+  DB_LOG_STAT *gsp;
+
+  memset(stats, 0, sizeof(bdb_perf_stats));
+
+  *db_err = dbh->get_type( dbh, &type );
+  if ( *db_err != 0 )
+     return;
+  *db_err = dbh->stat( dbh, txnid, &sp, DB_FAST_STAT );
+  if ( *db_err != 0 )
+     return;
+  if ( type == DB_BTREE || type == DB_RECNO ) {
+     stats->records = ((DB_BTREE_STAT *) sp)->bt_ndata;
+     stats->pages = ((DB_BTREE_STAT *) sp)->bt_pagecnt;
+  } else if ( type == DB_HASH ) {
+     stats->records = ((DB_HASH_STAT *) sp)->hash_ndata;
+     stats->pages = ((DB_HASH_STAT *) sp)->hash_pagecnt;
+  }
+  free( sp );
+
+  env = dbh->get_env( dbh );
+  if ( env == NULL )
+     return;
+  *db_err = env->memp_stat( env, &msp, NULL, 0 );
+  if ( *db_err != 0 )
+     return;
+  stats->cache_bytes = (double) msp->st_gbytes * 1073741824.0 + msp->st_bytes;
+  stats->cache_hits = msp->st_cache_hit;
+  stats->cache_misses = msp->st_cache_miss;
+  stats->pages_read = msp->st_page_in;
+  stats->pages_written = msp->st_page_out;
+  free( msp );
+
+  if ( env->lock_stat( env, &lsp, 0 ) == 0 ) {
+     stats->lock_waits = lsp->st_lock_wait;
+     stats->deadlocks = lsp->st_ndeadlocks;
+     free( lsp );
+  }
+  if ( env->log_stat( env, &gsp, 0 ) == 0 ) {
+     stats->log_bytes = (double) gsp->st_w_mbytes * 1048576.0 + gsp->st_w_bytes;
+     free( gsp );
+  }
 }
-*/
 
 #endif
@@ -183,6 +183,10 @@
  printf( "type key_range_flags is new flags;\n" );
  printf( "-- none exist in BDB v4\n" );
  printf( "\n" );
+ printf( "type compact_flags is new flags;\n" );
+ printf( " DB_COMPACT_FREELIST_ONLY  : constant compact_flags := %d;\n", DB_FREELIST_ONLY );
+ printf( " DB_COMPACT_FREE_SPACE     : constant compact_flags := %d;\n", DB_FREE_SPACE );
+ printf( "\n" );
  printf( "type cursor_flags is new flags;\n" );
  printf( " DB_CURSOR_CURSOR_BULK      : constant cursor_flags := %d;\n", DB_CURSOR_BULK );
  printf( " DB_CURSOR_READ_COMMITTED   : constant cursor_flags := %d;\n", DB_READ_COMMITTED );
@@ -668,6 +668,8 @@ begin
    content( e, "declare" );
    content( e, "delay" );
    content( e, "delete" );
+   content( e, "decimal" );
+   content( e, "digest" );
    content( e, "directory_operations" );
    content( e, "doc_format" );
    content( e, "doubly_linked_lists" );
@@ -708,6 +710,7 @@ begin
    content( e, "null" );
    content( e, "numerics" );
    content( e, "open" );
+   content( e, "ordered_maps" );
    content( e, "os" );
    content( e, "pen" );
    content( e, "pen.gl" );
@@ -769,20 +772,25 @@ begin
      createdOn( e, "v2.0");
      authorKen( e );
      description( e, "A collection of common routines using Berkeley DB B-tree files." );
-     content( e, "add( f, k, v )","get_previous( f, c, k, v )" );
-     content( e, "append( f, k, v )","b := has_element( f, k )" );
+     content( e, "add( f, k, v )","get_range( f, c, ka, va, n [, p] )" );
+     content( e, "append( f, k, v )","get_range( f, c, ka, va, n, lo, hi )" );
+     content( e, "begin_batch( f [, n [, ms] ] )","b := has_element( f, k )" );
      content( e, "clear( f )","increment( f, k [,n] )" );
      content( e, "close( f )","b := is_open( f )" );
      content( e, "close_cursor( f, c )","e := last_error( f )" );
-     content( e, "create( f, p, kl, vl )","open( f, p, kl, vl )" );
-     content( e, "decrement( f, k [,n] )","open_cursor( f, c )" );
-     content( e, "delete( f )","prepend( f, k, v )" );
-     content( e, "flush( f )","raise_exceptions( f, b )" );
-     content( e, "get( f, k, v )","remove( f, k )" );
-     content( e, "get_first( f, c, k, v )","replace( f, k, v )" );
-     content( e, "get_last( f, c, k, v )","set( f, k, v )" );
+     content( e, "compact( f [, n] )","open( f, p, kl, vl )" );
+     content( e, "convert( f, v )","open_cursor( f, c )" );
+     content( e, "create( f, p, kl, vl )","prepend( f, k, v )" );
+     content( e, "decrement( f, k [,n] )","raise_exceptions( f, b )" );
+     content( e, "delete( f )","remove( f, k )" );
+     content( e, "e := encoding( f )","replace( f, k, v )" );
+     content( e, "end_batch( f )","set( f, k, v )" );
+     content( e, "flush( f )","set_bulk_size( f, bytes )" );
+     content( e, "get( f, k, v )","set_durability( f, d )" );
+     content( e, "get_first( f, c, k, v )","set_encoding( f, e )" );
+     content( e, "get_last( f, c, k, v )","j := stats( f )" );
      content( e, "get_next( f, c, k, v )","truncate( f )" );
-     content( e, "b := will_raise( f )" );
+     content( e, "get_previous( f, c, k, v )","b := will_raise( f )" );
      seeAlso( e, "doc/pkg_btree_io.html" );
      endHelp( e );
    if HTMLoutput then
@@ -818,7 +826,7 @@ begin
      content( e, "db.connect( d [, u, w ][, h][, p] )" );
      content( e, "append( s [,a] )","prepare( s [, a] )" );
      content( e, "append_line( s )","append_quoted( s )" );
-     content( e, "execute","execute_checked( [ s ] )" );
+     content( e, "execute [ ( m ) ]","execute_checked( [ s ] )" );
      content( e, "disconnect","b := is_connected" );
      content( e, "reset","s := error_message" );
      content( e, "s := notice_message","s := in_abort_state" );
@@ -830,13 +838,20 @@ begin
      content( e, "begin_work","rollback_work" );
      content( e, "commit_work","rewind" );
      content( e, "fetch [ (i) ]","b := end_of_query" );
+     content( e, "n := fetch_all( a1 [, a2 ...] )" );
      content( e, "t := tuple","n := tuples" );
      content( e, "n := columns","s := column_name( c )" );
      content( e, "i := column_index( s )","b := is_null( c )" );
      content( e, "s := value( c )","d := engine_of" );
      content( e, "show","list" );
      content( e, "schema( t )","users" );
-     content( e, "databases" );
+     content( e, "databases","prepare_statement( s )" );
+     content( e, "bind( n [, v] )","execute_prepared [ ( m ) ]" );
+     content( e, "copy_in( t, c [, s] )","copy_out( q, f )" );
+     content( e, "put_copy_data( s )","put_copy_end" );
+     content( e, "connect_named( n, d [, u, w [, h [, p]]] )" );
+     content( e, "disconnect_named( n )","execute_async [ ( n ) ]" );
+     content( e, "b := is_ready [ ( n ) ]","wait [ ( n ) ]" );
      seeAlso( e, "doc/pkg_db.html" );
      endHelp( e );
    if HTMLoutput then
@@ -928,18 +943,21 @@ begin
      description( e, "A collection of common routines using Berkeley DB Hash files." );
      content( e, "add( f, k, v )","get_previous( f, c, k, v )" );
      content( e, "append( f, k, v )","b := has_element( f, k )" );
-     content( e, "clear( f )","increment( f, k [,n] )" );
-     content( e, "close( f )","b := is_open( f )" );
-     content( e, "close_cursor( f, c )","e := last_error( f )" );
-     content( e, "create( f, p, kl, vl )","open( f, p, kl, vl )" );
-     content( e, "decrement( f, k [,n] )","open_cursor( f, c )" );
-     content( e, "delete( f )","prepend( f, k, v )" );
-     content( e, "flush( f )","raise_exceptions( f, b )" );
-     content( e, "get( f, k, v )","remove( f, k )" );
-     content( e, "get_first( f, c, k, v )","replace( f, k, v )" );
-     content( e, "get_last( f, c, k, v )","set( f, k, v )" );
-     content( e, "get_next( f, c, k, v )","truncate( f )" );
-     content( e, "b := will_raise( f )" );
+     content( e, "begin_batch( f [, n [, ms] ] )","increment( f, k [,n] )" );
+     content( e, "clear( f )","b := is_open( f )" );
+     content( e, "close( f )","e := last_error( f )" );
+     content( e, "close_cursor( f, c )","open( f, p, kl, vl )" );
+     content( e, "convert( f, v )","open_cursor( f, c )" );
+     content( e, "create( f, p, kl, vl )","prepend( f, k, v )" );
+     content( e, "decrement( f, k [,n] )","raise_exceptions( f, b )" );
+     content( e, "delete( f )","remove( f, k )" );
+     content( e, "e := encoding( f )","replace( f, k, v )" );
+     content( e, "end_batch( f )","set( f, k, v )" );
+     content( e, "flush( f )","set_durability( f, d )" );
+     content( e, "get( f, k, v )","set_encoding( f, e )" );
+     content( e, "get_first( f, c, k, v )","j := stats( f )" );
+     content( e, "get_last( f, c, k, v )","truncate( f )" );
+     content( e, "get_next( f, c, k, v )","b := will_raise( f )" );
      seeAlso( e, "doc/pkg_hash_io.html" );
      endHelp( e );
    if HTMLoutput then
@@ -987,12 +1005,15 @@ begin
      content( e, "begin_work","rollback_work" );
      content( e, "commit_work","rewind" );
      content( e, "fetch [ (i) ]","b := end_of_query" );
+     content( e, "n := fetch_all( a1 [, a2 ...] )" );
      content( e, "n := tuple( t )","n := tuples" );
      content( e, "n := columns","s := column_name( c )" );
      content( e, "i := column_index( s )","b := is_null( c )" );
      content( e, "s := value( c )","b := engine_of " );
      content( e, "show","list" );
      content( e, "schema( t )","users" );
+     content( e, "prepare_statement( s )","bind( n [, v] )" );
+     content( e, "execute_prepared" );
      seeAlso( e, "doc/pkg_mysql.html" );
      endHelp( e );
    if HTMLoutput then
@@ -1218,6 +1239,7 @@ begin
   content( e, "pragma inspection_peek - like a inspection_point but no breakout" );
   content( e, "pragma inspection_point - break to command prompt if --break is used" );
   content( e, "pragma license( license_name [, extra] ) - specify a software license" );
+  content( e, "pragma local_memcache( cluster, bytes, seconds ) - cache a memcache cluster's values in-process" );
   content( e, "pragma manual_test( owner, name, objective, description, category, preconditions, steps, postconditions, units, work estimate, units, work priority, ticket) - manual test case" );
   content( e, "pragma manual_test_result( tester, date, notes, screenshots, status [, ticket] - manual test result" );
   content( e, "pragma no_command_hash - do not store command pathnames in the hash table" );
@@ -1523,6 +1545,29 @@ begin
      content( e, "delete( file )" );
      seeAlso( e, "doc/pkg_text_io.html" );
      endHelp( e );
+  elsif helpTopic = "decimal" then
+     startHelp( e, "decimal" );
+     summary( e, "decimal package" );
+     authorKen( e );
+     categoryPackage( e );
+     description( e, "Exact decimal arithmetic, such as for money, using the " &
+       "PostgreSQL numeric code.  Values are decimal.decimal strings." );
+     content( e, "r := add( a, b )","i := compare( a, b )","r := divide( a, b [, s] )" );
+     content( e, "r := multiply( a, b )","r := round( a, s )","r := subtract( a, b )" );
+     content( e, "r := sum( v )","r := to_decimal( s [, s] )","f := to_float( a )" );
+     content( e, "r := truncate( a, s )" );
+     seeAlso( e, "doc/pkg_decimal.html" );
+     endHelp( e );
+  elsif helpTopic = "digest" then
+     startHelp( e, "digest" );
+     summary( e, "digest package" );
+     authorKen( e );
+     categoryPackage( e );
+     description( e, "Compute a MD5, SHA-256 or CRC-32 checksum of data given a " &
+       "piece at a time.  The result is a lower-case hexadecimal string." );
+     content( e, "new( d, k )","update( d, s )","s := finish( d )" );
+     seeAlso( e, "doc/pkg_digest.html" );
+     endHelp( e );
   elsif helpTopic = "directory_operations" then
      startHelp( e, "directory_operations" );
      summary( e, "directory_operations package" );
@@ -1636,14 +1681,15 @@ begin
      authorKen( e );
      createdOn( e, "v1.5");
      categoryPackage( e );
-     description( e, "A collection of common routines using in-memory, dynamically growing hash tables." );
+     description( e, "A collection of common routines using in-memory, dynamically growing hash tables.  The tables use open addressing." );
      content( e, "add( t, k, v )","append( t, k, v )" );
      content( e, "decrement( t, k [,n] )","v := get( t, k )" );
      content( e, "get_first( t, v, f )","get_next( t, v, f )" );
      content( e, "b := has_element( t, k )","increment( t, k [,n] )" );
-     content( e, "prepend( t, k, v )","remove( t, k )" );
-     content( e, "replace( t, k, v )","reset( t )" );
-     content( e, "set( t, k, v )" );
+     content( e, "n := length( t )","prepend( t, k, v )" );
+     content( e, "remove( t, k )","replace( t, k, v )" );
+     content( e, "reserve( t, n )","reset( t )" );
+     content( e, "set( t, k, v )","j := stats( t )" );
      seeAlso( e, "doc/pkg_dht.html" );
      endHelp( e );
   elsif helpTopic = "enums" then
@@ -1698,7 +1744,9 @@ begin
      content( e, "b := is_executable_file( p )","b := is_regular_file( p )","b := is_readable( p )" );
      content( e, "b := is_readable_file( p )","b := is_waiting_file( p )","b := is_writable( p )  " );
      content( e, "b := is_writable_file( p )","t := last_accessed( p )","t := last_changed( p )" );
-     content( e, "t := last_modified( p )","l := size( p )" );
+     content( e, "t := last_modified( p )","l := size( p )","s := md5( p )" );
+     content( e, "s := sha256( p )","s := crc32( p )","encode_base64( p, t )" );
+     content( e, "decode_base64( p, t )" );
      seeAlso( e, "doc/pkg_files.html" );
      endHelp( e );
   elsif helpTopic = "for" then
@@ -2104,14 +2152,18 @@ begin
      description( e, "A collection of common routines using memcached, " &
                   "a distributed in-memory cache." );
      section( e, "memcache" );
-     content( e, "add( cl, k, v )","prepend( cl, k, v )" );
-     content( e, "append( cl, k, v )","register_server( cl, h, p )" );
-     content( e, "clear_servers( cl )","replace( cl, k, v )" );
-     content( e, "delete( cl, k )","set( cl, k, v )" );
-     content( e, "flush( cl )","set_cluster_name( cl, s )" );
-     content( e, "is_valid_memcache_key( k )","set_cluster_type( cl, e )" );
-     content( e, "v := get( cl, k )","s := stats( cl )" );
-     content( e, "cl := new_cluster","s := version( cl )" );
+     content( e, "add( cl, k, v [, t] )","cl := new_cluster" );
+     content( e, "append( cl, k, v )","prepend( cl, k, v )" );
+     content( e, "b := cas( cl, k, v, c [, t] )","register_server( cl, h, p [, w] )" );
+     content( e, "clear_servers( cl )","replace( cl, k, v [, t] )" );
+     content( e, "delete( cl, k )","set( cl, k, v [, t] )" );
+     content( e, "n := fence( cl )","set_cluster_name( cl, s )" );
+     content( e, "flush( cl )","set_cluster_type( cl, e )" );
+     content( e, "v := get( cl, k )","set_protocol( cl, p )" );
+     content( e, "get_multi( cl, ks, vs )","set_quiet( cl, k, v [, t] )" );
+     content( e, "gets( cl, k, v, c )","s := stats( cl )" );
+     content( e, "is_valid_memcache_key( k )","touch( cl, k, t )" );
+     content( e, "r := key_movement( cl )","s := version( cl )" );
      section( e, "memcache.highread" );
      content( e, "add( cl, k, v )","register_alpha_server( cl, h, p )" );
      content( e, "append( cl, k, v )","register_beta_server( cl, h, p )" );
@@ -2119,8 +2171,9 @@ begin
      content( e, "delete( cl, k )","set( cl, k, v )" );
      content( e, "flush( cl )","set_cluster_name( cl, s )" );
      content( e, "v := get( cl, k )","set_cluster_type( cl, e )" );
-     content( e, "cl := new_cluster","s := stats( cl )" );
-     content( e, "prepend( cl, k, v )","s := version( cl )" );
+     content( e, "get_multi( cl, ks, vs )","s := stats( cl )" );
+     content( e, "cl := new_cluster","s := version( cl )" );
+     content( e, "prepend( cl, k, v )" );
      seeAlso( e, "doc/pkg_memcache.html and doc/pkg_memcache_highread.html" );
      endHelp( e );
   elsif helpTopic = "mode" then
@@ -2154,6 +2207,30 @@ begin
      content( e, "null;" );
      seeAlso( e, "doc/ref_other.html" );
      endHelp( e );
+  elsif helpTopic = "ordered_maps" then
+     startHelp( e, "ordered_maps" );
+     summary( e, "ordered_maps package" );
+     authorKen( e );
+     categoryPackage( e );
+     description( e, "A collection of common routines using in-memory maps " &
+       "kept sorted by key.  Searches, inserts and deletes take logarithmic " &
+       "time.  Use ceiling and next for a range scan." );
+     content( e, "ceiling( m, k, c )","clear( m )" );
+     content( e, "b := contains( m, k )","delete( m, k )" );
+     content( e, "delete_first( m )","delete_last( m )" );
+     content( e, "e := element( c )","exclude( m, k )" );
+     content( e, "find( m, k, c )","first( m, c )" );
+     content( e, "e := first_element( m )","k := first_key( m )" );
+     content( e, "floor( m, k, c )","e := get( m, k )" );
+     content( e, "b := has_element( c )","include( m, k, e )" );
+     content( e, "insert( m, k, e )","b := is_empty( m )" );
+     content( e, "k := key( c )","last( m, c )" );
+     content( e, "e := last_element( m )","k := last_key( m )" );
+     content( e, "n := length( m )","next( c )" );
+     content( e, "previous( c )","replace( m, k, e )" );
+     content( e, "replace_element( m, c, e )" );
+     seeAlso( e, "doc/pkg_ordered_maps.html" );
+     endHelp( e );
   elsif helpTopic = "os" then
      startHelp( e, "os" );
      summary( e, "os package" );
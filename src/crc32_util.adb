@@ -0,0 +1,124 @@
+------------------------------------------------------------------------------
+-- CRC32 UTIL                                                               --
+--                                                                          --
+-- Part of SparForte                                                        --
+-- Designed and Programmed by Ken O. Burtch                                 --
+------------------------------------------------------------------------------
+--                                                                          --
+--            Copyright (C) 2001-2020 Free Software Foundation              --
+--                                                                          --
+-- This is free software;  you can  redistribute it  and/or modify it under --
+-- terms of the  GNU General Public License as published  by the Free Soft- --
+-- ware  Foundation;  either version 2,  or (at your option) any later ver- --
+-- sion.  This is distributed in the hope that it will be useful, but WITH- --
+-- OUT ANY WARRANTY;  without even the  implied warranty of MERCHANTABILITY --
+-- or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License --
+-- for  more details.  You should have  received  a copy of the GNU General --
+-- Public License  distributed with this;  see file COPYING.  If not, write --
+-- to  the Free Software Foundation,  59 Temple Place - Suite 330,  Boston, --
+-- MA 02111-1307, USA.                                                      --
+--                                                                          --
+-- This is maintained at http://www.sparforte.com                           --
+--                                                                          --
+------------------------------------------------------------------------------
+
+package body crc32_util is
+
+function Shift_Right( Value : CRC32; Amount : Natural ) return CRC32;
+pragma Import( Intrinsic, Shift_Right );
+
+Polynomial : constant CRC32 := 16#EDB8_8320#;  -- reversed 16#04C1_1DB7#
+
+type aByteTable is array( CRC32 range 0..255 ) of CRC32;
+type aSliceTables is array( 0..7 ) of aByteTable;
+
+tables : aSliceTables;
+-- tables( 0 ) is the usual byte-at-a-time table.  tables( n ) is the CRC
+-- of a byte followed by n zero bytes.
+
+
+------------------------------------------------------------------------------
+-- CRC Functions
+------------------------------------------------------------------------------
+
+procedure Initialize( C : out CRC32 ) is
+begin
+  C := 16#FFFF_FFFF#;
+end Initialize;
+
+procedure Update( C : in out CRC32; Value : string ) is
+  crc : CRC32 := C;
+  one : CRC32;
+  two : CRC32;
+  i   : integer := Value'first;
+begin
+  -- eight bytes at a time
+  while i + 7 <= Value'last loop
+     one := crc xor (  CRC32( character'pos( Value( i   ) ) )             or
+                       CRC32( character'pos( Value( i+1 ) ) ) * 16#100#    or
+                       CRC32( character'pos( Value( i+2 ) ) ) * 16#1_0000# or
+                       CRC32( character'pos( Value( i+3 ) ) ) * 16#100_0000# );
+     two :=            CRC32( character'pos( Value( i+4 ) ) )             or
+                       CRC32( character'pos( Value( i+5 ) ) ) * 16#100#    or
+                       CRC32( character'pos( Value( i+6 ) ) ) * 16#1_0000# or
+                       CRC32( character'pos( Value( i+7 ) ) ) * 16#100_0000#;
+     crc := tables( 7 )(   one                    and 16#FF# ) xor
+            tables( 6 )( ( Shift_Right( one,  8 ) and 16#FF# ) ) xor
+            tables( 5 )( ( Shift_Right( one, 16 ) and 16#FF# ) ) xor
+            tables( 4 )(   Shift_Right( one, 24 )              ) xor
+            tables( 3 )(   two                    and 16#FF# ) xor
+            tables( 2 )( ( Shift_Right( two,  8 ) and 16#FF# ) ) xor
+            tables( 1 )( ( Shift_Right( two, 16 ) and 16#FF# ) ) xor
+            tables( 0 )(   Shift_Right( two, 24 )              );
+     i := i + 8;
+  end loop;
+  -- any remaining bytes one at a time
+  while i <= Value'last loop
+     crc := Shift_Right( crc, 8 ) xor
+            tables( 0 )( ( crc xor CRC32( character'pos( Value( i ) ) ) ) and 16#FF# );
+     i := i + 1;
+  end loop;
+  C := crc;
+end Update;
+
+function Get_Value( C : CRC32 ) return CRC32 is
+begin
+  return not C;
+end Get_Value;
+
+function To_Hex( C : CRC32 ) return string is
+  hexDigits : constant string( 1..16 ) := "0123456789abcdef";
+  s : string( 1..8 );
+  v : CRC32 := C;
+begin
+  for i in reverse s'range loop
+      s( i ) := hexDigits( integer( v and 16#F# ) + 1 );
+      v := Shift_Right( v, 4 );
+  end loop;
+  return s;
+end To_Hex;
+
+begin
+  -- Build the lookup tables
+
+  for n in aByteTable'range loop
+      declare
+         crc : CRC32 := n;
+      begin
+         for bit in 1..8 loop
+             if ( crc and 1 ) = 1 then
+                crc := Shift_Right( crc, 1 ) xor Polynomial;
+             else
+                crc := Shift_Right( crc, 1 );
+             end if;
+         end loop;
+         tables( 0 )( n ) := crc;
+      end;
+  end loop;
+  for n in aByteTable'range loop
+      for t in 1..7 loop
+          tables( t )( n ) := Shift_Right( tables( t-1 )( n ), 8 ) xor
+             tables( 0 )( tables( t-1 )( n ) and 16#FF# );
+      end loop;
+  end loop;
+end crc32_util;
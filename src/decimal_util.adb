@@ -0,0 +1,272 @@
+------------------------------------------------------------------------------
+-- DECIMAL UTIL                                                             --
+--                                                                          --
+-- Part of SparForte                                                        --
+-- Designed and Programmed by Ken O. Burtch                                 --
+------------------------------------------------------------------------------
+--                                                                          --
+--            Copyright (C) 2001-2020 Free Software Foundation              --
+--                                                                          --
+-- This is free software;  you can  redistribute it  and/or modify it under --
+-- terms of the  GNU General Public License as published  by the Free Soft- --
+-- ware  Foundation;  either version 2,  or (at your option) any later ver- --
+-- sion.  This is distributed in the hope that it will be useful, but WITH- --
+-- OUT ANY WARRANTY;  without even the  implied warranty of MERCHANTABILITY --
+-- or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License --
+-- for  more details.  You should have  received  a copy of the GNU General --
+-- Public License  distributed with this;  see file COPYING.  If not, write --
+-- to  the Free Software Foundation,  59 Temple Place - Suite 330,  Boston, --
+-- MA 02111-1307, USA.                                                      --
+--                                                                          --
+-- This is maintained at http://www.sparforte.com                           --
+--                                                                          --
+------------------------------------------------------------------------------
+
+with interfaces.c,
+     interfaces.c.strings;
+use  interfaces.c,
+     interfaces.c.strings;
+
+package body decimal_util is
+
+nullNumeric : constant aNumeric := aNumeric( system.null_address );
+
+-- Decimal_Exception in decimal.h
+
+type aNumericException is ( no_error, numeric_format, numeric_overflow,
+   undefined_result, divide_by_zero );
+for aNumericException'size use int'size;
+pragma convention( C, aNumericException );
+
+------------------------------------------------------------------------------
+-- numeric.c
+------------------------------------------------------------------------------
+
+function numeric_global_rscale return int;
+pragma import( C, numeric_global_rscale, "numeric_global_rscale" );
+
+procedure numeric_free( num : aNumeric );
+pragma import( C, numeric_free, "numeric_free" );
+
+procedure numeric_free_string( str : chars_ptr );
+pragma import( C, numeric_free_string, "numeric_free" );
+
+function numeric_isnan( num : aNumeric ) return int;
+pragma import( C, numeric_isnan, "numeric_isnan" );
+
+function numeric_in( str : system.address; precision, scale : int; ex : system.address ) return aNumeric;
+pragma import( C, numeric_in, "numeric_in" );
+
+function numeric_out( num : aNumeric ) return chars_ptr;
+pragma import( C, numeric_out, "numeric_out" );
+
+function numeric_add( num1, num2 : aNumeric ) return aNumeric;
+pragma import( C, numeric_add, "numeric_add" );
+
+function numeric_sub( num1, num2 : aNumeric ) return aNumeric;
+pragma import( C, numeric_sub, "numeric_sub" );
+
+function numeric_mul( num1, num2 : aNumeric; global_rscale : system.address ) return aNumeric;
+pragma import( C, numeric_mul, "numeric_mul" );
+
+function numeric_div( num1, num2 : aNumeric; global_rscale, ex : system.address ) return aNumeric;
+pragma import( C, numeric_div, "numeric_div" );
+
+function numeric_round( num : aNumeric; scale : int ) return aNumeric;
+pragma import( C, numeric_round, "numeric_round" );
+
+function numeric_trunc( num : aNumeric; scale : int ) return aNumeric;
+pragma import( C, numeric_trunc, "numeric_trunc" );
+
+function numeric_cmp( num1, num2 : aNumeric ) return int;
+pragma import( C, numeric_cmp, "numeric_cmp" );
+
+------------------------------------------------------------------------------
+-- Conversions
+------------------------------------------------------------------------------
+
+function toNumeric( s : unbounded_string ) return aNumeric is
+  -- parse a decimal string.  The caller frees the result.
+  cstr : constant char_array := to_c( to_string( s ) );
+  ex   : aliased aNumericException := no_error;
+  num  : aNumeric;
+begin
+  num := numeric_in( cstr'address, 0, 0, ex'address );
+  if num = nullNumeric then
+     raise storage_error;
+  end if;
+  if ex /= no_error or else numeric_isnan( num ) /= 0 then
+     numeric_free( num );
+     raise decimal_format_error;
+  end if;
+  return num;
+end toNumeric;
+
+procedure toNumerics( left, right : unbounded_string; leftNum, rightNum : out aNumeric ) is
+  -- parse two decimal strings, freeing the first if the second is bad
+begin
+  leftNum := toNumeric( left );
+  begin
+    rightNum := toNumeric( right );
+  exception when others =>
+    numeric_free( leftNum );
+    raise;
+  end;
+end toNumerics;
+
+function toImage( num : aNumeric ) return unbounded_string is
+  -- format a numeric result and free it
+  cstr   : chars_ptr;
+  result : unbounded_string;
+begin
+  if num = nullNumeric then
+     raise storage_error;
+  end if;
+  if numeric_isnan( num ) /= 0 then
+     numeric_free( num );
+     raise decimal_format_error;
+  end if;
+  cstr := numeric_out( num );
+  numeric_free( num );
+  result := to_unbounded_string( value( cstr ) );
+  numeric_free_string( cstr );
+  return result;
+end toImage;
+
+------------------------------------------------------------------------------
+-- Operations
+------------------------------------------------------------------------------
+
+function DecimalNormalize( s : unbounded_string ) return unbounded_string is
+begin
+  return toImage( toNumeric( s ) );
+end DecimalNormalize;
+
+function DecimalAdd( left, right : unbounded_string ) return unbounded_string is
+  l, r   : aNumeric;
+  result : aNumeric;
+begin
+  toNumerics( left, right, l, r );
+  result := numeric_add( l, r );
+  numeric_free( l );
+  numeric_free( r );
+  return toImage( result );
+end DecimalAdd;
+
+function DecimalSubtract( left, right : unbounded_string ) return unbounded_string is
+  l, r   : aNumeric;
+  result : aNumeric;
+begin
+  toNumerics( left, right, l, r );
+  result := numeric_sub( l, r );
+  numeric_free( l );
+  numeric_free( r );
+  return toImage( result );
+end DecimalSubtract;
+
+function DecimalMultiply( left, right : unbounded_string ) return unbounded_string is
+  l, r   : aNumeric;
+  result : aNumeric;
+  rscale : aliased int := numeric_global_rscale;
+begin
+  toNumerics( left, right, l, r );
+  result := numeric_mul( l, r, rscale'address );
+  numeric_free( l );
+  numeric_free( r );
+  return toImage( result );
+end DecimalMultiply;
+
+function DecimalDivide( left, right : unbounded_string ) return unbounded_string is
+  l, r   : aNumeric;
+  result : aNumeric;
+  rscale : aliased int := numeric_global_rscale;
+  ex     : aliased aNumericException := no_error;
+begin
+  toNumerics( left, right, l, r );
+  result := numeric_div( l, r, rscale'address, ex'address );
+  numeric_free( l );
+  numeric_free( r );
+  if ex = divide_by_zero then
+     numeric_free( result );
+     raise decimal_divide_error;
+  elsif ex /= no_error then
+     numeric_free( result );
+     raise decimal_format_error;
+  end if;
+  return toImage( result );
+end DecimalDivide;
+
+function DecimalRound( s : unbounded_string; scale : natural ) return unbounded_string is
+  num    : constant aNumeric := toNumeric( s );
+  result : aNumeric;
+begin
+  result := numeric_round( num, int( scale ) );
+  numeric_free( num );
+  return toImage( result );
+end DecimalRound;
+
+function DecimalTruncate( s : unbounded_string; scale : natural ) return unbounded_string is
+  num    : constant aNumeric := toNumeric( s );
+  result : aNumeric;
+begin
+  result := numeric_trunc( num, int( scale ) );
+  numeric_free( num );
+  return toImage( result );
+end DecimalTruncate;
+
+function DecimalCompare( left, right : unbounded_string ) return integer is
+  l, r   : aNumeric;
+  result : int;
+begin
+  toNumerics( left, right, l, r );
+  result := numeric_cmp( l, r );
+  numeric_free( l );
+  numeric_free( r );
+  if result < 0 then
+     return -1;
+  elsif result > 0 then
+     return 1;
+  end if;
+  return 0;
+end DecimalCompare;
+
+------------------------------------------------------------------------------
+-- Totals
+------------------------------------------------------------------------------
+
+procedure DecimalTotalAdd( total : in out aDecimalTotal; s : unbounded_string ) is
+  num    : constant aNumeric := toNumeric( s );
+  result : aNumeric;
+begin
+  if total.numeric = nullNumeric then
+     total.numeric := num;
+  else
+     result := numeric_add( total.numeric, num );
+     numeric_free( num );
+     numeric_free( total.numeric );
+     total.numeric := result;
+  end if;
+end DecimalTotalAdd;
+
+function DecimalTotalImage( total : aDecimalTotal ) return unbounded_string is
+  cstr   : chars_ptr;
+  result : unbounded_string;
+begin
+  if total.numeric = nullNumeric then
+     return to_unbounded_string( "0" );
+  end if;
+  cstr := numeric_out( total.numeric );
+  result := to_unbounded_string( value( cstr ) );
+  numeric_free_string( cstr );
+  return result;
+end DecimalTotalImage;
+
+procedure Finalize( total : in out aDecimalTotal ) is
+begin
+  if total.numeric /= nullNumeric then
+     numeric_free( total.numeric );
+     total.numeric := nullNumeric;
+  end if;
+end Finalize;
+
+end decimal_util;
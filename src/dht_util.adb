@@ -0,0 +1,291 @@
+------------------------------------------------------------------------------
+-- Open Addressing String Hash Tables                                       --
+--                                                                          --
+-- Part of SparForte                                                        --
+------------------------------------------------------------------------------
+--                                                                          --
+--            Copyright (C) 2001-2020 Free Software Foundation              --
+--                                                                          --
+-- This is free software;  you can  redistribute it  and/or modify it under --
+-- terms of the  GNU General Public License as published  by the Free Soft- --
+-- ware  Foundation;  either version 2,  or (at your option) any later ver- --
+-- sion.  This is distributed in the hope that it will be useful, but WITH- --
+-- OUT ANY WARRANTY;  without even the  implied warranty of MERCHANTABILITY --
+-- or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License --
+-- for  more details.  You should have  received  a copy of the GNU General --
+-- Public License  distributed with this;  see file COPYING.  If not, write --
+-- to  the Free Software Foundation,  59 Temple Place - Suite 330,  Boston, --
+-- MA 02111-1307, USA.                                                      --
+--                                                                          --
+-- This is maintained at http://www.sparforte.com                           --
+--                                                                          --
+------------------------------------------------------------------------------
+
+with unchecked_deallocation;
+
+package body dht_util is
+
+minCapacity : constant unsigned_32 := 16;
+-- the size of a new table
+
+maxCapacity : constant unsigned_32 := 2**30;
+-- the largest table.  Larger tables raise storage_error.
+
+procedure free is new unchecked_deallocation( aHashArray, aHashArrayPtr );
+procedure free is new unchecked_deallocation( aSlotArray, aSlotArrayPtr );
+
+
+------------------------------------------------------------------------------
+-- Utility subprograms
+------------------------------------------------------------------------------
+
+--  HASH KEY
+--
+-- 32-bit FNV-1a hash of the whole key.  Zero is reserved for empty slots.
+
+function HashKey( key : unbounded_string ) return unsigned_32 is
+  buf  : constant string := to_string( key );
+  hash : unsigned_32 := 16#811c9dc5#;
+begin
+  for i in buf'range loop
+      hash := ( hash xor unsigned_32( character'pos( buf( i ) ) ) ) * 16#01000193#;
+  end loop;
+  if hash = 0 then
+     hash := 1;
+  end if;
+  return hash;
+end HashKey;
+
+--  IS OVERLOADED
+--
+-- True if count keys would fill more than three-quarters of capacity slots.
+
+function isOverloaded( count : natural; capacity : unsigned_32 ) return boolean is
+begin
+  return unsigned_64( count ) * 4 > unsigned_64( capacity ) * 3;
+end isOverloaded;
+
+--  CAPACITY FOR
+--
+-- The smallest capacity that holds count keys without being overloaded.
+
+function CapacityFor( count : natural ) return unsigned_32 is
+  capacity : unsigned_32 := minCapacity;
+begin
+  while isOverloaded( count, capacity ) loop
+     if capacity >= maxCapacity then
+        raise storage_error;
+     end if;
+     capacity := capacity * 2;
+  end loop;
+  return capacity;
+end CapacityFor;
+
+--  FIND SLOT
+--
+-- Search for the key.  If it is found, index is its slot.  Otherwise,
+-- index is the empty slot where it would be added.  The table must be
+-- allocated.
+
+procedure FindSlot( table : aStringHashTable; key : unbounded_string;
+  hash : unsigned_32; index : out unsigned_32; found : out boolean ) is
+  i : unsigned_32 := hash and table.mask;
+begin
+  found := false;
+  while table.hashes( i ) /= 0 loop
+     if table.hashes( i ) = hash then
+        if table.slots( i ).key = key then
+           found := true;
+           exit;
+        end if;
+     end if;
+     i := ( i + 1 ) and table.mask;
+  end loop;
+  index := i;
+end FindSlot;
+
+--  RESIZE
+--
+-- Rebuild the table with a new capacity.  The keys are not compared
+-- because the stored hashes are reused.
+
+procedure Resize( table : in out aStringHashTable; capacity : unsigned_32 ) is
+  oldHashes : aHashArrayPtr := table.hashes;
+  oldSlots  : aSlotArrayPtr := table.slots;
+  i         : unsigned_32;
+begin
+  if capacity > maxCapacity then
+     raise storage_error;
+  end if;
+  table.hashes := new aHashArray( 0..capacity-1 );
+  table.hashes.all := ( others => 0 );
+  table.slots  := new aSlotArray( 0..capacity-1 );
+  table.mask   := capacity - 1;
+  table.iterator := 0;
+  if oldHashes /= null then
+     for j in oldHashes'range loop
+         if oldHashes( j ) /= 0 then
+            i := oldHashes( j ) and table.mask;
+            while table.hashes( i ) /= 0 loop
+               i := ( i + 1 ) and table.mask;
+            end loop;
+            table.hashes( i ) := oldHashes( j );
+            table.slots( i ) := oldSlots( j );
+         end if;
+     end loop;
+     free( oldHashes );
+     free( oldSlots );
+     table.resizes := table.resizes + 1;
+  end if;
+end Resize;
+
+
+------------------------------------------------------------------------------
+-- Table subprograms
+------------------------------------------------------------------------------
+
+procedure Set( table : in out aStringHashTable; key, element : unbounded_string ) is
+  hash  : constant unsigned_32 := HashKey( key );
+  index : unsigned_32;
+  found : boolean;
+begin
+  if table.hashes = null then
+     Resize( table, minCapacity );
+  end if;
+  FindSlot( table, key, hash, index, found );
+  if found then
+     table.slots( index ).element := element;
+  else
+     if isOverloaded( table.count + 1, table.mask + 1 ) then
+        Resize( table, ( table.mask + 1 ) * 2 );
+        FindSlot( table, key, hash, index, found );
+     end if;
+     table.hashes( index ) := hash;
+     table.slots( index ) := aSlot'( key => key, element => element );
+     table.count := table.count + 1;
+  end if;
+end Set;
+
+function Get( table : aStringHashTable; key : unbounded_string ) return unbounded_string is
+  index : unsigned_32;
+  found : boolean := false;
+begin
+  if table.hashes /= null then
+     FindSlot( table, key, HashKey( key ), index, found );
+  end if;
+  if found then
+     return table.slots( index ).element;
+  end if;
+  return null_unbounded_string;
+end Get;
+
+-- With linear probing, a removed key cannot simply be marked empty because
+-- that would end the search for keys stored after it.  Instead, the
+-- following keys in the run are moved back into the hole when their home
+-- slot is at or before the hole.
+
+procedure Remove( table : in out aStringHashTable; key : unbounded_string ) is
+  index : unsigned_32;
+  found : boolean := false;
+  hole  : unsigned_32;
+  j     : unsigned_32;
+  home  : unsigned_32;
+begin
+  if table.hashes /= null then
+     FindSlot( table, key, HashKey( key ), index, found );
+  end if;
+  if found then
+     hole := index;
+     j := index;
+     loop
+        j := ( j + 1 ) and table.mask;
+        exit when table.hashes( j ) = 0;
+        home := table.hashes( j ) and table.mask;
+        if ( ( j - home ) and table.mask ) >= ( ( j - hole ) and table.mask ) then
+           table.hashes( hole ) := table.hashes( j );
+           table.slots( hole ) := table.slots( j );
+           hole := j;
+        end if;
+     end loop;
+     table.hashes( hole ) := 0;
+     table.slots( hole ) := aSlot'( key => null_unbounded_string, element => null_unbounded_string );
+     table.count := table.count - 1;
+  end if;
+end Remove;
+
+procedure Reset( table : in out aStringHashTable ) is
+begin
+  if table.hashes /= null then
+     free( table.hashes );
+     free( table.slots );
+  end if;
+  table.mask := 0;
+  table.count := 0;
+  table.resizes := 0;
+  table.iterator := 0;
+end Reset;
+
+procedure Reserve( table : in out aStringHashTable; count : natural ) is
+  capacity : constant unsigned_32 := CapacityFor( count );
+begin
+  if table.hashes = null or else capacity > table.mask + 1 then
+     Resize( table, capacity );
+  end if;
+end Reserve;
+
+function Length( table : aStringHashTable ) return natural is
+begin
+  return table.count;
+end Length;
+
+function Get_First( table : in out aStringHashTable ) return unbounded_string is
+begin
+  table.iterator := 0;
+  return Get_Next( table );
+end Get_First;
+
+function Get_Next( table : in out aStringHashTable ) return unbounded_string is
+  i : unsigned_32;
+begin
+  if table.hashes /= null then
+     while table.iterator <= table.mask loop
+        i := table.iterator;
+        table.iterator := table.iterator + 1;
+        if table.hashes( i ) /= 0 then
+           return table.slots( i ).element;
+        end if;
+     end loop;
+  end if;
+  return null_unbounded_string;
+end Get_Next;
+
+-- The probe length of a key is the number of slots examined to find it:
+-- one more than its distance from its home slot.
+
+function Stats( table : aStringHashTable ) return aStringHashTableStats is
+  result : aStringHashTableStats;
+  total  : long_float := 0.0;
+  probe  : unsigned_32;
+begin
+  result.length  := table.count;
+  result.resizes := table.resizes;
+  if table.hashes /= null then
+     result.capacity := natural( table.mask + 1 );
+     result.load := float( table.count ) / float( result.capacity );
+     for i in table.hashes'range loop
+         if table.hashes( i ) /= 0 then
+            probe := ( ( i - table.hashes( i ) ) and table.mask ) + 1;
+            total := total + long_float( probe );
+            if natural( probe ) > result.max_probe then
+               result.max_probe := natural( probe );
+            end if;
+         end if;
+     end loop;
+     if table.count > 0 then
+        result.average_probe := float( total / long_float( table.count ) );
+     end if;
+  end if;
+  return result;
+end Stats;
+
+end dht_util;
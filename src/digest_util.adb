@@ -0,0 +1,116 @@
+------------------------------------------------------------------------------
+-- DIGEST UTIL                                                              --
+--                                                                          --
+-- Part of SparForte                                                        --
+-- Designed and Programmed by Ken O. Burtch                                 --
+------------------------------------------------------------------------------
+--                                                                          --
+--            Copyright (C) 2001-2020 Free Software Foundation              --
+--                                                                          --
+-- This is free software;  you can  redistribute it  and/or modify it under --
+-- terms of the  GNU General Public License as published  by the Free Soft- --
+-- ware  Foundation;  either version 2,  or (at your option) any later ver- --
+-- sion.  This is distributed in the hope that it will be useful, but WITH- --
+-- OUT ANY WARRANTY;  without even the  implied warranty of MERCHANTABILITY --
+-- or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License --
+-- for  more details.  You should have  received  a copy of the GNU General --
+-- Public License  distributed with this;  see file COPYING.  If not, write --
+-- to  the Free Software Foundation,  59 Temple Place - Suite 330,  Boston, --
+-- MA 02111-1307, USA.                                                      --
+--                                                                          --
+-- This is maintained at http://www.sparforte.com                           --
+--                                                                          --
+------------------------------------------------------------------------------
+
+with interfaces.c,
+     spar_os;
+use  interfaces.c,
+     spar_os,
+     crc32_util;
+
+package body digest_util is
+
+fileBufferSize : constant := 65536;
+-- the amount of a file read at one time
+
+procedure StartDigest( ctx : out aDigestContext; kind : aDigestKind ) is
+begin
+  ctx.kind := kind;
+  ctx.isStarted := true;
+  case kind is
+  when md5_digest =>
+     md5.Init( ctx.md5Ctx );
+  when sha256_digest =>
+     ctx.sha256Ctx := gnat.sha256.Initial_Context;
+  when crc32_digest =>
+     Initialize( ctx.crc );
+  end case;
+end StartDigest;
+
+procedure UpdateDigest( ctx : in out aDigestContext; data : string ) is
+begin
+  case ctx.kind is
+  when md5_digest =>
+     md5.Update( ctx.md5Ctx, data );
+  when sha256_digest =>
+     gnat.sha256.Update( ctx.sha256Ctx, data );
+  when crc32_digest =>
+     Update( ctx.crc, data );
+  end case;
+end UpdateDigest;
+
+procedure FinishDigest( ctx : in out aDigestContext; digest : out unbounded_string ) is
+begin
+  case ctx.kind is
+  when md5_digest =>
+     declare
+        fp : md5.Fingerprint;
+     begin
+        md5.Final( ctx.md5Ctx, fp );
+        digest := to_unbounded_string( md5.Digest_To_Text( fp ) );
+     end;
+  when sha256_digest =>
+     digest := to_unbounded_string( gnat.sha256.Digest( ctx.sha256Ctx ) );
+  when crc32_digest =>
+     digest := to_unbounded_string( To_Hex( Get_Value( ctx.crc ) ) );
+  end case;
+  ctx.isStarted := false;
+end FinishDigest;
+
+procedure DigestFile( path : string; kind : aDigestKind;
+  digest : out unbounded_string; errno : out integer ) is
+  ctx         : aDigestContext;
+  fd          : aFileDescriptor;
+  buffer      : string( 1..fileBufferSize );
+  amountRead  : size_t;
+  closeResult : int;
+begin
+  digest := null_unbounded_string;
+  errno := 0;
+  fd := open( path & ASCII.NUL, O_RDONLY, 8#644# );
+  if fd < 0 then
+     errno := C_errno;
+     return;
+  end if;
+  StartDigest( ctx, kind );
+  loop
+<<reread>>
+     read( amountRead, fd, buffer'address, buffer'length );
+     exit when amountRead = 0;
+     -- KB: 2012/02/15: see spar_os-tty for an explaination of this kludge
+     if amountRead not in 0..size_t'last-1 then
+        if C_errno = EAGAIN or C_errno = EINTR then
+           goto reread;
+        end if;
+        errno := C_errno;
+        closeResult := close( fd );
+        return;
+     end if;
+     UpdateDigest( ctx, buffer( 1..integer( amountRead ) ) );
+  end loop;
+  closeResult := close( fd );
+  -- close EINTR is a diagnostic message.  Do not handle.
+  FinishDigest( ctx, digest );
+end DigestFile;
+
+end digest_util;
@@ -0,0 +1,327 @@
+------------------------------------------------------------------------------
+-- Least Recently Used String Caches                                        --
+--                                                                          --
+-- Part of SparForte                                                        --
+------------------------------------------------------------------------------
+--                                                                          --
+--            Copyright (C) 2001-2020 Free Software Foundation              --
+--                                                                          --
+-- This is free software;  you can  redistribute it  and/or modify it under --
+-- terms of the  GNU General Public License as published  by the Free Soft- --
+-- ware  Foundation;  either version 2,  or (at your option) any later ver- --
+-- sion.  This is distributed in the hope that it will be useful, but WITH- --
+-- OUT ANY WARRANTY;  without even the  implied warranty of MERCHANTABILITY --
+-- or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License --
+-- for  more details.  You should have  received  a copy of the GNU General --
+-- Public License  distributed with this;  see file COPYING.  If not, write --
+-- to  the Free Software Foundation,  59 Temple Place - Suite 330,  Boston, --
+-- MA 02111-1307, USA.                                                      --
+--                                                                          --
+-- This is maintained at http://www.sparforte.com                           --
+--                                                                          --
+------------------------------------------------------------------------------
+pragma ada_2005;
+
+with ada.containers.hashed_maps,
+     ada.strings.unbounded.hash,
+     unchecked_deallocation;
+use  ada.calendar;
+
+package body lru_util is
+
+nodeOverhead : constant natural := 64;
+-- the approximate bytes used by a node and its map entry, counted against
+-- the budget so that many tiny keys cannot use unlimited memory
+
+never : constant time := time_of( year_number'last, 12, 31 );
+-- the deadline of a key that memcached does not expire
+
+package lruMaps is new ada.containers.hashed_maps(
+   key_type        => unbounded_string,
+   element_type    => anLruNodePtr,
+   hash            => ada.strings.unbounded.hash,
+   equivalent_keys => "=" );
+
+type anLruCacheRecord is record
+     map       : lruMaps.map;
+     head      : anLruNodePtr;        -- most recently used
+     tail      : anLruNodePtr;        -- least recently used
+     ttl       : duration := 0.0;
+     counters  : anLruCacheStats;
+end record;
+
+procedure free is new unchecked_deallocation( anLruNode, anLruNodePtr );
+procedure free is new unchecked_deallocation( anLruCacheRecord, anLruCache );
+
+
+------------------------------------------------------------------------------
+-- Utility subprograms
+------------------------------------------------------------------------------
+
+--  UNLINK
+--
+-- Take a node out of the recently used list.
+
+procedure Unlink( cache : anLruCache; node : anLruNodePtr ) is
+begin
+  if node.prev = null then
+     cache.head := node.next;
+  else
+     node.prev.next := node.next;
+  end if;
+  if node.next = null then
+     cache.tail := node.prev;
+  else
+     node.next.prev := node.prev;
+  end if;
+  node.prev := null;
+  node.next := null;
+end Unlink;
+
+--  LINK FIRST
+--
+-- Put a node at the head of the recently used list.
+
+procedure LinkFirst( cache : anLruCache; node : anLruNodePtr ) is
+begin
+  node.prev := null;
+  node.next := cache.head;
+  if cache.head /= null then
+     cache.head.prev := node;
+  end if;
+  cache.head := node;
+  if cache.tail = null then
+     cache.tail := node;
+  end if;
+end LinkFirst;
+
+--  DISCARD
+--
+-- Remove a node from the map and the list and free it.
+
+procedure Discard( cache : anLruCache; node : in out anLruNodePtr ) is
+begin
+  lruMaps.exclude( cache.map, node.key );
+  Unlink( cache, node );
+  cache.counters.bytes := cache.counters.bytes - node.bytes;
+  cache.counters.items := cache.counters.items - 1;
+  free( node );
+end Discard;
+
+
+--  DROP VALUE
+--
+-- Discard a node's value but keep the node for its deadline.
+
+procedure DropValue( cache : anLruCache; node : anLruNodePtr ) is
+begin
+  cache.counters.bytes := cache.counters.bytes - length( node.value );
+  node.bytes := node.bytes - length( node.value );
+  node.value := null_unbounded_string;
+  node.cached := false;
+end DropValue;
+
+--  ADD NODE
+--
+-- Add a new node for a key, discarding least recently used keys until it
+-- fits.  Not added if the node is bigger than the whole budget.
+
+procedure AddNode( cache : anLruCache; key, value : unbounded_string;
+   cached : boolean; expires, deadline : time; added : out boolean ) is
+  bytes : constant natural := length( key ) + length( value ) + nodeOverhead;
+  node  : anLruNodePtr;
+begin
+  added := false;
+  if bytes > cache.counters.maxBytes then
+     return;
+  end if;
+  while cache.counters.bytes + bytes > cache.counters.maxBytes loop
+     node := cache.tail;
+     Discard( cache, node );
+     cache.counters.evictions := cache.counters.evictions + 1;
+  end loop;
+  node := new anLruNode'(
+     key      => key,
+     value    => value,
+     bytes    => bytes,
+     cached   => cached,
+     expires  => expires,
+     deadline => deadline,
+     prev     => null,
+     next     => null );
+  lruMaps.insert( cache.map, key, node );
+  LinkFirst( cache, node );
+  cache.counters.bytes := cache.counters.bytes + bytes;
+  cache.counters.items := cache.counters.items + 1;
+  added := true;
+end AddNode;
+
+
+------------------------------------------------------------------------------
+-- Caches
+------------------------------------------------------------------------------
+
+procedure Configure( cache : in out anLruCache; maxBytes : natural; ttl : duration ) is
+begin
+  if cache /= null then
+     Clear( cache );
+     if maxBytes = 0 then
+        free( cache );
+        return;
+     end if;
+  elsif maxBytes = 0 then
+     return;
+  else
+     cache := new anLruCacheRecord;
+  end if;
+  cache.ttl := ttl;
+  cache.counters := ( maxBytes => maxBytes, others => <> );
+end Configure;
+
+function IsEnabled( cache : anLruCache ) return boolean is
+begin
+  return cache /= null;
+end IsEnabled;
+
+procedure Find( cache : anLruCache; key : unbounded_string;
+   value : out unbounded_string; found : out boolean ) is
+  c    : lruMaps.cursor;
+  node : anLruNodePtr;
+begin
+  value := null_unbounded_string;
+  found := false;
+  if cache = null then
+     return;
+  end if;
+  c := lruMaps.find( cache.map, key );
+  if lruMaps.has_element( c ) then
+     node := lruMaps.element( c );
+     if not node.cached or else clock > node.expires then
+        if node.cached then
+           cache.counters.expired := cache.counters.expired + 1;
+        end if;
+        if clock < node.deadline then
+           DropValue( cache, node );
+        else
+           Discard( cache, node );
+        end if;
+     else
+        if node /= cache.head then
+           Unlink( cache, node );
+           LinkFirst( cache, node );
+        end if;
+        value := node.value;
+        found := true;
+     end if;
+  end if;
+  if found then
+     cache.counters.hits := cache.counters.hits + 1;
+  else
+     cache.counters.misses := cache.counters.misses + 1;
+  end if;
+end Find;
+
+procedure Store( cache : anLruCache; key, value : unbounded_string ) is
+  now      : constant time := clock;
+  c        : lruMaps.cursor;
+  node     : anLruNodePtr;
+  deadline : time := never;
+  expires  : time := now + cache.ttl;
+  added    : boolean;
+begin
+  if cache = null then
+     return;
+  end if;
+  c := lruMaps.find( cache.map, key );
+  if lruMaps.has_element( c ) then
+     node := lruMaps.element( c );
+     -- a passed deadline means the key was stored again since
+     if now < node.deadline then
+        deadline := node.deadline;
+     end if;
+     Discard( cache, node );
+  end if;
+  if deadline < expires then
+     expires := deadline;
+  end if;
+  AddNode( cache, key, value, true, expires, deadline, added );
+  if not added then
+     -- too big to cache: keep the deadline by itself
+     if deadline /= never then
+        SetDeadline( cache, key, deadline );
+     end if;
+  end if;
+end Store;
+
+procedure Remove( cache : anLruCache; key : unbounded_string ) is
+  c    : lruMaps.cursor;
+  node : anLruNodePtr;
+begin
+  if cache = null then
+     return;
+  end if;
+  c := lruMaps.find( cache.map, key );
+  if lruMaps.has_element( c ) then
+     node := lruMaps.element( c );
+     if clock < node.deadline then
+        DropValue( cache, node );
+     else
+        Discard( cache, node );
+     end if;
+  end if;
+end Remove;
+
+procedure SetDeadline( cache : anLruCache; key : unbounded_string;
+   deadline : ada.calendar.time ) is
+  added : boolean;
+begin
+  if cache = null then
+     return;
+  end if;
+  ClearDeadline( cache, key );
+  if clock < deadline then
+     AddNode( cache, key, null_unbounded_string, false, deadline, deadline, added );
+  end if;
+end SetDeadline;
+
+procedure ClearDeadline( cache : anLruCache; key : unbounded_string ) is
+  c    : lruMaps.cursor;
+  node : anLruNodePtr;
+begin
+  if cache = null then
+     return;
+  end if;
+  c := lruMaps.find( cache.map, key );
+  if lruMaps.has_element( c ) then
+     node := lruMaps.element( c );
+     Discard( cache, node );
+  end if;
+end ClearDeadline;
+
+procedure Clear( cache : anLruCache ) is
+  node : anLruNodePtr;
+begin
+  if cache = null then
+     return;
+  end if;
+  lruMaps.clear( cache.map );
+  while cache.head /= null loop
+     node := cache.head;
+     cache.head := node.next;
+     free( node );
+  end loop;
+  cache.tail := null;
+  cache.counters.bytes := 0;
+  cache.counters.items := 0;
+end Clear;
+
+function Stats( cache : anLruCache ) return anLruCacheStats is
+  empty : anLruCacheStats;
+begin
+  if cache = null then
+     return empty;
+  end if;
+  return cache.counters;
+end Stats;
+
+end lru_util;
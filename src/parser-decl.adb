@@ -1134,6 +1134,30 @@ begin
       if identifiers( id ).genKind2 /= eof_t then
          err( optional_bold( to_string( identifiers( type_token ).name ) ) & " should have one element type" );
       end if;
+   elsif uniType = ordered_map_t or uniType = ordered_cursor_t then
+      if identifiers( id ).genKind2 = eof_t then
+         err( optional_bold( to_string( identifiers( type_token ).name ) ) & " should have a key type and an element type" );
+      else
+         declare
+            genKindId  : identifier renames identifiers( id ).genKind;
+            genKind2Id : identifier renames identifiers( id ).genKind2;
+         begin
+            if class_ok( genKindId, typeClass, subClass ) then
+               if identifiers( genKindId ).list then
+                  err( "key type should be a scalar type" );
+               elsif identifiers( getBaseType( genKindId ) ).kind = root_record_t then
+                  err( "key type should be a scalar type" );
+               end if;
+            end if;
+            if class_ok( genKind2Id, typeClass, subClass ) then
+               if identifiers( genKind2Id ).list then
+                  err( "element type should be a scalar type" );
+               elsif identifiers( getBaseType( genKind2Id ) ).kind = root_record_t then
+                  err( "element type should be a scalar type" );
+               end if;
+            end if;
+         end;
+      end if;
    elsif uniType = dht_table_t then
       declare
          genKindId : identifier renames identifiers( id ).genKind;
@@ -1200,6 +1224,10 @@ procedure ParseDeclarationPart( id : in out identifier; anon_arrays : boolean; e
         declareResource( resId, hash_cursor, getIdentifierBlock( id ) );
      elsif uniType = dht_table_t then
         declareResource( resId, dynamic_string_hash_table, getIdentifierBlock( id ) );
+     elsif uniType = ordered_map_t then
+        declareResource( resId, ordered_string_map, getIdentifierBlock( id ) );
+     elsif uniType = ordered_cursor_t then
+        declareResource( resId, ordered_string_map_cursor, getIdentifierBlock( id ) );
      else
         -- TODO: implement generic types
         err( optional_bold( to_string( identifiers( type_token ).name ) ) &
@@ -0,0 +1,358 @@
+------------------------------------------------------------------------------
+-- Decimal Package Parser                                                   --
+--                                                                          --
+-- Part of SparForte                                                        --
+-- Designed and Programmed by Ken O. Burtch                                 --
+------------------------------------------------------------------------------
+--                                                                          --
+--            Copyright (C) 2001-2020 Free Software Foundation              --
+--                                                                          --
+-- This is free software;  you can  redistribute it  and/or modify it under --
+-- terms of the  GNU General Public License as published  by the Free Soft- --
+-- ware  Foundation;  either version 2,  or (at your option) any later ver- --
+-- sion.  This is distributed in the hope that it will be useful, but WITH- --
+-- OUT ANY WARRANTY;  without even the  implied warranty of MERCHANTABILITY --
+-- or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License --
+-- for  more details.  You should have  received  a copy of the GNU General --
+-- Public License  distributed with this;  see file COPYING.  If not, write --
+-- to  the Free Software Foundation,  59 Temple Place - Suite 330,  Boston, --
+-- MA 02111-1307, USA.                                                      --
+--                                                                          --
+-- This is maintained at http://www.sparforte.com                           --
+--                                                                          --
+------------------------------------------------------------------------------
+
+with ada.strings.unbounded,
+     decimal_util,
+     parser,
+     parser_params,
+     user_io,
+     world,
+     scanner;
+use  ada.strings.unbounded,
+     decimal_util,
+     parser,
+     parser_params,
+     user_io,
+     world,
+     scanner;
+
+package body parser_decimal is
+
+------------------------------------------------------------------------------
+-- Decimal package identifiers
+------------------------------------------------------------------------------
+
+decimal_decimal_t    : identifier;
+decimal_to_decimal_t : identifier;
+decimal_add_t        : identifier;
+decimal_subtract_t   : identifier;
+decimal_multiply_t   : identifier;
+decimal_divide_t     : identifier;
+decimal_round_t      : identifier;
+decimal_truncate_t   : identifier;
+decimal_compare_t    : identifier;
+decimal_sum_t        : identifier;
+decimal_to_float_t   : identifier;
+
+-- Decimal values are kept as exact decimal strings.  The arithmetic is done
+-- by the PostgreSQL numeric code in decimal_util, never with floating point.
+-- Each operation parses its operands and formats its result as text.
+
+function toScale( s : unbounded_string ) return natural is
+  -- convert a scale parameter
+begin
+  return natural( to_numeric( s ) );
+end toScale;
+
+procedure ParseDecimalToDecimal( result : out unbounded_string; kind : out identifier ) is
+  -- Syntax: d := decimal.to_decimal( s [, scale] )
+  -- Source: APQ.PostgreSQL.Decimal.Convert
+  expr_val   : unbounded_string;
+  expr_type  : identifier;
+  scale_val  : unbounded_string;
+  scale_type : identifier;
+  hasScale   : boolean := false;
+begin
+  kind := decimal_decimal_t;
+  expect( decimal_to_decimal_t );
+  ParseFirstStringParameter( expr_val, expr_type, string_t );
+  if token = symbol_t and identifiers( token ).value.all = "," then
+     ParseLastNumericParameter( scale_val, scale_type, natural_t );
+     hasScale := true;
+  else
+     expect( symbol_t, ")" );
+  end if;
+  if isExecutingCommand then
+     begin
+       if hasScale then
+          result := DecimalRound( expr_val, toScale( scale_val ) );
+       else
+          result := DecimalNormalize( expr_val );
+       end if;
+     exception when decimal_format_error =>
+       err( "not a decimal number" );
+     when others =>
+       err_exception_raised;
+     end;
+  end if;
+end ParseDecimalToDecimal;
+
+procedure ParseDecimalAdd( result : out unbounded_string; kind : out identifier ) is
+  -- Syntax: d := decimal.add( a, b )
+  -- Source: APQ.PostgreSQL.Decimal."+"
+  left_val   : unbounded_string;
+  left_type  : identifier;
+  right_val  : unbounded_string;
+  right_type : identifier;
+begin
+  kind := decimal_decimal_t;
+  expect( decimal_add_t );
+  ParseFirstStringParameter( left_val, left_type, decimal_decimal_t );
+  ParseLastStringParameter( right_val, right_type, decimal_decimal_t );
+  if isExecutingCommand then
+     begin
+       result := DecimalAdd( left_val, right_val );
+     exception when decimal_format_error =>
+       err( "not a decimal number" );
+     when others =>
+       err_exception_raised;
+     end;
+  end if;
+end ParseDecimalAdd;
+
+procedure ParseDecimalSubtract( result : out unbounded_string; kind : out identifier ) is
+  -- Syntax: d := decimal.subtract( a, b )
+  -- Source: APQ.PostgreSQL.Decimal."-"
+  left_val   : unbounded_string;
+  left_type  : identifier;
+  right_val  : unbounded_string;
+  right_type : identifier;
+begin
+  kind := decimal_decimal_t;
+  expect( decimal_subtract_t );
+  ParseFirstStringParameter( left_val, left_type, decimal_decimal_t );
+  ParseLastStringParameter( right_val, right_type, decimal_decimal_t );
+  if isExecutingCommand then
+     begin
+       result := DecimalSubtract( left_val, right_val );
+     exception when decimal_format_error =>
+       err( "not a decimal number" );
+     when others =>
+       err_exception_raised;
+     end;
+  end if;
+end ParseDecimalSubtract;
+
+procedure ParseDecimalMultiply( result : out unbounded_string; kind : out identifier ) is
+  -- Syntax: d := decimal.multiply( a, b )
+  -- Source: APQ.PostgreSQL.Decimal."*"
+  left_val   : unbounded_string;
+  left_type  : identifier;
+  right_val  : unbounded_string;
+  right_type : identifier;
+begin
+  kind := decimal_decimal_t;
+  expect( decimal_multiply_t );
+  ParseFirstStringParameter( left_val, left_type, decimal_decimal_t );
+  ParseLastStringParameter( right_val, right_type, decimal_decimal_t );
+  if isExecutingCommand then
+     begin
+       result := DecimalMultiply( left_val, right_val );
+     exception when decimal_format_error =>
+       err( "not a decimal number" );
+     when others =>
+       err_exception_raised;
+     end;
+  end if;
+end ParseDecimalMultiply;
+
+procedure ParseDecimalDivide( result : out unbounded_string; kind : out identifier ) is
+  -- Syntax: d := decimal.divide( a, b [, scale] )
+  -- Source: APQ.PostgreSQL.Decimal."/"
+  left_val   : unbounded_string;
+  left_type  : identifier;
+  right_val  : unbounded_string;
+  right_type : identifier;
+  scale_val  : unbounded_string;
+  scale_type : identifier;
+  hasScale   : boolean := false;
+begin
+  kind := decimal_decimal_t;
+  expect( decimal_divide_t );
+  ParseFirstStringParameter( left_val, left_type, decimal_decimal_t );
+  ParseNextStringParameter( right_val, right_type, decimal_decimal_t );
+  if token = symbol_t and identifiers( token ).value.all = "," then
+     ParseLastNumericParameter( scale_val, scale_type, natural_t );
+     hasScale := true;
+  else
+     expect( symbol_t, ")" );
+  end if;
+  if isExecutingCommand then
+     begin
+       if hasScale then
+          result := DecimalRound( DecimalDivide( left_val, right_val ), toScale( scale_val ) );
+       else
+          result := DecimalDivide( left_val, right_val );
+       end if;
+     exception when decimal_format_error =>
+       err( "not a decimal number" );
+     when decimal_divide_error =>
+       err( "division by zero" );
+     when others =>
+       err_exception_raised;
+     end;
+  end if;
+end ParseDecimalDivide;
+
+procedure ParseDecimalRound( result : out unbounded_string; kind : out identifier ) is
+  -- Syntax: d := decimal.round( a, scale )
+  -- Source: APQ.PostgreSQL.Decimal.Round
+  expr_val   : unbounded_string;
+  expr_type  : identifier;
+  scale_val  : unbounded_string;
+  scale_type : identifier;
+begin
+  kind := decimal_decimal_t;
+  expect( decimal_round_t );
+  ParseFirstStringParameter( expr_val, expr_type, decimal_decimal_t );
+  ParseLastNumericParameter( scale_val, scale_type, natural_t );
+  if isExecutingCommand then
+     begin
+       result := DecimalRound( expr_val, toScale( scale_val ) );
+     exception when decimal_format_error =>
+       err( "not a decimal number" );
+     when others =>
+       err_exception_raised;
+     end;
+  end if;
+end ParseDecimalRound;
+
+procedure ParseDecimalTruncate( result : out unbounded_string; kind : out identifier ) is
+  -- Syntax: d := decimal.truncate( a, scale )
+  -- Source: APQ.PostgreSQL.Decimal.Trunc
+  expr_val   : unbounded_string;
+  expr_type  : identifier;
+  scale_val  : unbounded_string;
+  scale_type : identifier;
+begin
+  kind := decimal_decimal_t;
+  expect( decimal_truncate_t );
+  ParseFirstStringParameter( expr_val, expr_type, decimal_decimal_t );
+  ParseLastNumericParameter( scale_val, scale_type, natural_t );
+  if isExecutingCommand then
+     begin
+       result := DecimalTruncate( expr_val, toScale( scale_val ) );
+     exception when decimal_format_error =>
+       err( "not a decimal number" );
+     when others =>
+       err_exception_raised;
+     end;
+  end if;
+end ParseDecimalTruncate;
+
+procedure ParseDecimalCompare( result : out unbounded_string; kind : out identifier ) is
+  -- Syntax: i := decimal.compare( a, b )
+  -- Source: N/A
+  left_val   : unbounded_string;
+  left_type  : identifier;
+  right_val  : unbounded_string;
+  right_type : identifier;
+begin
+  kind := integer_t;
+  expect( decimal_compare_t );
+  ParseFirstStringParameter( left_val, left_type, decimal_decimal_t );
+  ParseLastStringParameter( right_val, right_type, decimal_decimal_t );
+  if isExecutingCommand then
+     begin
+       result := to_unbounded_string( integer'image( DecimalCompare( left_val, right_val ) ) );
+     exception when decimal_format_error =>
+       err( "not a decimal number" );
+     when others =>
+       err_exception_raised;
+     end;
+  end if;
+end ParseDecimalCompare;
+
+procedure ParseDecimalSum( result : out unbounded_string; kind : out identifier ) is
+  -- Syntax: d := decimal.sum( a )
+  -- Source: N/A
+  -- The total is kept in the numeric representation, so each element is
+  -- parsed once and only the total is formatted.
+  arrayId : identifier;
+begin
+  kind := decimal_decimal_t;
+  expect( decimal_sum_t );
+  expect( symbol_t, "(" );
+  ParseIdentifier( arrayId );
+  if not (class_ok( arrayId, varClass ) and identifiers( arrayId ).list) then
+     err( "Array expected" );
+  else
+     baseTypesOK( identifiers( identifiers( arrayId ).kind ).kind, decimal_decimal_t );
+  end if;
+  expect( symbol_t, ")" );
+  if isExecutingCommand then
+     declare
+       total : aDecimalTotal;
+     begin
+       if identifiers( arrayId ).avalue = null then
+          err( "array " & optional_bold( to_string( identifiers( arrayId ).name ) ) &
+               " has no elements" );
+       else
+          for i in identifiers( arrayId ).avalue'range loop
+              DecimalTotalAdd( total, identifiers( arrayId ).avalue( i ) );
+          end loop;
+          result := DecimalTotalImage( total );
+       end if;
+     exception when decimal_format_error =>
+       err( "not a decimal number" );
+     when others =>
+       err_exception_raised;
+     end;
+  end if;
+end ParseDecimalSum;
+
+procedure ParseDecimalToFloat( result : out unbounded_string; kind : out identifier ) is
+  -- Syntax: f := decimal.to_float( a )
+  -- Source: N/A
+  expr_val  : unbounded_string;
+  expr_type : identifier;
+begin
+  kind := long_float_t;
+  expect( decimal_to_float_t );
+  ParseSingleStringParameter( expr_val, expr_type, decimal_decimal_t );
+  if isExecutingCommand then
+     begin
+       -- a decimal string is already valid numeric text: parse it once
+       result := to_unbounded_string( to_numeric( expr_val ) );
+     exception when constraint_error =>
+       err( "not a decimal number" );
+     when others =>
+       err_exception_raised;
+     end;
+  end if;
+end ParseDecimalToFloat;
+
+procedure StartupDecimal is
+begin
+  declareNamespace( "decimal" );
+  declareIdent( decimal_decimal_t, "decimal.decimal", string_t, typeClass );
+  declareFunction( decimal_to_decimal_t, "decimal.to_decimal", ParseDecimalToDecimal'access );
+  declareFunction( decimal_add_t, "decimal.add", ParseDecimalAdd'access );
+  declareFunction( decimal_subtract_t, "decimal.subtract", ParseDecimalSubtract'access );
+  declareFunction( decimal_multiply_t, "decimal.multiply", ParseDecimalMultiply'access );
+  declareFunction( decimal_divide_t, "decimal.divide", ParseDecimalDivide'access );
+  declareFunction( decimal_round_t, "decimal.round", ParseDecimalRound'access );
+  declareFunction( decimal_truncate_t, "decimal.truncate", ParseDecimalTruncate'access );
+  declareFunction( decimal_compare_t, "decimal.compare", ParseDecimalCompare'access );
+  declareFunction( decimal_sum_t, "decimal.sum", ParseDecimalSum'access );
+  declareFunction( decimal_to_float_t, "decimal.to_float", ParseDecimalToFloat'access );
+  declareNamespaceClosed( "decimal" );
+end StartupDecimal;
+
+procedure ShutdownDecimal is
+begin
+  null;
+end ShutdownDecimal;
+
+end parser_decimal;
@@ -30,7 +30,9 @@ with
     scanner,
     scanner_res,
     scanner_restypes,
-    parser_params;
+    parser_params,
+    parser_containers,
+    dht_util;
 use
     ada.strings.unbounded,
     world,
@@ -38,7 +40,8 @@ use
     scanner,
     scanner_res,
     scanner_restypes,
-    parser_params;
+    parser_params,
+    parser_containers;
 
 package body parser_dht is
 
@@ -64,6 +67,10 @@ dht_replace_t       : identifier;
 dht_increment_t     : identifier;
 dht_decrement_t     : identifier;
 
+dht_reserve_t       : identifier;
+dht_length_t        : identifier;
+dht_stats_t         : identifier;
+
 --dht_assemble_t      : identifier;
 --dht_disassemble_t   : identifier;
 
@@ -140,7 +147,7 @@ begin
   if isExecutingCommand then
      begin
        findResource( to_resource_id( identifiers( tableId ).value.all ), theTable );
-       Dynamic_String_Hash_Tables.Reset( theTable.dsht );
+       dht_util.Reset( theTable.dsht );
      exception when storage_error =>
        err( "storage error raised" );
      end;
@@ -169,7 +176,7 @@ begin
   if isExecutingCommand then
      begin
        findResource( to_resource_id( identifiers( tableId ).value.all ), theTable );
-       Dynamic_String_Hash_Tables.Set(
+       dht_util.Set(
           theTable.dsht,
           keyExpr,
           itemExpr );
@@ -199,7 +206,7 @@ begin
   if isExecutingCommand then
      begin
        findResource( to_resource_id( identifiers( tableId ).value.all ), theTable );
-       result := Dynamic_String_Hash_Tables.Get( theTable.dsht, keyExpr );
+       result := dht_util.Get( theTable.dsht, keyExpr );
      end;
   end if;
 end ParseDHTGet;
@@ -224,7 +231,7 @@ begin
   if isExecutingCommand then
      begin
        findResource( to_resource_id( identifiers( tableId ).value.all ), theTable );
-       result := to_bush_boolean( Dynamic_String_Hash_Tables.Get( theTable.dsht, keyExpr ) /= null_unbounded_string );
+       result := to_bush_boolean( dht_util.Get( theTable.dsht, keyExpr ) /= null_unbounded_string );
      end;
   end if;
 end ParseDHTHasElement;
@@ -248,7 +255,7 @@ begin
   if isExecutingCommand then
      begin
        findResource( to_resource_id( identifiers( tableId ).value.all ), theTable );
-       Dynamic_String_Hash_Tables.Remove( theTable.dsht, keyExpr );
+       dht_util.Remove( theTable.dsht, keyExpr );
      exception when storage_error =>
        err( "storage error raised" );
      end;
@@ -282,7 +289,7 @@ begin
        s : unbounded_string;
      begin
        findResource( to_resource_id( identifiers( tableId ).value.all ), theTable );
-       s := Dynamic_String_Hash_Tables.Get_First( theTable.dsht );
+       s := dht_util.Get_First( theTable.dsht );
        AssignParameter( itemRef, s );
        AssignParameter( eofRef, to_bush_boolean( s = null_unbounded_string ) );
      end;
@@ -316,7 +323,7 @@ begin
        s : unbounded_string;
      begin
        findResource( to_resource_id( identifiers( tableId ).value.all ), theTable );
-       s := Dynamic_String_Hash_Tables.Get_Next( theTable.dsht );
+       s := dht_util.Get_Next( theTable.dsht );
        AssignParameter( itemRef, s );
        AssignParameter( eofRef, to_bush_boolean( s = null_unbounded_string ) );
      end;
@@ -349,9 +356,9 @@ begin
   if isExecutingCommand then
      begin
        findResource( to_resource_id( identifiers( tableId ).value.all ), theTable );
-       oldItem := Dynamic_String_Hash_Tables.Get( theTable.dsht, keyExpr );
+       oldItem := dht_util.Get( theTable.dsht, keyExpr );
        if oldItem = null_unbounded_string then
-          Dynamic_String_Hash_Tables.Set( theTable.dsht, keyExpr, itemExpr );
+          dht_util.Set( theTable.dsht, keyExpr, itemExpr );
        end if;
      exception when storage_error =>
        err( "storage error raised" );
@@ -385,9 +392,9 @@ begin
   if isExecutingCommand then
      begin
        findResource( to_resource_id( identifiers( tableId ).value.all ), theTable );
-       oldItem := Dynamic_String_Hash_Tables.Get( theTable.dsht, keyExpr );
+       oldItem := dht_util.Get( theTable.dsht, keyExpr );
        if oldItem /= null_unbounded_string then
-          Dynamic_String_Hash_Tables.Set( theTable.dsht, keyExpr, itemExpr );
+          dht_util.Set( theTable.dsht, keyExpr, itemExpr );
        end if;
      exception when storage_error =>
        err( "storage error raised" );
@@ -424,9 +431,9 @@ begin
   if isExecutingCommand then
      begin
        findResource( to_resource_id( identifiers( tableId ).value.all ), theTable );
-       oldItem := Dynamic_String_Hash_Tables.Get( theTable.dsht, keyExpr );
+       oldItem := dht_util.Get( theTable.dsht, keyExpr );
        if oldItem /= null_unbounded_string then
-          Dynamic_String_Hash_Tables.Set( theTable.dsht, keyExpr, oldItem & itemExpr );
+          dht_util.Set( theTable.dsht, keyExpr, oldItem & itemExpr );
        end if;
      exception when storage_error =>
        err( "storage error raised" );
@@ -463,9 +470,9 @@ begin
   if isExecutingCommand then
      begin
        findResource( to_resource_id( identifiers( tableId ).value.all ), theTable );
-       oldItem := Dynamic_String_Hash_Tables.Get( theTable.dsht, keyExpr );
+       oldItem := dht_util.Get( theTable.dsht, keyExpr );
        if oldItem /= null_unbounded_string then
-          Dynamic_String_Hash_Tables.Set( theTable.dsht, keyExpr, itemExpr & oldItem );
+          dht_util.Set( theTable.dsht, keyExpr, itemExpr & oldItem );
        end if;
      exception when storage_error =>
        err( "storage error raised" );
@@ -511,13 +518,13 @@ begin
   if isExecutingCommand then
      begin
        findResource( to_resource_id( identifiers( tableId ).value.all ), theTable );
-       oldItem := Dynamic_String_Hash_Tables.Get( theTable.dsht, keyExpr );
+       oldItem := dht_util.Get( theTable.dsht, keyExpr );
        if oldItem /= null_unbounded_string then
           oldItemValue := to_numeric( oldItem );
           if hasAmt then
-             Dynamic_String_Hash_Tables.Set( theTable.dsht, keyExpr, to_unbounded_string( oldItemValue + long_float( natural( to_numeric( amtExpr ) ) ) ) );
+             dht_util.Set( theTable.dsht, keyExpr, to_unbounded_string( oldItemValue + long_float( natural( to_numeric( amtExpr ) ) ) ) );
           else
-             Dynamic_String_Hash_Tables.Set( theTable.dsht, keyExpr, to_unbounded_string( oldItemValue + 1.0 ) );
+             dht_util.Set( theTable.dsht, keyExpr, to_unbounded_string( oldItemValue + 1.0 ) );
           end if;
        end if;
      exception when storage_error =>
@@ -566,13 +573,13 @@ begin
   if isExecutingCommand then
      begin
        findResource( to_resource_id( identifiers( tableId ).value.all ), theTable );
-       oldItem := Dynamic_String_Hash_Tables.Get( theTable.dsht, keyExpr );
+       oldItem := dht_util.Get( theTable.dsht, keyExpr );
        if oldItem /= null_unbounded_string then
           oldItemValue := to_numeric( oldItem );
           if hasAmt then
-             Dynamic_String_Hash_Tables.Set( theTable.dsht, keyExpr, to_unbounded_string( oldItemValue - long_float( natural( to_numeric( amtExpr ) ) ) ) );
+             dht_util.Set( theTable.dsht, keyExpr, to_unbounded_string( oldItemValue - long_float( natural( to_numeric( amtExpr ) ) ) ) );
           else
-             Dynamic_String_Hash_Tables.Set( theTable.dsht, keyExpr, to_unbounded_string( oldItemValue - 1.0 ) );
+             dht_util.Set( theTable.dsht, keyExpr, to_unbounded_string( oldItemValue - 1.0 ) );
           end if;
        end if;
      exception when storage_error =>
@@ -583,6 +590,91 @@ begin
   end if;
 end ParseDHTDecrement;
 
+-----------------------------------------------------------------------------
+--  RESERVE
+--
+-- Grow the table so it can hold n keys without being rebuilt.
+-- Syntax: dynamic_hash_tables.reserve( t, n );
+-- Ada:    N/A
+-----------------------------------------------------------------------------
+
+procedure ParseDHTReserve is
+  tableId  : identifier;
+  theTable : resPtr;
+  cntExpr  : unbounded_string;
+  cntType  : identifier;
+begin
+  expect( dht_reserve_t );
+  ParseFirstTableParameter( tableId );
+  ParseLastNumericParameter( cntExpr, cntType, containers_count_type_t );
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( tableId ).value.all ), theTable );
+       dht_util.Reserve( theTable.dsht, natural( to_numeric( cntExpr ) ) );
+     exception when storage_error =>
+       err( "storage error raised" );
+     when constraint_error =>
+       err( "constraint error raised" );
+     end;
+  end if;
+end ParseDHTReserve;
+
+-----------------------------------------------------------------------------
+--  LENGTH
+--
+-- Syntax: n := dynamic_hash_tables.length( t );
+-- Ada:    N/A
+-----------------------------------------------------------------------------
+
+procedure ParseDHTLength( result : out unbounded_string; kind : out identifier ) is
+  tableId  : identifier;
+  theTable : resPtr;
+begin
+  kind := containers_count_type_t;
+  expect( dht_length_t );
+  ParseSingleTableParameter( tableId );
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( tableId ).value.all ), theTable );
+       result := to_unbounded_string( long_float( dht_util.Length( theTable.dsht ) ) );
+     end;
+  end if;
+end ParseDHTLength;
+
+-----------------------------------------------------------------------------
+--  STATS
+--
+-- Return the capacity, load factor, probe lengths and number of resizes
+-- as a JSON object.  This examines every slot in the table.
+-- Syntax: j := dynamic_hash_tables.stats( t );
+-- Ada:    N/A
+-----------------------------------------------------------------------------
+
+procedure ParseDHTStats( result : out unbounded_string; kind : out identifier ) is
+  tableId  : identifier;
+  theTable : resPtr;
+begin
+  kind := json_string_t;
+  expect( dht_stats_t );
+  ParseSingleTableParameter( tableId );
+  if isExecutingCommand then
+     declare
+       info : dht_util.aStringHashTableStats;
+     begin
+       findResource( to_resource_id( identifiers( tableId ).value.all ), theTable );
+       info := dht_util.Stats( theTable.dsht );
+       result := to_unbounded_string( "{""capacity"":" ) &
+         to_unbounded_string( long_float( info.capacity ) ) &
+         ",""length"":" & to_unbounded_string( long_float( info.length ) ) &
+         ",""load"":" & to_unbounded_string( long_float( info.load ) ) &
+         ",""max_probe"":" & to_unbounded_string( long_float( info.max_probe ) ) &
+         ",""average_probe"":" & to_unbounded_string( long_float( info.average_probe ) ) &
+         ",""resizes"":" & to_unbounded_string( long_float( info.resizes ) ) &
+         "}";
+     end;
+  end if;
+end ParseDHTStats;
+
 
 -----------------------------------------------------------------------------
 
@@ -608,6 +700,9 @@ begin
   declareProcedure( dht_prepend_t, "dynamic_hash_tables.prepend", ParseDHTPrepend'access );
   declareProcedure( dht_increment_t, "dynamic_hash_tables.increment", ParseDHTIncrement'access );
   declareProcedure( dht_decrement_t, "dynamic_hash_tables.decrement", ParseDHTDecrement'access );
+  declareProcedure( dht_reserve_t, "dynamic_hash_tables.reserve", ParseDHTReserve'access );
+  declareFunction(  dht_length_t, "dynamic_hash_tables.length", ParseDHTLength'access );
+  declareFunction(  dht_stats_t, "dynamic_hash_tables.stats", ParseDHTStats'access );
 
   --declareProcedure( dht_assemble_t, "dynamic_hash_tables.", 'access );
   --declareProcedure( dht_disassemble_t, "dynamic_hash_tables.", 'access );
@@ -0,0 +1,171 @@
+------------------------------------------------------------------------------
+-- Digest Package Parser                                                    --
+--                                                                          --
+-- Part of SparForte                                                        --
+-- Designed and Programmed by Ken O. Burtch                                 --
+------------------------------------------------------------------------------
+--                                                                          --
+--            Copyright (C) 2001-2020 Free Software Foundation              --
+--                                                                          --
+-- This is free software;  you can  redistribute it  and/or modify it under --
+-- terms of the  GNU General Public License as published  by the Free Soft- --
+-- ware  Foundation;  either version 2,  or (at your option) any later ver- --
+-- sion.  This is distributed in the hope that it will be useful, but WITH- --
+-- OUT ANY WARRANTY;  without even the  implied warranty of MERCHANTABILITY --
+-- or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License --
+-- for  more details.  You should have  received  a copy of the GNU General --
+-- Public License  distributed with this;  see file COPYING.  If not, write --
+-- to  the Free Software Foundation,  59 Temple Place - Suite 330,  Boston, --
+-- MA 02111-1307, USA.                                                      --
+--                                                                          --
+-- This is maintained at http://www.sparforte.com                           --
+--                                                                          --
+------------------------------------------------------------------------------
+
+with ada.strings.unbounded,
+    world,
+    scanner,
+    scanner_res,
+    digest_util,
+    parser_params;
+use ada.strings.unbounded,
+    world,
+    scanner,
+    scanner_res,
+    digest_util,
+    parser_params;
+
+package body parser_digest is
+
+------------------------------------------------------------------------------
+-- Digest package identifiers
+------------------------------------------------------------------------------
+
+digest_context_t     : identifier;
+digest_kind_t        : identifier;
+digest_kind_md5_t    : identifier;
+digest_kind_sha256_t : identifier;
+digest_kind_crc32_t  : identifier;
+digest_new_t         : identifier;
+digest_update_t      : identifier;
+digest_finish_t      : identifier;
+
+function toDigestKind( expr_val : unbounded_string ) return aDigestKind is
+  -- convert a digest.digest_kind value to the digest kind
+begin
+  return aDigestKind'val( natural'value( to_string( expr_val ) ) );
+end toDigestKind;
+
+procedure ParseDigestNew is
+  -- Syntax: digest.new( d, k )
+  -- Source: N/A
+  resId     : resHandleId;
+  ref       : reference;
+  expr_val  : unbounded_string;
+  expr_type : identifier;
+  theDigest : resPtr;
+begin
+  expect( digest_new_t );
+  ParseFirstOutParameter( ref, digest_context_t );
+  if baseTypesOK( ref.kind, digest_context_t ) then
+     ParseLastEnumParameter( expr_val, expr_type, digest_kind_t );
+  end if;
+  if isExecutingCommand then
+     begin
+       if not identifiers( ref.id ).resource then
+          identifiers( ref.id ).resource := true;
+          declareResource( resId, digest_context, getIdentifierBlock( ref.id ) );
+          AssignParameter( ref, to_unbounded_string( resId ) );
+          findResource( resId, theDigest );
+       else
+          -- Reuse existing resource
+          findResource( to_resource_id( identifiers( ref.id ).value.all ), theDigest );
+       end if;
+       StartDigest( theDigest.digest_ctx, toDigestKind( expr_val ) );
+     exception when others =>
+       err_exception_raised;
+     end;
+  end if;
+end ParseDigestNew;
+
+procedure ParseDigestUpdate is
+  -- Syntax: digest.update( d, s )
+  -- Source: N/A
+  digestId  : identifier;
+  expr_val  : unbounded_string;
+  expr_type : identifier;
+  theDigest : resPtr;
+begin
+  expect( digest_update_t );
+  ParseFirstInOutParameter( digestId, digest_context_t );
+  ParseLastStringParameter( expr_val, expr_type, string_t );
+  if isExecutingCommand then
+     if identifiers( digestId ).resource then
+        begin
+          findResource( to_resource_id( identifiers( digestId ).value.all ), theDigest );
+          if theDigest.digest_ctx.isStarted then
+             UpdateDigest( theDigest.digest_ctx, to_string( expr_val ) );
+          else
+             err( "digest has not been started with digest.new" );
+          end if;
+        exception when others =>
+          err_exception_raised;
+        end;
+     else
+        err( "digest has not been started with digest.new" );
+     end if;
+  end if;
+end ParseDigestUpdate;
+
+procedure ParseDigestFinish( result : out unbounded_string; kind : out identifier ) is
+  -- Syntax: s := digest.finish( d )
+  -- Source: N/A
+  digestId  : identifier;
+  theDigest : resPtr;
+begin
+  kind := string_t;
+  expect( digest_finish_t );
+  ParseSingleInOutParameter( digestId, digest_context_t );
+  if isExecutingCommand then
+     if identifiers( digestId ).resource then
+        begin
+          findResource( to_resource_id( identifiers( digestId ).value.all ), theDigest );
+          if theDigest.digest_ctx.isStarted then
+             FinishDigest( theDigest.digest_ctx, result );
+          else
+             err( "digest has not been started with digest.new" );
+          end if;
+        exception when others =>
+          err_exception_raised;
+        end;
+     else
+        err( "digest has not been started with digest.new" );
+     end if;
+  end if;
+end ParseDigestFinish;
+
+procedure StartupDigest is
+begin
+  declareNamespace( "digest" );
+  declareIdent( digest_context_t, "digest.context", positive_t, typeClass );
+  identifiers( digest_context_t ).usage := limitedUsage;
+  identifiers( digest_context_t ).resource := true;
+  declareIdent( digest_kind_t, "digest.digest_kind", root_enumerated_t, typeClass );
+  declareProcedure( digest_new_t, "digest.new", ParseDigestNew'access );
+  declareProcedure( digest_update_t, "digest.update", ParseDigestUpdate'access );
+  declareFunction( digest_finish_t, "digest.finish", ParseDigestFinish'access );
+  declareNamespaceClosed( "digest" );
+
+  declareNamespace( "digest_kind" );
+  declareStandardEnum( digest_kind_md5_t,    "digest_kind.md5",    digest_kind_t, "0" );
+  declareStandardEnum( digest_kind_sha256_t, "digest_kind.sha256", digest_kind_t, "1" );
+  declareStandardEnum( digest_kind_crc32_t,  "digest_kind.crc32",  digest_kind_t, "2" );
+  declareNamespaceClosed( "digest_kind" );
+end StartupDigest;
+
+procedure ShutdownDigest is
+begin
+  null;
+end ShutdownDigest;
+
+end parser_digest;
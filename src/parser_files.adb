@@ -28,9 +28,12 @@ with gnat.io_aux,
      ada.strings.unbounded,
      spar_os,
      string_util,
+     digest_util,
+     base64_util,
      world,
      scanner.calendar,
      parser_aux,
+     parser_params,
      parser,
      parser_cal;
 use  gnat.io_aux,
@@ -38,10 +41,13 @@ use  gnat.io_aux,
      ada.strings.unbounded,
      spar_os,
      string_util,
+     digest_util,
+     base64_util,
      world,
      scanner,
      scanner.calendar,
      parser_aux,
+     parser_params,
      parser,
      parser_cal;
 
@@ -68,6 +74,11 @@ files_size_t             : identifier;
 files_last_modified_t    : identifier;
 files_last_changed_t     : identifier;
 files_last_accessed_t    : identifier;
+files_md5_t              : identifier;
+files_sha256_t           : identifier;
+files_crc32_t            : identifier;
+files_encode_base64_t    : identifier;
+files_decode_base64_t    : identifier;
 
 --epoch        : time := time_of( 1970, 1, 1, 0.0 );
 --secondsInDay : day_duration := day_duration'last;
@@ -420,6 +431,80 @@ begin
   end if;
 end ParseFileLastAccessed;
 
+procedure ParseFileDigest( f : out unbounded_string; kind : out identifier;
+  funcId : identifier; digestKind : aDigestKind ) is
+  -- Syntax: files.md5( path ), files.sha256( path ), files.crc32( path );
+  -- Source: N/A
+  -- The file is read in blocks so it is never loaded into memory.
+  file_val  : unbounded_string;
+  file_type : identifier;
+  errno     : integer;
+begin
+  kind := string_t;
+  expect( funcId );
+  expect( symbol_t, "(" );
+  ParseExpression( file_val, file_type );
+  if baseTypesOK( file_type, string_t ) then
+     expect( symbol_t, ")" );
+  end if;
+  if isExecutingCommand then
+     DigestFile( to_string( file_val ), digestKind, f, errno );
+     if errno /= 0 then
+        err( "unable to read file: " & OSError( errno ) );
+     end if;
+  end if;
+end ParseFileDigest;
+
+procedure ParseFileMD5( f : out unbounded_string; kind : out identifier ) is
+begin
+  ParseFileDigest( f, kind, files_md5_t, md5_digest );
+end ParseFileMD5;
+
+procedure ParseFileSHA256( f : out unbounded_string; kind : out identifier ) is
+begin
+  ParseFileDigest( f, kind, files_sha256_t, sha256_digest );
+end ParseFileSHA256;
+
+procedure ParseFileCRC32( f : out unbounded_string; kind : out identifier ) is
+begin
+  ParseFileDigest( f, kind, files_crc32_t, crc32_digest );
+end ParseFileCRC32;
+
+procedure ParseFileBase64( funcId : identifier; isEncoding : boolean ) is
+  -- Syntax: files.encode_base64( from, to ), files.decode_base64( from, to );
+  -- Source: N/A
+  -- The file is converted in blocks so it is never loaded into memory.
+  from_val  : unbounded_string;
+  from_type : identifier;
+  to_val    : unbounded_string;
+  to_type   : identifier;
+  errno     : integer;
+begin
+  expect( funcId );
+  ParseFirstStringParameter( from_val, from_type, string_t );
+  ParseLastStringParameter( to_val, to_type, string_t );
+  if isExecutingCommand then
+     if isEncoding then
+        EncodeBase64File( to_string( from_val ), to_string( to_val ), errno );
+     else
+        DecodeBase64File( to_string( from_val ), to_string( to_val ), errno );
+     end if;
+     if errno /= 0 then
+        err( "unable to convert file: " & OSError( errno ) );
+     end if;
+  end if;
+end ParseFileBase64;
+
+procedure ParseFileEncodeBase64 is
+begin
+  ParseFileBase64( files_encode_base64_t, isEncoding => true );
+end ParseFileEncodeBase64;
+
+procedure ParseFileDecodeBase64 is
+begin
+  ParseFileBase64( files_decode_base64_t, isEncoding => false );
+end ParseFileDecodeBase64;
+
 procedure StartupFiles is
 begin
   declareNamespace( "files" );
@@ -440,6 +525,11 @@ begin
   declareFunction( files_last_modified_t, "files.last_modified", ParseFileLastModified'access );
   declareFunction( files_last_changed_t, "files.last_changed", ParseFileLastChanged'access );
   declareFunction( files_last_accessed_t, "files.last_accessed", ParseFileLastAccessed'access );
+  declareFunction( files_md5_t, "files.md5", ParseFileMD5'access );
+  declareFunction( files_sha256_t, "files.sha256", ParseFileSHA256'access );
+  declareFunction( files_crc32_t, "files.crc32", ParseFileCRC32'access );
+  declareProcedure( files_encode_base64_t, "files.encode_base64", ParseFileEncodeBase64'access );
+  declareProcedure( files_decode_base64_t, "files.decode_base64", ParseFileDecodeBase64'access );
   declareNamespaceClosed( "files" );
 end StartupFiles;
 
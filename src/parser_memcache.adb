@@ -25,21 +25,29 @@
 
 with gen_list,
     --ada.numerics.float_random,
+    ada.calendar.conversions,
     ada.strings.unbounded,
+    interfaces.c,
     user_io,
+    string_util,
     world,
     scanner,
+    parser,
     parser_params,
+    lru_util,
     pegasock.memcache.highread;
 use ada.strings,
     ada.strings.unbounded,
     user_io,
+    string_util,
     world,
     scanner,
+    parser,
     parser_params,
     pegasock,
     pegasock.memcache,
     pegasock.memcache.highread;
+use type ada.calendar.time;
 
 package body parser_memcache is
 
@@ -47,9 +55,13 @@ package body parser_memcache is
 -- Memcache package identifiers
 ------------------------------------------------------------------------------
 
-memcache_cluster_t               : identifier;
 memcache_cluster_type_t          : identifier;
 memcache_cluster_type_normal_t   : identifier;
+memcache_cluster_type_consistent_t : identifier;
+memcache_protocol_t              : identifier;
+memcache_protocol_text_t         : identifier;
+memcache_protocol_binary_t       : identifier;
+memcache_memcache_cas_t          : identifier;
 
 memcache_is_valid_memcache_key_t : identifier;
 memcache_new_cluster_t           : identifier;
@@ -57,13 +69,21 @@ memcache_clear_servers_t         : identifier;
 memcache_register_server_t       : identifier;
 memcache_set_cluster_name_t      : identifier;
 memcache_set_cluster_type_t      : identifier;
+memcache_key_movement_t          : identifier;
+memcache_set_protocol_t          : identifier;
 memcache_set_t                   : identifier;
 memcache_add_t                   : identifier;
 memcache_replace_t               : identifier;
 memcache_append_t                : identifier;
 memcache_prepend_t               : identifier;
 memcache_get_t                   : identifier;
+memcache_get_multi_t             : identifier;
 memcache_delete_t                : identifier;
+memcache_touch_t                 : identifier;
+memcache_gets_t                  : identifier;
+memcache_cas_t                   : identifier;
+memcache_set_quiet_t             : identifier;
+memcache_fence_t                 : identifier;
 memcache_stats_t                 : identifier;
 memcache_version_t               : identifier;
 memcache_flush_t                 : identifier;
@@ -82,6 +102,7 @@ highread_replace_t               : identifier;
 highread_append_t                : identifier;
 highread_prepend_t               : identifier;
 highread_get_t                   : identifier;
+highread_get_multi_t             : identifier;
 highread_delete_t                : identifier;
 highread_stats_t                 : identifier;
 highread_version_t               : identifier;
@@ -96,8 +117,9 @@ highread_flush_t                 : identifier;
 type aMemcacheClusterID is new natural;
 
 type aMemcacheClusterEntry is record
-  id      : aMemcacheClusterID := 0;
-  cluster : aMemcacheCluster;
+  id        : aMemcacheClusterID := 0;
+  cluster   : aMemcacheCluster;
+  nearCache : lru_util.anLruCache := lru_util.nullCache; -- pragma local_memcache
 end record;
 
 function ">="( left, right : aMemcacheClusterEntry ) return boolean is
@@ -200,6 +222,214 @@ begin
   end if;
 end checkRestrictedShell;
 
+--  PARSE KEY ARRAYS
+--
+-- Parse the key and value array parameters of get_multi.  Both must be
+-- string arrays.  The value array is marked as written.
+-----------------------------------------------------------------------------
+
+procedure ParseKeyArrays( keysId, valuesId : out identifier ) is
+begin
+  expect( symbol_t, "," );
+  ParseIdentifier( keysId );
+  if not (class_ok( keysId, varClass ) and identifiers( keysId ).list) then
+     err( "Array expected" );
+  elsif getUniType( identifiers( identifiers( keysId ).kind ).kind ) /= uni_string_t then
+     err( "string array expected" );
+  end if;
+  expect( symbol_t, "," );
+  ParseIdentifier( valuesId );
+  if not (class_ok( valuesId, varClass ) and identifiers( valuesId ).list) then
+     err( "Array expected" );
+  elsif getUniType( identifiers( identifiers( valuesId ).kind ).kind ) /= uni_string_t then
+     err( "string array expected" );
+  elsif syntax_check and then not error_found then
+     -- Mark the array as having been written for future tests.
+     identifiers( valuesId ).wasWritten := true;
+     identifiers( valuesId ).writtenByThread := getThreadName;
+  end if;
+  expect( symbol_t, ")" );
+end ParseKeyArrays;
+
+
+--  KEY ARRAYS OK
+--
+-- Check the key and value arrays before anything is sent to memcached:
+-- both must have elements, there must be a value for every key and every
+-- key must be a valid memcache key.  Report an error if not.
+-----------------------------------------------------------------------------
+
+function KeyArraysOK( keysId, valuesId : identifier ) return boolean is
+begin
+  if identifiers( keysId ).avalue = null then
+     err( "array " & optional_bold( to_string( identifiers( keysId ).name ) ) &
+          " has no elements" );
+     return false;
+  elsif identifiers( valuesId ).avalue = null then
+     err( "array " & optional_bold( to_string( identifiers( valuesId ).name ) ) &
+          " has no elements" );
+     return false;
+  elsif identifiers( valuesId ).avalue'length < identifiers( keysId ).avalue'length then
+     err( "value array has fewer elements than the key array" );
+     return false;
+  end if;
+  for i in identifiers( keysId ).avalue'range loop
+      if not isValidMemcacheKey( identifiers( keysId ).avalue( i ) ) then
+         err( "key """ & toSecureData( to_string( identifiers( keysId ).avalue( i ) ) ) &
+              """ is not a valid memcache key" );
+         return false;
+      end if;
+  end loop;
+  return true;
+end KeyArraysOK;
+
+
+--  GET KEYS
+--
+-- Copy the keys from a SparForte array.
+-----------------------------------------------------------------------------
+
+procedure GetKeys( keysId : identifier; names : out aMemcacheKeyList ) is
+begin
+  for i in names'range loop
+      names( i ) := identifiers( keysId ).avalue( identifiers( keysId ).avalue'first + long_integer( i-1 ) );
+  end loop;
+end GetKeys;
+
+
+--  PUT VALUES
+--
+-- Copy the values into a SparForte array.  KeyArraysOK has checked that
+-- it is long enough.
+-----------------------------------------------------------------------------
+
+procedure PutValues( valuesId : identifier; values : aMemcacheKeyList ) is
+begin
+  for i in values'range loop
+      identifiers( valuesId ).avalue( identifiers( valuesId ).avalue'first + long_integer( i-1 ) ) := values( i );
+  end loop;
+end PutValues;
+
+
+--  GET MULTI CACHED
+--
+-- get_multi for a cluster with a local cache.  Only the keys that are not
+-- cached are fetched from the servers, and the values found are cached.
+-----------------------------------------------------------------------------
+
+procedure GetMultiCached( cluster_entry : in out aMemcacheClusterEntry;
+   names : aMemcacheKeyList; values : out aMemcacheKeyList ) is
+  missing : aMemcacheKeyList( names'range );
+  where   : array( names'range ) of positive;
+  found   : boolean;
+  count   : natural := 0;
+begin
+  for i in names'range loop
+      lru_util.Find( cluster_entry.nearCache, names( i ), values( i ), found );
+      if not found then
+         count := count + 1;
+         missing( count ) := names( i );
+         where( count ) := i;
+      end if;
+  end loop;
+  if count > 0 then
+     declare
+        fetched : aMemcacheKeyList( 1..count );
+     begin
+        GetMulti( cluster_entry.cluster, missing( 1..count ), fetched );
+        for i in fetched'range loop
+            values( where( i ) ) := fetched( i );
+            if length( fetched( i ) ) > 0 then
+               lru_util.Store( cluster_entry.nearCache, missing( i ), fetched( i ) );
+            end if;
+        end loop;
+     end;
+  end if;
+end GetMultiCached;
+
+
+--  PARSE OPTIONAL TTL
+--
+-- Parse an optional last parameter, the seconds until a value expires,
+-- and the closing parenthesis.  ttl_val is empty if there is none.
+-----------------------------------------------------------------------------
+
+procedure ParseOptionalTTL( ttl_val : out unbounded_string ) is
+  ttl_type : identifier;
+begin
+  ttl_val := null_unbounded_string;
+  if token = symbol_t and identifiers( token ).value.all = "," then
+     ParseLastNumericParameter( ttl_val, ttl_type, natural_t );
+  else
+     expect( symbol_t, ")" );
+  end if;
+end ParseOptionalTTL;
+
+
+--  TO EXPIRY
+--
+-- The expiry for an optional ttl parameter.  Zero (never) if there is none.
+-----------------------------------------------------------------------------
+
+function ToExpiry( ttl_val : unbounded_string ) return natural is
+begin
+  if length( ttl_val ) = 0 then
+     return 0;
+  end if;
+  return natural( to_numeric( ttl_val ) );
+end ToExpiry;
+
+
+--  FORGET CACHED
+--
+-- Discard the local copy of a key being stored or touched with a memcache
+-- expiry, and limit how long a value read for it later can be cached so
+-- that it does not outlive the expiry in memcached.  Like memcached, an
+-- expiry over 30 days is a Unix time.
+-----------------------------------------------------------------------------
+
+procedure ForgetCached( nearCache : lru_util.anLruCache; key : unbounded_string; expiry : natural ) is
+  maxRelativeExpiry : constant natural := 60*60*24*30;
+begin
+  if not lru_util.IsEnabled( nearCache ) then
+     return;
+  elsif expiry = 0 then
+     lru_util.ClearDeadline( nearCache, key );
+  elsif expiry <= maxRelativeExpiry then
+     lru_util.SetDeadline( nearCache, key, ada.calendar.clock + duration( expiry ) );
+  else
+     lru_util.SetDeadline( nearCache, key,
+        ada.calendar.conversions.to_ada_time( interfaces.c.long( expiry ) ) );
+  end if;
+end ForgetCached;
+
+
+--  LOCAL CACHE STATS
+--
+-- The stats lines for a cluster's local cache, in the same "server name
+-- value" form as the server stats.
+-----------------------------------------------------------------------------
+
+function LocalCacheStats( cache : lru_util.anLruCache ) return unbounded_string is
+  counters : constant lru_util.anLruCacheStats := lru_util.Stats( cache );
+  lookups  : constant long_integer := counters.hits + counters.misses;
+  hitRate  : natural := 0;
+  result   : unbounded_string;
+begin
+  if lookups > 0 then
+     hitRate := natural( counters.hits * 100 / lookups );
+  end if;
+  result := result & " local hits" & counters.hits'img & ASCII.LF;
+  result := result & " local misses" & counters.misses'img & ASCII.LF;
+  result := result & " local hit_rate" & hitRate'img & ASCII.LF;
+  result := result & " local expired" & counters.expired'img & ASCII.LF;
+  result := result & " local evictions" & counters.evictions'img & ASCII.LF;
+  result := result & " local curr_items" & counters.items'img & ASCII.LF;
+  result := result & " local bytes" & counters.bytes'img & ASCII.LF;
+  result := result & " local limit_maxbytes" & counters.maxBytes'img & ASCII.LF;
+  return result;
+end LocalCacheStats;
+
 ----------------------------------------------------------------------------
 -- PARSE THE MEMCACHE PACKAGE
 ----------------------------------------------------------------------------
@@ -248,30 +478,41 @@ begin
 end ParseMemcacheNewCluster;
 
 procedure ParseMemcacheRegisterServer is
--- Syntax: register_server( cluster, host, port )
+-- Syntax: register_server( cluster, host, port [, weight] )
 -- Source: pegasock.memcache.register_server
   cluster_entry : aMemcacheClusterEntry;
   expr_val : unbounded_string;
   expr_type : identifier;
   expr_val2 : unbounded_string;
   expr_type2 : identifier;
+  weight_val : unbounded_string;
+  weight_type : identifier;
   cluster_id : identifier;
 begin
   checkRestrictedShell;
   expect( memcache_register_server_t );
   ParseFirstInOutParameter( cluster_id, memcache_cluster_t  );
   ParseNextStringParameter( expr_val, expr_type );
-  ParseLastNumericParameter( expr_val2, expr_type2, natural_t );
+  ParseNextNumericParameter( expr_val2, expr_type2, natural_t );
+  if token = symbol_t and identifiers( token ).value.all = "," then
+     ParseLastNumericParameter( weight_val, weight_type, positive_t );
+  else
+     expect( symbol_t, ")" );
+  end if;
   checkMemcacheRestriction;
   if isExecutingCommand then
      declare
         cluster : constant aMemcacheClusterID := aMemcacheClusterID( to_numeric( identifiers( cluster_id ).value.all ) );
         port : constant natural := natural( to_numeric( expr_val2 ) );
+        weight : aMemcacheServerWeight := 1;
         clusterIndex : memcacheClusterList.aListIndex;
      begin
+        if length( weight_val ) > 0 then
+           weight := aMemcacheServerWeight( to_numeric( weight_val ) );
+        end if;
         GetCluster( cluster, cluster_entry, clusterIndex );
         if clusterIndex /= 0 then
-           RegisterServer( cluster_entry.cluster, expr_val, port );
+           RegisterServer( cluster_entry.cluster, expr_val, port, weight );
            memcacheClusterList.Replace( memcacheCluster, clusterIndex, cluster_entry );
         end if;
      exception when others =>
@@ -297,6 +538,7 @@ begin
      begin
         GetCluster( cluster, cluster_entry, clusterIndex );
         if clusterIndex /= 0 then
+           lru_util.Clear( cluster_entry.nearCache );
            ClearServers( cluster_entry.cluster );
            memcacheClusterList.Replace( memcacheCluster, clusterIndex, cluster_entry );
         end if;
@@ -373,21 +615,92 @@ begin
   end if;
 end ParseMemcacheSetClusterType;
 
+procedure ParseMemcacheKeyMovement( result : out unbounded_string; kind : out identifier ) is
+-- Syntax: key_movement( cluster )
+-- Source: pegasock.memcache.keyMovement
+  cluster_entry : aMemcacheClusterEntry;
+  cluster_id : identifier;
+  ratio : float;
+begin
+  kind := float_t;
+  checkRestrictedShell;
+  expect( memcache_key_movement_t );
+  ParseSingleInOutParameter( cluster_id, memcache_cluster_t  );
+  checkMemcacheRestriction;
+  if isExecutingCommand then
+     declare
+        cluster : constant aMemcacheClusterID := aMemcacheClusterID( to_numeric( identifiers( cluster_id ).value.all ) );
+        clusterIndex : memcacheClusterList.aListIndex;
+     begin
+        GetCluster( cluster, cluster_entry, clusterIndex );
+        if clusterIndex /= 0 then
+           KeyMovement( cluster_entry.cluster, ratio );
+           memcacheClusterList.Replace( memcacheCluster, clusterIndex, cluster_entry );
+           result := to_unbounded_string( long_float( ratio ) );
+        end if;
+     exception when others =>
+        err_exception_raised;
+     end;
+  end if;
+end ParseMemcacheKeyMovement;
+
+procedure ParseMemcacheSetProtocol is
+-- Syntax: set_protocol( cluster, protocol )
+-- Source: pegasock.memcache.setProtocol
+-- Example:memcache.set_protocol( c, memcache.memcache_protocol.binary )
+  cluster_entry : aMemcacheClusterEntry;
+  expr_val : unbounded_string;
+  expr_type : identifier;
+  cluster_id : identifier;
+  protocol : aMemcacheProtocol;
+begin
+  checkRestrictedShell;
+  expect( memcache_set_protocol_t );
+  ParseFirstInOutParameter( cluster_id, memcache_cluster_t  );
+  ParseLastEnumParameter( expr_val, expr_type, memcache_protocol_t );
+  checkMemcacheRestriction;
+  if isExecutingCommand then
+     begin
+        protocol := aMemcacheProtocol'val( natural( to_numeric( expr_val ) ) );
+     exception when constraint_error =>
+        err( "constraint error" );
+        return;
+     when others =>
+        err_exception_raised;
+        return;
+     end;
+     declare
+        cluster : constant aMemcacheClusterID := aMemcacheClusterID( to_numeric( identifiers( cluster_id ).value.all ) );
+        clusterIndex : memcacheClusterList.aListIndex;
+     begin
+        GetCluster( cluster, cluster_entry, clusterIndex );
+        if clusterIndex /= 0 then
+           SetProtocol( cluster_entry.cluster, protocol );
+           memcacheClusterList.Replace( memcacheCluster, clusterIndex, cluster_entry );
+        end if;
+     exception when others =>
+        err_exception_raised;
+     end;
+  end if;
+end ParseMemcacheSetProtocol;
+
 procedure ParseMemcacheSet is
--- Syntax: set( cluster, key, value )
+-- Syntax: set( cluster, key, value [, ttl] )
 -- Source: pegasock.memcache.set
   cluster_entry : aMemcacheClusterEntry;
   expr_val : unbounded_string;
   expr_type : identifier;
   expr_val2 : unbounded_string;
   expr_type2 : identifier;
+  ttl_val : unbounded_string;
   cluster_id : identifier;
 begin
   checkRestrictedShell;
   expect( memcache_set_t );
   ParseFirstInOutParameter( cluster_id, memcache_cluster_t  );
   ParseNextStringParameter( expr_val, expr_type );
-  ParseLastStringParameter( expr_val2, expr_type2 );
+  ParseNextStringParameter( expr_val2, expr_type2 );
+  ParseOptionalTTL( ttl_val );
   checkMemcacheRestriction;
   if isExecutingCommand then
      declare
@@ -396,7 +709,8 @@ begin
      begin
         GetCluster( cluster, cluster_entry, clusterIndex );
         if clusterIndex /= 0 then
-           Set( cluster_entry.cluster, expr_val, expr_val2 );
+           ForgetCached( cluster_entry.nearCache, expr_val, ToExpiry( ttl_val ) );
+           Set( cluster_entry.cluster, expr_val, expr_val2, ToExpiry( ttl_val ) );
            memcacheClusterList.Replace( memcacheCluster, clusterIndex, cluster_entry );
         end if;
      exception when constraint_error =>
@@ -408,20 +722,22 @@ begin
 end ParseMemcacheSet;
 
 procedure ParseMemcacheAdd is
--- Syntax: add( cluster, key, value )
+-- Syntax: add( cluster, key, value [, ttl] )
 -- Source: pegasock.memcache.add
   cluster_entry : aMemcacheClusterEntry;
   expr_val : unbounded_string;
   expr_type : identifier;
   expr_val2 : unbounded_string;
   expr_type2 : identifier;
+  ttl_val : unbounded_string;
   cluster_id : identifier;
 begin
   checkRestrictedShell;
   expect( memcache_add_t );
   ParseFirstInOutParameter( cluster_id, memcache_cluster_t  );
   ParseNextStringParameter( expr_val, expr_type );
-  ParseLastStringParameter( expr_val2, expr_type2 );
+  ParseNextStringParameter( expr_val2, expr_type2 );
+  ParseOptionalTTL( ttl_val );
   checkMemcacheRestriction;
   if isExecutingCommand then
      declare
@@ -430,7 +746,8 @@ begin
      begin
         GetCluster( cluster, cluster_entry, clusterIndex );
         if clusterIndex /= 0 then
-           Add( cluster_entry.cluster, expr_val, expr_val2 );
+           ForgetCached( cluster_entry.nearCache, expr_val, ToExpiry( ttl_val ) );
+           Add( cluster_entry.cluster, expr_val, expr_val2, ToExpiry( ttl_val ) );
            memcacheClusterList.Replace( memcacheCluster, clusterIndex, cluster_entry );
         end if;
      exception when constraint_error =>
@@ -442,20 +759,22 @@ begin
 end ParseMemcacheAdd;
 
 procedure ParseMemcacheReplace is
--- Syntax: replace( cluster, key, value )
+-- Syntax: replace( cluster, key, value [, ttl] )
 -- Source: pegasock.memcache.replace
   cluster_entry : aMemcacheClusterEntry;
   expr_val : unbounded_string;
   expr_type : identifier;
   expr_val2 : unbounded_string;
   expr_type2 : identifier;
+  ttl_val : unbounded_string;
   cluster_id : identifier;
 begin
   checkRestrictedShell;
   expect( memcache_replace_t );
   ParseFirstInOutParameter( cluster_id, memcache_cluster_t  );
   ParseNextStringParameter( expr_val, expr_type );
-  ParseLastStringParameter( expr_val2, expr_type2 );
+  ParseNextStringParameter( expr_val2, expr_type2 );
+  ParseOptionalTTL( ttl_val );
   checkMemcacheRestriction;
   if isExecutingCommand then
      declare
@@ -464,7 +783,8 @@ begin
      begin
         GetCluster( cluster, cluster_entry, clusterIndex );
         if clusterIndex /= 0 then
-           Replace( cluster_entry.cluster, expr_val, expr_val2 );
+           ForgetCached( cluster_entry.nearCache, expr_val, ToExpiry( ttl_val ) );
+           Replace( cluster_entry.cluster, expr_val, expr_val2, ToExpiry( ttl_val ) );
            memcacheClusterList.Replace( memcacheCluster, clusterIndex, cluster_entry );
         end if;
      exception when others =>
@@ -496,6 +816,7 @@ begin
      begin
         GetCluster( cluster, cluster_entry, clusterIndex );
         if clusterIndex /= 0 then
+           lru_util.Remove( cluster_entry.nearCache, expr_val );
            Append( cluster_entry.cluster,expr_val, expr_val2 );
            memcacheClusterList.Replace( memcacheCluster, clusterIndex, cluster_entry );
         end if;
@@ -528,6 +849,7 @@ begin
      begin
         GetCluster( cluster, cluster_entry, clusterIndex );
         if clusterIndex /= 0 then
+           lru_util.Remove( cluster_entry.nearCache, expr_val );
            Prepend( cluster_entry.cluster, expr_val, expr_val2 );
            memcacheClusterList.Replace( memcacheCluster, clusterIndex, cluster_entry );
         end if;
@@ -540,6 +862,7 @@ end ParseMemcachePrepend;
 procedure ParseMemcacheGet( result : out unbounded_string; kind : out identifier ) is
 -- Syntax: value := get( cluster, key )
 -- Source: pegasock.memcache.get
+-- Checks the cluster's local cache first (pragma local_memcache).
   cluster_entry : aMemcacheClusterEntry;
   expr_val : unbounded_string;
   expr_type : identifier;
@@ -555,11 +878,19 @@ begin
      declare
         cluster : constant aMemcacheClusterID := aMemcacheClusterID( to_numeric( identifiers( cluster_id ).value.all ) );
         clusterIndex : memcacheClusterList.aListIndex;
+        found : boolean;
      begin
         GetCluster( cluster, cluster_entry, clusterIndex );
         if clusterIndex /= 0 then
-           Get( cluster_entry.cluster, expr_val, result );
-           memcacheClusterList.Replace( memcacheCluster, clusterIndex, cluster_entry );
+           lru_util.Find( cluster_entry.nearCache, expr_val, result, found );
+           if not found then
+              Get( cluster_entry.cluster, expr_val, result );
+              memcacheClusterList.Replace( memcacheCluster, clusterIndex, cluster_entry );
+              -- missing keys are not cached: they may be set by another process
+              if length( result ) > 0 then
+                 lru_util.Store( cluster_entry.nearCache, expr_val, result );
+              end if;
+           end if;
         end if;
      exception when constraint_error =>
         err( "no memcache servers registered" );
@@ -569,6 +900,45 @@ begin
   end if;
 end ParseMemcacheGet;
 
+procedure ParseMemcacheGetMulti is
+-- Syntax: get_multi( cluster, keys, values )
+-- Source: pegasock.memcache.getMulti
+  cluster_entry : aMemcacheClusterEntry;
+  cluster_id : identifier;
+  keys_id : identifier;
+  values_id : identifier;
+begin
+  checkRestrictedShell;
+  expect( memcache_get_multi_t );
+  ParseFirstInOutParameter( cluster_id, memcache_cluster_t  );
+  ParseKeyArrays( keys_id, values_id );
+  checkMemcacheRestriction;
+  if isExecutingCommand and then KeyArraysOK( keys_id, values_id ) then
+     declare
+        cluster : constant aMemcacheClusterID := aMemcacheClusterID( to_numeric( identifiers( cluster_id ).value.all ) );
+        clusterIndex : memcacheClusterList.aListIndex;
+        names  : aMemcacheKeyList( 1..natural( identifiers( keys_id ).avalue'length ) );
+        values : aMemcacheKeyList( names'range );
+     begin
+        GetCluster( cluster, cluster_entry, clusterIndex );
+        if clusterIndex /= 0 then
+           GetKeys( keys_id, names );
+           if lru_util.IsEnabled( cluster_entry.nearCache ) then
+              GetMultiCached( cluster_entry, names, values );
+           else
+              GetMulti( cluster_entry.cluster, names, values );
+           end if;
+           memcacheClusterList.Replace( memcacheCluster, clusterIndex, cluster_entry );
+           PutValues( values_id, values );
+        end if;
+     exception when constraint_error =>
+        err( "no memcache servers registered" );
+     when others =>
+        err_exception_raised;
+     end;
+  end if;
+end ParseMemcacheGetMulti;
+
 procedure ParseMemcacheDelete is
 -- Syntax: delete( cluster, key )
 -- Source: pegasock.memcache.delete
@@ -589,6 +959,7 @@ begin
      begin
         GetCluster( cluster, cluster_entry, clusterIndex );
         if clusterIndex /= 0 then
+           lru_util.Remove( cluster_entry.nearCache, expr_val );
            Delete( cluster_entry.cluster, expr_val );
            memcacheClusterList.Replace( memcacheCluster, clusterIndex, cluster_entry );
         end if;
@@ -600,6 +971,200 @@ begin
   end if;
 end ParseMemcacheDelete;
 
+procedure ParseMemcacheTouch is
+-- Syntax: touch( cluster, key, ttl )
+-- Source: pegasock.memcache.touch
+  cluster_entry : aMemcacheClusterEntry;
+  expr_val : unbounded_string;
+  expr_type : identifier;
+  ttl_val : unbounded_string;
+  ttl_type : identifier;
+  cluster_id : identifier;
+begin
+  checkRestrictedShell;
+  expect( memcache_touch_t );
+  ParseFirstInOutParameter( cluster_id, memcache_cluster_t  );
+  ParseNextStringParameter( expr_val, expr_type );
+  ParseLastNumericParameter( ttl_val, ttl_type, natural_t );
+  checkMemcacheRestriction;
+  if isExecutingCommand then
+     declare
+        cluster : constant aMemcacheClusterID := aMemcacheClusterID( to_numeric( identifiers( cluster_id ).value.all ) );
+        clusterIndex : memcacheClusterList.aListIndex;
+     begin
+        GetCluster( cluster, cluster_entry, clusterIndex );
+        if clusterIndex /= 0 then
+           -- the local copy would outlive the new expiry
+           ForgetCached( cluster_entry.nearCache, expr_val, ToExpiry( ttl_val ) );
+           Touch( cluster_entry.cluster, expr_val, ToExpiry( ttl_val ) );
+           memcacheClusterList.Replace( memcacheCluster, clusterIndex, cluster_entry );
+        end if;
+     exception when constraint_error =>
+        err( "no memcache servers registered" );
+     when others =>
+        err_exception_raised;
+     end;
+  end if;
+end ParseMemcacheTouch;
+
+procedure ParseMemcacheGets is
+-- Syntax: gets( cluster, key, value, cas )
+-- Source: pegasock.memcache.gets
+-- The local cache is not used: the value must match the CAS.
+  cluster_entry : aMemcacheClusterEntry;
+  expr_val : unbounded_string;
+  expr_type : identifier;
+  cluster_id : identifier;
+  valueRef : reference;
+  casRef : reference;
+begin
+  checkRestrictedShell;
+  expect( memcache_gets_t );
+  ParseFirstInOutParameter( cluster_id, memcache_cluster_t  );
+  ParseNextStringParameter( expr_val, expr_type );
+  ParseNextOutParameter( valueRef, string_t );
+  baseTypesOK( valueRef.kind, string_t );
+  ParseLastOutParameter( casRef, memcache_memcache_cas_t );
+  baseTypesOK( casRef.kind, memcache_memcache_cas_t );
+  checkMemcacheRestriction;
+  if isExecutingCommand then
+     declare
+        cluster : constant aMemcacheClusterID := aMemcacheClusterID( to_numeric( identifiers( cluster_id ).value.all ) );
+        clusterIndex : memcacheClusterList.aListIndex;
+        value : unbounded_string;
+        cas : aMemcacheCAS;
+     begin
+        GetCluster( cluster, cluster_entry, clusterIndex );
+        if clusterIndex /= 0 then
+           Gets( cluster_entry.cluster, expr_val, value, cas );
+           memcacheClusterList.Replace( memcacheCluster, clusterIndex, cluster_entry );
+           AssignParameter( valueRef, value );
+           AssignParameter( casRef, trim( to_unbounded_string( cas'img ), left ) );
+        end if;
+     exception when constraint_error =>
+        err( "no memcache servers registered" );
+     when others =>
+        err_exception_raised;
+     end;
+  end if;
+end ParseMemcacheGets;
+
+procedure ParseMemcacheCAS( result : out unbounded_string; kind : out identifier ) is
+-- Syntax: b := cas( cluster, key, value, cas [, ttl] )
+-- Source: pegasock.memcache.compareAndSwap
+  cluster_entry : aMemcacheClusterEntry;
+  expr_val : unbounded_string;
+  expr_type : identifier;
+  expr_val2 : unbounded_string;
+  expr_type2 : identifier;
+  cas_val : unbounded_string;
+  cas_type : identifier;
+  ttl_val : unbounded_string;
+  cluster_id : identifier;
+begin
+  kind := boolean_t;
+  checkRestrictedShell;
+  expect( memcache_cas_t );
+  ParseFirstInOutParameter( cluster_id, memcache_cluster_t  );
+  ParseNextStringParameter( expr_val, expr_type );
+  ParseNextStringParameter( expr_val2, expr_type2 );
+  ParseNextStringParameter( cas_val, cas_type, memcache_memcache_cas_t );
+  ParseOptionalTTL( ttl_val );
+  checkMemcacheRestriction;
+  if isExecutingCommand then
+     declare
+        cluster : constant aMemcacheClusterID := aMemcacheClusterID( to_numeric( identifiers( cluster_id ).value.all ) );
+        clusterIndex : memcacheClusterList.aListIndex;
+        cas : aMemcacheCAS;
+        stored : boolean;
+     begin
+        begin
+           cas := aMemcacheCAS'value( to_string( cas_val ) );
+        exception when constraint_error =>
+           err( "cas value expected" );
+           return;
+        end;
+        GetCluster( cluster, cluster_entry, clusterIndex );
+        if clusterIndex /= 0 then
+           ForgetCached( cluster_entry.nearCache, expr_val, ToExpiry( ttl_val ) );
+           CompareAndSwap( cluster_entry.cluster, expr_val, expr_val2, cas, stored, ToExpiry( ttl_val ) );
+           memcacheClusterList.Replace( memcacheCluster, clusterIndex, cluster_entry );
+           result := to_bush_boolean( stored );
+        end if;
+     exception when constraint_error =>
+        err( "no memcache servers registered" );
+     when others =>
+        err_exception_raised;
+     end;
+  end if;
+end ParseMemcacheCAS;
+
+procedure ParseMemcacheSetQuiet is
+-- Syntax: set_quiet( cluster, key, value [, ttl] )
+-- Source: pegasock.memcache.setQuiet
+  cluster_entry : aMemcacheClusterEntry;
+  expr_val : unbounded_string;
+  expr_type : identifier;
+  expr_val2 : unbounded_string;
+  expr_type2 : identifier;
+  ttl_val : unbounded_string;
+  cluster_id : identifier;
+begin
+  checkRestrictedShell;
+  expect( memcache_set_quiet_t );
+  ParseFirstInOutParameter( cluster_id, memcache_cluster_t  );
+  ParseNextStringParameter( expr_val, expr_type );
+  ParseNextStringParameter( expr_val2, expr_type2 );
+  ParseOptionalTTL( ttl_val );
+  checkMemcacheRestriction;
+  if isExecutingCommand then
+     declare
+        cluster : constant aMemcacheClusterID := aMemcacheClusterID( to_numeric( identifiers( cluster_id ).value.all ) );
+        clusterIndex : memcacheClusterList.aListIndex;
+     begin
+        GetCluster( cluster, cluster_entry, clusterIndex );
+        if clusterIndex /= 0 then
+           ForgetCached( cluster_entry.nearCache, expr_val, ToExpiry( ttl_val ) );
+           SetQuiet( cluster_entry.cluster, expr_val, expr_val2, ToExpiry( ttl_val ) );
+           memcacheClusterList.Replace( memcacheCluster, clusterIndex, cluster_entry );
+        end if;
+     exception when constraint_error =>
+        err( "no memcache servers registered" );
+     when others =>
+        err_exception_raised;
+     end;
+  end if;
+end ParseMemcacheSetQuiet;
+
+procedure ParseMemcacheFence( result : out unbounded_string; kind : out identifier ) is
+-- Syntax: n := fence( cluster )
+-- Source: pegasock.memcache.fence
+  cluster_entry : aMemcacheClusterEntry;
+  cluster_id : identifier;
+  failures : natural;
+begin
+  kind := natural_t;
+  checkRestrictedShell;
+  expect( memcache_fence_t );
+  ParseSingleInOutParameter( cluster_id, memcache_cluster_t  );
+  checkMemcacheRestriction;
+  if isExecutingCommand then
+     declare
+        cluster : constant aMemcacheClusterID := aMemcacheClusterID( to_numeric( identifiers( cluster_id ).value.all ) );
+        clusterIndex : memcacheClusterList.aListIndex;
+     begin
+        GetCluster( cluster, cluster_entry, clusterIndex );
+        if clusterIndex /= 0 then
+           Fence( cluster_entry.cluster, failures );
+           memcacheClusterList.Replace( memcacheCluster, clusterIndex, cluster_entry );
+           result := to_unbounded_string( long_float( failures ) );
+        end if;
+     exception when others =>
+        err_exception_raised;
+     end;
+  end if;
+end ParseMemcacheFence;
+
 procedure ParseMemcacheStats( result : out unbounded_string; kind : out identifier ) is
 -- Syntax: stats( cluster )
 -- Source: pegasock.memcache.stats
@@ -620,6 +1185,9 @@ begin
         if clusterIndex /= 0 then
            Stats( cluster_entry.cluster, result );
            memcacheClusterList.Replace( memcacheCluster, clusterIndex, cluster_entry );
+           if lru_util.IsEnabled( cluster_entry.nearCache ) then
+              result := result & LocalCacheStats( cluster_entry.nearCache );
+           end if;
         end if;
      exception when others =>
         err_exception_raised;
@@ -673,6 +1241,7 @@ begin
      begin
         GetCluster( cluster, cluster_entry, clusterIndex );
         if clusterIndex /= 0 then
+           lru_util.Clear( cluster_entry.nearCache );
            Flush( cluster_entry.cluster );
            memcacheClusterList.Replace( memcacheCluster, clusterIndex, cluster_entry );
         end if;
@@ -682,6 +1251,28 @@ begin
   end if;
 end ParseMemcacheFlush;
 
+procedure SetLocalMemcache( cluster_id : identifier; maxBytes : natural; ttl : duration ) is
+-- Syntax: pragma local_memcache( cluster, bytes, seconds )
+-- Source: lru_util.Configure
+  cluster_entry : aMemcacheClusterEntry;
+begin
+  checkMemcacheRestriction;
+  if isExecutingCommand then
+     declare
+        cluster : constant aMemcacheClusterID := aMemcacheClusterID( to_numeric( identifiers( cluster_id ).value.all ) );
+        clusterIndex : memcacheClusterList.aListIndex;
+     begin
+        GetCluster( cluster, cluster_entry, clusterIndex );
+        if clusterIndex /= 0 then
+           lru_util.Configure( cluster_entry.nearCache, maxBytes, ttl );
+           memcacheClusterList.Replace( memcacheCluster, clusterIndex, cluster_entry );
+        end if;
+     exception when others =>
+        err_exception_raised;
+     end;
+  end if;
+end SetLocalMemcache;
+
 
 ----------------------------------------------------------------------------
 -- PARSE THE MEMCACHE HIGHREAD PACKAGE
@@ -1066,6 +1657,41 @@ begin
   end if;
 end ParseHighreadGet;
 
+procedure ParseHighreadGetMulti is
+-- Syntax: get_multi( cluster, keys, values )
+-- Source: pegasock.memcache.highread.getMulti
+  cluster_entry : aMemcacheDualClusterEntry;
+  cluster_id : identifier;
+  keys_id : identifier;
+  values_id : identifier;
+begin
+  checkRestrictedShell;
+  expect( highread_get_multi_t );
+  ParseFirstInOutParameter( cluster_id, highread_cluster_t  );
+  ParseKeyArrays( keys_id, values_id );
+  checkMemcacheRestriction;
+  if isExecutingCommand and then KeyArraysOK( keys_id, values_id ) then
+     declare
+        cluster : constant aMemcacheDualClusterID := aMemcacheDualClusterID( to_numeric( identifiers( cluster_id ).value.all ) );
+        clusterIndex : memcacheDualClusterList.aListIndex;
+        names  : aMemcacheKeyList( 1..natural( identifiers( keys_id ).avalue'length ) );
+        values : aMemcacheKeyList( names'range );
+     begin
+        GetCluster( cluster, cluster_entry, clusterIndex );
+        if clusterIndex /= 0 then
+           GetKeys( keys_id, names );
+           GetMulti( cluster_entry.cluster, names, values );
+           memcacheDualClusterList.Replace( memcacheDualCluster, clusterIndex, cluster_entry );
+           PutValues( values_id, values );
+        end if;
+     exception when constraint_error =>
+        err( "no memcache servers registered" );
+     when others =>
+        err_exception_raised;
+     end;
+  end if;
+end ParseHighreadGetMulti;
+
 procedure ParseHighreadDelete is
 -- Syntax: delete( cluster, key )
 -- Source: pegasock.memcache.highread.delete
@@ -1194,6 +1820,11 @@ begin
   -- identifiers( memcache_cluster_t ).resource := true;
   declareIdent( memcache_cluster_type_t, "memcache.memcache_cluster_type", root_enumerated_t, typeClass );
   declareStandardConstant( memcache_cluster_type_normal_t, "memcache.memcache_cluster_type.normal", memcache_cluster_type_t, "0" );
+  declareStandardConstant( memcache_cluster_type_consistent_t, "memcache.memcache_cluster_type.consistent", memcache_cluster_type_t, "1" );
+  declareIdent( memcache_protocol_t, "memcache.memcache_protocol", root_enumerated_t, typeClass );
+  declareStandardConstant( memcache_protocol_text_t, "memcache.memcache_protocol.text", memcache_protocol_t, "0" );
+  declareStandardConstant( memcache_protocol_binary_t, "memcache.memcache_protocol.binary", memcache_protocol_t, "1" );
+  declareIdent( memcache_memcache_cas_t, "memcache.memcache_cas", string_t, typeClass );
 
   declareFunction(  memcache_is_valid_memcache_key_t, "memcache.is_valid_memcache_key", ParseMemcacheIsValidMemcacheKey'access );
   declareFunction( memcache_new_cluster_t, "memcache.new_cluster", ParseMemcacheNewCluster'access  );
@@ -1201,13 +1832,21 @@ begin
   declareProcedure( memcache_clear_servers_t, "memcache.clear_servers", ParseMemcacheClearServers'access );
   declareProcedure( memcache_set_cluster_name_t, "memcache.set_cluster_name", ParseMemcacheSetClusterName'access );
   declareProcedure( memcache_set_cluster_type_t, "memcache.set_cluster_type", ParseMemcacheSetClusterType'access );
+  declareFunction(  memcache_key_movement_t, "memcache.key_movement", ParseMemcacheKeyMovement'access );
+  declareProcedure( memcache_set_protocol_t, "memcache.set_protocol", ParseMemcacheSetProtocol'access );
   declareProcedure( memcache_set_t, "memcache.set", ParseMemcacheSet'access );
   declareProcedure( memcache_add_t, "memcache.add", ParseMemcacheAdd'access );
   declareProcedure( memcache_replace_t, "memcache.replace", ParseMemcacheReplace'access );
   declareProcedure( memcache_append_t, "memcache.append", ParseMemcacheAppend'access );
   declareProcedure( memcache_prepend_t, "memcache.prepend", ParseMemcachePrepend'access );
   declareFunction(  memcache_get_t, "memcache.get", ParseMemcacheGet'access );
+  declareProcedure( memcache_get_multi_t, "memcache.get_multi", ParseMemcacheGetMulti'access );
   declareProcedure( memcache_delete_t, "memcache.delete", ParseMemcacheDelete'access );
+  declareProcedure( memcache_touch_t, "memcache.touch", ParseMemcacheTouch'access );
+  declareProcedure( memcache_gets_t, "memcache.gets", ParseMemcacheGets'access );
+  declareFunction(  memcache_cas_t, "memcache.cas", ParseMemcacheCAS'access );
+  declareProcedure( memcache_set_quiet_t, "memcache.set_quiet", ParseMemcacheSetQuiet'access );
+  declareFunction(  memcache_fence_t, "memcache.fence", ParseMemcacheFence'access );
   declareFunction(  memcache_stats_t, "memcache.stats", ParseMemcacheStats'access );
   declareFunction(  memcache_version_t, "memcache.version", ParseMemcacheVersion'access );
   declareProcedure( memcache_flush_t, "memcache.flush", ParseMemcacheFlush'access );
@@ -1228,6 +1867,7 @@ begin
   declareProcedure( highread_append_t, "memcache.highread.append", ParseHighreadAppend'access );
   declareProcedure( highread_prepend_t, "memcache.highread.prepend", ParseHighreadPrepend'access );
   declareFunction(  highread_get_t, "memcache.highread.get", ParseHighreadGet'access );
+  declareProcedure( highread_get_multi_t, "memcache.highread.get_multi", ParseHighreadGetMulti'access );
   declareProcedure( highread_delete_t, "memcache.highread.delete", ParseHighreadDelete'access );
   declareFunction(  highread_stats_t, "memcache.highread.stats", ParseHighreadStats'access );
   declareFunction(  highread_version_t, "memcache.highread.version", ParseHighreadVersion'access );
@@ -1236,7 +1876,18 @@ begin
 end StartupMemcache;
 
 procedure ShutdownMemcache is
+  cluster_entry : aMemcacheClusterEntry;
+  failures : natural;
 begin
+  -- write any quiet requests still queued before the connections go
+  for i in 1..memcacheClusterList.Length( memcacheCluster ) loop
+      memcacheClusterList.Find( memcacheCluster, i, cluster_entry );
+      begin
+        Fence( cluster_entry.cluster, failures );
+      exception when others =>
+        null;
+      end;
+  end loop;
   memcacheClusterList.clear( memcacheCluster );
   memcacheDualClusterList.clear( memcacheDualCluster );
 end ShutdownMemcache;
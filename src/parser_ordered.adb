@@ -0,0 +1,884 @@
+------------------------------------------------------------------------------
+-- Ordered Maps Package Parser                                              --
+--                                                                          --
+-- Part of SparForte                                                        --
+------------------------------------------------------------------------------
+--                                                                          --
+--            Copyright (C) 2001-2020 Free Software Foundation              --
+--                                                                          --
+-- This is free software;  you can  redistribute it  and/or modify it under --
+-- terms of the  GNU General Public License as published  by the Free Soft- --
+-- ware  Foundation;  either version 2,  or (at your option) any later ver- --
+-- sion.  This is distributed in the hope that it will be useful, but WITH- --
+-- OUT ANY WARRANTY;  without even the  implied warranty of MERCHANTABILITY --
+-- or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License --
+-- for  more details.  You should have  received  a copy of the GNU General --
+-- Public License  distributed with this;  see file COPYING.  If not, write --
+-- to  the Free Software Foundation,  59 Temple Place - Suite 330,  Boston, --
+-- MA 02111-1307, USA.                                                      --
+--                                                                          --
+-- This is maintained at http://www.sparforte.com                           --
+--                                                                          --
+------------------------------------------------------------------------------
+
+--with text_io;use text_io;
+
+with
+    ada.strings.unbounded,
+    world,
+    scanner,
+    scanner_res,
+    scanner_restypes,
+    parser_params,
+    parser_containers;
+use
+    ada.strings.unbounded,
+    world,
+    scanner,
+    scanner_res,
+    scanner_restypes,
+    parser_params,
+    parser_containers;
+
+package body parser_ordered is
+
+------------------------------------------------------------------------------
+-- Ordered Maps package identifiers
+------------------------------------------------------------------------------
+
+-- ordered_map_t          : identifier;
+-- ordered_cursor_t       : identifier;
+
+ordered_clear_t         : identifier;
+ordered_is_empty_t      : identifier;
+ordered_length_t        : identifier;
+ordered_insert_t        : identifier;
+ordered_include_t       : identifier;
+ordered_replace_t       : identifier;
+ordered_delete_t        : identifier;
+ordered_exclude_t       : identifier;
+ordered_contains_t      : identifier;
+ordered_get_t           : identifier;
+ordered_first_key_t     : identifier;
+ordered_last_key_t      : identifier;
+ordered_first_element_t : identifier;
+ordered_last_element_t  : identifier;
+ordered_delete_first_t  : identifier;
+ordered_delete_last_t   : identifier;
+
+ordered_first_t         : identifier;
+ordered_last_t          : identifier;
+ordered_find_t          : identifier;
+ordered_floor_t         : identifier;
+ordered_ceiling_t       : identifier;
+ordered_next_t          : identifier;
+ordered_previous_t      : identifier;
+ordered_key_t           : identifier;
+ordered_element_t       : identifier;
+ordered_replace_element_t : identifier;
+ordered_has_element_t   : identifier;
+
+------------------------------------------------------------------------------
+-- Utility subprograms
+------------------------------------------------------------------------------
+
+procedure ParseSingleMapParameter( mapId : out identifier ) is
+begin
+  ParseSingleInOutInstantiatedParameter( mapId, ordered_map_t );
+end ParseSingleMapParameter;
+
+procedure ParseFirstMapParameter( mapId : out identifier ) is
+begin
+  ParseFirstInOutInstantiatedParameter( mapId, ordered_map_t );
+end ParseFirstMapParameter;
+
+procedure ParseSingleCursorParameter( cursId : out identifier ) is
+begin
+  ParseSingleInOutInstantiatedParameter( cursId, ordered_cursor_t );
+end ParseSingleCursorParameter;
+
+procedure ParseNextCursorParameter( cursId : out identifier ) is
+begin
+  ParseNextInOutInstantiatedParameter( cursId, ordered_cursor_t );
+end ParseNextCursorParameter;
+
+procedure ParseLastCursorParameter( cursId : out identifier ) is
+begin
+  ParseLastInOutInstantiatedParameter( cursId, ordered_cursor_t );
+end ParseLastCursorParameter;
+
+-- The map and the cursor must have the same key and element types
+
+procedure mapCursorTypesOk( mapId, cursId : identifier ) is
+begin
+  genTypesOk( identifiers( mapId ).genKind, identifiers( cursId ).genKind );
+  if not error_found then
+     genTypesOk( identifiers( mapId ).genKind2, identifiers( cursId ).genKind2 );
+  end if;
+end mapCursorTypesOk;
+
+-- Keys are stored as strings like all other SparForte values.  A numeric
+-- key also keeps its value so that the tree is sorted by number (2 before
+-- 10) and not by the string image.  Enumerated keys are numbers internally
+-- and sort in their declared order.  The image is normalized so that 1 and
+-- 1.0 are the same key.
+
+function isNumericKey( mapId : identifier ) return boolean is
+  keyKind : constant identifier := getUniType( identifiers( mapId ).genKind );
+begin
+  return keyKind = uni_numeric_t or keyKind = root_enumerated_t;
+end isNumericKey;
+
+function toMapKey( mapId : identifier; keyExpr : unbounded_string ) return ordered_map_key is
+  n : long_float;
+begin
+  if isNumericKey( mapId ) then
+     n := to_numeric( keyExpr );
+     return ordered_map_key'( numeric => n, text => to_unbounded_string( n ) );
+  end if;
+  return ordered_map_key'( numeric => 0.0, text => keyExpr );
+end toMapKey;
+
+-- Parse a key parameter.  The key type is the first type parameter of the
+-- map.
+
+procedure ParseNextKeyParameter( mapId : identifier; keyExpr : out unbounded_string ) is
+  keyType : identifier;
+begin
+  -- if an error occurred, the mapId may be invalid and won't have a genKind
+  -- defined
+  if not error_found then
+     ParseNextGenItemParameter( keyExpr, keyType, identifiers( mapId ).genKind );
+  end if;
+end ParseNextKeyParameter;
+
+procedure ParseLastKeyParameter( mapId : identifier; keyExpr : out unbounded_string ) is
+  keyType : identifier;
+begin
+  if not error_found then
+     ParseLastGenItemParameter( keyExpr, keyType, identifiers( mapId ).genKind );
+  end if;
+end ParseLastKeyParameter;
+
+-- Parse an element parameter.  The element type is the second type
+-- parameter of the map.
+
+procedure ParseLastElementParameter( mapId : identifier; itemExpr : out unbounded_string ) is
+  itemType : identifier;
+begin
+  if not error_found then
+     ParseLastGenItemParameter( itemExpr, itemType, identifiers( mapId ).genKind2 );
+  end if;
+end ParseLastElementParameter;
+
+
+------------------------------------------------------------------------------
+--  CLEAR
+--
+-- Syntax: ordered_maps.clear( m );
+-- Source: Ada.Containers.Ordered_Maps.Clear
+------------------------------------------------------------------------------
+
+procedure ParseOrderedClear is
+  mapId  : identifier;
+  theMap : resPtr;
+begin
+  expect( ordered_clear_t );
+  ParseSingleMapParameter( mapId );
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( mapId ).value.all ), theMap );
+       ordered_string_maps.Clear( theMap.osmMap );
+     end;
+  end if;
+end ParseOrderedClear;
+
+
+------------------------------------------------------------------------------
+--  IS EMPTY
+--
+-- Syntax: b := ordered_maps.is_empty( m );
+-- Source: Ada.Containers.Ordered_Maps.Is_Empty
+------------------------------------------------------------------------------
+
+procedure ParseOrderedIsEmpty( result : out unbounded_string; kind : out identifier ) is
+  mapId  : identifier;
+  theMap : resPtr;
+begin
+  kind := boolean_t;
+  expect( ordered_is_empty_t );
+  ParseSingleMapParameter( mapId );
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( mapId ).value.all ), theMap );
+       result := to_bush_boolean( ordered_string_maps.Is_Empty( theMap.osmMap ) );
+     end;
+  end if;
+end ParseOrderedIsEmpty;
+
+
+------------------------------------------------------------------------------
+--  LENGTH
+--
+-- Syntax: n := ordered_maps.length( m );
+-- Source: Ada.Containers.Ordered_Maps.Length
+------------------------------------------------------------------------------
+
+procedure ParseOrderedLength( result : out unbounded_string; kind : out identifier ) is
+  mapId  : identifier;
+  theMap : resPtr;
+begin
+  kind := containers_count_type_t;
+  expect( ordered_length_t );
+  ParseSingleMapParameter( mapId );
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( mapId ).value.all ), theMap );
+       result := to_unbounded_string( long_float( ordered_string_maps.Length( theMap.osmMap ) ) );
+     end;
+  end if;
+end ParseOrderedLength;
+
+
+------------------------------------------------------------------------------
+--  INSERT
+--
+-- Syntax: ordered_maps.insert( m, k, e );
+-- Source: Ada.Containers.Ordered_Maps.Insert
+------------------------------------------------------------------------------
+
+procedure ParseOrderedInsert is
+  mapId    : identifier;
+  theMap   : resPtr;
+  keyExpr  : unbounded_string;
+  itemExpr : unbounded_string;
+begin
+  expect( ordered_insert_t );
+  ParseFirstMapParameter( mapId );
+  ParseNextKeyParameter( mapId, keyExpr );
+  ParseLastElementParameter( mapId, itemExpr );
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( mapId ).value.all ), theMap );
+       ordered_string_maps.Insert( theMap.osmMap, toMapKey( mapId, keyExpr ), itemExpr );
+     exception when constraint_error =>
+       err( "key is already in the map" );
+     end;
+  end if;
+end ParseOrderedInsert;
+
+
+------------------------------------------------------------------------------
+--  INCLUDE
+--
+-- Insert the element, replacing the element if the key already exists.
+-- Syntax: ordered_maps.include( m, k, e );
+-- Source: Ada.Containers.Ordered_Maps.Include
+------------------------------------------------------------------------------
+
+procedure ParseOrderedInclude is
+  mapId    : identifier;
+  theMap   : resPtr;
+  keyExpr  : unbounded_string;
+  itemExpr : unbounded_string;
+begin
+  expect( ordered_include_t );
+  ParseFirstMapParameter( mapId );
+  ParseNextKeyParameter( mapId, keyExpr );
+  ParseLastElementParameter( mapId, itemExpr );
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( mapId ).value.all ), theMap );
+       ordered_string_maps.Include( theMap.osmMap, toMapKey( mapId, keyExpr ), itemExpr );
+     end;
+  end if;
+end ParseOrderedInclude;
+
+
+------------------------------------------------------------------------------
+--  REPLACE
+--
+-- Syntax: ordered_maps.replace( m, k, e );
+-- Source: Ada.Containers.Ordered_Maps.Replace
+------------------------------------------------------------------------------
+
+procedure ParseOrderedReplace is
+  mapId    : identifier;
+  theMap   : resPtr;
+  keyExpr  : unbounded_string;
+  itemExpr : unbounded_string;
+begin
+  expect( ordered_replace_t );
+  ParseFirstMapParameter( mapId );
+  ParseNextKeyParameter( mapId, keyExpr );
+  ParseLastElementParameter( mapId, itemExpr );
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( mapId ).value.all ), theMap );
+       ordered_string_maps.Replace( theMap.osmMap, toMapKey( mapId, keyExpr ), itemExpr );
+     exception when constraint_error =>
+       err( "key is not in the map" );
+     end;
+  end if;
+end ParseOrderedReplace;
+
+
+------------------------------------------------------------------------------
+--  DELETE
+--
+-- Syntax: ordered_maps.delete( m, k );
+-- Source: Ada.Containers.Ordered_Maps.Delete
+------------------------------------------------------------------------------
+
+procedure ParseOrderedDelete is
+  mapId   : identifier;
+  theMap  : resPtr;
+  keyExpr : unbounded_string;
+begin
+  expect( ordered_delete_t );
+  ParseFirstMapParameter( mapId );
+  ParseLastKeyParameter( mapId, keyExpr );
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( mapId ).value.all ), theMap );
+       ordered_string_maps.Delete( theMap.osmMap, toMapKey( mapId, keyExpr ) );
+     exception when constraint_error =>
+       err( "key is not in the map" );
+     end;
+  end if;
+end ParseOrderedDelete;
+
+
+------------------------------------------------------------------------------
+--  EXCLUDE
+--
+-- Delete the key, if it exists.
+-- Syntax: ordered_maps.exclude( m, k );
+-- Source: Ada.Containers.Ordered_Maps.Exclude
+------------------------------------------------------------------------------
+
+procedure ParseOrderedExclude is
+  mapId   : identifier;
+  theMap  : resPtr;
+  keyExpr : unbounded_string;
+begin
+  expect( ordered_exclude_t );
+  ParseFirstMapParameter( mapId );
+  ParseLastKeyParameter( mapId, keyExpr );
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( mapId ).value.all ), theMap );
+       ordered_string_maps.Exclude( theMap.osmMap, toMapKey( mapId, keyExpr ) );
+     end;
+  end if;
+end ParseOrderedExclude;
+
+
+------------------------------------------------------------------------------
+--  CONTAINS
+--
+-- Syntax: b := ordered_maps.contains( m, k );
+-- Source: Ada.Containers.Ordered_Maps.Contains
+------------------------------------------------------------------------------
+
+procedure ParseOrderedContains( result : out unbounded_string; kind : out identifier ) is
+  mapId   : identifier;
+  theMap  : resPtr;
+  keyExpr : unbounded_string;
+begin
+  kind := boolean_t;
+  expect( ordered_contains_t );
+  ParseFirstMapParameter( mapId );
+  ParseLastKeyParameter( mapId, keyExpr );
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( mapId ).value.all ), theMap );
+       result := to_bush_boolean( ordered_string_maps.Contains( theMap.osmMap, toMapKey( mapId, keyExpr ) ) );
+     end;
+  end if;
+end ParseOrderedContains;
+
+
+------------------------------------------------------------------------------
+--  GET
+--
+-- Syntax: e := ordered_maps.get( m, k );
+-- Source: Ada.Containers.Ordered_Maps.Element( Container, Key )
+------------------------------------------------------------------------------
+
+procedure ParseOrderedGet( result : out unbounded_string; kind : out identifier ) is
+  mapId   : identifier;
+  theMap  : resPtr;
+  keyExpr : unbounded_string;
+begin
+  expect( ordered_get_t );
+  ParseFirstMapParameter( mapId );
+  -- if an error occurred, the mapId may be invalid and won't have a genKind
+  -- defined
+  if not error_found then
+     kind := identifiers( mapId ).genKind2;
+  else
+     kind := eof_t;
+  end if;
+  ParseLastKeyParameter( mapId, keyExpr );
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( mapId ).value.all ), theMap );
+       result := ordered_string_maps.Element( theMap.osmMap, toMapKey( mapId, keyExpr ) );
+     exception when constraint_error =>
+       err( "key is not in the map" );
+     end;
+  end if;
+end ParseOrderedGet;
+
+
+------------------------------------------------------------------------------
+--  FIRST KEY / LAST KEY
+--
+-- Syntax: k := ordered_maps.first_key( m );
+--         k := ordered_maps.last_key( m );
+-- Source: Ada.Containers.Ordered_Maps.First_Key, Last_Key
+------------------------------------------------------------------------------
+
+procedure ParseOrderedFirstKey( result : out unbounded_string; kind : out identifier ) is
+  mapId  : identifier;
+  theMap : resPtr;
+begin
+  expect( ordered_first_key_t );
+  ParseSingleMapParameter( mapId );
+  if not error_found then
+     kind := identifiers( mapId ).genKind;
+  else
+     kind := eof_t;
+  end if;
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( mapId ).value.all ), theMap );
+       result := ordered_string_maps.First_Key( theMap.osmMap ).text;
+     exception when constraint_error =>
+       err( "the map is empty" );
+     end;
+  end if;
+end ParseOrderedFirstKey;
+
+procedure ParseOrderedLastKey( result : out unbounded_string; kind : out identifier ) is
+  mapId  : identifier;
+  theMap : resPtr;
+begin
+  expect( ordered_last_key_t );
+  ParseSingleMapParameter( mapId );
+  if not error_found then
+     kind := identifiers( mapId ).genKind;
+  else
+     kind := eof_t;
+  end if;
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( mapId ).value.all ), theMap );
+       result := ordered_string_maps.Last_Key( theMap.osmMap ).text;
+     exception when constraint_error =>
+       err( "the map is empty" );
+     end;
+  end if;
+end ParseOrderedLastKey;
+
+
+------------------------------------------------------------------------------
+--  FIRST ELEMENT / LAST ELEMENT
+--
+-- Syntax: e := ordered_maps.first_element( m );
+--         e := ordered_maps.last_element( m );
+-- Source: Ada.Containers.Ordered_Maps.First_Element, Last_Element
+------------------------------------------------------------------------------
+
+procedure ParseOrderedFirstElement( result : out unbounded_string; kind : out identifier ) is
+  mapId  : identifier;
+  theMap : resPtr;
+begin
+  expect( ordered_first_element_t );
+  ParseSingleMapParameter( mapId );
+  if not error_found then
+     kind := identifiers( mapId ).genKind2;
+  else
+     kind := eof_t;
+  end if;
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( mapId ).value.all ), theMap );
+       result := ordered_string_maps.First_Element( theMap.osmMap );
+     exception when constraint_error =>
+       err( "the map is empty" );
+     end;
+  end if;
+end ParseOrderedFirstElement;
+
+procedure ParseOrderedLastElement( result : out unbounded_string; kind : out identifier ) is
+  mapId  : identifier;
+  theMap : resPtr;
+begin
+  expect( ordered_last_element_t );
+  ParseSingleMapParameter( mapId );
+  if not error_found then
+     kind := identifiers( mapId ).genKind2;
+  else
+     kind := eof_t;
+  end if;
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( mapId ).value.all ), theMap );
+       result := ordered_string_maps.Last_Element( theMap.osmMap );
+     exception when constraint_error =>
+       err( "the map is empty" );
+     end;
+  end if;
+end ParseOrderedLastElement;
+
+
+------------------------------------------------------------------------------
+--  DELETE FIRST / DELETE LAST
+--
+-- Syntax: ordered_maps.delete_first( m );
+--         ordered_maps.delete_last( m );
+-- Source: Ada.Containers.Ordered_Maps.Delete_First, Delete_Last
+------------------------------------------------------------------------------
+
+procedure ParseOrderedDeleteFirst is
+  mapId  : identifier;
+  theMap : resPtr;
+begin
+  expect( ordered_delete_first_t );
+  ParseSingleMapParameter( mapId );
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( mapId ).value.all ), theMap );
+       ordered_string_maps.Delete_First( theMap.osmMap );
+     end;
+  end if;
+end ParseOrderedDeleteFirst;
+
+procedure ParseOrderedDeleteLast is
+  mapId  : identifier;
+  theMap : resPtr;
+begin
+  expect( ordered_delete_last_t );
+  ParseSingleMapParameter( mapId );
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( mapId ).value.all ), theMap );
+       ordered_string_maps.Delete_Last( theMap.osmMap );
+     end;
+  end if;
+end ParseOrderedDeleteLast;
+
+
+------------------------------------------------------------------------------
+--  FIRST / LAST
+--
+-- Syntax: ordered_maps.first( m, c );
+--         ordered_maps.last( m, c );
+-- Source: c := Ada.Containers.Ordered_Maps.First( m ), Last( m )
+------------------------------------------------------------------------------
+
+procedure ParseOrderedFirst is
+  mapId     : identifier;
+  theMap    : resPtr;
+  cursId    : identifier;
+  theCursor : resPtr;
+begin
+  expect( ordered_first_t );
+  ParseFirstMapParameter( mapId );
+  ParseLastCursorParameter( cursId );
+  if not error_found then
+     mapCursorTypesOk( mapId, cursId );
+  end if;
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( mapId ).value.all ), theMap );
+       findResource( to_resource_id( identifiers( cursId ).value.all ), theCursor );
+       theCursor.osmCursor := ordered_string_maps.First( theMap.osmMap );
+     end;
+  end if;
+end ParseOrderedFirst;
+
+procedure ParseOrderedLast is
+  mapId     : identifier;
+  theMap    : resPtr;
+  cursId    : identifier;
+  theCursor : resPtr;
+begin
+  expect( ordered_last_t );
+  ParseFirstMapParameter( mapId );
+  ParseLastCursorParameter( cursId );
+  if not error_found then
+     mapCursorTypesOk( mapId, cursId );
+  end if;
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( mapId ).value.all ), theMap );
+       findResource( to_resource_id( identifiers( cursId ).value.all ), theCursor );
+       theCursor.osmCursor := ordered_string_maps.Last( theMap.osmMap );
+     end;
+  end if;
+end ParseOrderedLast;
+
+
+------------------------------------------------------------------------------
+--  FIND / FLOOR / CEILING
+--
+-- Position the cursor on the key, on the largest key less than or equal to
+-- the key, or on the smallest key greater than or equal to the key.  If
+-- there is no such key, the cursor has no element.  Ceiling followed by
+-- next is a range scan.
+-- Syntax: ordered_maps.find( m, k, c );
+--         ordered_maps.floor( m, k, c );
+--         ordered_maps.ceiling( m, k, c );
+-- Source: c := Ada.Containers.Ordered_Maps.Find( m, k ), Floor, Ceiling
+------------------------------------------------------------------------------
+
+type aSearchKind is ( findSearch, floorSearch, ceilingSearch );
+
+procedure ParseOrderedSearch( searchId : identifier; searchKind : aSearchKind ) is
+  mapId     : identifier;
+  theMap    : resPtr;
+  keyExpr   : unbounded_string;
+  cursId    : identifier;
+  theCursor : resPtr;
+begin
+  expect( searchId );
+  ParseFirstMapParameter( mapId );
+  ParseNextKeyParameter( mapId, keyExpr );
+  ParseLastCursorParameter( cursId );
+  if not error_found then
+     mapCursorTypesOk( mapId, cursId );
+  end if;
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( mapId ).value.all ), theMap );
+       findResource( to_resource_id( identifiers( cursId ).value.all ), theCursor );
+       case searchKind is
+       when findSearch =>
+          theCursor.osmCursor := ordered_string_maps.Find( theMap.osmMap, toMapKey( mapId, keyExpr ) );
+       when floorSearch =>
+          theCursor.osmCursor := ordered_string_maps.Floor( theMap.osmMap, toMapKey( mapId, keyExpr ) );
+       when ceilingSearch =>
+          theCursor.osmCursor := ordered_string_maps.Ceiling( theMap.osmMap, toMapKey( mapId, keyExpr ) );
+       end case;
+     end;
+  end if;
+end ParseOrderedSearch;
+
+procedure ParseOrderedFind is
+begin
+  ParseOrderedSearch( ordered_find_t, findSearch );
+end ParseOrderedFind;
+
+procedure ParseOrderedFloor is
+begin
+  ParseOrderedSearch( ordered_floor_t, floorSearch );
+end ParseOrderedFloor;
+
+procedure ParseOrderedCeiling is
+begin
+  ParseOrderedSearch( ordered_ceiling_t, ceilingSearch );
+end ParseOrderedCeiling;
+
+
+------------------------------------------------------------------------------
+--  NEXT / PREVIOUS
+--
+-- Syntax: ordered_maps.next( c );
+--         ordered_maps.previous( c );
+-- Source: Ada.Containers.Ordered_Maps.Next, Previous
+------------------------------------------------------------------------------
+
+procedure ParseOrderedNext is
+  cursId    : identifier;
+  theCursor : resPtr;
+begin
+  expect( ordered_next_t );
+  ParseSingleCursorParameter( cursId );
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( cursId ).value.all ), theCursor );
+       ordered_string_maps.Next( theCursor.osmCursor );
+     end;
+  end if;
+end ParseOrderedNext;
+
+procedure ParseOrderedPrevious is
+  cursId    : identifier;
+  theCursor : resPtr;
+begin
+  expect( ordered_previous_t );
+  ParseSingleCursorParameter( cursId );
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( cursId ).value.all ), theCursor );
+       ordered_string_maps.Previous( theCursor.osmCursor );
+     end;
+  end if;
+end ParseOrderedPrevious;
+
+
+------------------------------------------------------------------------------
+--  KEY / ELEMENT
+--
+-- Syntax: k := ordered_maps.key( c );
+--         e := ordered_maps.element( c );
+-- Source: Ada.Containers.Ordered_Maps.Key, Element
+------------------------------------------------------------------------------
+
+procedure ParseOrderedKey( result : out unbounded_string; kind : out identifier ) is
+  cursId    : identifier;
+  theCursor : resPtr;
+begin
+  expect( ordered_key_t );
+  ParseSingleCursorParameter( cursId );
+  -- if an error occurred, the cursId may be invalid and won't have a genKind
+  -- defined
+  if not error_found then
+     kind := identifiers( cursId ).genKind;
+  else
+     kind := eof_t;
+  end if;
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( cursId ).value.all ), theCursor );
+       result := ordered_string_maps.Key( theCursor.osmCursor ).text;
+     exception when constraint_error =>
+       err( "position cursor has no element" );
+     end;
+  end if;
+end ParseOrderedKey;
+
+procedure ParseOrderedElement( result : out unbounded_string; kind : out identifier ) is
+  cursId    : identifier;
+  theCursor : resPtr;
+begin
+  expect( ordered_element_t );
+  ParseSingleCursorParameter( cursId );
+  if not error_found then
+     kind := identifiers( cursId ).genKind2;
+  else
+     kind := eof_t;
+  end if;
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( cursId ).value.all ), theCursor );
+       result := ordered_string_maps.Element( theCursor.osmCursor );
+     exception when constraint_error =>
+       err( "position cursor has no element" );
+     end;
+  end if;
+end ParseOrderedElement;
+
+
+------------------------------------------------------------------------------
+--  REPLACE ELEMENT
+--
+-- Syntax: ordered_maps.replace_element( m, c, e );
+-- Source: Ada.Containers.Ordered_Maps.Replace_Element
+------------------------------------------------------------------------------
+
+procedure ParseOrderedReplaceElement is
+  mapId     : identifier;
+  theMap    : resPtr;
+  cursId    : identifier;
+  theCursor : resPtr;
+  itemExpr  : unbounded_string;
+begin
+  expect( ordered_replace_element_t );
+  ParseFirstMapParameter( mapId );
+  ParseNextCursorParameter( cursId );
+  if not error_found then
+     mapCursorTypesOk( mapId, cursId );
+  end if;
+  ParseLastElementParameter( mapId, itemExpr );
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( mapId ).value.all ), theMap );
+       findResource( to_resource_id( identifiers( cursId ).value.all ), theCursor );
+       ordered_string_maps.Replace_Element( theMap.osmMap, theCursor.osmCursor, itemExpr );
+     exception when constraint_error =>
+       err( "position cursor has no element" );
+     when program_error =>
+       err( "position cursor is not in the map" );
+     end;
+  end if;
+end ParseOrderedReplaceElement;
+
+
+------------------------------------------------------------------------------
+--  HAS ELEMENT
+--
+-- Syntax: b := ordered_maps.has_element( c );
+-- Source: Ada.Containers.Ordered_Maps.Has_Element
+------------------------------------------------------------------------------
+
+procedure ParseOrderedHasElement( result : out unbounded_string; kind : out identifier ) is
+  cursId    : identifier;
+  theCursor : resPtr;
+begin
+  kind := boolean_t;
+  expect( ordered_has_element_t );
+  ParseSingleCursorParameter( cursId );
+  if isExecutingCommand then
+     begin
+       findResource( to_resource_id( identifiers( cursId ).value.all ), theCursor );
+       result := to_bush_boolean( ordered_string_maps.Has_Element( theCursor.osmCursor ) );
+     end;
+  end if;
+end ParseOrderedHasElement;
+
+
+-----------------------------------------------------------------------------
+
+procedure StartupOrdered is
+begin
+  declareNamespace( "ordered_maps" );
+
+  declareIdent( ordered_map_t,    "ordered_maps.map", variable_t, genericTypeClass );
+  identifiers( ordered_map_t ).usage := limitedUsage;
+  identifiers( ordered_map_t ).resource := true;
+  declareIdent( ordered_cursor_t, "ordered_maps.cursor", variable_t, genericTypeClass );
+  identifiers( ordered_cursor_t ).usage := limitedUsage;
+  identifiers( ordered_cursor_t ).resource := true;
+
+  declareProcedure( ordered_clear_t,     "ordered_maps.clear",    ParseOrderedClear'access );
+  declareFunction(  ordered_is_empty_t,  "ordered_maps.is_empty", ParseOrderedIsEmpty'access );
+  declareFunction(  ordered_length_t,    "ordered_maps.length",   ParseOrderedLength'access );
+  declareProcedure( ordered_insert_t,    "ordered_maps.insert",   ParseOrderedInsert'access );
+  declareProcedure( ordered_include_t,   "ordered_maps.include",  ParseOrderedInclude'access );
+  declareProcedure( ordered_replace_t,   "ordered_maps.replace",  ParseOrderedReplace'access );
+  declareProcedure( ordered_delete_t,    "ordered_maps.delete",   ParseOrderedDelete'access );
+  declareProcedure( ordered_exclude_t,   "ordered_maps.exclude",  ParseOrderedExclude'access );
+  declareFunction(  ordered_contains_t,  "ordered_maps.contains", ParseOrderedContains'access );
+  declareFunction(  ordered_get_t,       "ordered_maps.get",      ParseOrderedGet'access );
+  declareFunction(  ordered_first_key_t, "ordered_maps.first_key", ParseOrderedFirstKey'access );
+  declareFunction(  ordered_last_key_t,  "ordered_maps.last_key", ParseOrderedLastKey'access );
+  declareFunction(  ordered_first_element_t, "ordered_maps.first_element", ParseOrderedFirstElement'access );
+  declareFunction(  ordered_last_element_t,  "ordered_maps.last_element", ParseOrderedLastElement'access );
+  declareProcedure( ordered_delete_first_t,  "ordered_maps.delete_first", ParseOrderedDeleteFirst'access );
+  declareProcedure( ordered_delete_last_t,   "ordered_maps.delete_last", ParseOrderedDeleteLast'access );
+
+  declareProcedure( ordered_first_t,     "ordered_maps.first",    ParseOrderedFirst'access );
+  declareProcedure( ordered_last_t,      "ordered_maps.last",     ParseOrderedLast'access );
+  declareProcedure( ordered_find_t,      "ordered_maps.find",     ParseOrderedFind'access );
+  declareProcedure( ordered_floor_t,     "ordered_maps.floor",    ParseOrderedFloor'access );
+  declareProcedure( ordered_ceiling_t,   "ordered_maps.ceiling",  ParseOrderedCeiling'access );
+  declareProcedure( ordered_next_t,      "ordered_maps.next",     ParseOrderedNext'access );
+  declareProcedure( ordered_previous_t,  "ordered_maps.previous", ParseOrderedPrevious'access );
+  declareFunction(  ordered_key_t,       "ordered_maps.key",      ParseOrderedKey'access );
+  declareFunction(  ordered_element_t,   "ordered_maps.element",  ParseOrderedElement'access );
+  declareProcedure( ordered_replace_element_t, "ordered_maps.replace_element", ParseOrderedReplaceElement'access );
+  declareFunction(  ordered_has_element_t, "ordered_maps.has_element", ParseOrderedHasElement'access );
+
+  declareNamespaceClosed( "ordered_maps" );
+end StartupOrdered;
+
+procedure ShutdownOrdered is
+begin
+  null;
+end ShutdownOrdered;
+
+end parser_ordered;
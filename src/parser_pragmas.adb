@@ -39,6 +39,7 @@ with  ada.text_io,
     signal_flags,
     jobs, -- for clearCommandHash
     parser.decl.as,
+    parser_memcache,
     parser_teams;
 use ada.text_io,
     ada.command_line,
@@ -58,6 +59,7 @@ use ada.text_io,
     jobs,
     parser,
     parser.decl.as,
+    parser_memcache,
     parser_teams;
 
 package body parser_pragmas is
@@ -89,6 +91,7 @@ type aPragmaKind is (
      inspection,
      inspect_var,
      license,
+     local_cache,
      manual_test,
      manual_test_result,
      noCommandHash,
@@ -190,6 +193,8 @@ begin
      pragmaKind := inspection;
   elsif name = "license" then
      pragmaKind := license;
+  elsif name = "local_memcache" then
+     pragmaKind := local_cache;
   elsif name = "inspection_peek" then
      pragmaKind := peek;
   elsif name = "manual_test" then
@@ -1096,6 +1101,16 @@ begin
            baseTypesOK( var_id, uni_string_t );
         end if;
      end if;
+  when local_cache =>                        -- pragma local_memcache
+     ParseIdentifier( var_id );
+     if baseTypesOK( identifiers( var_id ).kind, memcache_cluster_t ) then
+        expect( symbol_t, "," );
+        expr_val := identifiers( token ).value.all;
+        expect( number_t );
+        expect( symbol_t, "," );
+        expr_val2 := identifiers( token ).value.all;
+        expect( number_t );
+     end if;
   when register_memcache_server =>           -- pragma register_memcache_server
      expr_val := identifiers( token ).value.all;
      expect( strlit_t );
@@ -1719,6 +1734,16 @@ begin
         null;
      when refactor =>
         null;
+     when local_cache =>
+         begin
+            SetLocalMemcache( var_id,
+               natural( to_numeric( expr_val ) ),
+               duration( to_numeric( expr_val2 ) ) );
+         exception when constraint_error =>
+            err( "local cache bytes and seconds must not be negative" );
+         when others =>
+            err_exception_raised;
+         end;
      when register_memcache_server =>
          checkAndInitializeDistributedMemcacheCluster;
          begin
@@ -24,12 +24,10 @@
 --with text_io;
 
 with interfaces.c,
-    ada.strings.unbounded.text_io,
-    ada.streams.stream_io,
-    ada.text_io,
+    ada.strings.unbounded,
     gnat.regexp,
     gnat.regpat,
-    base64,
+    base64_util,
     spar_os,
     world,
     scanner,
@@ -41,11 +39,9 @@ with interfaces.c,
     parser_strings_pcre;
 use interfaces.c,
     ada.strings.unbounded,
-    ada.strings.unbounded.text_io,
-    ada.streams.stream_io,
     gnat.regexp,
     gnat.regpat,
-    base64,
+    base64_util,
     spar_os,
     world,
     scanner,
@@ -827,42 +823,10 @@ procedure ParseStringsToString( result : out unbounded_string; kind : out identi
   baseType   : identifier;
 
   procedure DoBase64ToString( result : out unbounded_string; expr_val : unbounded_string ) is
-    rawFile : ada.streams.stream_io.file_type;
-    base64file : ada.text_io.file_type;
   begin
-    -- The AdaPower base64 package requires streams and/or files.  It
-    -- doesn't do strings.
-    --
-    -- Barnes' documentation is a bit sketchy.  I am faking this.  There may
-    -- be a cleaner and more efficient way to do this.
-    ada.text_io.create( base64File );
-    ada.text_io.put( base64File, to_string( expr_val ) );
-    ada.text_io.reset( base64File, ada.text_io.in_file );
-    ada.streams.stream_io.create( rawFile );
-    Decode_Stream( From => base64File, To => rawFile  );
-    ada.streams.stream_io.reset( rawFile, ada.streams.stream_io.in_file );
-    declare
-       rawStream : ada.streams.stream_io.stream_access;
-       ch : character;
-    begin
-       rawStream := ada.streams.stream_io.Stream( rawFile );
-       while not ada.streams.stream_io.end_of_file( rawFile ) loop
-          character'read( rawStream, ch );
-          result := result & ch;
-       end loop;
-     end;
-     ada.streams.stream_io.delete( rawFile );
-     ada.text_io.delete( base64File );
-   exception when MODE_ERROR =>
-     err( "internal_error: file mode error" );
-   when status_error =>
-     err( "internal_error: status error - cannot open file" );
-   when name_error =>
-     err( "internal_error: name error - cannot open fie" );
-   when end_error =>
-     err( "internal_error: end error - end of file reached" );
-   when others =>
-     err_exception_raised;
+    FromBase64( expr_val, result );
+  exception when others =>
+    err_exception_raised;
   end DoBase64ToString;
 
 begin
@@ -1356,9 +1320,7 @@ end ParseStringsIsFixed;
 
 procedure ParseStringsToBase64( result : out unbounded_string; kind : out identifier ) is
   -- Syntax: strings.to_base64( s )
-  -- Source: base64.encode_stream
-  rawFile : ada.streams.stream_io.file_type;
-  base64file : ada.text_io.file_type;
+  -- Source: base64.encode_block
   expr_val : unbounded_string;
   expr_type : identifier;
 begin
@@ -1367,39 +1329,9 @@ begin
   ParseSingleStringExpression( expr_val, expr_type );
   begin
     if isExecutingCommand then
-       -- The AdaPower base64 package requires streams and/or files.  It
-       -- doesn't do strings.
-       --
-       -- Barnes' documentation is a bit sketchy.  I am faking this.  There may
-       -- be a cleaner and more efficient way to do this.
-       ada.streams.stream_io.create( rawFile );
-       declare
-          rawStream : ada.streams.stream_io.stream_access;
-          s : constant string := to_string( expr_val );
-       begin
-          rawStream := ada.streams.stream_io.Stream( rawFile );
-          string'write( rawStream, s );
-       end;
-       ada.streams.stream_io.reset( rawFile, ada.streams.stream_io.in_file );
-       ada.text_io.create( base64File );
-       Encode_Stream( From => rawFile, To => base64File  );
-       ada.text_io.reset( base64File, ada.text_io.in_file );
-       -- TODO: loop
-       while not ada.text_io.end_of_file( base64File ) loop
-          result := result & get_line( base64File );
-       end loop;
-       ada.streams.stream_io.delete( rawFile );
-       ada.text_io.delete( base64file );
+       ToBase64( expr_val, result );
     end if;
-  exception when MODE_ERROR =>
-    err( "internal_error: file mode error" );
-  when status_error =>
-    err( "internal_error: status error - cannot open file" );
-  when name_error =>
-    err( "internal_error: name error - cannot open fie" );
-  when end_error =>
-    err( "internal_error: end error - end of file reached" );
-  when others =>
+  exception when others =>
     err_exception_raised;
   end;
 end ParseStringsToBase64;
@@ -82,11 +82,14 @@ begin
 end findServer;
 
 procedure ParseTSNewSocketServer is
-  -- Syntax: tinyserve.new_socket_server( ss, t );
+  -- Syntax: tinyserve.new_socket_server( ss, t [, b] );
   -- Ada:    N/A
   resId : resHandleId;
   ref : reference;
   genKindId : identifier;
+  backendExpr : unbounded_string;
+  backendKind : identifier;
+  server : resPtr := null;
 begin
   expect( tinyserve_new_socket_server_t );
   ParseFirstOutParameter( ref, tinyserve_socket_server_t );
@@ -97,17 +100,25 @@ begin
      null;
   end if;
   identifiers( ref.id ).genKind := genKindId;
-  expect( symbol_t, ")" );
+  if token = symbol_t and identifiers( token ).value.all = "," then
+     ParseLastEnumParameter( backendExpr, backendKind, tinyserve_socket_backend_t );
+  else
+     expect( symbol_t, ")" );
+  end if;
   if isExecutingCommand then
      identifiers( ref.id ).resource := true;
      declareResource( resId, tinyserve_socket_server, getIdentifierBlock( ref.id ) );
      AssignParameter( ref, to_unbounded_string( resId ) );
+     if length( backendExpr ) > 0 then
+        findResource( resId, server );
+        server.tinyserve_backend := aSocketBackend'val( natural( to_numeric( backendExpr ) ) );
+     end if;
   end if;
 end ParseTSNewSocketServer;
 
 procedure ParseTSStartUp is
   -- Syntax: tinyserve.startup( server, host, port, recv, send, queue, linger
-  -- secs, usecs );
+  -- secs, usecs [, workers] );
   serverId   : identifier;
   hostExpr   : unbounded_string;
   hostKind   : identifier;
@@ -125,6 +136,9 @@ procedure ParseTSStartUp is
   secsKind   : identifier;
   usecsExpr  : unbounded_string;
   usecsKind  : identifier;
+  workersExpr : unbounded_string;
+  workersKind : identifier;
+  workers    : natural := 0;
   server     : resPtr := null;
 begin
   if rshOpt then
@@ -140,24 +154,39 @@ begin
      ParseNextNumericParameter( queueExpr, queueKind, integer_t );
      ParseNextNumericParameter( lingerExpr, lingerKind, integer_t );
      ParseNextNumericParameter( secsExpr, secsKind, integer_t );
-     ParseLastNumericParameter( usecsExpr, usecsKind, integer_t );
+     ParseNextNumericParameter( usecsExpr, usecsKind, integer_t );
+     if token = symbol_t and identifiers( token ).value.all = "," then
+        ParseLastNumericParameter( workersExpr, workersKind, natural_t );
+     else
+        expect( symbol_t, ")" );
+     end if;
 -- TODO: handle defaults
 -- TODO: out parameter works here?
      if isExecutingCommand then
         findServer( identifiers( serverId ).value.all, server );
         if server /= null then
+           if length( workersExpr ) > 0 then
+              workers := natural( to_numeric( workersExpr ) );
+           end if;
            -- TODO: number conversion could throw exception
-           pegasock.tinyserve.startupTinyServe(
-             socket_data => server.tinyserve_server,
-             host => to_string( hostExpr ),
-             port => integer( to_numeric( portExpr ) ),
-             min_recv_buffer_size => integer( to_numeric( recvExpr ) ),
-             min_send_buffer_size => integer( to_numeric( sendExpr ) ),
-             socket_queue_length => integer( to_numeric( queueExpr ) ),
-             socket_linger_seconds => integer( to_numeric( lingerExpr ) ),
-             timeout_secs => integer( to_numeric( secsExpr ) ),
-             timeout_usecs => integer( to_numeric( usecsExpr ) )
-        );
+           begin
+             pegasock.tinyserve.startupTinyServe(
+               socket_data => server.tinyserve_server,
+               host => to_string( hostExpr ),
+               port => integer( to_numeric( portExpr ) ),
+               min_recv_buffer_size => integer( to_numeric( recvExpr ) ),
+               min_send_buffer_size => integer( to_numeric( sendExpr ) ),
+               socket_queue_length => integer( to_numeric( queueExpr ) ),
+               socket_linger_seconds => integer( to_numeric( lingerExpr ) ),
+               timeout_secs => integer( to_numeric( secsExpr ) ),
+               timeout_usecs => integer( to_numeric( usecsExpr ) ),
+               backend => server.tinyserve_backend,
+               workers => workers
+             );
+           exception when others =>
+             -- e.g. the worker processes could not be started
+             err_exception_raised;
+           end;
         end if;
      end if;
    end if;
@@ -195,6 +224,50 @@ begin
   end if;
 end ParseTSManageConnections;
 
+procedure ParseTSManageConnectionsBatch( result : out unbounded_string; kind : out identifier ) is
+  -- Syntax: n := tinyserve.manage_connections_batch( server, clients )
+  serverId   : identifier;
+  server     : resPtr := null;
+  arrayId    : identifier;
+  count      : natural := 0;
+begin
+  kind := natural_t;
+  expect( tinyserve_manage_connections_batch_t );
+  ParseFirstServerParameter( serverId );
+  expect( symbol_t, "," );
+  ParseIdentifier( arrayId );
+  if not (class_ok( arrayId, varClass ) and identifiers( arrayId ).list) then
+     err( "Array expected" );
+  elsif getUniType( identifiers( identifiers( arrayId ).kind ).kind ) /= uni_numeric_t then
+     err( "numeric array expected" );
+  elsif syntax_check and then not error_found then
+     -- Mark the array as having been written for future tests.
+     identifiers( arrayId ).wasWritten := true;
+     identifiers( arrayId ).writtenByThread := getThreadName;
+  end if;
+  expect( symbol_t, ")" );
+  if isExecutingCommand then
+     findServer( identifiers( serverId ).value.all, server );
+     if identifiers( arrayId ).avalue = null then
+        err( "array " & optional_bold( to_string( identifiers( arrayId ).name ) ) &
+             " has no elements" );
+     elsif server /= null and identifiers( arrayId ).avalue'length > 0 then
+        declare
+          ids : aClientIDList( 1..positive( identifiers( arrayId ).avalue'length ) );
+        begin
+          manageConnections( server.tinyserve_server, ids, count );
+          for i in 1..count loop
+              identifiers( arrayId ).avalue( identifiers( arrayId ).avalue'first + long_integer( i-1 ) ) :=
+                 to_unbounded_string( ids( i )'img );
+          end loop;
+        exception when others =>
+          err_exception_raised;
+        end;
+     end if;
+     result := to_unbounded_string( count'img );
+  end if;
+end ParseTSManageConnectionsBatch;
+
 procedure ParseTSGetNextClient is
   -- Syntax: tinyserve.get_next_client( server, client )
   serverId   : identifier;
@@ -241,7 +314,7 @@ procedure ParseTSCountClients( result : out unbounded_string; kind : out identif
 begin
   kind := integer_t;
   expect( tinyserve_count_clients_t );
-  ParseFirstServerParameter( serverId );
+  ParseSingleServerParameter( serverId );
   if isExecutingCommand then
      findServer( identifiers( serverId ).value.all, server );
      if server /= null then
@@ -251,6 +324,82 @@ begin
   end if;
 end ParseTSCountClients;
 
+procedure ParseTSWorkerNumber( result : out unbounded_string; kind : out identifier ) is
+  -- Syntax: n := tinyserve.worker_number( server )
+  serverId   : identifier;
+  server     : resPtr := null;
+  worker     : natural;
+begin
+  kind := natural_t;
+  expect( tinyserve_worker_number_t );
+  ParseSingleServerParameter( serverId );
+  if isExecutingCommand then
+     findServer( identifiers( serverId ).value.all, server );
+     if server /= null then
+        worker := getWorkerNumber( server.tinyserve_server );
+        result := to_unbounded_string( worker'img );
+     end if;
+  end if;
+end ParseTSWorkerNumber;
+
+procedure ParseTSCountWorkerClients( result : out unbounded_string; kind : out identifier ) is
+  -- Syntax: n := tinyserve.count_worker_clients( server [, worker] )
+  serverId   : identifier;
+  server     : resPtr := null;
+  workerExpr : unbounded_string;
+  workerKind : identifier;
+  clients    : natural;
+begin
+  kind := natural_t;
+  expect( tinyserve_count_worker_clients_t );
+  ParseFirstServerParameter( serverId );
+  if token = symbol_t and identifiers( token ).value.all = "," then
+     ParseLastNumericParameter( workerExpr, workerKind, natural_t );
+  else
+     expect( symbol_t, ")" );
+  end if;
+  if isExecutingCommand then
+     findServer( identifiers( serverId ).value.all, server );
+     if server /= null then
+        if length( workerExpr ) = 0 then
+           clients := countWorkerClients( server.tinyserve_server );
+        else
+           clients := countWorkerClients( server.tinyserve_server, natural( to_numeric( workerExpr ) ) );
+        end if;
+        result := to_unbounded_string( clients'img );
+     end if;
+  end if;
+end ParseTSCountWorkerClients;
+
+procedure ParseTSCountWorkerAccepts( result : out unbounded_string; kind : out identifier ) is
+  -- Syntax: n := tinyserve.count_worker_accepts( server [, worker] )
+  serverId   : identifier;
+  server     : resPtr := null;
+  workerExpr : unbounded_string;
+  workerKind : identifier;
+  accepts    : natural;
+begin
+  kind := natural_t;
+  expect( tinyserve_count_worker_accepts_t );
+  ParseFirstServerParameter( serverId );
+  if token = symbol_t and identifiers( token ).value.all = "," then
+     ParseLastNumericParameter( workerExpr, workerKind, natural_t );
+  else
+     expect( symbol_t, ")" );
+  end if;
+  if isExecutingCommand then
+     findServer( identifiers( serverId ).value.all, server );
+     if server /= null then
+        if length( workerExpr ) = 0 then
+           accepts := countWorkerAccepts( server.tinyserve_server );
+        else
+           accepts := countWorkerAccepts( server.tinyserve_server, natural( to_numeric( workerExpr ) ) );
+        end if;
+        result := to_unbounded_string( accepts'img );
+     end if;
+  end if;
+end ParseTSCountWorkerAccepts;
+
 procedure ParseTSGetFDSetSize( result : out unbounded_string; kind : out identifier ) is
   fdsize : interfaces.C.int;
 begin
@@ -280,15 +429,153 @@ begin
 end ParseTSIsTimeout;
 
 procedure ParseTSClose is
+  -- Syntax: tinyserve.close( server, client )
+  serverId   : identifier;
+  server     : resPtr := null;
+  clientExpr : unbounded_string;
+  clientKind : identifier;
 begin
-  null;
+  expect( tinyserve_close_t );
+  ParseFirstServerParameter( serverId );
+  ParseLastNumericParameter( clientExpr, clientKind, tinyserve_client_id_t );
+  if isExecutingCommand then
+     findServer( identifiers( serverId ).value.all, server );
+     if server /= null then
+        close( server.tinyserve_server, aClientID( to_numeric( clientExpr ) ) );
+     end if;
+  end if;
 end ParseTSClose;
 
 procedure ParseTSDrop is
+  -- Syntax: tinyserve.drop( server, client )
+  serverId   : identifier;
+  server     : resPtr := null;
+  clientExpr : unbounded_string;
+  clientKind : identifier;
 begin
-  null;
+  expect( tinyserve_drop_t );
+  ParseFirstServerParameter( serverId );
+  ParseLastNumericParameter( clientExpr, clientKind, tinyserve_client_id_t );
+  if isExecutingCommand then
+     findServer( identifiers( serverId ).value.all, server );
+     if server /= null then
+        drop( server.tinyserve_server, aClientID( to_numeric( clientExpr ) ) );
+     end if;
+  end if;
 end ParseTSDrop;
 
+procedure ParseTSSetMessageFraming is
+  -- Syntax: tinyserve.set_message_framing( server, framing [, size] )
+  serverId    : identifier;
+  server      : resPtr := null;
+  framingExpr : unbounded_string;
+  framingKind : identifier;
+  sizeExpr    : unbounded_string;
+  sizeKind    : identifier;
+begin
+  expect( tinyserve_set_message_framing_t );
+  ParseFirstServerParameter( serverId );
+  ParseNextEnumParameter( framingExpr, framingKind, tinyserve_message_framing_t );
+  if token = symbol_t and identifiers( token ).value.all = "," then
+     ParseLastNumericParameter( sizeExpr, sizeKind, natural_t );
+  else
+     expect( symbol_t, ")" );
+  end if;
+  if isExecutingCommand then
+     findServer( identifiers( serverId ).value.all, server );
+     if server /= null then
+        begin
+          if length( sizeExpr ) = 0 then
+             setMessageFraming( server.tinyserve_server,
+                aMessageFraming'val( natural( to_numeric( framingExpr ) ) ) );
+          else
+             setMessageFraming( server.tinyserve_server,
+                aMessageFraming'val( natural( to_numeric( framingExpr ) ) ),
+                natural( to_numeric( sizeExpr ) ) );
+          end if;
+        exception when others =>
+          err_exception_raised;
+        end;
+     end if;
+  end if;
+end ParseTSSetMessageFraming;
+
+procedure ParseTSGetMessage is
+  -- Syntax: tinyserve.get_message( server, client, message, status )
+  serverId   : identifier;
+  server     : resPtr := null;
+  clientExpr : unbounded_string;
+  clientKind : identifier;
+  messageRef : reference;
+  statusRef  : reference;
+  message    : unbounded_string;
+  status     : aMessageStatus;
+begin
+  expect( tinyserve_get_message_t );
+  ParseFirstServerParameter( serverId );
+  ParseNextNumericParameter( clientExpr, clientKind, tinyserve_client_id_t );
+  ParseNextOutParameter( messageRef, string_t );
+  baseTypesOK( messageRef.kind, string_t );
+  ParseLastOutParameter( statusRef, tinyserve_message_status_t );
+  baseTypesOK( statusRef.kind, tinyserve_message_status_t );
+  if isExecutingCommand then
+     findServer( identifiers( serverId ).value.all, server );
+     if server /= null then
+        begin
+          getMessage( server.tinyserve_server, aClientID( to_numeric( clientExpr ) ), message, status );
+          AssignParameter( messageRef, message );
+          AssignParameter( statusRef, to_unbounded_string( aMessageStatus'pos( status )'img ) );
+        exception when others =>
+          err_exception_raised;
+        end;
+     end if;
+  end if;
+end ParseTSGetMessage;
+
+procedure ParseTSPutMessage is
+  -- Syntax: tinyserve.put_message( server, client, message )
+  serverId    : identifier;
+  server      : resPtr := null;
+  clientExpr  : unbounded_string;
+  clientKind  : identifier;
+  messageExpr : unbounded_string;
+  messageKind : identifier;
+begin
+  expect( tinyserve_put_message_t );
+  ParseFirstServerParameter( serverId );
+  ParseNextNumericParameter( clientExpr, clientKind, tinyserve_client_id_t );
+  ParseLastStringParameter( messageExpr, messageKind, string_t );
+  if isExecutingCommand then
+     findServer( identifiers( serverId ).value.all, server );
+     if server /= null then
+        begin
+          putMessage( server.tinyserve_server, aClientID( to_numeric( clientExpr ) ), to_string( messageExpr ) );
+        exception when others =>
+          err_exception_raised;
+        end;
+     end if;
+  end if;
+end ParseTSPutMessage;
+
+procedure ParseTSHasPendingOutput( result : out unbounded_string; kind : out identifier ) is
+  -- Syntax: b := tinyserve.has_pending_output( server, client )
+  serverId   : identifier;
+  server     : resPtr := null;
+  clientExpr : unbounded_string;
+  clientKind : identifier;
+begin
+  kind := boolean_t;
+  expect( tinyserve_has_pending_output_t );
+  ParseFirstServerParameter( serverId );
+  ParseLastNumericParameter( clientExpr, clientKind, tinyserve_client_id_t );
+  if isExecutingCommand then
+     findServer( identifiers( serverId ).value.all, server );
+     if server /= null then
+        result := to_bush_boolean( hasPendingOutput( server.tinyserve_server, aClientID( to_numeric( clientExpr ) ) ) );
+     end if;
+  end if;
+end ParseTSHasPendingOutput;
+
 procedure StartupTinyserve is
 begin
   declareNamespace( "tinyserve" );
@@ -298,23 +585,52 @@ begin
   identifiers( tinyserve_socket_server_t ).resource := true;
 
   declareIdent( tinyserve_client_id_t, "tinyserve.client_id", integer_t, typeClass );
+  declareIdent( tinyserve_socket_backend_t, "tinyserve.socket_backend", root_enumerated_t, typeClass );
+  declareIdent( tinyserve_message_framing_t, "tinyserve.message_framing", root_enumerated_t, typeClass );
+  declareIdent( tinyserve_message_status_t, "tinyserve.message_status", root_enumerated_t, typeClass );
 
   -- TODO: allow multiple listeners
   declareProcedure( tinyserve_new_socket_server_t, "tinyserve.new_socket_server", ParseTSNewSocketServer'access );
   declareProcedure( tinyserve_startup_t, "tinyserve.startup", ParseTSStartUp'access );
   declareProcedure( tinyserve_shutdown_t, "tinyserve.shutdown", ParseTSShutdown'access );
   declareProcedure( tinyserve_manage_connections_t, "tinyserve.manage_connections", ParseTSManageConnections'access );
+  declareFunction(  tinyserve_manage_connections_batch_t, "tinyserve.manage_connections_batch", ParseTSManageConnectionsBatch'access );
   declareProcedure( tinyserve_get_next_client_t, "tinyserve.get_next_client", ParseTSGetNextClient'access );
   declareProcedure( tinyserve_get_listener_socket_t, "tinyserve.get_listener_socket", ParseTSGetListenerSocket'access );
   declareFunction(  tinyserve_count_clients_t, "tinyserve.count_clients", ParseTSCountClients'access );
+  declareFunction(  tinyserve_worker_number_t, "tinyserve.worker_number", ParseTSWorkerNumber'access );
+  declareFunction(  tinyserve_count_worker_clients_t, "tinyserve.count_worker_clients", ParseTSCountWorkerClients'access );
+  declareFunction(  tinyserve_count_worker_accepts_t, "tinyserve.count_worker_accepts", ParseTSCountWorkerAccepts'access );
   declareFunction(  tinyserve_get_fdset_size_t, "tinyserve.get_fdset_size", ParseTSGetFDSetSize'access );
   declareFunction(  tinyserve_client_might_not_block_on_write_t, "tinyserve.client_might_not_block_on_write", ParseTSClientMightNotBlockOnWrite'access );
   declareProcedure( tinyserve_establish_t, "tinyserve.establish", ParseTSEstablish'access );
   declareFunction(  tinyserve_is_timeout_t, "tinyserve.is_timeout", ParseTSIsTimeout'access );
   declareProcedure( tinyserve_close_t, "tinyserve.close", ParseTSClose'access );
   declareProcedure( tinyserve_drop_t, "tinyserve.drop", ParseTSDrop'access );
+  declareProcedure( tinyserve_set_message_framing_t, "tinyserve.set_message_framing", ParseTSSetMessageFraming'access );
+  declareProcedure( tinyserve_get_message_t, "tinyserve.get_message", ParseTSGetMessage'access );
+  declareProcedure( tinyserve_put_message_t, "tinyserve.put_message", ParseTSPutMessage'access );
+  declareFunction(  tinyserve_has_pending_output_t, "tinyserve.has_pending_output", ParseTSHasPendingOutput'access );
 
   declareNamespaceClosed( "tinyserve" );
+
+  declareNamespace( "socket_backend" );
+  declareStandardEnum( socket_backend_select_backend_t, "socket_backend.select_backend", tinyserve_socket_backend_t, "0" );
+  declareStandardEnum( socket_backend_epoll_backend_t,  "socket_backend.epoll_backend",  tinyserve_socket_backend_t, "1" );
+  declareNamespaceClosed( "socket_backend" );
+
+  declareNamespace( "message_framing" );
+  declareStandardEnum( message_framing_line_framing_t,            "message_framing.line_framing",            tinyserve_message_framing_t, "0" );
+  declareStandardEnum( message_framing_length_prefixed_framing_t, "message_framing.length_prefixed_framing", tinyserve_message_framing_t, "1" );
+  declareStandardEnum( message_framing_fixed_size_framing_t,      "message_framing.fixed_size_framing",      tinyserve_message_framing_t, "2" );
+  declareStandardEnum( message_framing_http_framing_t,            "message_framing.http_framing",            tinyserve_message_framing_t, "3" );
+  declareNamespaceClosed( "message_framing" );
+
+  declareNamespace( "message_status" );
+  declareStandardEnum( message_status_complete_message_t, "message_status.complete_message", tinyserve_message_status_t, "0" );
+  declareStandardEnum( message_status_partial_message_t,  "message_status.partial_message",  tinyserve_message_status_t, "1" );
+  declareStandardEnum( message_status_client_closed_t,    "message_status.client_closed",    tinyserve_message_status_t, "2" );
+  declareNamespaceClosed( "message_status" );
 end StartupTinyserve;
 
 procedure ShutdownTinyserve is
@@ -13,6 +13,7 @@
 #include <signal.h>
 #include <time.h>
 #include <errno.h>
+#include <poll.h>
 
 /* C PEGASOCK ERRNO                                         */
 /*                                                          */
@@ -30,3 +31,33 @@ void C_pegasock_reset_errno() {
      errno = 0;
 }
 
+/* C PEGASOCK WAIT READABLE                                 */
+/*                                                          */
+/* Wait up to timeout_ms milliseconds for data on either of */
+/* two sockets.  fd2 may be -1.  Returns 1 if fd1 is ready, */
+/* 2 if fd2 is ready, 3 if both are, 0 on a timeout and -1  */
+/* on an error.  A closed or failed socket counts as ready  */
+/* so the read reports the error.                           */
+
+int C_pegasock_wait_readable( int fd1, int fd2, int timeout_ms ) {
+    struct pollfd fds[2];
+    int res;
+
+    fds[0].fd = fd1;
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    fds[1].fd = fd2;
+    fds[1].events = POLLIN;
+    fds[1].revents = 0;
+    do {
+       res = poll( fds, 2, timeout_ms );
+    } while ( res < 0 && errno == EINTR );
+    if ( res <= 0 )
+       return res;
+    res = 0;
+    if ( fds[0].revents != 0 )
+       res |= 1;
+    if ( fds[1].revents != 0 )
+       res |= 2;
+    return res;
+}
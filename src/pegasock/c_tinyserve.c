@@ -5,12 +5,28 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <limits.h>
+#include <strings.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/prctl.h>
+#include <sys/sendfile.h>
+#define HAVE_EPOLL 1
+#endif
+#if !defined( MAP_ANONYMOUS ) && defined( MAP_ANON )
+#define MAP_ANONYMOUS MAP_ANON
+#endif
 
 // Configuration constants
 
@@ -20,6 +36,41 @@
 // http://publib.boulder.ibm.com/infocenter/wasinfo/v6r0/index.jsp?topic=/com.ibm.websphere.express.doc/info/exp/ae/tprf_tunelinux.html
 // recommends bumping the maximum for this and nextdev_max_backlog to 3000
 
+// Readiness backends.  These must match aSocketBackend in
+// pegasock-tinyserve.ads.  select() is limited to FD_SETSIZE descriptors and
+// scans every descriptor on each call.  epoll() (Linux only) is limited only
+// by the open file limit and only returns the descriptors that are ready.
+
+#define BACKEND_SELECT 0
+#define BACKEND_EPOLL  1
+
+// the most ready descriptors returned by one epoll_wait()
+#define EPOLL_MAX_EVENTS 1024
+
+// Message framing.  These must match aMessageFraming in
+// pegasock-tinyserve.ads.
+
+#define FRAMING_LINE   0                  // message ends with a line feed
+#define FRAMING_LENGTH 1                  // 4-byte network order length first
+#define FRAMING_FIXED  2                  // all messages are the same size
+#define FRAMING_HTTP   3                  // HTTP header and Content-Length
+
+#define MESSAGE_MAX (16*1024*1024)        // largest message accepted
+#define CLIENT_BUFFER_MIN 4096            // starting buffer size
+
+#define WORKERS_MAX 256                   // most worker processes
+
+#define FILE_CHUNK_MAX (1024*1024*1024)   // most file bytes sent at once
+
+// MSG_NOSIGNAL suppresses the broken pipe signal but an error is still
+// returned
+
+#ifdef __APPLE__
+#define SEND_FLAGS 0
+#else
+#define SEND_FLAGS MSG_NOSIGNAL
+#endif
+
 // Shared with Ada
 //
 // socket_buffer - string buffer for C to/from Ada strings
@@ -31,6 +82,42 @@ int socket_error = 0;
 
 // Globals
 
+// Per-client read and write buffers.  Incoming data is kept until a whole
+// message has arrived.  Outgoing data is kept until the socket can take it.
+
+typedef struct {
+  char *rd;                                             // incoming data
+  int rd_len;                                           // bytes in rd
+  int rd_size;                                          // size of rd
+  int rd_scan;                                          // searched for LF
+  int msg_offset;                                       // current message
+  int msg_len;
+  int frame_len;                                        // message + framing
+  int closed;                                           // client hung up
+  char *wr;                                             // outgoing data
+  int wr_pos;                                           // first unsent byte
+  int wr_len;                                           // bytes in wr
+  int wr_size;                                          // size of wr
+  int file_pending;                                     // file to send
+  int file_fd;                                          // file descriptor
+  off_t file_pos;                                       // next file byte
+  off_t file_end;                                       // bytes to send
+  int file_mark;                                        // wr offset of file
+  int close_pending;                                    // close when sent
+  time_t last_active;                                   // last read/write
+} ClientBuffer;
+
+// Per-worker counts.  These are in memory shared by all worker processes
+// and the parent.  Each worker only updates its own entry.
+
+typedef struct {
+  pid_t pid;                                            // worker process
+  time_t started;                                       // when forked
+  volatile int accepted;                                // clients accepted
+  volatile int open;                                    // clients open
+  int restarts;                                         // times restarted
+} WorkerStats;
+
 typedef struct {
   int min_recv_buffer_size;                             // init parameters
   int min_send_buffer_size;
@@ -41,11 +128,31 @@ typedef struct {
   //unsigned int len_inet;                              // protocol addr length
   // CygWin: socklen_t is signed int
   socklen_t len_inet;
+  struct sockaddr_in listen_addr;                       // listener address
+  int reuse_port;                                       // SO_REUSEPORT
+  int worker;                                           // 0 if not a worker
+  int num_workers;                                      // worker processes
+  WorkerStats *stats;                                   // shared counts
   int timeout_secs;                                     // accept timeout
   int timeout_usecs;
   fd_set so_set;                                        // select() fd sets
   fd_set rd_set;
   fd_set wr_set;
+  fd_set out_set;                                       // output waiting
+  int framing;                                          // message framing
+  int fixed_size;                                       // for fixed framing
+  ClientBuffer **buffers;                               // buffers by fd
+  int buffers_size;                                     // size of buffers
+  int backend;                                          // select or epoll
+#ifdef HAVE_EPOLL
+  int epoll_fd;                                         // epoll instance
+  struct epoll_event *events;                           // last epoll_wait()
+  int num_events;                                       // events returned
+  int next_event;                                       // getNextClient pos
+  unsigned char *clients;                               // open fds by fd
+  int clients_size;                                     // size of clients
+  int num_clients;                                      // open clients
+#endif
 } SocketData;
 
 
@@ -73,11 +180,359 @@ int getFDSetSize() {
 
 void ready_socket_data( SocketData *socket_data ) {
   FD_ZERO( &socket_data->so_set );
+  FD_ZERO( &socket_data->out_set );
   FD_SET( socket_data->socket_listener, &socket_data->so_set );
   socket_data->max_fd = socket_data->socket_listener + 1;
 }
 
 
+// GET CLIENT BUFFER
+//
+// Return the buffers for a client socket.  If create is true, create
+// them if they don't exist.  Return NULL on an error.
+
+static ClientBuffer *get_client_buffer( SocketData *socket_data, int socket_client, int create ) {
+  ClientBuffer **new_buffers;
+  ClientBuffer *cb;
+  int new_size;
+
+  if ( socket_client < 0 ) {
+     if ( create )
+        socket_error = EBADF;
+     return NULL;
+  }
+  if ( socket_client >= socket_data->buffers_size ) {
+     if ( !create )
+        return NULL;
+     new_size = socket_data->buffers_size > 0 ? socket_data->buffers_size * 2 : FD_SETSIZE;
+     while ( new_size <= socket_client )
+        new_size *= 2;
+     new_buffers = realloc( socket_data->buffers, new_size * sizeof( ClientBuffer * ) );
+     if ( new_buffers == NULL ) {
+        socket_error = 256;
+        return NULL;
+     }
+     memset( new_buffers + socket_data->buffers_size, 0,
+        ( new_size - socket_data->buffers_size ) * sizeof( ClientBuffer * ) );
+     socket_data->buffers = new_buffers;
+     socket_data->buffers_size = new_size;
+  }
+  cb = socket_data->buffers[ socket_client ];
+  if ( cb == NULL && create ) {
+     cb = calloc( 1, sizeof( ClientBuffer ) );
+     if ( cb == NULL ) {
+        socket_error = 256;
+        return NULL;
+     }
+     cb->last_active = time( NULL );
+     socket_data->buffers[ socket_client ] = cb;
+  }
+  return cb;
+}
+
+
+// FREE CLIENT BUFFER
+//
+// Discard a client's buffers, including any unsent data.
+
+static void free_client_buffer( SocketData *socket_data, int socket_client ) {
+  ClientBuffer *cb;
+
+  cb = get_client_buffer( socket_data, socket_client, 0 );
+  if ( cb != NULL ) {
+     if ( cb->file_pending )
+        close( cb->file_fd );
+     free( cb->rd );
+     free( cb->wr );
+     free( cb );
+     socket_data->buffers[ socket_client ] = NULL;
+  }
+  if ( socket_client >= 0 && socket_client < FD_SETSIZE )
+     FD_CLR( socket_client, &socket_data->out_set );
+}
+
+
+// CLIENT IS CLOSING
+//
+// True if the client was closed while output was still waiting.  The
+// socket stays open until the output is sent.
+
+static int client_is_closing( SocketData *socket_data, int socket_client ) {
+  ClientBuffer *cb;
+
+  cb = get_client_buffer( socket_data, socket_client, 0 );
+  return cb != NULL && cb->close_pending;
+}
+
+
+// WATCH CLIENT OUTPUT
+//
+// Start or stop waiting for a client socket to become writable.
+
+static void watch_client_output( SocketData *socket_data, int socket_client, int watch ) {
+#ifdef HAVE_EPOLL
+  struct epoll_event ev;
+
+  if ( socket_data->backend == BACKEND_EPOLL ) {
+     memset( &ev, 0, sizeof( ev ) );
+     if ( client_is_closing( socket_data, socket_client ) )
+        ev.events = EPOLLOUT;
+     else
+        ev.events = watch ? EPOLLIN | EPOLLOUT : EPOLLIN;
+     ev.data.fd = socket_client;
+     if ( epoll_ctl( socket_data->epoll_fd, EPOLL_CTL_MOD, socket_client, &ev ) < 0 )
+        socket_error = errno;
+     return;
+  }
+#endif
+  if ( watch ) {
+     FD_SET( socket_client, &socket_data->out_set );
+  } else {
+     FD_CLR( socket_client, &socket_data->out_set );
+  }
+}
+
+
+// SEND CLIENT FILE
+//
+// Send part of a client's queued file.  If wait is false, stop when the
+// socket would block.  Return the number of bytes sent, 0 if the socket
+// would block or -1 on an error.  On Linux, sendfile() copies the file in
+// the kernel.  Elsewhere, it is read and sent in pieces.
+
+static int send_client_file( int socket_client, ClientBuffer *cb, int wait ) {
+  off_t left;
+  int chunk;
+  int bytes_sent;
+#ifdef __linux__
+  int flags = 0;
+#else
+  char buffer[ CLIENT_BUFFER_MIN * 4 ];
+  int bytes_read;
+#endif
+
+  left = cb->file_end - cb->file_pos;
+  chunk = left > FILE_CHUNK_MAX ? FILE_CHUNK_MAX : (int) left;
+#ifdef __linux__
+  // sendfile() has no flags so make the socket non-blocking for the call
+  if ( !wait ) {
+     flags = fcntl( socket_client, F_GETFL, 0 );
+     if ( flags >= 0 )
+        fcntl( socket_client, F_SETFL, flags | O_NONBLOCK );
+  }
+  bytes_sent = sendfile( socket_client, cb->file_fd, &cb->file_pos, chunk );
+  if ( bytes_sent < 0 )
+     socket_error = errno;
+  if ( !wait && flags >= 0 )
+     fcntl( socket_client, F_SETFL, flags );
+#else
+  if ( chunk > (int) sizeof( buffer ) )
+     chunk = sizeof( buffer );
+  bytes_read = pread( cb->file_fd, buffer, chunk, cb->file_pos );
+  if ( bytes_read <= 0 ) {
+     socket_error = bytes_read < 0 ? errno : EIO;
+     return -1;
+  }
+  bytes_sent = send( socket_client, buffer, bytes_read,
+     wait ? SEND_FLAGS : SEND_FLAGS | MSG_DONTWAIT );
+  if ( bytes_sent < 0 )
+     socket_error = errno;
+  else
+     cb->file_pos += bytes_sent;
+#endif
+  if ( bytes_sent < 0 ) {
+     if ( socket_error == EINTR || socket_error == EAGAIN || socket_error == EWOULDBLOCK ) {
+        socket_error = 0;
+        return 0;
+     }
+     return -1;
+  }
+  if ( bytes_sent == 0 ) {
+     // the file is shorter than expected
+     socket_error = EIO;
+     return -1;
+  }
+  return bytes_sent;
+}
+
+
+// DISCARD CLIENT OUTPUT
+//
+// Forget a client's queued output after an error.
+
+static void discard_client_output( SocketData *socket_data, int socket_client, ClientBuffer *cb ) {
+  if ( cb->file_pending ) {
+     close( cb->file_fd );
+     cb->file_pending = 0;
+  }
+  cb->wr_pos = cb->wr_len = 0;
+  watch_client_output( socket_data, socket_client, 0 );
+}
+
+
+// FLUSH CLIENT OUTPUT
+//
+// Send as much queued output as the socket will take, including a queued
+// file.  If wait is false, stop when the socket would block.  Return the
+// number of bytes still waiting (at most INT_MAX) or -1 on an error (and
+// the output is discarded).
+
+static int flush_client_output( SocketData *socket_data, int socket_client, int wait ) {
+  ClientBuffer *cb;
+  int bytes_sent;
+  int limit;
+  off_t left;
+
+  cb = get_client_buffer( socket_data, socket_client, 0 );
+  if ( cb == NULL || ( cb->wr_pos == cb->wr_len && !cb->file_pending ) )
+     return 0;
+  for (;;) {
+     // output queued before the file goes first
+     limit = cb->file_pending ? cb->file_mark : cb->wr_len;
+     if ( cb->wr_pos < limit ) {
+        bytes_sent = send( socket_client, cb->wr + cb->wr_pos, limit - cb->wr_pos,
+           wait ? SEND_FLAGS : SEND_FLAGS | MSG_DONTWAIT );
+        if ( bytes_sent < 0 ) {
+           if ( errno == EINTR )
+              continue;
+           if ( errno == EAGAIN || errno == EWOULDBLOCK )
+              break;
+           socket_error = errno;
+           discard_client_output( socket_data, socket_client, cb );
+           return -1;
+        }
+        cb->wr_pos += bytes_sent;
+        cb->last_active = time( NULL );
+     } else if ( cb->file_pending ) {
+        bytes_sent = send_client_file( socket_client, cb, wait );
+        if ( bytes_sent < 0 ) {
+           discard_client_output( socket_data, socket_client, cb );
+           return -1;
+        }
+        if ( bytes_sent == 0 )
+           break;
+        cb->last_active = time( NULL );
+        if ( cb->file_pos >= cb->file_end ) {
+           close( cb->file_fd );
+           cb->file_pending = 0;
+        }
+     } else {
+        break;
+     }
+  }
+  if ( cb->wr_pos == cb->wr_len && !cb->file_pending ) {
+     cb->wr_pos = cb->wr_len = 0;
+     watch_client_output( socket_data, socket_client, 0 );
+     return 0;
+  }
+  left = cb->wr_len - cb->wr_pos;
+  if ( cb->file_pending )
+     left += cb->file_end - cb->file_pos;
+  return left > INT_MAX ? INT_MAX : (int) left;
+}
+
+
+#ifdef HAVE_EPOLL
+
+// READY EPOLL DATA
+//
+// Create the epoll instance and register the listener socket.  Return 0 on
+// success or -1 on an error.
+
+static int ready_epoll_data( SocketData *socket_data ) {
+  struct epoll_event ev;
+
+  socket_data->num_events = 0;
+  socket_data->next_event = 0;
+  socket_data->num_clients = 0;
+  socket_data->clients_size = FD_SETSIZE;
+  socket_data->events = malloc( EPOLL_MAX_EVENTS * sizeof( struct epoll_event ) );
+  socket_data->clients = calloc( socket_data->clients_size, 1 );
+  if ( socket_data->events == NULL || socket_data->clients == NULL ) {
+     free( socket_data->events );
+     free( socket_data->clients );
+     socket_error = 256;
+     return -1;
+  }
+  socket_data->epoll_fd = epoll_create1( EPOLL_CLOEXEC );
+  if ( socket_data->epoll_fd < 0 ) {
+     socket_error = errno;
+     free( socket_data->events );
+     free( socket_data->clients );
+     return -1;
+  }
+  memset( &ev, 0, sizeof( ev ) );
+  ev.events = EPOLLIN;
+  ev.data.fd = socket_data->socket_listener;
+  if ( epoll_ctl( socket_data->epoll_fd, EPOLL_CTL_ADD, socket_data->socket_listener, &ev ) < 0 ) {
+     socket_error = errno;
+     close( socket_data->epoll_fd );
+     free( socket_data->events );
+     free( socket_data->clients );
+     return -1;
+  }
+  return 0;
+}
+
+
+// ADD EPOLL CLIENT
+//
+// Watch a new client socket for incoming data.  The open client table is
+// grown as needed since there is no FD_SETSIZE limit.  Return 0 on success
+// or -1 on an error.
+
+static int add_epoll_client( SocketData *socket_data, int socket_client ) {
+  struct epoll_event ev;
+  unsigned char *new_clients;
+  int new_size;
+
+  if ( socket_client >= socket_data->clients_size ) {
+     new_size = socket_data->clients_size * 2;
+     while ( new_size <= socket_client )
+        new_size *= 2;
+     new_clients = realloc( socket_data->clients, new_size );
+     if ( new_clients == NULL ) {
+        socket_error = 256;
+        return -1;
+     }
+     memset( new_clients + socket_data->clients_size, 0,
+        new_size - socket_data->clients_size );
+     socket_data->clients = new_clients;
+     socket_data->clients_size = new_size;
+  }
+  memset( &ev, 0, sizeof( ev ) );
+  ev.events = EPOLLIN;
+  ev.data.fd = socket_client;
+  if ( epoll_ctl( socket_data->epoll_fd, EPOLL_CTL_ADD, socket_client, &ev ) < 0 ) {
+     socket_error = errno;
+     return -1;
+  }
+  socket_data->clients[ socket_client ] = 1;
+  socket_data->num_clients++;
+  return 0;
+}
+
+
+// NEXT EPOLL CLIENT
+//
+// Return the next client from the last epoll_wait() with data waiting,
+// or -1 if there are no more.  Only the ready descriptors are examined.
+
+static int next_epoll_client( SocketData *socket_data ) {
+  int fd;
+
+  while ( socket_data->next_event < socket_data->num_events ) {
+     fd = socket_data->events[ socket_data->next_event++ ].data.fd;
+     if ( fd >= 0 && fd != socket_data->socket_listener )
+        return fd;
+  }
+  return -1;
+}
+
+
+#endif
+
+
 // PREPARE FOR SELECT
 //
 // Copy the socket list for reading with select().
@@ -88,6 +543,9 @@ void prepare_for_select( SocketData *socket_data ) {
   FD_ZERO( &socket_data->rd_set );
   for ( z=0; z<socket_data->max_fd; ++z ) {
      if ( FD_ISSET( z, &socket_data->so_set ) ) {
+        // a client being closed is only waiting for its output to drain
+        if ( client_is_closing( socket_data, z ) )
+           continue;
         FD_SET( z, &socket_data->rd_set );
         FD_SET( z, &socket_data->wr_set );
      }
@@ -101,6 +559,10 @@ void prepare_for_select( SocketData *socket_data ) {
 int count_clients( SocketData *socket_data ) {
   int z;
   int cnt=0;
+#ifdef HAVE_EPOLL
+  if ( socket_data->backend == BACKEND_EPOLL )
+     return socket_data->num_clients;
+#endif
   for ( z=socket_data->socket_listener+1; z<socket_data->max_fd; ++z ) {
      if ( FD_ISSET( z, &socket_data->so_set ) ) {
         cnt++;
@@ -116,83 +578,33 @@ int count_clients( SocketData *socket_data ) {
 // will not block...but more might).
 
 int clientMightNotBlockOnWrite( SocketData *socket_data, int socket_client ) {
+#ifdef HAVE_EPOLL
+   if ( socket_data->backend == BACKEND_EPOLL )
+      return socket_client >= 0 && socket_client < socket_data->clients_size &&
+             socket_data->clients[ socket_client ];
+#endif
    return FD_ISSET( socket_client, &socket_data->wr_set );
 } // client_might_not_block_on_write
 
 
-//  INITIALIZE SERVER
-//
-// Create a socket (based on the global variables) that can handle
-// (accept) new client connections.  The address or IP to listen to
-// should be in the buffer.  socket_port is the port to listen to.
+//  OPEN LISTENER
 //
-//  Return the listener socket that clients connect to.
-
-SocketData *initialize_server( int socket_port,
-  int min_recv_buffer_size, int min_send_buffer_size,
-  int socket_queue_length, int socket_linger_seconds,
-  int timeout_secs, int timeout_usecs ) {
+// Create, bind and listen on the listener socket for the address in the
+// socket data.  Return 0 on success or -1 on an error.
 
-  SocketData *socket_data;
+static int open_listener( SocketData *socket_data ) {
   socklen_t optlen = -1;
   int recv_buffer_size = -1;
   int send_buffer_size = -1;
   int default_recv_buffer_size = -1;
   int default_send_buffer_size = -1;
   struct linger so_linger;
-
   int z = -1;
-  struct sockaddr_in adr_inet;
-  struct hostent *hp;
-
-  socket_error = 0;
-
-  socket_data = malloc( sizeof( SocketData ) );
-  if ( socket_data == NULL ) {
-     socket_error = 256;
-     return NULL;
-  }
-
-  // Record parameters
-
-  socket_data->min_recv_buffer_size = min_recv_buffer_size;
-  socket_data->min_send_buffer_size = min_send_buffer_size;
-  socket_data->socket_queue_length = socket_queue_length;
-  socket_data->socket_linger_seconds = socket_linger_seconds;
-  socket_data->timeout_secs = timeout_secs;
-  socket_data->timeout_usecs = timeout_usecs;
-
-  if ( !(hp = gethostbyname( socket_buffer ) ) ) {
-        socket_error = errno;
-        free( socket_data );
-	return NULL;
-  }
-  memset( &adr_inet, 0, sizeof(adr_inet) );                // prepare socket addr
-  memcpy( (char *)&adr_inet.sin_addr, (char *)hp->h_addr, hp->h_length );
-  adr_inet.sin_port = htons( socket_port );                 // web server port
-  adr_inet.sin_family = hp->h_addrtype;              // TCP/IP; open socket
-
-/*
-  printf( "Socket: Host %s (%d.%d.%d.%d) Port %d will be where clients connect\n",
-           socket_buffer,
-	   hp->h_addr_list[0][0],
-	   hp->h_addr_list[0][1],
-	   hp->h_addr_list[0][2],
-	   hp->h_addr_list[0][3],
-	   socket_port );
-*/
-
-  if ( socket_port > 32767 ) {
-     socket_error = 256;
-     free( socket_data );
-     return NULL;
-  }
 
   socket_data->socket_listener = socket( AF_INET, SOCK_STREAM, 0 );
   if ( socket_data->socket_listener < 0 ) {
      socket_error = errno;
-     free( socket_data );
-     return NULL;
+     return -1;
   }
 
   // Socket buffer sizes
@@ -211,13 +623,13 @@ SocketData *initialize_server( int socket_port,
   if ( socket_data->min_send_buffer_size > 0 ) {
      optlen = sizeof( socket_data->min_send_buffer_size );
      z = setsockopt( socket_data->socket_listener, SOL_SOCKET, SO_SNDBUF,
-       &min_send_buffer_size, optlen );
+       &socket_data->min_send_buffer_size, optlen );
      if ( z ) printf( "setsockopt( send size ) failed - %d\n", errno );
   }
   if ( socket_data->min_recv_buffer_size > 0 ) {
      optlen = sizeof( socket_data->min_recv_buffer_size );
      z = setsockopt( socket_data->socket_listener, SOL_SOCKET, SO_SNDBUF,
-       &min_recv_buffer_size, optlen );
+       &socket_data->min_recv_buffer_size, optlen );
      if ( z ) printf( "setsockopt( recv size ) failed - %d\n", errno );
   }
 
@@ -233,9 +645,9 @@ SocketData *initialize_server( int socket_port,
 
 /*
   printf( "Socket send buffer size (bytes): default=%d request=%d actual=%d\n",
-    default_send_buffer_size, min_send_buffer_size, send_buffer_size );
+    default_send_buffer_size, socket_data->min_send_buffer_size, send_buffer_size );
   printf( "Socket recv buffer size (bytes): default=%d request=%d actual=%d\n",
-    default_recv_buffer_size, min_recv_buffer_size, recv_buffer_size );
+    default_recv_buffer_size, socket_data->min_recv_buffer_size, recv_buffer_size );
 */
 
   // No error if restarting socket server and address still in use in kernel
@@ -245,6 +657,17 @@ SocketData *initialize_server( int socket_port,
       &z, sizeof( z ) );
   if ( z ) printf( "setsockopt( reuseaddr ) failed - %d\n", errno );
 
+#ifdef SO_REUSEPORT
+  // Let each worker process have its own listener on the same port
+
+  if ( socket_data->reuse_port ) {
+     z = 1;
+     z = setsockopt( socket_data->socket_listener, SOL_SOCKET, SO_REUSEPORT,
+         &z, sizeof( z ) );
+     if ( z ) printf( "setsockopt( reuseport ) failed - %d\n", errno );
+  }
+#endif
+
   // Block socket on close if data not all read
 
   if ( socket_data->socket_linger_seconds > 0 ) {
@@ -265,14 +688,14 @@ SocketData *initialize_server( int socket_port,
 
   // Put the socket on the network
 
-  socket_data->len_inet = sizeof( adr_inet );
+  socket_data->len_inet = sizeof( socket_data->listen_addr );
 
-  z = bind( socket_data->socket_listener, (struct sockaddr *)&adr_inet, socket_data->len_inet );
+  z = bind( socket_data->socket_listener, (struct sockaddr *)&socket_data->listen_addr, socket_data->len_inet );
   if ( z == -1 ) {
      socket_error = errno;
      close( socket_data->socket_listener );
-     free( socket_data );
-     return NULL;
+     socket_data->socket_listener = -1;
+     return -1;
   }
 
   // Make it a listener than can receive new clients
@@ -280,120 +703,225 @@ SocketData *initialize_server( int socket_port,
   if ( listen( socket_data->socket_listener, socket_data->socket_queue_length ) < 0 ) {
      socket_error = errno;
      close( socket_data->socket_listener );
-     free( socket_data );
-     return NULL;
+     socket_data->socket_listener = -1;
+     return -1;
   }
 
-  ready_socket_data( socket_data );
+  // Non-blocking so that all waiting clients can be accepted at once
 
-  return socket_data;
+  z = fcntl( socket_data->socket_listener, F_GETFL, 0 );
+  if ( z < 0 || fcntl( socket_data->socket_listener, F_SETFL, z | O_NONBLOCK ) < 0 ) {
+     socket_error = errno;
+     close( socket_data->socket_listener );
+     socket_data->socket_listener = -1;
+     return -1;
+  }
 
-} // initialize_server
+  return 0;
+}
 
 
-//  MANAGE CONNECTIONS
+//  INITIALIZE SERVER
 //
-// Wait on all open sockets for a client to connect.  Return the client
-// socket, 0 (timeout) or -1 (error).
+// Create a socket (based on the global variables) that can handle
+// (accept) new client connections.  The address or IP to listen to
+// should be in the buffer.  socket_port is the port to listen to.
+// backend chooses select or epoll.  Without epoll, select is used.
+// If there will be more than one worker process, the port is shared
+// with SO_REUSEPORT (see start_workers).
+//
+//  Return the listener socket that clients connect to.
 
-int manageConnections( SocketData *socket_data ) {
-    int client_socket;
-    struct sockaddr_in adr_clnt;
-    struct timeval socket_timeout;
-    int res;
-    int c;
+SocketData *initialize_server( int socket_port,
+  int min_recv_buffer_size, int min_send_buffer_size,
+  int socket_queue_length, int socket_linger_seconds,
+  int timeout_secs, int timeout_usecs, int backend, int workers ) {
 
-    socket_error = 0;
-    prepare_for_select( socket_data );
-    socket_timeout.tv_sec  = socket_data->timeout_secs;
-    socket_timeout.tv_usec = socket_data->timeout_usecs;
-    res = select( socket_data->max_fd, &socket_data->rd_set, NULL, NULL, &socket_timeout );
-    if ( res < 0 ) {
-       socket_error = errno;
-       if ( socket_error == EINTR ) {
-          client_socket = 0;
-       } else {
-          printf( "Select failed: %d\n", errno );
-          client_socket = -1;
-       }
-    } else if ( res == 0 ) {
-      // zero is a timeout
-      client_socket = 0;
-    } else if ( FD_ISSET( socket_data->socket_listener, &socket_data->rd_set ) ) {
-      // New client connecting - what priority should this be?
+  SocketData *socket_data;
+  struct sockaddr_in adr_inet;
+  struct hostent *hp;
 
-retry:
-     client_socket = accept( socket_data->socket_listener, (struct sockaddr *)&adr_clnt, &socket_data->len_inet );
-     if ( client_socket < 0 ) {
-       socket_error = errno;
-       if ( socket_error == EINTR ) {
-          goto retry;
-       } else if ( socket_error == EAGAIN ) {
-          // EAGAIN only occurs on non-blocking sockets to indicate no data yet
-          socket_error = 0;
-       } else {
-          printf( "Accept failed: %d\n", errno );
-          client_socket = -1;
-       }
-    } else if ( client_socket > FD_SETSIZE )  {
-       printf( "Socket closed: at capacity - FD_SETSIZE exceeded\n" );
-       close( client_socket );
-       client_socket = -1;
-    } else {
-        if ( client_socket + 1 > socket_data->max_fd ) {
-           socket_data->max_fd = client_socket + 1;
-       }
-       FD_SET( client_socket, &socket_data->so_set );
-       // client_socket = 0; // nothing to do
-    }
- } else {
-    //printf( "Existing socket\n" );
-    // existing client with new data
-    // not very efficient here since accept may report multiple
-    // clients but I'm only servicing one at a time.
-    client_socket = 0;
-    for ( c = 0 ; c < socket_data->max_fd ; ++c ) {
-        if ( c == socket_data->socket_listener ) // should never occur
-           continue;     // but ignore listener
-        if ( FD_ISSET( c, &socket_data->rd_set ) )  {
-           client_socket = c;
-           break;
-        }
-    }
-  }
+  socket_error = 0;
 
-  return client_socket;
+  socket_data = malloc( sizeof( SocketData ) );
+  if ( socket_data == NULL ) {
+     socket_error = 256;
+     return NULL;
+  }
 
-} // get_client_connection
+  // Record parameters
 
+  socket_data->min_recv_buffer_size = min_recv_buffer_size;
+  socket_data->min_send_buffer_size = min_send_buffer_size;
+  socket_data->socket_queue_length = socket_queue_length;
+  socket_data->socket_linger_seconds = socket_linger_seconds;
+  socket_data->timeout_secs = timeout_secs;
+  socket_data->timeout_usecs = timeout_usecs;
+  socket_data->backend = BACKEND_SELECT;
+  socket_data->framing = FRAMING_LINE;
+  socket_data->fixed_size = 0;
+  socket_data->buffers = NULL;
+  socket_data->buffers_size = 0;
+  socket_data->worker = 0;
+  socket_data->num_workers = 0;
+  socket_data->stats = NULL;
+#ifdef SO_REUSEPORT
+  socket_data->reuse_port = workers > 1;
+#else
+  socket_data->reuse_port = 0;
+#endif
 
-// GET NEXT CLIENT
-//
-// Get the next client waiting to be handled.
+  if ( !(hp = gethostbyname( socket_buffer ) ) ) {
+        socket_error = errno;
+        free( socket_data );
+	return NULL;
+  }
+  memset( &adr_inet, 0, sizeof(adr_inet) );                // prepare socket addr
+  memcpy( (char *)&adr_inet.sin_addr, (char *)hp->h_addr, hp->h_length );
+  adr_inet.sin_port = htons( socket_port );                 // web server port
+  adr_inet.sin_family = hp->h_addrtype;              // TCP/IP; open socket
+  socket_data->listen_addr = adr_inet;
 
-int getNextClient( SocketData *socket_data, int last_client ) {
-  int c;
+/*
+  printf( "Socket: Host %s (%d.%d.%d.%d) Port %d will be where clients connect\n",
+           socket_buffer,
+	   hp->h_addr_list[0][0],
+	   hp->h_addr_list[0][1],
+	   hp->h_addr_list[0][2],
+	   hp->h_addr_list[0][3],
+	   socket_port );
+*/
 
-  if ( last_client < 0 ) return -1;
-  for ( c = last_client+1; c <= socket_data->max_fd ; c++ ) {
-    if ( FD_ISSET( c, &socket_data->rd_set ) ) break;
+  if ( socket_port > 32767 ) {
+     socket_error = 256;
+     free( socket_data );
+     return NULL;
+  }
+
+  if ( open_listener( socket_data ) < 0 ) {
+     free( socket_data );
+     return NULL;
   }
-  if ( c > socket_data->max_fd ) c = -1;
-  return c;
-} // get_next_client
 
+  ready_socket_data( socket_data );
 
-//  CLOSE CLIENT
+#ifdef HAVE_EPOLL
+  if ( backend == BACKEND_EPOLL ) {
+     if ( ready_epoll_data( socket_data ) < 0 ) {
+        close( socket_data->socket_listener );
+        free( socket_data );
+        return NULL;
+     }
+     socket_data->backend = BACKEND_EPOLL;
+  }
+#endif
+
+  return socket_data;
+
+} // initialize_server
+
+
+// ACCEPT CLIENT
 //
-// Close the client socket.  Clear the client from the select list.
+// Accept one waiting client.  The listener socket is non-blocking so that
+// all waiting clients can be accepted.  Return the client socket, 0 if no
+// client is waiting or -1 (error).
 
-void closeClient( SocketData *socket_data, int socket_client ) {
+static int accept_client( SocketData *socket_data ) {
+  int client_socket;
+  struct sockaddr_in adr_clnt;
+  int flags;
+  int watched;
+
+retry:
+  client_socket = accept( socket_data->socket_listener, (struct sockaddr *)&adr_clnt, &socket_data->len_inet );
+  if ( client_socket < 0 ) {
+     socket_error = errno;
+     if ( socket_error == EINTR ) {
+        goto retry;
+     } else if ( socket_error == EAGAIN || socket_error == EWOULDBLOCK ||
+                 socket_error == ECONNABORTED ) {
+        // no more clients waiting (or the client gave up)
+        socket_error = 0;
+        return 0;
+     }
+     printf( "Accept failed: %d\n", errno );
+     return -1;
+  }
+
+  // Some operating systems copy non-blocking to the client socket
+
+  flags = fcntl( client_socket, F_GETFL, 0 );
+  if ( flags >= 0 && ( flags & O_NONBLOCK ) )
+     fcntl( client_socket, F_SETFL, flags & ~O_NONBLOCK );
+
+  watched = 0;
+#ifdef HAVE_EPOLL
+  if ( socket_data->backend == BACKEND_EPOLL ) {
+     if ( add_epoll_client( socket_data, client_socket ) < 0 ) {
+        printf( "Socket closed: cannot watch client - %d\n", socket_error );
+        close( client_socket );
+        return -1;
+     }
+     watched = 1;
+  }
+#endif
+  if ( !watched ) {
+     if ( client_socket >= FD_SETSIZE )  {
+        printf( "Socket closed: at capacity - FD_SETSIZE exceeded\n" );
+        close( client_socket );
+        return -1;
+     }
+     FD_SET( client_socket, &socket_data->so_set );
+  }
+  if ( client_socket + 1 > socket_data->max_fd ) {
+     socket_data->max_fd = client_socket + 1;
+  }
+  if ( socket_data->stats != NULL ) {
+     socket_data->stats[ socket_data->worker ].accepted++;
+     socket_data->stats[ socket_data->worker ].open++;
+  }
+  return client_socket;
+}
+
+
+// RELEASE CLIENT
+//
+// Close the client socket and discard any unsent output.  Clear the client
+// from the select list.
+
+static void release_client( SocketData *socket_data, int socket_client ) {
   int c;
+#ifdef HAVE_EPOLL
+  struct epoll_event ev;
+#endif
 
-  socket_error = 0;
+  free_client_buffer( socket_data, socket_client );
   shutdown( socket_client, SHUT_RDWR );
+#ifdef HAVE_EPOLL
+  if ( socket_data->backend == BACKEND_EPOLL ) {
+     if ( socket_client >= 0 && socket_client < socket_data->clients_size &&
+          socket_data->clients[ socket_client ] ) {
+        memset( &ev, 0, sizeof( ev ) );
+        epoll_ctl( socket_data->epoll_fd, EPOLL_CTL_DEL, socket_client, &ev );
+        socket_data->clients[ socket_client ] = 0;
+        socket_data->num_clients--;
+        if ( socket_data->stats != NULL )
+           socket_data->stats[ socket_data->worker ].open--;
+     }
+     // Forget any data waiting for this client from the last epoll_wait()
+     for ( c = socket_data->next_event; c < socket_data->num_events; c++ ) {
+        if ( socket_data->events[c].data.fd == socket_client )
+           socket_data->events[c].data.fd = -1;
+     }
+     close( socket_client );
+     return;
+  }
+#endif
   if ( FD_ISSET( socket_client, &socket_data->so_set ) ) {
      FD_CLR( socket_client, &socket_data->so_set );
+     if ( socket_data->stats != NULL )
+        socket_data->stats[ socket_data->worker ].open--;
   }
   close( socket_client );
   // Reduce search set if possible
@@ -402,6 +930,254 @@ void closeClient( SocketData *socket_data, int socket_client ) {
       socket_data->max_fd = c;
   }
 
+} // release_client
+
+
+// FINISH CLOSING CLIENT
+//
+// After output was sent to a client being closed, close the socket if
+// there is nothing left to send or the output failed.  True if the client
+// is being closed, so it must not be returned to the caller.
+
+static int finish_closing_client( SocketData *socket_data, int socket_client, int left ) {
+  if ( !client_is_closing( socket_data, socket_client ) )
+     return 0;
+  if ( left <= 0 )
+     release_client( socket_data, socket_client );
+  return 1;
+}
+
+
+// WAIT FOR CLIENTS
+//
+// Wait on all open sockets for a client to connect, for client data or
+// for room to send queued output.  Queued output is sent.  Return the
+// number of ready sockets, 0 (timeout) or -1 (error).
+
+static int wait_for_clients( SocketData *socket_data ) {
+  struct timeval socket_timeout;
+  fd_set out_ready;
+  int res;
+  int c;
+#ifdef HAVE_EPOLL
+  int timeout_msecs;
+  int fd;
+  int left;
+
+  if ( socket_data->backend == BACKEND_EPOLL ) {
+     socket_data->num_events = 0;
+     socket_data->next_event = 0;
+     timeout_msecs = socket_data->timeout_secs * 1000 + socket_data->timeout_usecs / 1000;
+     res = epoll_wait( socket_data->epoll_fd, socket_data->events, EPOLL_MAX_EVENTS, timeout_msecs );
+     if ( res < 0 ) {
+        socket_error = errno;
+        if ( socket_error == EINTR )
+           return 0;
+        printf( "Epoll wait failed: %d\n", errno );
+        return -1;
+     }
+     socket_data->num_events = res;
+
+     // Send waiting output to clients that can now take it.  Clients that
+     // are only writable are not returned to the caller.
+
+     for ( c = 0; c < res; c++ ) {
+         fd = socket_data->events[c].data.fd;
+         left = 0;
+         if ( socket_data->events[c].events & EPOLLOUT ) {
+            left = flush_client_output( socket_data, fd, 0 );
+            if ( !( socket_data->events[c].events & ( EPOLLIN | EPOLLERR | EPOLLHUP ) ) )
+               socket_data->events[c].data.fd = -1;
+         }
+         if ( socket_data->events[c].events & ( EPOLLERR | EPOLLHUP ) )
+            left = -1;
+         if ( finish_closing_client( socket_data, fd, left ) )
+            socket_data->events[c].data.fd = -1;
+     }
+     return res;
+  }
+#endif
+  prepare_for_select( socket_data );
+  socket_timeout.tv_sec  = socket_data->timeout_secs;
+  socket_timeout.tv_usec = socket_data->timeout_usecs;
+  out_ready = socket_data->out_set;
+  res = select( socket_data->max_fd, &socket_data->rd_set, &out_ready, NULL, &socket_timeout );
+  if ( res < 0 ) {
+     socket_error = errno;
+     if ( socket_error == EINTR )
+        return 0;
+     printf( "Select failed: %d\n", errno );
+     return -1;
+  }
+  if ( res > 0 ) {
+     // Send waiting output to clients that can now take it
+     for ( c = 0 ; c < socket_data->max_fd ; ++c ) {
+         if ( FD_ISSET( c, &out_ready ) )
+            finish_closing_client( socket_data, c, flush_client_output( socket_data, c, 0 ) );
+     }
+  }
+  return res;
+}
+
+
+// LISTENER IS READY
+//
+// True if wait_for_clients found new clients waiting to connect.
+
+static int listener_is_ready( SocketData *socket_data ) {
+#ifdef HAVE_EPOLL
+  int i;
+
+  if ( socket_data->backend == BACKEND_EPOLL ) {
+     for ( i = 0; i < socket_data->num_events; i++ ) {
+         if ( socket_data->events[i].data.fd == socket_data->socket_listener )
+            return 1;
+     }
+     return 0;
+  }
+#endif
+  return FD_ISSET( socket_data->socket_listener, &socket_data->rd_set );
+}
+
+
+//  MANAGE CONNECTIONS
+//
+// Wait on all open sockets for a client to connect.  Return the client
+// socket, 0 (timeout) or -1 (error).
+
+int manageConnections( SocketData *socket_data ) {
+    int client_socket;
+    int res;
+    int c;
+
+    socket_error = 0;
+    res = wait_for_clients( socket_data );
+    if ( res <= 0 )
+       return res;
+
+    // New client connecting - what priority should this be?
+
+    if ( listener_is_ready( socket_data ) ) {
+       client_socket = accept_client( socket_data );
+       if ( client_socket != 0 )
+          return client_socket;
+    }
+
+    // existing client with new data.  Only one is returned: use
+    // getNextClient for the rest or manageConnectionsBatch for all.
+
+#ifdef HAVE_EPOLL
+    if ( socket_data->backend == BACKEND_EPOLL ) {
+       client_socket = next_epoll_client( socket_data );
+       return client_socket < 0 ? 0 : client_socket;
+    }
+#endif
+    client_socket = 0;
+    for ( c = 0 ; c < socket_data->max_fd ; ++c ) {
+        if ( c == socket_data->socket_listener ) // should never occur
+           continue;     // but ignore listener
+        if ( FD_ISSET( c, &socket_data->rd_set ) )  {
+           client_socket = c;
+           break;
+        }
+    }
+    return client_socket;
+
+} // get_client_connection
+
+
+//  MANAGE CONNECTIONS BATCH
+//
+// Wait on all open sockets like manageConnections but return every ready
+// client at once.  All waiting new clients are accepted first, followed by
+// the clients with data.  Up to max_clients are stored in clients (any
+// others are returned next time).  Return the number of clients, 0
+// (timeout) or -1 (error).
+
+int manageConnectionsBatch( SocketData *socket_data, int *clients, int max_clients ) {
+    int client_socket;
+    int count = 0;
+    int res;
+    int c;
+
+    socket_error = 0;
+    res = wait_for_clients( socket_data );
+    if ( res <= 0 )
+       return res;
+
+    if ( listener_is_ready( socket_data ) ) {
+       while ( count < max_clients ) {
+          client_socket = accept_client( socket_data );
+          if ( client_socket < 0 ) {
+             if ( count == 0 )
+                return -1;
+             break;
+          }
+          if ( client_socket == 0 )
+             break;
+          clients[ count++ ] = client_socket;
+       }
+    }
+
+#ifdef HAVE_EPOLL
+    if ( socket_data->backend == BACKEND_EPOLL ) {
+       while ( count < max_clients ) {
+          client_socket = next_epoll_client( socket_data );
+          if ( client_socket < 0 )
+             break;
+          clients[ count++ ] = client_socket;
+       }
+       return count;
+    }
+#endif
+    for ( c = 0 ; c < socket_data->max_fd && count < max_clients ; ++c ) {
+        if ( c != socket_data->socket_listener && FD_ISSET( c, &socket_data->rd_set ) )
+           clients[ count++ ] = c;
+    }
+    return count;
+
+} // manage_connections_batch
+
+
+// GET NEXT CLIENT
+//
+// Get the next client waiting to be handled.
+
+int getNextClient( SocketData *socket_data, int last_client ) {
+  int c;
+
+  if ( last_client < 0 ) return -1;
+#ifdef HAVE_EPOLL
+  // epoll remembers its position in the ready list
+  if ( socket_data->backend == BACKEND_EPOLL )
+     return next_epoll_client( socket_data );
+#endif
+  for ( c = last_client+1; c <= socket_data->max_fd ; c++ ) {
+    if ( FD_ISSET( c, &socket_data->rd_set ) ) break;
+  }
+  if ( c > socket_data->max_fd ) c = -1;
+  return c;
+} // get_next_client
+
+
+//  CLOSE CLIENT
+//
+// Close the client socket.  If output is still waiting and the socket
+// would block, the client is not read from again and the socket is closed
+// by wait_for_clients once the output is sent.
+
+void closeClient( SocketData *socket_data, int socket_client ) {
+  ClientBuffer *cb;
+
+  socket_error = 0;
+  if ( flush_client_output( socket_data, socket_client, 0 ) > 0 ) {
+     cb = get_client_buffer( socket_data, socket_client, 0 );
+     cb->close_pending = 1;
+     shutdown( socket_client, SHUT_RD );
+     watch_client_output( socket_data, socket_client, 1 );
+     return;
+  }
+  release_client( socket_data, socket_client );
 } // close_client
 
 
@@ -423,6 +1199,7 @@ void abortClient( SocketData *socket_data, int socket_client ) {
         printf( "setsockopt( linger ) failed - %d\n", errno );
      }
   }
+  free_client_buffer( socket_data, socket_client );
   closeClient( socket_data, socket_client );
 } // abort_client
 
@@ -433,6 +1210,28 @@ void shutdown_server( SocketData *socket_data ) {
   int c;
 
   socket_error = 0;
+  for ( c = 0 ; c < socket_data->buffers_size ; ++c ) {
+      free_client_buffer( socket_data, c );
+  }
+  free( socket_data->buffers );
+  if ( socket_data->stats != NULL )
+     munmap( socket_data->stats, ( WORKERS_MAX + 1 ) * sizeof( WorkerStats ) );
+#ifdef HAVE_EPOLL
+  if ( socket_data->backend == BACKEND_EPOLL ) {
+     for ( c = 0 ; c < socket_data->clients_size ; ++c ) {
+         if ( socket_data->clients[c] ) {
+            shutdown( c, SHUT_RDWR );
+            close( c );
+         }
+     }
+     close( socket_data->epoll_fd );
+     free( socket_data->events );
+     free( socket_data->clients );
+     close( socket_data->socket_listener );
+     free( socket_data );
+     return;
+  }
+#endif
   for ( c = 0 ; c < socket_data->max_fd ; ++c ) {
       if ( FD_ISSET( c, &socket_data->so_set ) )  {
           if ( c != socket_data->socket_listener ) {
@@ -520,3 +1319,689 @@ retry:
 
 } // send_client_message
 
+
+//  SET MESSAGE FRAMING
+//
+// Choose how messages are separated: by line feeds, by a 4-byte network
+// order length before each message, by a fixed size or as HTTP requests.
+// --------------------------------------------------------------------------
+
+void setMessageFraming( SocketData *socket_data, int framing, int fixed_size ) {
+  socket_error = 0;
+  if ( framing < FRAMING_LINE || framing > FRAMING_HTTP ||
+     ( framing == FRAMING_FIXED && ( fixed_size < 1 || fixed_size > MESSAGE_MAX ) ) ) {
+     socket_error = EINVAL;
+     return;
+  }
+  socket_data->framing = framing;
+  socket_data->fixed_size = fixed_size;
+}
+
+
+//  FIND HTTP FRAME
+//
+// Look for a complete HTTP request in a client's read buffer: a header
+// ending with a blank line followed by a Content-Length body.  Return the
+// request length, -1 if it is incomplete or -3 if it is too large or uses
+// a chunked body (not supported).
+// --------------------------------------------------------------------------
+
+static int find_http_frame( ClientBuffer *cb ) {
+  char *p;
+  char *end;
+  char *line;
+  int head_len = -1;
+  long body_len = 0;
+
+  // only search the data that hasn't been searched yet, backing up in case
+  // the blank line was split between reads
+
+  end = cb->rd + cb->rd_len;
+  for ( p = cb->rd + ( cb->rd_scan > 3 ? cb->rd_scan - 3 : 0 ); p < end; p++ ) {
+      p = memchr( p, '\n', end - p );
+      if ( p == NULL )
+         break;
+      if ( p + 1 < end && p[1] == '\n' ) {
+         head_len = p + 2 - cb->rd;
+         break;
+      }
+      if ( p + 2 < end && p[1] == '\r' && p[2] == '\n' ) {
+         head_len = p + 3 - cb->rd;
+         break;
+      }
+  }
+  if ( head_len < 0 ) {
+     cb->rd_scan = cb->rd_len;
+     if ( cb->rd_len > MESSAGE_MAX ) {
+        socket_error = EMSGSIZE;
+        return -3;
+     }
+     return -1;
+  }
+
+  // the body length is in the header
+
+  end = cb->rd + head_len;
+  for ( line = cb->rd; line < end; line = p + 1 ) {
+      p = memchr( line, '\n', end - line );
+      if ( end - line > 15 && strncasecmp( line, "content-length:", 15 ) == 0 ) {
+         body_len = strtol( line + 15, NULL, 10 );
+         if ( body_len < 0 || body_len > MESSAGE_MAX ) {
+            socket_error = EMSGSIZE;
+            return -3;
+         }
+      } else if ( end - line > 18 && strncasecmp( line, "transfer-encoding:", 18 ) == 0 ) {
+         socket_error = EPROTONOSUPPORT;
+         return -3;
+      }
+  }
+  if ( cb->rd_len < head_len + body_len ) {
+     // the blank line will be found again right away
+     cb->rd_scan = head_len;
+     return -1;
+  }
+  cb->msg_offset = 0;
+  cb->msg_len = head_len + body_len;
+  cb->frame_len = cb->msg_len;
+  return cb->msg_len;
+}
+
+
+//  FIND FRAME
+//
+// Look for a complete message in a client's read buffer.  Return the
+// message length, -1 if the message is incomplete or -3 if the message is
+// too large.
+// --------------------------------------------------------------------------
+
+static int find_frame( SocketData *socket_data, ClientBuffer *cb ) {
+  char *eol;
+  unsigned int len;
+
+  if ( cb->frame_len > 0 )
+     return cb->msg_len;
+  switch ( socket_data->framing ) {
+  case FRAMING_LENGTH:
+     if ( cb->rd_len < 4 )
+        return -1;
+     memcpy( &len, cb->rd, 4 );
+     len = ntohl( len );
+     if ( len > MESSAGE_MAX ) {
+        socket_error = EMSGSIZE;
+        return -3;
+     }
+     if ( cb->rd_len - 4 < (int) len )
+        return -1;
+     cb->msg_offset = 4;
+     cb->msg_len = len;
+     cb->frame_len = len + 4;
+     break;
+  case FRAMING_FIXED:
+     if ( cb->rd_len < socket_data->fixed_size )
+        return -1;
+     cb->msg_offset = 0;
+     cb->msg_len = socket_data->fixed_size;
+     cb->frame_len = socket_data->fixed_size;
+     break;
+  case FRAMING_HTTP:
+     return find_http_frame( cb );
+  default:
+     // only search the data that hasn't been searched yet
+     eol = memchr( cb->rd + cb->rd_scan, '\n', cb->rd_len - cb->rd_scan );
+     if ( eol == NULL ) {
+        cb->rd_scan = cb->rd_len;
+        if ( cb->rd_len > MESSAGE_MAX ) {
+           socket_error = EMSGSIZE;
+           return -3;
+        }
+        return -1;
+     }
+     cb->msg_offset = 0;
+     cb->msg_len = eol - cb->rd;
+     cb->frame_len = cb->msg_len + 1;
+     if ( cb->msg_len > 0 && cb->rd[ cb->msg_len-1 ] == '\r' )
+        cb->msg_len--;
+  }
+  return cb->msg_len;
+}
+
+
+//  GET FRAMED MESSAGE
+//
+// Read whatever the client has sent without blocking and check for a
+// complete message.  Return the message length (use take_framed_message
+// to get it), -1 if the message is not complete yet, -2 if the client
+// closed the connection or -3 on an error.
+// --------------------------------------------------------------------------
+
+int get_framed_message( SocketData *socket_data, int socket_client ) {
+  ClientBuffer *cb;
+  char *new_rd;
+  int new_size;
+  int bytes_read;
+  int res;
+
+  socket_error = 0;
+  cb = get_client_buffer( socket_data, socket_client, 1 );
+  if ( cb == NULL )
+     return -3;
+
+  res = find_frame( socket_data, cb );
+  while ( res == -1 && !cb->closed ) {
+     // make room for more data
+     if ( cb->rd_size - cb->rd_len < CLIENT_BUFFER_MIN ) {
+        new_size = cb->rd_size > 0 ? cb->rd_size * 2 : CLIENT_BUFFER_MIN * 2;
+        new_rd = realloc( cb->rd, new_size );
+        if ( new_rd == NULL ) {
+           socket_error = 256;
+           return -3;
+        }
+        cb->rd = new_rd;
+        cb->rd_size = new_size;
+     }
+     bytes_read = recv( socket_client, cb->rd + cb->rd_len, cb->rd_size - cb->rd_len, MSG_DONTWAIT );
+     if ( bytes_read < 0 ) {
+        if ( errno == EINTR )
+           continue;
+        if ( errno == EAGAIN || errno == EWOULDBLOCK )
+           break;
+        socket_error = errno;
+        return -3;
+     } else if ( bytes_read == 0 ) {
+        cb->closed = 1;
+     } else {
+        cb->rd_len += bytes_read;
+        cb->last_active = time( NULL );
+        res = find_frame( socket_data, cb );
+     }
+  }
+  if ( res == -1 && cb->closed )
+     res = -2;
+  return res;
+}
+
+
+//  TAKE FRAMED MESSAGE
+//
+// Copy the message found by get_framed_message into message and remove it
+// from the client's read buffer.
+// --------------------------------------------------------------------------
+
+void take_framed_message( SocketData *socket_data, int socket_client, char *message ) {
+  ClientBuffer *cb;
+
+  socket_error = 0;
+  cb = get_client_buffer( socket_data, socket_client, 0 );
+  if ( cb == NULL || cb->frame_len == 0 ) {
+     socket_error = EINVAL;
+     return;
+  }
+  memcpy( message, cb->rd + cb->msg_offset, cb->msg_len );
+  cb->rd_len -= cb->frame_len;
+  memmove( cb->rd, cb->rd + cb->frame_len, cb->rd_len );
+  cb->rd_scan = 0;
+  cb->frame_len = 0;
+}
+
+
+//  RESERVE CLIENT OUTPUT
+//
+// Move unsent output to the front of a client's write buffer and make room
+// for len more bytes.  Return 0 on success or -1 on an error.
+// --------------------------------------------------------------------------
+
+static int reserve_client_output( ClientBuffer *cb, int len ) {
+  char *new_wr;
+  int new_size;
+  int needed;
+
+  if ( cb->wr_pos > 0 ) {
+     cb->wr_len -= cb->wr_pos;
+     memmove( cb->wr, cb->wr + cb->wr_pos, cb->wr_len );
+     if ( cb->file_pending )
+        cb->file_mark -= cb->wr_pos;
+     cb->wr_pos = 0;
+  }
+  needed = cb->wr_len + len;
+  if ( needed > cb->wr_size ) {
+     new_size = cb->wr_size > 0 ? cb->wr_size : CLIENT_BUFFER_MIN;
+     while ( new_size < needed )
+        new_size *= 2;
+     new_wr = realloc( cb->wr, new_size );
+     if ( new_wr == NULL ) {
+        socket_error = 256;
+        return -1;
+     }
+     cb->wr = new_wr;
+     cb->wr_size = new_size;
+  }
+  return 0;
+}
+
+
+//  PUT FRAMED MESSAGE
+//
+// Queue a message for the client, adding the framing, and send as much as
+// possible without blocking.  The rest is sent by manageConnections when
+// the client can take it.  HTTP messages are sent as-is.  Return the number
+// of bytes still waiting or -1 on an error.
+// --------------------------------------------------------------------------
+
+int put_framed_message( SocketData *socket_data, int socket_client, char *message, int len ) {
+  ClientBuffer *cb;
+  unsigned int prefix;
+  int res;
+
+  socket_error = 0;
+  if ( len < 0 || len > MESSAGE_MAX ||
+       ( socket_data->framing == FRAMING_FIXED && len != socket_data->fixed_size ) ) {
+     socket_error = EINVAL;
+     return -1;
+  }
+  cb = get_client_buffer( socket_data, socket_client, 1 );
+  if ( cb == NULL )
+     return -1;
+  if ( reserve_client_output( cb, len + 4 ) < 0 )
+     return -1;
+
+  if ( socket_data->framing == FRAMING_LENGTH ) {
+     prefix = htonl( len );
+     memcpy( cb->wr + cb->wr_len, &prefix, 4 );
+     cb->wr_len += 4;
+  }
+  memcpy( cb->wr + cb->wr_len, message, len );
+  cb->wr_len += len;
+  if ( socket_data->framing == FRAMING_LINE )
+     cb->wr[ cb->wr_len++ ] = '\n';
+
+  res = flush_client_output( socket_data, socket_client, 0 );
+  if ( res > 0 )
+     watch_client_output( socket_data, socket_client, 1 );
+  return res;
+}
+
+
+//  PUT FILE MESSAGE
+//
+// Queue the first len bytes of a file for the client, after any queued
+// messages, with no framing.  The file is sent with sendfile() where
+// available so it is never copied into the write buffer.  If another file
+// is still waiting to be sent, this one is read into the write buffer
+// instead.  Return the number of bytes still waiting (at most INT_MAX) or
+// -1 on an error.
+// --------------------------------------------------------------------------
+
+int put_file_message( SocketData *socket_data, int socket_client, char *path, long len ) {
+  ClientBuffer *cb;
+  struct stat st;
+  int file_fd;
+  int bytes_read;
+  int res;
+
+  socket_error = 0;
+  cb = get_client_buffer( socket_data, socket_client, 1 );
+  if ( cb == NULL )
+     return -1;
+  file_fd = open( path, O_RDONLY | O_CLOEXEC );
+  if ( file_fd < 0 ) {
+     socket_error = errno;
+     return -1;
+  }
+  if ( fstat( file_fd, &st ) < 0 ) {
+     socket_error = errno;
+     close( file_fd );
+     return -1;
+  }
+  if ( !S_ISREG( st.st_mode ) || len < 0 || len > st.st_size ) {
+     socket_error = S_ISDIR( st.st_mode ) ? EISDIR : EINVAL;
+     close( file_fd );
+     return -1;
+  }
+  if ( len == 0 ) {
+     close( file_fd );
+     return flush_client_output( socket_data, socket_client, 0 );
+  }
+  if ( cb->file_pending ) {
+     if ( len > MESSAGE_MAX ) {
+        socket_error = EFBIG;
+        close( file_fd );
+        return -1;
+     }
+     if ( reserve_client_output( cb, len ) < 0 ) {
+        close( file_fd );
+        return -1;
+     }
+     while ( len > 0 ) {
+        bytes_read = read( file_fd, cb->wr + cb->wr_len, len );
+        if ( bytes_read < 0 && errno == EINTR )
+           continue;
+        if ( bytes_read <= 0 ) {
+           socket_error = bytes_read < 0 ? errno : EIO;
+           close( file_fd );
+           return -1;
+        }
+        cb->wr_len += bytes_read;
+        len -= bytes_read;
+     }
+     close( file_fd );
+  } else {
+     cb->file_fd = file_fd;
+     cb->file_pos = 0;
+     cb->file_end = len;
+     cb->file_mark = cb->wr_len;
+     cb->file_pending = 1;
+  }
+  res = flush_client_output( socket_data, socket_client, 0 );
+  if ( res > 0 )
+     watch_client_output( socket_data, socket_client, 1 );
+  return res;
+}
+
+
+//  GET FILE VALIDATORS
+//
+// Look up the size of a file and the HTTP validators for it: an entity
+// tag made from the modification time and size (as nginx does) and the
+// Last-Modified date.  etag must hold 48 characters and modified 32.
+// Return 0 on success or -1 if it is not a regular file.
+// --------------------------------------------------------------------------
+
+int get_file_validators( char *path, char *etag, char *modified, long *size ) {
+  struct stat st;
+  struct tm tm;
+
+  socket_error = 0;
+  if ( stat( path, &st ) < 0 ) {
+     socket_error = errno;
+     return -1;
+  }
+  if ( !S_ISREG( st.st_mode ) ) {
+     socket_error = S_ISDIR( st.st_mode ) ? EISDIR : EINVAL;
+     return -1;
+  }
+  *size = st.st_size;
+  snprintf( etag, 48, "\"%llx-%llx\"", (unsigned long long) st.st_mtime,
+     (unsigned long long) st.st_size );
+  gmtime_r( &st.st_mtime, &tm );
+  strftime( modified, 32, "%a, %d %b %Y %H:%M:%S GMT", &tm );
+  return 0;
+}
+
+
+//  CLOSE IDLE CLIENTS
+//
+// Close clients using messages that have not sent anything or taken any
+// output for idle_secs seconds, unless output is still waiting.  Clients
+// already closed whose output has not moved for idle_secs are dropped.
+// Return the number of clients closed.
+// --------------------------------------------------------------------------
+
+int close_idle_clients( SocketData *socket_data, int idle_secs ) {
+  ClientBuffer *cb;
+  time_t now;
+  int count = 0;
+  int c;
+
+  socket_error = 0;
+  now = time( NULL );
+  for ( c = 0 ; c < socket_data->buffers_size ; ++c ) {
+      cb = socket_data->buffers[c];
+      if ( cb == NULL || now - cb->last_active < idle_secs )
+         continue;
+      if ( cb->close_pending ) {
+         // already closed but the client stopped taking its output
+         release_client( socket_data, c );
+      } else if ( cb->wr_pos == cb->wr_len && !cb->file_pending ) {
+         closeClient( socket_data, c );
+      } else {
+         continue;
+      }
+      count++;
+  }
+  return count;
+}
+
+
+//  HAS PENDING OUTPUT
+//
+// True if there is queued output that has not been sent to the client.
+// --------------------------------------------------------------------------
+
+int has_pending_output( SocketData *socket_data, int socket_client ) {
+  ClientBuffer *cb;
+
+  cb = get_client_buffer( socket_data, socket_client, 0 );
+  return cb != NULL && ( cb->wr_pos < cb->wr_len || cb->file_pending );
+}
+
+
+// WORKER PROCESSES
+//
+// The server can be split into pre-forked worker processes, each running
+// the same server loop.  With SO_REUSEPORT, each worker has its own
+// listener on the same port and the kernel divides new clients between
+// them.  Otherwise, the workers share the original listener.  The parent
+// process only restarts workers that exit.
+
+static volatile sig_atomic_t stopping_workers = 0;
+static struct sigaction old_sigterm;
+static struct sigaction old_sigint;
+
+static void stop_workers_handler( int sig ) {
+  (void) sig;
+  stopping_workers = 1;
+}
+
+
+// READY WORKER
+//
+// Prepare a newly forked worker.  The worker needs its own listener (if
+// SO_REUSEPORT is used and it is not keeping the parent's) and its own epoll
+// instance.  Return 0 on success or -1 on an error.
+
+static int ready_worker( SocketData *socket_data, int worker, int keep_listener ) {
+  struct sigaction sa;
+
+  memset( &sa, 0, sizeof( sa ) );
+  sa.sa_handler = SIG_DFL;
+  sigaction( SIGTERM, &sa, NULL );
+  sigaction( SIGINT, &old_sigint, NULL );
+#ifdef __linux__
+  // stop if the parent stops
+  prctl( PR_SET_PDEATHSIG, SIGTERM );
+#endif
+  socket_data->worker = worker;
+  socket_data->stats[ worker ].open = 0;
+
+  if ( socket_data->reuse_port && !keep_listener ) {
+     if ( socket_data->socket_listener >= 0 )
+        close( socket_data->socket_listener );
+     if ( open_listener( socket_data ) < 0 )
+        return -1;
+  }
+  ready_socket_data( socket_data );
+#ifdef HAVE_EPOLL
+  if ( socket_data->backend == BACKEND_EPOLL ) {
+     close( socket_data->epoll_fd );
+     free( socket_data->events );
+     free( socket_data->clients );
+     if ( ready_epoll_data( socket_data ) < 0 )
+        return -1;
+  }
+#endif
+  return 0;
+}
+
+
+//  START WORKERS
+//
+// Fork the worker processes.  In a worker, return the worker number
+// (1 to workers).  In the parent, supervise the workers, restarting any
+// that exit, until the parent receives SIGTERM or SIGINT.  Then stop the
+// workers and return 0.  Return -1 on an error.
+// --------------------------------------------------------------------------
+
+int start_workers( SocketData *socket_data, int workers ) {
+  struct sigaction sa;
+  pid_t pid;
+  int status;
+  int w;
+
+  socket_error = 0;
+  if ( socket_data == NULL || workers < 1 || workers > WORKERS_MAX ) {
+     socket_error = EINVAL;
+     return -1;
+  }
+  socket_data->stats = mmap( NULL, ( WORKERS_MAX + 1 ) * sizeof( WorkerStats ),
+     PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+  if ( socket_data->stats == MAP_FAILED ) {
+     socket_error = errno;
+     socket_data->stats = NULL;
+     return -1;
+  }
+  memset( socket_data->stats, 0, ( WORKERS_MAX + 1 ) * sizeof( WorkerStats ) );
+  socket_data->num_workers = workers;
+
+  // No SA_RESTART: waitpid must be interrupted by the signal
+
+  stopping_workers = 0;
+  memset( &sa, 0, sizeof( sa ) );
+  sa.sa_handler = stop_workers_handler;
+  sigemptyset( &sa.sa_mask );
+  sigaction( SIGTERM, &sa, &old_sigterm );
+  sigaction( SIGINT, &sa, &old_sigint );
+
+  for ( w = 1; w <= workers; w++ ) {
+      socket_data->stats[w].started = time( NULL );
+      pid = fork();
+      if ( pid == 0 ) {
+         // the first worker takes over the parent's listener
+         if ( ready_worker( socket_data, w, w == 1 ) < 0 )
+            _exit( 1 );
+         return w;
+      } else if ( pid < 0 ) {
+         socket_error = errno;
+         stopping_workers = 1;
+         break;
+      }
+      socket_data->stats[w].pid = pid;
+  }
+
+  // With SO_REUSEPORT, the parent must not hold a listener or some clients
+  // would be sent to it.  Restarted workers open their own.
+
+  if ( socket_data->reuse_port ) {
+     close( socket_data->socket_listener );
+     socket_data->socket_listener = -1;
+  }
+
+  while ( !stopping_workers ) {
+     pid = waitpid( -1, &status, 0 );
+     if ( pid < 0 ) {
+        if ( errno == EINTR )
+           continue;
+        socket_error = errno;
+        break;
+     }
+     for ( w = 1; w <= workers; w++ ) {
+         if ( socket_data->stats[w].pid == pid )
+            break;
+     }
+     if ( w > workers )
+        continue;
+     socket_data->stats[w].pid = 0;
+     socket_data->stats[w].open = 0;
+     if ( stopping_workers )
+        break;
+     printf( "Worker %d (pid %d) stopped - restarting\n", w, (int) pid );
+     // don't restart a worker that fails at once in a tight loop
+     if ( time( NULL ) - socket_data->stats[w].started < 1 )
+        sleep( 1 );
+     socket_data->stats[w].restarts++;
+     socket_data->stats[w].started = time( NULL );
+     pid = fork();
+     if ( pid == 0 ) {
+        if ( ready_worker( socket_data, w, 0 ) < 0 )
+           _exit( 1 );
+        return w;
+     } else if ( pid < 0 ) {
+        socket_error = errno;
+        printf( "Worker %d restart failed - %d\n", w, errno );
+     } else {
+        socket_data->stats[w].pid = pid;
+     }
+  }
+
+  // Stop the workers
+
+  for ( w = 1; w <= workers; w++ ) {
+      if ( socket_data->stats[w].pid > 0 )
+         kill( socket_data->stats[w].pid, SIGTERM );
+  }
+  for ( w = 1; w <= workers; w++ ) {
+      if ( socket_data->stats[w].pid > 0 ) {
+         while ( waitpid( socket_data->stats[w].pid, &status, 0 ) < 0 && errno == EINTR );
+         socket_data->stats[w].pid = 0;
+         socket_data->stats[w].open = 0;
+      }
+  }
+  sigaction( SIGTERM, &old_sigterm, NULL );
+  sigaction( SIGINT, &old_sigint, NULL );
+  return socket_error ? -1 : 0;
+}
+
+
+//  GET WORKER NUMBER
+//
+// Return the worker number of this process or 0 if this is not a worker.
+// --------------------------------------------------------------------------
+
+int get_worker_number( SocketData *socket_data ) {
+  return socket_data->worker;
+}
+
+
+//  COUNT WORKER CLIENTS
+//
+// Return the number of clients open in a worker process, or in all worker
+// processes if worker is 0.  Without workers, this is count_clients.
+// --------------------------------------------------------------------------
+
+int count_worker_clients( SocketData *socket_data, int worker ) {
+  int w;
+  int cnt = 0;
+
+  if ( socket_data->stats == NULL )
+     return count_clients( socket_data );
+  if ( worker > 0 ) {
+     if ( worker > socket_data->num_workers )
+        return 0;
+     return socket_data->stats[ worker ].open;
+  }
+  for ( w = 1; w <= socket_data->num_workers; w++ )
+      cnt += socket_data->stats[w].open;
+  return cnt;
+}
+
+
+//  COUNT WORKER ACCEPTS
+//
+// Return the number of clients accepted by a worker process, or by all
+// worker processes if worker is 0.
+// --------------------------------------------------------------------------
+
+int count_worker_accepts( SocketData *socket_data, int worker ) {
+  int w;
+  int cnt = 0;
+
+  if ( socket_data->stats == NULL )
+     return 0;
+  if ( worker > 0 ) {
+     if ( worker > socket_data->num_workers )
+        return 0;
+     return socket_data->stats[ worker ].accepted;
+  }
+  for ( w = 1; w <= socket_data->num_workers; w++ )
+      cnt += socket_data->stats[w].accepted;
+  return cnt;
+}
@@ -0,0 +1,172 @@
+-- Local load generator for tinyserve.  A client task opens many connections
+-- to a tinyserve echo server running in the main program, sends a message on
+-- every connection and waits for all of the replies, for a number of rounds.
+-- The server reports how long it took.
+--
+-- Usage: loadtester [select|epoll] [connections] [rounds]
+--
+-- The clients and the server share one process, so the open file limit must
+-- be more than twice the number of connections (e.g. ulimit -n 210000 for
+-- 100000 connections).  The select backend stops at FD_SETSIZE.
+-----------------------------------------------------------------------------
+
+with ada.text_io,
+     ada.command_line,
+     ada.calendar,
+     ada.strings.unbounded,
+     pegasock.tinyserve;
+use  ada.text_io,
+     ada.command_line,
+     ada.calendar,
+     ada.strings.unbounded,
+     pegasock,
+     pegasock.tinyserve;
+
+procedure loadtester is
+  port        : constant integer := 11217;
+  backend     : aSocketBackend := epoll_backend;
+  connections : positive := 1000;
+  rounds      : positive := 10;
+
+  -- Messages are a fixed size so they can be read in one syscall
+
+  messageSize : constant positive := 5;
+  ping        : constant string := "ping" & ASCII.LF;
+  bye         : constant string := "bye!" & ASCII.LF;
+
+  type aSocketList is array( aClientID range <> ) of aBufferedSocket;
+  type aSocketListPtr is access aSocketList;
+
+  protected loadStatus is
+    procedure setFailed;
+    function isFailed return boolean;
+  private
+    failed : boolean := false;
+  end loadStatus;
+
+  protected body loadStatus is
+    procedure setFailed is
+    begin
+      failed := true;
+    end setFailed;
+    function isFailed return boolean is
+    begin
+      return failed;
+    end isFailed;
+  end loadStatus;
+
+  task type aLoadGenerator is
+    entry start;
+  end aLoadGenerator;
+
+  -- LOAD GENERATOR
+  --
+  -- Connect all clients then send a message on each connection and read
+  -- back every reply before starting the next round.
+
+  task body aLoadGenerator is
+    clients : aSocketListPtr;
+    reply   : unbounded_string;
+  begin
+    accept start;
+    clients := new aSocketList( 1..aClientID( connections ) );
+    for i in clients'range loop
+        establish( clients(i), to_unbounded_string( "localhost" ), port );
+    end loop;
+    for r in 1..rounds loop
+        for i in clients'range loop
+            if r = rounds then
+               put( clients(i), bye );
+            else
+               put( clients(i), ping );
+            end if;
+        end loop;
+        for i in clients'range loop
+            get( clients(i), messageSize, reply );
+        end loop;
+    end loop;
+    for i in clients'range loop
+        close( clients(i) );
+    end loop;
+  exception when others =>
+    put_line( standard_error, "load generator failed after connecting" );
+    loadStatus.setFailed;
+  end aLoadGenerator;
+
+  server    : aSocketServer;
+  sockets   : aSocketListPtr;
+  id        : aClientID;
+  message   : unbounded_string;
+  closed    : natural := 0;
+  requests  : natural := 0;
+  startTime : time;
+  elapsed   : duration;
+begin
+  if argument_count >= 1 then
+     if argument( 1 ) = "select" then
+        backend := select_backend;
+     elsif argument( 1 ) = "epoll" then
+        backend := epoll_backend;
+     else
+        put_line( standard_error, "usage: loadtester [select|epoll] [connections] [rounds]" );
+        return;
+     end if;
+  end if;
+  if argument_count >= 2 then
+     connections := positive'value( argument( 2 ) );
+  end if;
+  if argument_count >= 3 then
+     rounds := positive'value( argument( 3 ) );
+  end if;
+
+  put_line( "Backend:     " & backend'img );
+  put_line( "Connections:" & connections'img );
+  put_line( "Rounds:     " & rounds'img );
+
+  -- Client IDs are file descriptors.  Both ends of every connection are in
+  -- this process.
+
+  sockets := new aSocketList( 0..aClientID( connections * 2 + 64 ) );
+
+  startupTinyServe( server, "localhost", port, 0, 0, 4096, 0, 1, 0, backend );
+
+  declare
+    generator : aLoadGenerator;
+  begin
+    startTime := clock;
+    generator.start;
+    while closed < connections and not loadStatus.isFailed loop
+      manageConnections( server, id );
+      while id > 0 loop
+        if not isOpen( sockets( id ) ) then
+           -- a new client: read its message when it arrives
+           establish( sockets( id ), id );
+        else
+           get( sockets( id ), messageSize, message );
+           put( sockets( id ), to_string( message ) );
+           requests := requests + 1;
+           if to_string( message ) = bye then
+              close( server, sockets( id ) );
+              closed := closed + 1;
+           end if;
+        end if;
+        getNextClient( server, id );
+      end loop;
+    end loop;
+    elapsed := clock - startTime;
+  exception when others =>
+    -- e.g. the select backend is at capacity
+    put_line( standard_error, "server failed after" & requests'img & " requests" );
+    abort generator;
+    shutdownTinyServe( server );
+    return;
+  end;
+
+  shutdownTinyServe( server );
+
+  put_line( "Requests:   " & requests'img );
+  put_line( "Seconds:    " & elapsed'img );
+  if elapsed > 0.0 then
+     put_line( "Requests/s: " & integer'image( integer( float( requests ) / float( elapsed ) ) ) );
+  end if;
+end loadtester;
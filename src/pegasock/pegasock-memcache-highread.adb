@@ -41,56 +41,147 @@ begin
   SetClusterType( mc.betaCluster, mct );
 end SetClusterType;
 
+-- REPLICATE
+--
+-- Send a storage command or delete to both clusters before reading any
+-- replies, so the writes to all four servers overlap.
+
+procedure replicate( mc : in out aMemcacheDualCluster; op : string; name, value : unbounded_string ) is
+  alphaRequest : aPendingRequest;
+  betaRequest  : aPendingRequest;
+begin
+  sendRequest( mc.alphaCluster, op, name, value, alphaRequest );
+  sendRequest( mc.betaCluster, op, name, value, betaRequest );
+  finishRequest( alphaRequest, op, name );
+  finishRequest( betaRequest, op, name );
+end replicate;
+
 procedure Set( mc : in out aMemcacheDualCluster; name, value : unbounded_string ) is
 begin
-  Set( mc.alphaCluster, name, value );
-  Set( mc.betaCluster, name, value );
+  replicate( mc, "set", name, value );
 end Set;
 
 procedure Add( mc : in out aMemcacheDualCluster; name, value : unbounded_string ) is
 begin
-  Add( mc.alphaCluster, name, value );
-  Add( mc.betaCluster, name, value );
+  replicate( mc, "add", name, value );
 end Add;
 
 procedure Replace( mc : in out aMemcacheDualCluster; name, value : unbounded_string ) is
 begin
-  Replace( mc.alphaCluster, name, value );
-  Replace( mc.betaCluster, name, value );
+  replicate( mc, "replace", name, value );
 end Replace;
 
 procedure Append( mc : in out aMemcacheDualCluster; name, value : unbounded_string ) is
 begin
-  Append( mc.alphaCluster, name, value );
-  Append( mc.betaCluster, name, value );
+  replicate( mc, "append", name, value );
 end Append;
 
 procedure Prepend( mc : in out aMemcacheDualCluster; name, value : unbounded_string ) is
 begin
-  Prepend( mc.alphaCluster, name, value );
-  Prepend( mc.betaCluster, name, value );
+  replicate( mc, "prepend", name, value );
 end Prepend;
 
+-- Get asks a server in each cluster at once and uses the first value
+-- returned.  If neither has it, the other servers for the key are asked.
+
 procedure Get( mc : in out aMemcacheDualCluster; name : unbounded_string; value : out unbounded_string ) is
+  alphaPrimary   : aServerNumber;
+  alphaSecondary : aServerNumber;
+  betaPrimary    : aServerNumber;
+  betaSecondary  : aServerNumber;
+  temp           : aServerNumber;
+  result         : unbounded_string;
+  alphaPtr       : aMemcacheDescriptorPtr;
+  betaPtr        : aMemcacheDescriptorPtr;
+  pragma suppress( access_check ); -- disable when debugging!
+
+  procedure getFromBoth( alphaServer, betaServer : aMemcacheDescriptorPtr ) is
+  begin
+    if not mc.flipCluster then
+       getFirstValue( alphaServer, betaServer, name, value, result );
+    else
+       getFirstValue( betaServer, alphaServer, name, value, result );
+    end if;
+  end getFromBoth;
+
 begin
+  getServers( mc.alphaCluster, name, alphaPrimary, alphaSecondary );
+  getServers( mc.betaCluster, name, betaPrimary, betaSecondary );
   mc.flipCluster := not mc.flipCluster;
-  if not mc.flipCluster then
-     Get( mc.alphaCluster, name, value );
-     if length( value ) = 0 then
-        Get( mc.betaCluster, name, value );
+  flipPrimary := not flipPrimary;
+  if flipPrimary then
+     temp := alphaPrimary;
+     alphaPrimary := alphaSecondary;
+     alphaSecondary := temp;
+     temp := betaPrimary;
+     betaPrimary := betaSecondary;
+     betaSecondary := temp;
+  end if;
+  getFromBoth( mc.alphaCluster.server( alphaPrimary )'unchecked_access,
+               mc.betaCluster.server( betaPrimary )'unchecked_access );
+  if length( value ) = 0 then
+     -- servers not asked yet
+     if alphaSecondary /= alphaPrimary then
+        alphaPtr := mc.alphaCluster.server( alphaSecondary )'unchecked_access;
      end if;
-  else
-     Get( mc.betaCluster, name, value );
-     if length( value ) = 0 then
-        Get( mc.alphaCluster, name, value );
+     if betaSecondary /= betaPrimary then
+        betaPtr := mc.betaCluster.server( betaSecondary )'unchecked_access;
+     end if;
+     if alphaPtr /= null or betaPtr /= null then
+        getFromBoth( alphaPtr, betaPtr );
      end if;
   end if;
 end Get;
 
+-- GetMulti reads all keys from one sub-cluster and then only the missing
+-- keys from the other.
+
+procedure GetMulti( mc : in out aMemcacheDualCluster; names : aMemcacheKeyList; values : out aMemcacheKeyList ) is
+  missingCount : natural := 0;
+
+  procedure getMissing( other : in out aMemcacheCluster ) is
+    missingNames  : aMemcacheKeyList( 1..missingCount );
+    missingValues : aMemcacheKeyList( 1..missingCount );
+    positions     : array( 1..missingCount ) of positive;
+    m             : natural := 0;
+  begin
+    for i in names'range loop
+        if length( values( i ) ) = 0 then
+           m := m + 1;
+           missingNames( m ) := names( i );
+           positions( m ) := i;
+        end if;
+    end loop;
+    GetMulti( other, missingNames, missingValues );
+    for j in missingValues'range loop
+        values( positions( j ) ) := missingValues( j );
+    end loop;
+  end getMissing;
+
+begin
+  mc.flipCluster := not mc.flipCluster;
+  if not mc.flipCluster then
+     GetMulti( mc.alphaCluster, names, values );
+  else
+     GetMulti( mc.betaCluster, names, values );
+  end if;
+  for i in values'range loop
+      if length( values( i ) ) = 0 then
+         missingCount := missingCount + 1;
+      end if;
+  end loop;
+  if missingCount > 0 then
+     if not mc.flipCluster then
+        getMissing( mc.betaCluster );
+     else
+        getMissing( mc.alphaCluster );
+     end if;
+  end if;
+end GetMulti;
+
 procedure Delete( mc : in out aMemcacheDualCluster; name : unbounded_string ) is
 begin
-  Delete( mc.alphaCluster, name );
-  Delete( mc.betaCluster, name );
+  replicate( mc, "delete", name, null_unbounded_string );
 end Delete;
 
 procedure Stats( mc : in out aMemcacheDualCluster; value : out unbounded_string ) is
@@ -0,0 +1,161 @@
+-- The Memcached binary protocol
+-----------------------------------------------------------------------------
+
+with Gnat.Source_Info,
+     Ada.Text_IO;
+use  Ada.Text_IO;
+
+package body pegasock.memcache.packets is
+
+requestMagic  : constant character := character'val( 16#80# );
+responseMagic : constant character := character'val( 16#81# );
+
+headerSize : constant positive := 24;
+
+outputLimit : constant positive := 65536;
+-- bytes of queued requests before they are written
+
+
+--  TO BYTES
+--
+-- A number as count bytes in network (big-endian) order.
+-----------------------------------------------------------------------------
+
+function toBytes( value : aMemcacheCAS; count : positive ) return string is
+  s : string( 1..count );
+  v : aMemcacheCAS := value;
+begin
+  for i in reverse s'range loop
+      s( i ) := character'val( natural( v mod 256 ) );
+      v := v / 256;
+  end loop;
+  return s;
+end toBytes;
+
+
+--  FROM BYTES
+--
+-- A number from bytes in network (big-endian) order.
+-----------------------------------------------------------------------------
+
+function fromBytes( s : string ) return aMemcacheCAS is
+  v : aMemcacheCAS := 0;
+begin
+  for i in s'range loop
+      v := v * 256 + aMemcacheCAS( character'pos( s( i ) ) );
+  end loop;
+  return v;
+end fromBytes;
+
+
+function storageExtras( expiry : natural ) return string is
+begin
+  return toBytes( 0, 4 ) & toBytes( aMemcacheCAS( expiry ), 4 );
+end storageExtras;
+
+function touchExtras( expiry : natural ) return string is
+begin
+  return toBytes( aMemcacheCAS( expiry ), 4 );
+end touchExtras;
+
+
+--  QUEUE REQUEST
+--
+-- Build the header: magic, opcode, key length, extras length, data type,
+-- vbucket, body length, opaque and CAS.
+-----------------------------------------------------------------------------
+
+procedure queueRequest( mcdp : aMemcacheDescriptorPtr;
+   opcode : anOpcode;
+   key    : unbounded_string := null_unbounded_string;
+   value  : unbounded_string := null_unbounded_string;
+   extras : string := "";
+   cas    : aMemcacheCAS := 0 ) is
+  bodyLength : constant natural := extras'length + length( key ) + length( value );
+begin
+  append( mcdp.output, requestMagic );
+  append( mcdp.output, character'val( natural( opcode ) ) );
+  append( mcdp.output, toBytes( aMemcacheCAS( length( key ) ), 2 ) );
+  append( mcdp.output, character'val( extras'length ) );
+  append( mcdp.output, toBytes( 0, 3 ) );            -- data type, vbucket
+  append( mcdp.output, toBytes( aMemcacheCAS( bodyLength ), 4 ) );
+  append( mcdp.output, toBytes( 0, 4 ) );            -- opaque
+  append( mcdp.output, toBytes( cas, 8 ) );
+  append( mcdp.output, extras );
+  append( mcdp.output, key );
+  append( mcdp.output, value );
+  if length( mcdp.output ) > outputLimit then
+     sendRequests( mcdp );
+  end if;
+end queueRequest;
+
+
+procedure sendRequests( mcdp : aMemcacheDescriptorPtr ) is
+begin
+  if length( mcdp.output ) > 0 then
+     -- cleared first so a failed write isn't sent again after a reconnect
+     declare
+       output : constant string := to_string( mcdp.output );
+     begin
+       mcdp.output := null_unbounded_string;
+       put( mcdp.fd, output );
+     end;
+  end if;
+end sendRequests;
+
+
+--  READ REPLY
+--
+-- Read the header, then the extras, key and value.  The only extras in a
+-- reply are the flags of a get, which are not used.
+-----------------------------------------------------------------------------
+
+procedure readReply( mcdp : aMemcacheDescriptorPtr; reply : out aReply ) is
+  header      : unbounded_string;
+  payload     : unbounded_string;
+  keyLength   : natural;
+  extraLength : natural;
+  bodyLength  : natural;
+begin
+  get( mcdp.fd, headerSize, header );
+  if length( header ) /= headerSize or else element( header, 1 ) /= responseMagic then
+     raise data_error with "not a memcache binary protocol reply";
+  end if;
+  reply.opcode := anOpcode( character'pos( element( header, 2 ) ) );
+  keyLength := natural( fromBytes( slice( header, 3, 4 ) ) );
+  extraLength := character'pos( element( header, 5 ) );
+  reply.status := aStatus( fromBytes( slice( header, 7, 8 ) ) );
+  bodyLength := natural( fromBytes( slice( header, 9, 12 ) ) );
+  reply.cas := fromBytes( slice( header, 17, 24 ) );
+  reply.key := null_unbounded_string;
+  reply.value := null_unbounded_string;
+  if bodyLength > 0 then
+     get( mcdp.fd, bodyLength, payload );
+     reply.key := unbounded_slice( payload, extraLength + 1, extraLength + keyLength );
+     reply.value := unbounded_slice( payload, extraLength + keyLength + 1, bodyLength );
+  end if;
+end readReply;
+
+
+procedure sendFence( mcdp : aMemcacheDescriptorPtr ) is
+begin
+  queueRequest( mcdp, opNoop );
+  sendRequests( mcdp );
+end sendFence;
+
+
+procedure readFence( mcdp : aMemcacheDescriptorPtr ) is
+  reply : aReply;
+begin
+  loop
+     readReply( mcdp, reply );
+  exit when reply.opcode = opNoop;
+     mcdp.quietFailures := mcdp.quietFailures + 1;
+     put_line( standard_error, Gnat.Source_Info.Source_Location &
+       ": quiet request failed on server " & to_string( mcdp.host ) &
+       mcdp.port'img & " with status" & reply.status'img );
+  end loop;
+  mcdp.quietRequests := 0;
+end readFence;
+
+end pegasock.memcache.packets;
@@ -6,15 +6,25 @@ pragma ada_2005;
 with Gnat.Source_Info,
      Ada.Text_IO,
      Ada.Characters.Handling,
-     Ada.Calendar;
+     Ada.Calendar,
+     Ada.Containers.Generic_Array_Sort,
+     Ada.Unchecked_Deallocation,
+     Pegasock.Memcache.Packets;
 use  Ada.Text_IO,
      Ada.Characters,
      Ada.Characters.Handling,
      Ada.Calendar;
+use type Pegasock.Memcache.Packets.anOpcode,
+     Pegasock.Memcache.Packets.aStatus;
 
 package body pegasock.memcache is
 
-type hash_integer is mod 2**32;
+procedure free is new Ada.Unchecked_Deallocation( aRingPoints, aRingPointsPtr );
+procedure free is new Ada.Unchecked_Deallocation( aKeyOwners, aKeyOwnersPtr );
+procedure free is new Ada.Unchecked_Deallocation( aClusterRingRecord, aClusterRingPtr );
+
+function C_pegasock_wait_readable( fd1, fd2, timeout_ms : integer ) return integer;
+pragma import( C, C_pegasock_wait_readable, "C_pegasock_wait_readable" );
 
 -- Basic Memache result messages
 
@@ -24,9 +34,10 @@ memcacheResult_END          : constant unbounded_string := to_unbounded_string(
 -- memcacheResult_CLIENT_ERROR : constant unbounded_string := to_unbounded_string( "CLIENT_ERROR" );
 -- memcacheResult_SERVER_ERROR : constant unbounded_string := to_unbounded_string( "SERVER_ERROR" );
 memcacheResult_STORED       : constant unbounded_string := to_unbounded_string( "STORED" );
---memcacheResult_NOT_STORED   : constant unbounded_string := to_unbounded_string( "NOT_STORED" );
---memcacheResult_EXISTS       : constant unbounded_string := to_unbounded_string( "EXISTS" );
---memcacheResult_NOT_FOUND    : constant unbounded_string := to_unbounded_string( "NOT_FOUND" );
+memcacheResult_NOT_STORED   : constant unbounded_string := to_unbounded_string( "NOT_STORED" );
+memcacheResult_EXISTS       : constant unbounded_string := to_unbounded_string( "EXISTS" );
+memcacheResult_NOT_FOUND    : constant unbounded_string := to_unbounded_string( "NOT_FOUND" );
+memcacheResult_TOUCHED      : constant unbounded_string := to_unbounded_string( "TOUCHED" );
 memcacheResult_VALUE        : constant unbounded_string := to_unbounded_string( "VALUE" );
 memcacheResult_DELETED      : constant unbounded_string := to_unbounded_string( "DELETED" );
 memcacheResult_STAT         : constant unbounded_string := to_unbounded_string( "STAT" );
@@ -61,6 +72,174 @@ begin
 end fnv_hash_of;
 
 
+--  RING HASH OF
+--
+-- FNV-1a hash of every character followed by the MurmurHash3 finalizer.
+-- Used for the consistent hash ring, where the points for one server
+-- differ only in the last characters and must still be spread out.
+-----------------------------------------------------------------------------
+
+function ring_hash_of( s : string ) return hash_integer is
+  hash : hash_integer := 16#811c9dc5#;
+begin
+  for i in s'range loop
+      hash := ( hash xor character'pos( s(i) ) ) * 16#01000193#;
+  end loop;
+  hash := hash xor ( hash / 2**16 );
+  hash := hash * 16#85ebca6b#;
+  hash := hash xor ( hash / 2**13 );
+  hash := hash * 16#c2b2ae35#;
+  hash := hash xor ( hash / 2**16 );
+  return hash;
+end ring_hash_of;
+
+function "<"( left, right : aRingPoint ) return boolean is
+begin
+  return left.hash < right.hash or else
+     ( left.hash = right.hash and left.server < right.server );
+end "<";
+
+procedure sortRing is new Ada.Containers.Generic_Array_Sort(
+  Index_Type => positive,
+  Element_Type => aRingPoint,
+  Array_Type => aRingPoints );
+
+
+--  ADJUST / FINALIZE (CLUSTER RING)
+--
+-- Count the copies of a cluster sharing the ring.  The last one frees it.
+-----------------------------------------------------------------------------
+
+procedure Adjust( ring : in out aClusterRing ) is
+begin
+  if ring.ptr /= null then
+     ring.ptr.refs := ring.ptr.refs + 1;
+  end if;
+end Adjust;
+
+procedure Finalize( ring : in out aClusterRing ) is
+begin
+  if ring.ptr /= null then
+     if ring.ptr.refs = 1 then
+        free( ring.ptr.points );
+        free( ring.ptr.owners );
+        free( ring.ptr );
+     else
+        ring.ptr.refs := ring.ptr.refs - 1;
+     end if;
+     ring.ptr := null;
+  end if;
+end Finalize;
+
+
+--  MAKE RING UNIQUE
+--
+-- Before changing the ring or the saved owners, give the cluster its own
+-- copy so other copies of the cluster are not changed.
+-----------------------------------------------------------------------------
+
+procedure makeRingUnique( mc : in out aMemcacheCluster ) is
+  old : constant aClusterRingPtr := mc.ring.ptr;
+begin
+  if old = null then
+     mc.ring.ptr := new aClusterRingRecord;
+  elsif old.refs > 1 then
+     old.refs := old.refs - 1;
+     mc.ring.ptr := new aClusterRingRecord;
+     if old.points /= null then
+        mc.ring.ptr.points := new aRingPoints'( old.points.all );
+     end if;
+     if old.owners /= null then
+        mc.ring.ptr.owners := new aKeyOwners'( old.owners.all );
+     end if;
+  end if;
+end makeRingUnique;
+
+
+--  BUILD RING
+--
+-- Rebuild the consistent hash ring after the servers change.  Each server
+-- gets pointsPerWeight points per unit of weight, hashed from the host,
+-- port and point number, so a server keeps the same points no matter
+-- which other servers are registered.
+-----------------------------------------------------------------------------
+
+procedure buildRing( mc : in out aMemcacheCluster ) is
+  total : natural := 0;
+  p     : natural := 0;
+begin
+  if mc.ring.ptr = null and ( mc.clusterType /= consistent or mc.serverCount = 0 ) then
+     return;
+  end if;
+  makeRingUnique( mc );
+  free( mc.ring.ptr.points );
+  if mc.clusterType /= consistent or mc.serverCount = 0 then
+     return;
+  end if;
+  for s in 1..mc.serverCount loop
+      total := total + mc.server( s ).weight * pointsPerWeight;
+  end loop;
+  mc.ring.ptr.points := new aRingPoints( 1..total );
+  declare
+    ring : aRingPoints renames mc.ring.ptr.points.all;
+  begin
+    for s in 1..mc.serverCount loop
+        for i in 1..mc.server( s ).weight * pointsPerWeight loop
+            p := p + 1;
+            ring( p ).hash := ring_hash_of( to_string( mc.server( s ).host ) &
+               ":" & mc.server( s ).port'img & "-" & i'img );
+            ring( p ).server := s;
+        end loop;
+    end loop;
+    sortRing( ring );
+  end;
+end buildRing;
+
+
+--  GET RING SERVERS
+--
+-- Find the first point on the ring at or after the key's hash (wrapping
+-- around).  Its server is the primary.  The secondary is the server of the
+-- next point belonging to a different server.
+-----------------------------------------------------------------------------
+
+procedure getRingServers( mc : aMemcacheCluster; name : unbounded_string; primaryServer, secondaryServer : out aServerNumber ) is
+  hash  : constant hash_integer := ring_hash_of( to_string( name ) );
+  ring  : aRingPoints renames mc.ring.ptr.points.all;
+  low   : positive := ring'first;
+  high  : positive := ring'last;
+  mid   : positive;
+  p     : positive;
+begin
+  if ring( high ).hash < hash then
+     p := ring'first;
+  else
+     while low < high loop
+        mid := low + ( high - low ) / 2;
+        if ring( mid ).hash < hash then
+           low := mid + 1;
+        else
+           high := mid;
+        end if;
+     end loop;
+     p := low;
+  end if;
+  primaryServer := ring( p ).server;
+  secondaryServer := primaryServer;
+  for i in 1..ring'length-1 loop
+      if p = ring'last then
+         p := ring'first;
+      else
+         p := p + 1;
+      end if;
+      if ring( p ).server /= primaryServer then
+         secondaryServer := ring( p ).server;
+         exit;
+      end if;
+  end loop;
+end getRingServers;
+
+
 --  BACKOFF SERVER
 --
 -- Increase the backoff level and start/resume backing off.
@@ -75,6 +254,11 @@ begin
      mcdp.backoffLevel := mcdp.backoffLevel + 1;
   end if;
   mcdp.backoffCount := backoffFactor**mcdp.backoffLevel;
+  mcdp.pendingReplies := 0;  -- discarded with the connection
+  mcdp.output := null_unbounded_string;
+  -- the quiet requests not fenced may not have been stored
+  mcdp.quietFailures := mcdp.quietFailures + mcdp.quietRequests;
+  mcdp.quietRequests := 0;
   -- error message could be pre
   put_line( standard_error, Gnat.Source_Info.Source_Location &
     ": server " & to_string( mcdp.host) & mcdp.port'img & " error - backing off for" &
@@ -124,6 +308,180 @@ begin
   handleBackoff( mc.server( s )'unchecked_access );
 end handleBackoff;
 
+
+--  WAIT FOR REPLY
+--
+-- Wait up to replyTimeout for a reply from either of two servers (second
+-- may be null).  Return 1 if the first is ready, 2 if the second is, 3 if
+-- both are, or 0 if neither replied in time.  A reply already in the read
+-- buffer is ready.
+-----------------------------------------------------------------------------
+
+function waitForReply( first, second : aMemcacheDescriptorPtr ) return natural is
+  fd1   : integer := -1;
+  fd2   : integer := -1;
+  ready : natural := 0;
+  res   : integer;
+begin
+  if first /= null then
+     if first.fd.readPos <= integer( first.fd.amountRead ) then
+        ready := 1;
+     end if;
+     fd1 := integer( first.fd.fd );
+  end if;
+  if second /= null then
+     if second.fd.readPos <= integer( second.fd.amountRead ) then
+        ready := ready + 2;
+     end if;
+     fd2 := integer( second.fd.fd );
+  end if;
+  if ready = 0 then
+     res := C_pegasock_wait_readable( fd1, fd2, replyTimeout );
+     if res > 0 then
+        ready := res;
+     end if;
+  end if;
+  return ready;
+end waitForReply;
+
+
+--  BINARY RESULT
+--
+-- The text protocol reply matching the status of a binary protocol reply,
+-- so replies from both protocols are checked the same way.
+-----------------------------------------------------------------------------
+
+function binaryResult( op : string; status : packets.aStatus ) return unbounded_string is
+begin
+  if status = packets.statusOK then
+     if op = "delete" then
+        return memcacheResult_DELETED;
+     elsif op = "touch" then
+        return memcacheResult_TOUCHED;
+     elsif op = "get" then
+        return memcacheResult_END;
+     end if;
+     return memcacheResult_STORED;
+  elsif status = packets.statusKeyNotFound then
+     if op = "get" then
+        return memcacheResult_END;
+     end if;
+     return memcacheResult_NOT_FOUND;
+  elsif status = packets.statusKeyExists then
+     return memcacheResult_EXISTS;
+  elsif status = packets.statusNotStored then
+     return memcacheResult_NOT_STORED;
+  end if;
+  return to_unbounded_string( "SERVER_ERROR status" & status'img );
+end binaryResult;
+
+
+--  READ GET REPLY
+--
+-- Read the reply to a get of one key.  value is empty if the key was not
+-- found.  result is the last line of the reply (END if successful).
+-----------------------------------------------------------------------------
+
+procedure readGetReply( mcdp : access aMemcacheDescriptor; value, result : out unbounded_string ) is
+  p          : natural;
+  sizeToRead : integer;
+  reply      : packets.aReply;
+begin
+  value := null_unbounded_string;
+  if mcdp.protocol = binary_protocol then
+     packets.readReply( mcdp.all'unchecked_access, reply );
+     value := reply.value;
+     result := binaryResult( "get", reply.status );
+     return;
+  end if;
+  get( mcdp.fd, result );
+  if head( result, length( memcacheResult_VALUE ) ) = memcacheResult_VALUE then
+     p := length( result )-1;
+     while element( result, p ) /= ' ' loop
+       p := p - 1;
+     end loop;
+     sizeToRead := integer'value( slice( result, p, length( result ) ) );
+     if sizeToRead > 0 then
+        get( mcdp.fd, sizeToRead, value );
+     end if;
+     get( mcdp.fd, 2, result );  -- read EOL
+     get( mcdp.fd, result );
+  end if;
+end readGetReply;
+
+
+--  FENCE SERVER
+--
+-- Send a noop after a server's quiet requests and read up to its reply,
+-- counting the quiet requests that failed.
+-----------------------------------------------------------------------------
+
+procedure fenceServer( mcdp : access aMemcacheDescriptor ) is
+  serverPtr : constant aMemcacheDescriptorPtr := mcdp.all'unchecked_access;
+begin
+  packets.sendFence( serverPtr );
+  if waitForReply( serverPtr, null ) = 0 then
+     put_line( standard_error, Gnat.Source_Info.Source_Location &
+       ": server " & to_string( mcdp.host) & mcdp.port'img & " timed out" );
+     backoffServer( mcdp );
+  else
+     packets.readFence( serverPtr );
+  end if;
+exception when others =>
+  backoffServer( mcdp );
+end fenceServer;
+
+
+--  DRAIN REPLIES
+--
+-- Read the get replies that arrived after another server had already
+-- answered.
+-----------------------------------------------------------------------------
+
+procedure drainReplies( mcdp : access aMemcacheDescriptor ) is
+  value  : unbounded_string;
+  result : unbounded_string;
+begin
+  while mcdp.backoffCount = 0 and mcdp.pendingReplies > 0 loop
+     begin
+       if waitForReply( mcdp.all'unchecked_access, null ) = 0 then
+          put_line( standard_error, Gnat.Source_Info.Source_Location &
+            ": server " & to_string( mcdp.host) & mcdp.port'img & " timed out" );
+          backoffServer( mcdp );
+       else
+          readGetReply( mcdp, value, result );
+          mcdp.pendingReplies := mcdp.pendingReplies - 1;
+       end if;
+     exception when others =>
+       backoffServer( mcdp );
+     end;
+  end loop;
+end drainReplies;
+
+
+--  PREPARE SERVER
+--
+-- Make a server ready for a new request: handle any backoff, then read
+-- the get replies that arrived after another server had already answered
+-- and the failures of any quiet requests.
+-----------------------------------------------------------------------------
+
+procedure prepareServer( mcdp : access aMemcacheDescriptor ) is
+begin
+  if mcdp.backoffCount > 0 then
+     handleBackoff( mcdp );
+  end if;
+  drainReplies( mcdp );
+  if mcdp.backoffCount = 0 and mcdp.quietRequests > 0 then
+     fenceServer( mcdp );
+  end if;
+end prepareServer;
+
+procedure prepareServer( mc : in out aMemcacheCluster; s : aServerNumber ) is
+begin
+  prepareServer( mc.server( s )'unchecked_access );
+end prepareServer;
+
 --  RECONCILE RESULTS
 --
 -- Given memcache result message from a primary and secondary server, compare
@@ -144,6 +502,10 @@ begin
      result := memcacheResult_DELETED;
   elsif secondaryResult = memcacheResult_DELETED then
      result := memcacheResult_DELETED;
+  elsif primaryResult = memcacheResult_TOUCHED then
+     result := memcacheResult_TOUCHED;
+  elsif secondaryResult = memcacheResult_TOUCHED then
+     result := memcacheResult_TOUCHED;
   elsif primaryResult = secondaryResult then
      result := primaryResult;
   else
@@ -169,6 +531,10 @@ begin
      secondaryServer := 0;
      return;
   end if;
+  if mc.ring.ptr /= null and then mc.ring.ptr.points /= null then
+     getRingServers( mc, name, primaryServer, secondaryServer );
+     return;
+  end if;
   primaryServer := aServerNumber(
     fnv_hash_of( to_string(name), hash_integer(mc.serverCount) ) );
   -- KISS: Keep it simple, stupid.
@@ -179,6 +545,296 @@ begin
 end getServers;
 
 
+--  GET KEY OWNERS
+--
+-- Find the primary server of each sample key.  Servers are identified by
+-- host and port since the server numbers change when servers are cleared
+-- and registered again.
+-----------------------------------------------------------------------------
+
+procedure getKeyOwners( mc : aMemcacheCluster; owners : out aKeyOwners ) is
+  primaryServer   : aServerNumber;
+  secondaryServer : aServerNumber;
+begin
+  for i in owners'range loop
+      if mc.serverCount = 0 then
+         owners( i ) := 0;
+      else
+         getServers( mc, to_unbounded_string( "key" & i'img ), primaryServer, secondaryServer );
+         owners( i ) := ring_hash_of( to_string( mc.server( primaryServer ).host ) &
+            ":" & mc.server( primaryServer ).port'img );
+      end if;
+  end loop;
+end getKeyOwners;
+
+
+--  SAVE KEY OWNERS
+--
+-- Called before the servers change.  Remember the owners of the sample
+-- keys, unless they were already saved since the last KeyMovement.
+-----------------------------------------------------------------------------
+
+procedure saveKeyOwners( mc : in out aMemcacheCluster ) is
+begin
+  if mc.serverCount > 0 and ( mc.ring.ptr = null or else mc.ring.ptr.owners = null ) then
+     makeRingUnique( mc );
+     mc.ring.ptr.owners := new aKeyOwners;
+     getKeyOwners( mc, mc.ring.ptr.owners.all );
+  end if;
+end saveKeyOwners;
+
+
+--  BINARY OPCODE
+--
+-- The binary protocol opcode and extras for a storage command, a delete
+-- or a touch.
+-----------------------------------------------------------------------------
+
+procedure binaryOpcode( op : string; expiry : natural; opcode : out packets.anOpcode; extras : out unbounded_string ) is
+begin
+  extras := null_unbounded_string;
+  if op = "set" then
+     opcode := packets.opSet;
+  elsif op = "add" then
+     opcode := packets.opAdd;
+  elsif op = "replace" then
+     opcode := packets.opReplace;
+  elsif op = "append" then
+     opcode := packets.opAppend;
+  elsif op = "prepend" then
+     opcode := packets.opPrepend;
+  elsif op = "delete" then
+     opcode := packets.opDelete;
+  elsif op = "touch" then
+     opcode := packets.opTouch;
+     extras := to_unbounded_string( packets.touchExtras( expiry ) );
+  else
+     raise program_error with "unknown memcache operation " & op;
+  end if;
+  if op = "set" or op = "add" or op = "replace" then
+     extras := to_unbounded_string( packets.storageExtras( expiry ) );
+  end if;
+end binaryOpcode;
+
+
+--  SEND TO SERVER
+--
+-- Send a storage command, a delete or a touch to one server without
+-- waiting for the reply.  sentPtr is the server, or null if it is backing
+-- off or fails.
+-----------------------------------------------------------------------------
+
+procedure sendToServer( serverPtr : aMemcacheDescriptorPtr; op : string; name, value : unbounded_string; expiry : natural; sentPtr : out aMemcacheDescriptorPtr ) is
+  memcache_cmd : unbounded_string;
+  opcode       : packets.anOpcode;
+  extras       : unbounded_string;
+begin
+  sentPtr := null;
+  prepareServer( serverPtr );
+  if serverPtr.backoffCount = 0 then
+     begin
+       if serverPtr.protocol = binary_protocol then
+          binaryOpcode( op, expiry, opcode, extras );
+          packets.queueRequest( serverPtr, opcode, name, value, to_string( extras ) );
+          packets.sendRequests( serverPtr );
+       else
+          if op = "delete" then
+             memcache_cmd := "delete " & name;
+          elsif op = "touch" then
+             memcache_cmd := "touch " & name & expiry'img;
+          else
+             memcache_cmd := op & " " & name & " 0" & expiry'img & integer'image( length( value ) );
+          end if;
+          pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
+            ": cmd = '" & to_string( memcache_cmd ) & "'" ) );
+          put_line( serverPtr.fd, memcache_cmd );
+          if op /= "delete" and op /= "touch" then
+             put_line( serverPtr.fd, value );
+          end if;
+       end if;
+       sentPtr := serverPtr;
+     exception when others =>
+       backoffServer( serverPtr );
+     end;
+  end if;
+end sendToServer;
+
+
+--  SEND REQUEST
+--
+-- Send a storage command, a delete or a touch to the primary and secondary
+-- servers of a key without waiting for the replies.  Servers that are
+-- backing off or that fail are not sent the request.
+-- constraint_error is raised if no servers are defined.
+-----------------------------------------------------------------------------
+
+procedure sendRequest( mc : in out aMemcacheCluster; op : string; name, value : unbounded_string; request : out aPendingRequest; expiry : natural := 0 ) is
+  primaryServer   : aServerNumber;
+  secondaryServer : aServerNumber;
+  pragma suppress( access_check ); -- disable when debugging!
+begin
+  getServers( mc, name, primaryServer, secondaryServer );
+
+  pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
+       ": " & op & " '" & to_string( name ) & "' on primary server" &
+       primaryServer'img & " and secondary" & secondaryServer'img ) );
+
+  -- this pointer is used to improve performance. not sure why unchecked
+  -- is necessary for a local pointer to a global identifier
+  sendToServer( mc.server( primaryServer )'unchecked_access, op, name, value, expiry, request.primaryPtr );
+  if primaryServer = secondaryServer then
+     request.secondaryPtr := null;
+  else
+     sendToServer( mc.server( secondaryServer )'unchecked_access, op, name, value, expiry, request.secondaryPtr );
+  end if;
+end sendRequest;
+
+
+--  FINISH REQUEST
+--
+-- Read the replies to a request from sendRequest.  A server that does not
+-- reply within replyTimeout is backed off.  Log a failure if neither
+-- server stored (or deleted) the value.
+-----------------------------------------------------------------------------
+
+procedure finishRequest( request : aPendingRequest; op : string; name : unbounded_string ) is
+  result          : unbounded_string;
+  primaryResult   : unbounded_string;
+  secondaryResult : unbounded_string;
+  expected        : unbounded_string := memcacheResult_STORED;
+  binaryReply     : packets.aReply;
+
+  procedure getReply( serverPtr : aMemcacheDescriptorPtr; reply : out unbounded_string ) is
+  begin
+    reply := null_unbounded_string;
+    if serverPtr /= null then
+       begin
+         if waitForReply( serverPtr, null ) = 0 then
+            put_line( standard_error, Gnat.Source_Info.Source_Location &
+              ": server " & to_string( serverPtr.host) & serverPtr.port'img & " timed out" );
+            backoffServer( serverPtr );
+         elsif serverPtr.protocol = binary_protocol then
+            packets.readReply( serverPtr, binaryReply );
+            reply := binaryResult( op, binaryReply.status );
+         else
+            get( serverPtr.fd, reply );
+         end if;
+       exception when others =>
+         backoffServer( serverPtr );
+       end;
+    end if;
+  end getReply;
+
+begin
+  if op = "delete" then
+     expected := memcacheResult_DELETED;
+  elsif op = "touch" then
+     expected := memcacheResult_TOUCHED;
+  end if;
+
+  -- Both servers were sent the request so the second reply is usually
+  -- waiting by the time the first has been read
+
+  getReply( request.primaryPtr, primaryResult );
+  getReply( request.secondaryPtr, secondaryResult );
+  reconcileResults( result, primaryResult, secondaryResult );
+
+  if head( result, length( expected ) ) /= expected then
+     put_line( standard_error, Gnat.Source_Info.Source_Location &
+       ": " & op & " failed on key '" & to_string( name ) & "' with result '" &
+       to_string( result ) & "'" );
+  else
+     null;
+     pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
+       ": " & op & " succeeded on key '" & to_string( name ) & "' with result '" &
+       to_string( result ) & "'" ) );
+  end if;
+end finishRequest;
+
+
+--  GET FIRST VALUE
+--
+-- Send a get to two servers (second may be null) at once and return the
+-- value from the first to reply with one.  If that is the first reply, the
+-- slower server's reply is left to be read before its next request, so a
+-- read doesn't wait for it.  value is empty if neither has the key.
+-- result is the last line of the reply used.
+-----------------------------------------------------------------------------
+
+procedure getFirstValue( first, second : aMemcacheDescriptorPtr; name : unbounded_string; value, result : out unbounded_string ) is
+  memcache_cmd : unbounded_string;
+  waiting      : array( 1..2 ) of aMemcacheDescriptorPtr := ( first, second );
+  ready        : natural;
+  chosen       : positive;
+  serverValue  : unbounded_string;
+  serverResult : unbounded_string;
+begin
+  value := null_unbounded_string;
+  result := null_unbounded_string;
+  memcache_cmd := "get " & name;
+  pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
+    ": cmd = '" & to_string( memcache_cmd ) & "'" ) );
+
+  for i in waiting'range loop
+      if waiting( i ) /= null then
+         prepareServer( waiting( i ) );
+         if waiting( i ).backoffCount = 0 then
+            begin
+              if waiting( i ).protocol = binary_protocol then
+                 packets.queueRequest( waiting( i ), packets.opGet, name );
+                 packets.sendRequests( waiting( i ) );
+              else
+                 put_line( waiting( i ).fd, memcache_cmd );
+              end if;
+            exception when others =>
+              backoffServer( waiting( i ) );
+              waiting( i ) := null;
+            end;
+         else
+            waiting( i ) := null;
+         end if;
+      end if;
+  end loop;
+
+  while waiting( 1 ) /= null or waiting( 2 ) /= null loop
+     ready := waitForReply( waiting( 1 ), waiting( 2 ) );
+     if ready = 0 then
+        for i in waiting'range loop
+            if waiting( i ) /= null then
+               put_line( standard_error, Gnat.Source_Info.Source_Location &
+                 ": server " & to_string( waiting( i ).host) & waiting( i ).port'img & " timed out" );
+               backoffServer( waiting( i ) );
+               waiting( i ) := null;
+            end if;
+        end loop;
+        exit;
+     end if;
+     if ready = 2 then
+        chosen := 2;
+     else
+        chosen := 1;
+     end if;
+     begin
+       readGetReply( waiting( chosen ), serverValue, serverResult );
+       result := serverResult;
+     exception when others =>
+       backoffServer( waiting( chosen ) );
+       serverValue := null_unbounded_string;
+     end;
+     waiting( chosen ) := null;
+     if length( serverValue ) > 0 then
+        value := serverValue;
+        for i in waiting'range loop
+            if waiting( i ) /= null then
+               waiting( i ).pendingReplies := waiting( i ).pendingReplies + 1;
+               waiting( i ) := null;
+            end if;
+        end loop;
+     end if;
+  end loop;
+end getFirstValue;
+
+
 --  GET RANDOM SERVERS
 --
 -- Returns two random serers from the memcache cluster.
@@ -232,7 +888,7 @@ end isValidMemcacheKey;
 -- there are too many servers.
 -----------------------------------------------------------------------------
 
-procedure RegisterServer( mc : in out aMemcacheCluster; host : unbounded_string; port : integer ) is
+procedure RegisterServer( mc : in out aMemcacheCluster; host : unbounded_string; port : integer; weight : aMemcacheServerWeight := 1 ) is
   duplicateServer : boolean := false;
 begin
   if mc.serverCount = aServerNumber'last then
@@ -247,29 +903,43 @@ begin
   if duplicateServer then
      raise NAME_ERROR with "Error: Server exists - " & to_string( host ) & port'img;
   end if;
+  saveKeyOwners( mc );
   mc.serverCount := mc.serverCount + 1;
   mc.server( mc.serverCount ).host := host;
   mc.server( mc.serverCount ).port := port;
   mc.server( mc.serverCount ).backoffCount := 1;
   mc.server( mc.serverCount ).backoffLevel := 0;
+  mc.server( mc.serverCount ).weight := weight;
+  mc.server( mc.serverCount ).protocol := mc.protocol;
+  mc.server( mc.serverCount ).output := null_unbounded_string;
+  mc.server( mc.serverCount ).pendingReplies := 0;
+  mc.server( mc.serverCount ).quietRequests := 0;
+  mc.server( mc.serverCount ).quietFailures := 0;
   -- setEOL( mc.server( mc.serverCount ).fd, CRLF );
   -- cannot be done here because fd will be overwritten in establish
+  buildRing( mc );
 end RegisterServer;
 
 
 --  CLEAR SERVERS
 --
 -- Close all open file descriptors and discard all registered servers.
+-- Quiet requests not yet fenced are written first.
 -----------------------------------------------------------------------------
 
 procedure ClearServers( mc : in out aMemcacheCluster ) is
 begin
+  saveKeyOwners( mc );
   for i in 1..mc.serverCount loop
+    if mc.server(i).backoffCount = 0 and mc.server(i).quietRequests > 0 then
+       fenceServer( mc.server(i)'unchecked_access );
+    end if;
     if is_open( mc.server(i).fd ) then
        close( mc.server(i).fd );
     end if;
   end loop;
   mc.serverCount := 0;
+  buildRing( mc );
 end ClearServers;
 
 
@@ -291,85 +961,86 @@ end SetClusterName;
 
 procedure SetClusterType( mc : in out aMemcacheCluster; mct : aMemcacheClusterType ) is
 begin
-  mc.clusterType := mct;
+  if mct /= mc.clusterType then
+     saveKeyOwners( mc );
+     mc.clusterType := mct;
+     buildRing( mc );
+  end if;
 end SetClusterType;
 
 
---  SET
+--  KEY MOVEMENT
 --
--- Store a value for the named key, ovewriting if necessary.
--- constraint_error is raised if no servers are defined.
+-- Return the fraction (0 to 1) of keys whose primary server changed since
+-- the servers or cluster type were first changed after the last call.  It
+-- is estimated from a sample of keys.  Zero if nothing changed.
 -----------------------------------------------------------------------------
 
-procedure Set( mc : in out aMemcacheCluster; name, value : unbounded_string ) is
-  memcache_cmd    : unbounded_string;
-  primaryServer   : aServerNumber;
-  secondaryServer : aServerNumber;
-  result          : unbounded_string;
-  primaryResult   : unbounded_string;
-  secondaryResult : unbounded_string;
-  primaryPtr      : aMemcacheDescriptorPtr;
-  secondaryPtr    : aMemcacheDescriptorPtr;
-  pragma suppress( access_check ); -- disable when debugging!
+procedure KeyMovement( mc : in out aMemcacheCluster; ratio : out float ) is
+  owners : aKeyOwners;
+  moved  : natural := 0;
 begin
+  ratio := 0.0;
+  if mc.ring.ptr /= null and then mc.ring.ptr.owners /= null then
+     getKeyOwners( mc, owners );
+     for i in owners'range loop
+         if owners( i ) /= mc.ring.ptr.owners( i ) then
+            moved := moved + 1;
+         end if;
+     end loop;
+     ratio := float( moved ) / float( keyMovementSamples );
+     makeRingUnique( mc );
+     free( mc.ring.ptr.owners );
+  end if;
+end KeyMovement;
 
-  getServers( mc, name, primaryServer, secondaryServer );
 
-  pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
-       ": set '" & to_string( name ) & "' on primary server" &
-       primaryServer'img & " and secondary" & secondaryServer'img ) );
-
-  memcache_cmd := "set " & name & " 0 0" & integer'image( length( value ) );
-  pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
-    ": cmd = '" & to_string( memcache_cmd ) & "'" ) );
-
-  -- this pointer is used to improve performance. not sure why unchecked
-  -- is necessary for a local pointer to a global identifier
-  primaryPtr := mc.server( primaryServer )'unchecked_access;
+--  SET PROTOCOL
+--
+-- Choose the text or binary protocol.  Memcached chooses the protocol of a
+-- connection from its first request, so the open connections are finished
+-- and closed, and are opened again on their next use.
+-----------------------------------------------------------------------------
 
-  if primaryPtr.backoffCount > 0 then
-     handleBackoff( primaryPtr );
-  end if;
-  if primaryPtr.backoffCount = 0 then
-     begin
-       put_line( primaryPtr.fd, memcache_cmd );
-       put_line( primaryPtr.fd, value );
-       get( primaryPtr.fd, primaryResult );
-     exception when others =>
-       backoffServer( primaryPtr );
-     end;
+procedure SetProtocol( mc : in out aMemcacheCluster; protocol : aMemcacheProtocol ) is
+  serverPtr : aMemcacheDescriptorPtr;
+  pragma suppress( access_check ); -- disable when debugging!
+begin
+  if protocol = mc.protocol then
+     return;
   end if;
+  for s in 1..mc.serverCount loop
+      serverPtr := mc.server( s )'unchecked_access;
+      if serverPtr.backoffCount = 0 then
+         drainReplies( serverPtr );
+         if serverPtr.backoffCount = 0 and serverPtr.quietRequests > 0 then
+            fenceServer( serverPtr );
+         end if;
+      end if;
+      if isOpen( serverPtr.fd ) then
+         close( serverPtr.fd );
+         serverPtr.backoffCount := 1;
+         serverPtr.backoffLevel := 0;
+      end if;
+      serverPtr.protocol := protocol;
+      serverPtr.output := null_unbounded_string;
+      serverPtr.pendingReplies := 0;
+  end loop;
+  mc.protocol := protocol;
+end SetProtocol;
 
-  if primaryServer = secondaryServer then
-     result := primaryResult;
-  else
-     secondaryPtr := mc.server( secondaryServer )'unchecked_access;
-     if secondaryPtr.backoffCount > 0 then
-        handleBackoff( mc, secondaryServer );
-     end if;
-     if secondaryPtr.backoffCount = 0 then
-        begin
-          put_line( secondaryPtr.fd, memcache_cmd );
-          put_line( secondaryPtr.fd, value );
-          get( secondaryPtr.fd, secondaryResult );
-       exception when others =>
-          backoffServer( secondaryPtr );
-       end;
-     end if;
-     reconcileResults( result, primaryResult, secondaryResult );
-  end if;
 
-  if head( result, length( memcacheResult_STORED ) ) /= memcacheResult_STORED then
-     put_line( standard_error, Gnat.Source_Info.Source_Location &
-       ": set failed on key '" & to_string( name ) & "' with result '" &
-       to_string( result ) & "'" );
-  else
-     null;
-     pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
-       ": set succeeded on key '" & to_string( name ) & "' with result '" &
-       to_string( result ) & "'" ) );
+--  SET
+--
+-- Store a value for the named key, ovewriting if necessary.
+-- constraint_error is raised if no servers are defined.
+-----------------------------------------------------------------------------
 
-  end if;
+procedure Set( mc : in out aMemcacheCluster; name, value : unbounded_string; expiry : natural := 0 ) is
+  request : aPendingRequest;
+begin
+  sendRequest( mc, "set", name, value, request, expiry );
+  finishRequest( request, "set", name );
 end Set;
 
 
@@ -379,490 +1050,637 @@ end Set;
 -- constraint_error is raised if no servers are defined.
 -----------------------------------------------------------------------------
 
-procedure Add( mc : in out aMemcacheCluster; name, value : unbounded_string ) is
-  memcache_cmd    : unbounded_string;
-  primaryServer   : aServerNumber;
-  secondaryServer : aServerNumber;
-  result          : unbounded_string;
-  primaryResult   : unbounded_string;
-  secondaryResult : unbounded_string;
-  primaryPtr      : aMemcacheDescriptorPtr;
-  secondaryPtr    : aMemcacheDescriptorPtr;
-  pragma suppress( access_check ); -- disable when debugging!
+procedure Add( mc : in out aMemcacheCluster; name, value : unbounded_string; expiry : natural := 0 ) is
+  request : aPendingRequest;
 begin
-  getServers( mc, name, primaryServer, secondaryServer );
+  sendRequest( mc, "add", name, value, request, expiry );
+  finishRequest( request, "add", name );
+end Add;
 
-  pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
-       ": add '" & to_string( name ) & "' on primary server" &
-       primaryServer'img & " and secondary" & secondaryServer'img ) );
 
-  memcache_cmd := "add " & name & " 0 0" & integer'image( length( value ) );
-  pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
-    ": cmd = '" & to_string( memcache_cmd ) & "'" ) );
+--  REPLACE
+--
+-- Store a value for the named key, only if it already exists.
+-- constraint_error is raised if no servers are defined.
+-----------------------------------------------------------------------------
 
-  -- this pointer is used to improve performance. not sure why unchecked
-  -- is necessary for a local pointer to a global identifier
-  primaryPtr := mc.server( primaryServer )'unchecked_access;
+procedure Replace( mc : in out aMemcacheCluster; name, value : unbounded_string; expiry : natural := 0 ) is
+  request : aPendingRequest;
+begin
+  sendRequest( mc, "replace", name, value, request, expiry );
+  finishRequest( request, "replace", name );
+end Replace;
 
-  if primaryPtr.backoffCount > 0 then
-     handleBackoff( primaryPtr );
-  end if;
-  if primaryPtr.backoffCount = 0 then
-     begin
-       put_line( primaryPtr.fd, memcache_cmd );
-       put_line( primaryPtr.fd, value );
-       get( primaryPtr.fd, primaryResult );
-     exception when others =>
-       backoffServer( primaryPtr );
-     end;
-  end if;
 
-  if primaryServer = secondaryServer then
-     result := primaryResult;
-  else
-     secondaryPtr := mc.server( secondaryServer )'unchecked_access;
-     if secondaryPtr.backoffCount > 0 then
-        handleBackoff( secondaryPtr );
-     end if;
-     if secondaryPtr.backoffCount = 0 then
-        begin
-          put_line( secondaryPtr.fd, memcache_cmd );
-          put_line( secondaryPtr.fd, value );
-          get( secondaryPtr.fd, secondaryResult );
-       exception when others =>
-          backoffServer( secondaryPtr );
-       end;
-     end if;
-     reconcileResults( result, primaryResult, secondaryResult );
-  end if;
+--  APPEND
+--
+-- Add string to the end of the value for the named key.
+-- constraint_error is raised if no servers are defined.
+-----------------------------------------------------------------------------
 
-  if head( result, length( memcacheResult_STORED ) ) /= memcacheResult_STORED then
-     put_line( standard_error, Gnat.Source_Info.Source_Location &
-       ": add failed on key '" & to_string( name ) & "' with result '" &
-       to_string( result ) & "'" );
-  else
-     null;
-     pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
-       ": add succeeded on key '" & to_string( name ) & "' with result '" &
-       to_string( result ) & "'" ) );
-  end if;
-end Add;
+procedure Append( mc : in out aMemcacheCluster; name, value : unbounded_string ) is
+  request : aPendingRequest;
+begin
+  sendRequest( mc, "append", name, value, request );
+  finishRequest( request, "append", name );
+end Append;
 
 
---  REPLACE
+--  PREPEND
 --
--- Store a value for the named key, only if it already exists.
+-- Add string to the beginning to the value for the named key.
 -- constraint_error is raised if no servers are defined.
 -----------------------------------------------------------------------------
 
-procedure Replace( mc : in out aMemcacheCluster; name, value : unbounded_string ) is
-  memcache_cmd    : unbounded_string;
+procedure Prepend( mc : in out aMemcacheCluster; name, value : unbounded_string ) is
+  request : aPendingRequest;
+begin
+  sendRequest( mc, "prepend", name, value, request );
+  finishRequest( request, "prepend", name );
+end Prepend;
+
+
+--  DELETE
+--
+-- Delete a key and its value.
+-- constraint_error is raised if no servers are defined.
+-----------------------------------------------------------------------------
+
+procedure Delete( mc : in out aMemcacheCluster; name : unbounded_string ) is
+  request : aPendingRequest;
+begin
+  sendRequest( mc, "delete", name, null_unbounded_string, request );
+  finishRequest( request, "delete", name );
+end Delete;
+
+
+--  GET
+--
+-- Return the value of the given key.  Return an empty string if the key is
+-- not found or if there is a major server failure.
+-- constraint_error is raised if no servers are defined.
+-----------------------------------------------------------------------------
+
+procedure Get( mc : in out aMemcacheCluster; name : unbounded_string; value : out unbounded_string ) is
   primaryServer   : aServerNumber;
   secondaryServer : aServerNumber;
+  temp            : aServerNumber;
   result          : unbounded_string;
-  primaryResult   : unbounded_string;
-  secondaryResult : unbounded_string;
   primaryPtr      : aMemcacheDescriptorPtr;
   secondaryPtr    : aMemcacheDescriptorPtr;
   pragma suppress( access_check ); -- disable when debugging!
 begin
   getServers( mc, name, primaryServer, secondaryServer );
+  flipPrimary := not flipPrimary;
+  if flipPrimary then
+    temp := primaryServer;
+    primaryServer := secondaryServer;
+    secondaryServer := temp;
+  end if;
 
   pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
-       ": replace '" & to_string( name ) & "' on primary server" &
-       primaryServer'img & " and secondary" & secondaryServer'img ) );
-
-  memcache_cmd := "replace " & name & " 0 0" & integer'image( length( value ) );
-  pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
-    ": cmd = '" & to_string( memcache_cmd ) & "'" ) );
+       ": get '" & to_string( name ) & "'" ) );
 
-  -- this pointer is used to improve performance. not sure why unchecked
-  -- is necessary for a local pointer to a global identifier
   primaryPtr := mc.server( primaryServer )'unchecked_access;
-
-  if primaryPtr.backoffCount > 0 then
-     handleBackoff( primaryPtr );
-  end if;
-  if primaryPtr.backoffCount = 0 then
-     begin
-       put_line( primaryPtr.fd, memcache_cmd );
-       put_line( primaryPtr.fd, value );
-       get( primaryPtr.fd, primaryResult );
-     exception when others =>
-       backoffServer( primaryPtr );
-     end;
-  end if;
-
-  if primaryServer = secondaryServer then
-     result := primaryResult;
-  else
+  if primaryServer /= secondaryServer then
      secondaryPtr := mc.server( secondaryServer )'unchecked_access;
-     if secondaryPtr.backoffCount > 0 then
-        handleBackoff( secondaryPtr );
-     end if;
-     if secondaryPtr.backoffCount = 0 then
-        begin
-          put_line( secondaryPtr.fd, memcache_cmd );
-          put_line( secondaryPtr.fd, value );
-          get( secondaryPtr.fd, secondaryResult );
-       exception when others =>
-          backoffServer( secondaryPtr );
-       end;
-     end if;
-     reconcileResults( result, primaryResult, secondaryResult );
   end if;
+  getFirstValue( primaryPtr, secondaryPtr, name, value, result );
 
-  if head( result, length( memcacheResult_STORED ) ) /= memcacheResult_STORED then
-     put_line( standard_error, Gnat.Source_Info.Source_Location &
-       ": replace failed on key '" & to_string( name ) & "' with result '" &
-       to_string( result ) & "'" );
+  if head( result, length( memcacheResult_END ) ) /= memcacheResult_END then
+     -- a server failure will result in a null string response.  If we report
+     -- every failed access attempt (which also occurs even after backing off)
+     -- we'll bombard the logs.  so suppress these error messages.  the backoff
+     -- warnings will still be logged anyway
+     if length( result ) > 0 then
+        put_line( standard_error, Gnat.Source_Info.Source_Location &
+          ": get failed on key '" & to_string( name ) & "' with result '" &
+          to_string( result ) & "'" );
+     end if;
   else
      null;
      pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
-       ": replace succeeded on key '" & to_string( name ) & "' with result '" &
+       ": get succeeded on key '" & to_string( name ) & "' with result '" &
        to_string( result ) & "'" ) );
   end if;
-end Replace;
+end Get;
 
 
---  APPEND
+--  GET MULTI
 --
--- Add string to the end of the value for the named key.
--- constraint_error is raised if no servers are defined.
+-- Look up the values for several keys at once.  The keys are grouped by
+-- server and each server is sent a single "get" with all of its keys.  All
+-- the gets are sent before any replies are read so the servers answer at
+-- the same time.  Keys missing on one server are then looked up on the
+-- other server holding them, as with Get.  values(i) is the value of
+-- names(i), or an empty string if the key does not exist.  values must have
+-- the same range as names.  constraint_error is raised if no servers are
+-- defined.
 -----------------------------------------------------------------------------
 
-procedure Append( mc : in out aMemcacheCluster; name, value : unbounded_string ) is
-  memcache_cmd    : unbounded_string;
-  primaryServer   : aServerNumber;
-  secondaryServer : aServerNumber;
-  result          : unbounded_string;
-  primaryResult   : unbounded_string;
-  secondaryResult : unbounded_string;
-  primaryPtr      : aMemcacheDescriptorPtr;
-  secondaryPtr    : aMemcacheDescriptorPtr;
+procedure GetMulti( mc : in out aMemcacheCluster; names : aMemcacheKeyList; values : out aMemcacheKeyList ) is
+  type aKeyServerList is array( names'range ) of aServerNumber;
+  type aKeyFlags is array( names'range ) of boolean;
+  type aServerFlags is array( 1..aServerNumber'last ) of boolean;
+  primaryServers   : aKeyServerList;
+  secondaryServers : aKeyServerList;
+  targetServers    : aKeyServerList;
+  temp             : aServerNumber;
+  found            : aKeyFlags := ( others => false );
+  sent             : aServerFlags;
   pragma suppress( access_check ); -- disable when debugging!
-begin
-  getServers( mc, name, primaryServer, secondaryServer );
 
-  pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
-       ": append '" & to_string( name ) & "' on primary server" &
-       primaryServer'img & " and secondary" & secondaryServer'img ) );
-
-  memcache_cmd := "append " & name & " 0 0" & integer'image( length( value ) );
-  pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
-    ": cmd = '" & to_string( memcache_cmd ) & "'" ) );
-
-  -- this pointer is used to improve performance. not sure why unchecked
-  -- is necessary for a local pointer to a global identifier
-  primaryPtr := mc.server( primaryServer )'unchecked_access;
+  -- SEND GETS
+  --
+  -- Send one get to each server for the keys not found yet.
+
+  procedure sendGets is
+    memcache_cmd : unbounded_string;
+    serverPtr    : aMemcacheDescriptorPtr;
+  begin
+    for s in 1..mc.serverCount loop
+        sent( s ) := false;
+        memcache_cmd := to_unbounded_string( "get" );
+        for i in names'range loop
+            if targetServers( i ) = s and not found( i ) then
+               memcache_cmd := memcache_cmd & ' ' & names( i );
+            end if;
+        end loop;
+        if length( memcache_cmd ) > 3 then
+           pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
+             ": server" & s'img & " cmd = '" & to_string( memcache_cmd ) & "'" ) );
+           serverPtr := mc.server( s )'unchecked_access;
+           prepareServer( serverPtr );
+           if serverPtr.backoffCount = 0 then
+              begin
+                if mc.protocol = binary_protocol then
+                   -- quiet gets only reply if the key is found: the
+                   -- noop marks the end of the replies
+                   for i in names'range loop
+                       if targetServers( i ) = s and not found( i ) then
+                          packets.queueRequest( serverPtr, packets.opGetKQ, names( i ) );
+                       end if;
+                   end loop;
+                   packets.queueRequest( serverPtr, packets.opNoop );
+                   packets.sendRequests( serverPtr );
+                else
+                   put_line( serverPtr.fd, memcache_cmd );
+                end if;
+                sent( s ) := true;
+              exception when others =>
+                backoffServer( serverPtr );
+              end;
+           end if;
+        end if;
+    end loop;
+  end sendGets;
+
+  -- SAVE VALUE
+  --
+  -- Store a value returned by a server.  Servers return values in the
+  -- order the keys were sent so the search starts after the last key found.
+
+  procedure saveValue( s : aServerNumber; key, value : unbounded_string; next : in out integer ) is
+    i : integer := next;
+  begin
+    for tries in names'range loop
+        if i > names'last then
+           i := names'first;
+        end if;
+        if targetServers( i ) = s and then not found( i ) and then names( i ) = key then
+           values( i ) := value;
+           found( i ) := true;
+           next := i + 1;
+           return;
+        end if;
+        i := i + 1;
+    end loop;
+  end saveValue;
+
+  -- READ BINARY REPLIES
+  --
+  -- Read the values found by quiet gets, up to the reply to the noop.
+
+  procedure readBinaryReplies( s : aServerNumber; serverPtr : aMemcacheDescriptorPtr; next : in out integer ) is
+    reply : packets.aReply;
+  begin
+    loop
+      packets.readReply( serverPtr, reply );
+      exit when reply.opcode = packets.opNoop;
+      if reply.status = packets.statusOK then
+         saveValue( s, reply.key, reply.value, next );
+      else
+         put_line( standard_error, Gnat.Source_Info.Source_Location &
+           ": get failed on server" & s'img & " with status" & reply.status'img );
+      end if;
+    end loop;
+  end readBinaryReplies;
+
+  -- READ REPLIES
+  --
+  -- Read the values from each server that was sent a get, up to the END.
+
+  procedure readReplies is
+    result     : unbounded_string;
+    value      : unbounded_string;
+    eol        : unbounded_string;
+    p          : natural;
+    sizeToRead : integer;
+    next       : integer;
+    serverPtr  : aMemcacheDescriptorPtr;
+  begin
+    for s in 1..mc.serverCount loop
+      if sent( s ) then
+         serverPtr := mc.server( s )'unchecked_access;
+         next := names'first;
+         begin
+           if waitForReply( serverPtr, null ) = 0 then
+              raise data_error with "server timed out";
+           end if;
+           if mc.protocol = binary_protocol then
+              readBinaryReplies( s, serverPtr, next );
+           else
+              loop
+                get( serverPtr.fd, result );
+                exit when head( result, length( memcacheResult_VALUE ) ) /= memcacheResult_VALUE;
+                -- VALUE key flags bytes
+                p := length( result )-1;
+                while element( result, p ) /= ' ' loop
+                  p := p - 1;
+                end loop;
+                sizeToRead := integer'value( slice( result, p, length( result ) ) );
+                value := null_unbounded_string;
+                if sizeToRead > 0 then
+                   get( serverPtr.fd, sizeToRead, value );
+                end if;
+                get( serverPtr.fd, 2, eol );  -- read EOL
+                p := length( memcacheResult_VALUE ) + 2;
+                saveValue( s, unbounded_slice( result, p,
+                   index( result, " ", p ) - 1 ), value, next );
+              end loop;
+              if result /= memcacheResult_END then
+                 put_line( standard_error, Gnat.Source_Info.Source_Location &
+                   ": get failed on server" & s'img & " with result '" &
+                   to_string( result ) & "'" );
+              end if;
+           end if;
+         exception when others =>
+           backoffServer( serverPtr );
+         end;
+      end if;
+    end loop;
+  end readReplies;
 
-  if primaryPtr.backoffCount > 0 then
-     handleBackoff( primaryPtr );
+begin
+  values := ( others => null_unbounded_string );
+  if names'length = 0 then
+     return;
   end if;
-  if primaryPtr.backoffCount = 0 then
-     begin
-       put_line( primaryPtr.fd, memcache_cmd );
-       put_line( primaryPtr.fd, value );
-       get( primaryPtr.fd, primaryResult );
-     exception when others =>
-       backoffServer( primaryPtr );
-     end;
+  if mc.serverCount = 0 then
+     raise constraint_error with "no memcache servers registered";
   end if;
 
-  if primaryServer = secondaryServer then
-     result := primaryResult;
-  else
-     secondaryPtr := mc.server( secondaryServer )'unchecked_access;
-     if secondaryPtr.backoffCount > 0 then
-        handleBackoff( secondaryPtr );
-     end if;
-     if secondaryPtr.backoffCount = 0 then
-        begin
-          put_line( secondaryPtr.fd, memcache_cmd );
-          put_line( secondaryPtr.fd, value );
-          get( secondaryPtr.fd, secondaryResult );
-       exception when others =>
-          backoffServer( secondaryPtr );
-       end;
-     end if;
-     reconcileResults( result, primaryResult, secondaryResult );
-  end if;
+  -- Alternate the primary and secondary servers to distribute the load
 
-  if head( result, length( memcacheResult_STORED ) ) /= memcacheResult_STORED then
-     put_line( standard_error, Gnat.Source_Info.Source_Location &
-       ": append failed on key '" & to_string( name ) & "' with result '" &
-       to_string( result ) & "'" );
-  else
-     null;
-     pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
-       ": append succeeded on key '" & to_string( name ) & "' with result '" &
-       to_string( result ) & "'" ) );
-  end if;
-end Append;
+  flipPrimary := not flipPrimary;
+  for i in names'range loop
+      getServers( mc, names( i ), primaryServers( i ), secondaryServers( i ) );
+      if flipPrimary then
+         temp := primaryServers( i );
+         primaryServers( i ) := secondaryServers( i );
+         secondaryServers( i ) := temp;
+      end if;
+  end loop;
+
+  pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
+       ": get_multi of" & names'length'img & " keys" ) );
+
+  targetServers := primaryServers;
+  sendGets;
+  readReplies;
+
+  -- Look for the missing keys on their other servers
+
+  for i in names'range loop
+      if found( i ) and then length( values( i ) ) > 0 then
+         targetServers( i ) := 0;
+      else
+         found( i ) := false;
+         if secondaryServers( i ) = primaryServers( i ) then
+            targetServers( i ) := 0;
+         else
+            targetServers( i ) := secondaryServers( i );
+         end if;
+      end if;
+  end loop;
+  sendGets;
+  readReplies;
+end GetMulti;
 
 
---  PREPEND
+--  TOUCH
 --
--- Add string to the beginning to the value for the named key.
+-- Change the expiry of a key without reading or changing its value.
 -- constraint_error is raised if no servers are defined.
 -----------------------------------------------------------------------------
 
-procedure Prepend( mc : in out aMemcacheCluster; name, value : unbounded_string ) is
-  memcache_cmd    : unbounded_string;
+procedure Touch( mc : in out aMemcacheCluster; name : unbounded_string; expiry : natural ) is
+  request : aPendingRequest;
+begin
+  sendRequest( mc, "touch", name, null_unbounded_string, request, expiry );
+  finishRequest( request, "touch", name );
+end Touch;
+
+
+--  GET CAS SERVERS
+--
+-- A CAS value is only meaningful to the server that returned it, so Gets
+-- and CompareAndSwap both use the primary server of a key, or else the
+-- secondary if the primary is backing off.  otherPtr is the server that
+-- is given the new value after a successful CompareAndSwap, or null.
+-----------------------------------------------------------------------------
+
+procedure getCasServers( mc : in out aMemcacheCluster; name : unbounded_string; chosenPtr, otherPtr : out aMemcacheDescriptorPtr ) is
   primaryServer   : aServerNumber;
   secondaryServer : aServerNumber;
-  result          : unbounded_string;
-  primaryResult   : unbounded_string;
-  secondaryResult : unbounded_string;
-  primaryPtr      : aMemcacheDescriptorPtr;
-  secondaryPtr    : aMemcacheDescriptorPtr;
   pragma suppress( access_check ); -- disable when debugging!
 begin
   getServers( mc, name, primaryServer, secondaryServer );
+  chosenPtr := mc.server( primaryServer )'unchecked_access;
+  otherPtr := null;
+  prepareServer( chosenPtr );
+  if primaryServer /= secondaryServer then
+     if chosenPtr.backoffCount = 0 then
+        otherPtr := mc.server( secondaryServer )'unchecked_access;
+     else
+        chosenPtr := mc.server( secondaryServer )'unchecked_access;
+        prepareServer( chosenPtr );
+     end if;
+  end if;
+end getCasServers;
 
-  pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
-       ": prepend '" & to_string( name ) & "' on primary server" &
-       primaryServer'img & " and secondary" & secondaryServer'img ) );
 
-  memcache_cmd := "prepend " & name & " 0 0" & integer'image( length( value ) );
-  pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
-    ": cmd = '" & to_string( memcache_cmd ) & "'" ) );
+--  GETS
+--
+-- Return the value of the given key and its CAS value, for a later
+-- CompareAndSwap.  Return an empty string and a CAS of zero if the key is
+-- not found or if there is a major server failure.
+-- constraint_error is raised if no servers are defined.
+-----------------------------------------------------------------------------
 
-  -- this pointer is used to improve performance. not sure why unchecked
-  -- is necessary for a local pointer to a global identifier
-  primaryPtr := mc.server( primaryServer )'unchecked_access;
+procedure Gets( mc : in out aMemcacheCluster; name : unbounded_string; value : out unbounded_string; cas : out aMemcacheCAS ) is
+  serverPtr  : aMemcacheDescriptorPtr;
+  otherPtr   : aMemcacheDescriptorPtr;
+  result     : unbounded_string;
+  reply      : packets.aReply;
+  p          : natural;
+  q          : natural;
+  sizeToRead : integer;
+begin
+  value := null_unbounded_string;
+  cas := 0;
+  getCasServers( mc, name, serverPtr, otherPtr );
 
-  if primaryPtr.backoffCount > 0 then
-     handleBackoff( primaryPtr );
-  end if;
-  if primaryPtr.backoffCount = 0 then
+  pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
+       ": gets '" & to_string( name ) & "' on server " &
+       to_string( serverPtr.host ) & serverPtr.port'img ) );
+
+  if serverPtr.backoffCount = 0 then
      begin
-       put_line( primaryPtr.fd, memcache_cmd );
-       put_line( primaryPtr.fd, value );
-       get( primaryPtr.fd, primaryResult );
+       if serverPtr.protocol = binary_protocol then
+          packets.queueRequest( serverPtr, packets.opGet, name );
+          packets.sendRequests( serverPtr );
+       else
+          put_line( serverPtr.fd, "gets " & name );
+       end if;
+       if waitForReply( serverPtr, null ) = 0 then
+          raise data_error with "server timed out";
+       end if;
+       if serverPtr.protocol = binary_protocol then
+          packets.readReply( serverPtr, reply );
+          result := binaryResult( "get", reply.status );
+          if reply.status = packets.statusOK then
+             value := reply.value;
+             cas := reply.cas;
+          end if;
+       else
+          get( serverPtr.fd, result );
+          if head( result, length( memcacheResult_VALUE ) ) = memcacheResult_VALUE then
+             -- VALUE key flags bytes cas
+             p := length( result );
+             while element( result, p ) /= ' ' loop
+               p := p - 1;
+             end loop;
+             cas := aMemcacheCAS'value( slice( result, p+1, length( result ) ) );
+             q := p - 1;
+             while element( result, q ) /= ' ' loop
+               q := q - 1;
+             end loop;
+             sizeToRead := integer'value( slice( result, q+1, p-1 ) );
+             if sizeToRead > 0 then
+                get( serverPtr.fd, sizeToRead, value );
+             end if;
+             get( serverPtr.fd, 2, result );  -- read EOL
+             get( serverPtr.fd, result );
+          end if;
+       end if;
      exception when others =>
-       backoffServer( primaryPtr );
+       backoffServer( serverPtr );
+       value := null_unbounded_string;
+       cas := 0;
      end;
   end if;
 
-  if primaryServer = secondaryServer then
-     result := primaryResult;
-  else
-     secondaryPtr := mc.server( secondaryServer )'unchecked_access;
-     if secondaryPtr.backoffCount > 0 then
-        handleBackoff( secondaryPtr );
-     end if;
-     if secondaryPtr.backoffCount = 0 then
-        begin
-          put_line( secondaryPtr.fd, memcache_cmd );
-          put_line( secondaryPtr.fd, value );
-          get( secondaryPtr.fd, secondaryResult );
-       exception when others =>
-          backoffServer( secondaryPtr );
-       end;
-     end if;
-     reconcileResults( result, primaryResult, secondaryResult );
-  end if;
-
-  if head( result, length( memcacheResult_STORED ) ) /= memcacheResult_STORED then
+  if length( result ) > 0 and head( result, length( memcacheResult_END ) ) /= memcacheResult_END then
      put_line( standard_error, Gnat.Source_Info.Source_Location &
-       ": prepend failed on key '" & to_string( name ) & "' with result '" &
+       ": gets failed on key '" & to_string( name ) & "' with result '" &
        to_string( result ) & "'" );
-  else
-     null;
-     pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
-       ": prepend succeeded on key '" & to_string( name ) & "' with result '" &
-       to_string( result ) & "'" ) );
   end if;
-end Prepend;
+end Gets;
 
 
---  DELETE
+--  COMPARE AND SWAP
 --
--- Delete a key and its value.
+-- Store a value for the named key only if it has not changed since Gets
+-- returned the CAS value.  stored is false if it changed, if it was
+-- deleted or if the server failed.  When the value is stored, it is also
+-- set on the key's other server.
 -- constraint_error is raised if no servers are defined.
 -----------------------------------------------------------------------------
 
-procedure Delete( mc : in out aMemcacheCluster; name : unbounded_string ) is
-  memcache_cmd    : unbounded_string;
-  primaryServer   : aServerNumber;
-  secondaryServer : aServerNumber;
-  result          : unbounded_string;
-  primaryResult   : unbounded_string;
-  secondaryResult : unbounded_string;
-  primaryPtr      : aMemcacheDescriptorPtr;
-  secondaryPtr    : aMemcacheDescriptorPtr;
-  pragma suppress( access_check ); -- disable when debugging!
+procedure CompareAndSwap( mc : in out aMemcacheCluster; name, value : unbounded_string; cas : aMemcacheCAS; stored : out boolean; expiry : natural := 0 ) is
+  serverPtr : aMemcacheDescriptorPtr;
+  otherPtr  : aMemcacheDescriptorPtr;
+  result    : unbounded_string;
+  reply     : packets.aReply;
+  request   : aPendingRequest;
 begin
-  getServers( mc, name, primaryServer, secondaryServer );
-
-  pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
-       ": delete '" & to_string( name ) & "' on primary server" &
-       primaryServer'img & " and secondary" & secondaryServer'img ) );
+  stored := false;
+  if cas = 0 then
+     -- Gets found no value.  A binary set with a CAS of zero would store
+     -- the value unconditionally.
+     return;
+  end if;
+  getCasServers( mc, name, serverPtr, otherPtr );
 
-  memcache_cmd := "delete " & name;
   pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
-    ": cmd = '" & to_string( memcache_cmd ) & "'" ) );
+       ": cas '" & to_string( name ) & "' on server " &
+       to_string( serverPtr.host ) & serverPtr.port'img ) );
 
-  -- this pointer is used to improve performance. not sure why unchecked
-  -- is necessary for a local pointer to a global identifier
-  primaryPtr := mc.server( primaryServer )'unchecked_access;
-
-  if primaryPtr.backoffCount > 0 then
-     handleBackoff( primaryPtr );
-  end if;
-  if primaryPtr.backoffCount = 0 then
+  if serverPtr.backoffCount = 0 then
      begin
-       put_line( primaryPtr.fd, memcache_cmd );
-       get( primaryPtr.fd, primaryResult );
+       if serverPtr.protocol = binary_protocol then
+          packets.queueRequest( serverPtr, packets.opSet, name, value,
+             packets.storageExtras( expiry ), cas );
+          packets.sendRequests( serverPtr );
+       else
+          put_line( serverPtr.fd, "cas " & name & " 0" & expiry'img &
+             integer'image( length( value ) ) & cas'img );
+          put_line( serverPtr.fd, value );
+       end if;
+       if waitForReply( serverPtr, null ) = 0 then
+          raise data_error with "server timed out";
+       end if;
+       if serverPtr.protocol = binary_protocol then
+          packets.readReply( serverPtr, reply );
+          result := binaryResult( "set", reply.status );
+       else
+          get( serverPtr.fd, result );
+       end if;
      exception when others =>
-       backoffServer( primaryPtr );
+       backoffServer( serverPtr );
      end;
   end if;
 
-  if primaryServer = secondaryServer then
-     result := primaryResult;
-  else
-     secondaryPtr := mc.server( secondaryServer )'unchecked_access;
-     if secondaryPtr.backoffCount > 0 then
-        handleBackoff( secondaryPtr );
+  if result = memcacheResult_STORED then
+     stored := true;
+     if otherPtr /= null then
+        sendToServer( otherPtr, "set", name, value, expiry, request.primaryPtr );
+        finishRequest( request, "set", name );
      end if;
-     if secondaryPtr.backoffCount = 0 then
-        begin
-          put_line( secondaryPtr.fd, memcache_cmd );
-          get( secondaryPtr.fd, secondaryResult );
-       exception when others =>
-          backoffServer( secondaryPtr );
-       end;
+  elsif result /= memcacheResult_EXISTS and result /= memcacheResult_NOT_FOUND then
+     -- EXISTS and NOT_FOUND are normal: another process changed the key
+     if length( result ) > 0 then
+        put_line( standard_error, Gnat.Source_Info.Source_Location &
+          ": cas failed on key '" & to_string( name ) & "' with result '" &
+          to_string( result ) & "'" );
      end if;
-     reconcileResults( result, primaryResult, secondaryResult );
-  end if;
-
-  if head( result, length( memcacheResult_DELETED ) ) /= memcacheResult_DELETED then
-     put_line( standard_error, Gnat.Source_Info.Source_Location &
-       ": delete failed on key '" & to_string( name ) & "' with result '" &
-       to_string( result ) & "'" );
-  else
-     null;
-     pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
-       ": delete succeeded on key '" & to_string( name ) & "' with result '" &
-       to_string( result ) & "'" ) );
   end if;
-end Delete;
+end CompareAndSwap;
 
 
---  GET
+--  SET QUIET
 --
--- Return the value of the given key.  Return an empty string if the key is
--- not found or if there is a major server failure.
+-- Store a value for the named key without waiting for the servers to
+-- reply.  With the binary protocol, the requests are queued and written
+-- together and only failures are answered; the failures are counted by
+-- Fence, which is also done each time the queue is written.  With the text protocol, the request is sent with noreply and
+-- only a server that is down is counted as a failure.
 -- constraint_error is raised if no servers are defined.
 -----------------------------------------------------------------------------
 
-procedure Get( mc : in out aMemcacheCluster; name : unbounded_string; value : out unbounded_string ) is
-  memcache_cmd    : unbounded_string;
+procedure SetQuiet( mc : in out aMemcacheCluster; name, value : unbounded_string; expiry : natural := 0 ) is
   primaryServer   : aServerNumber;
   secondaryServer : aServerNumber;
-  temp            : aServerNumber;
-  result          : unbounded_string;
-  primaryResult   : unbounded_string;
-  secondaryResult : unbounded_string;
-  p               : natural;
-  sizeToRead      : integer;
-  primaryPtr      : aMemcacheDescriptorPtr;
-  secondaryPtr    : aMemcacheDescriptorPtr;
   pragma suppress( access_check ); -- disable when debugging!
+
+  procedure sendQuiet( serverPtr : aMemcacheDescriptorPtr ) is
+  begin
+    -- unlike prepareServer, the quiet requests already sent are not
+    -- fenced
+    if serverPtr.backoffCount > 0 then
+       handleBackoff( serverPtr );
+    end if;
+    drainReplies( serverPtr );
+    if serverPtr.backoffCount > 0 then
+       serverPtr.quietFailures := serverPtr.quietFailures + 1;
+       return;
+    end if;
+    begin
+      if serverPtr.protocol = binary_protocol then
+         serverPtr.quietRequests := serverPtr.quietRequests + 1;
+         packets.queueRequest( serverPtr, packets.opSetQ, name, value,
+            packets.storageExtras( expiry ) );
+         -- The queue is written when it is full.  Read the failures for it
+         -- before writing more: a server that cannot write its replies
+         -- stops reading, and a blocked write here would never finish.
+         if length( serverPtr.output ) = 0 then
+            fenceServer( serverPtr );
+         end if;
+      else
+         put_line( serverPtr.fd, "set " & name & " 0" & expiry'img &
+            integer'image( length( value ) ) & " noreply" );
+         put_line( serverPtr.fd, value );
+      end if;
+    exception when others =>
+      -- a binary request is counted by backoffServer
+      if serverPtr.protocol = text_protocol then
+         serverPtr.quietFailures := serverPtr.quietFailures + 1;
+      end if;
+      backoffServer( serverPtr );
+    end;
+  end sendQuiet;
+
 begin
   getServers( mc, name, primaryServer, secondaryServer );
-  flipPrimary := not flipPrimary;
-  if flipPrimary then
-    temp := primaryServer;
-    primaryServer := secondaryServer;
-    secondaryServer := temp;
-  end if;
 
   pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
-       ": get '" & to_string( name ) & "'" ) );
-
-  memcache_cmd := "get " & name;
-  pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
-    ": cmd = '" & to_string( memcache_cmd ) & "'" ) );
+       ": set quiet '" & to_string( name ) & "' on primary server" &
+       primaryServer'img & " and secondary" & secondaryServer'img ) );
 
-  value := null_unbounded_string;
+  sendQuiet( mc.server( primaryServer )'unchecked_access );
+  if primaryServer /= secondaryServer then
+     sendQuiet( mc.server( secondaryServer )'unchecked_access );
+  end if;
+end SetQuiet;
 
-  primaryPtr := mc.server( primaryServer )'unchecked_access;
 
-  if primaryPtr.backoffCount > 0 then
-     handleBackoff( primaryPtr );
-  end if;
-  if primaryPtr.backoffCount = 0 then
-     begin
-       put_line( primaryPtr.fd, memcache_cmd );
-       get( primaryPtr.fd, primaryResult );
-       if head( primaryResult, length( memcacheResult_VALUE ) ) = memcacheResult_VALUE then
-          p := length( primaryResult )-1;
-          while element( primaryResult, p ) /= ' ' loop
-            p := p - 1;
-          end loop;
-          sizeToRead := integer'value( slice( primaryResult, p, length( primaryResult ) ) );
-          if sizeToRead > 0 then
-             get( primaryPtr.fd, sizeToRead, value );
-          end if;
-          get( primaryPtr.fd, 2, primaryResult );  -- read EOL
-          get( primaryPtr.fd, primaryResult );
-          result := primaryResult;
-       end if;
-     exception when others =>
-       backoffServer( primaryPtr );
-     end;
-  end if;
+--  FENCE
+--
+-- Wait until the servers have handled every SetQuiet and return the
+-- number of quiet requests that failed since the last fence.  A noop is
+-- sent to every server before any replies are read so the servers finish
+-- at the same time.  A value that failed on only one of its servers is
+-- counted once for that server.
+-----------------------------------------------------------------------------
 
-  if length( value ) = 0 then
-     if primaryServer /= secondaryServer then
-        secondaryPtr := mc.server( secondaryServer )'unchecked_access;
-       if secondaryPtr.backoffCount > 0 then
-          handleBackoff( secondaryPtr );
-       end if;
-       if secondaryPtr.backoffCount = 0 then
-          begin
-            put_line( secondaryPtr.fd, memcache_cmd );
-            get( secondaryPtr.fd, secondaryResult );
-            if head( secondaryResult, length( memcacheResult_VALUE ) ) = memcacheResult_VALUE then
-               p := length( secondaryResult )-1;
-               while element( secondaryResult, p ) /= ' ' loop
-                 p := p - 1;
-               end loop;
-               sizeToRead := integer'value( slice( secondaryResult, p, length( secondaryResult ) ) );
-               if sizeToRead > 0 then
-                  get( secondaryPtr.fd, sizeToRead, value );
-               end if;
-               get( secondaryPtr.fd, 2, secondaryResult );  -- read EOL
-               get( secondaryPtr.fd, secondaryResult );
-            end if;
+procedure Fence( mc : in out aMemcacheCluster; failures : out natural ) is
+  type aServerFlags is array( 1..aServerNumber'last ) of boolean;
+  fenced    : aServerFlags := ( others => false );
+  serverPtr : aMemcacheDescriptorPtr;
+  pragma suppress( access_check ); -- disable when debugging!
+begin
+  failures := 0;
+  for s in 1..mc.serverCount loop
+      serverPtr := mc.server( s )'unchecked_access;
+      if serverPtr.backoffCount = 0 and serverPtr.quietRequests > 0 then
+         begin
+           packets.sendFence( serverPtr );
+           fenced( s ) := true;
          exception when others =>
-           backoffServer( secondaryPtr );
+           backoffServer( serverPtr );
          end;
-       end if;
-       result := secondaryResult;
-     end if;
-  end if;
-
-  if head( result, length( memcacheResult_END ) ) /= memcacheResult_END then
-     -- a server failure will result in a null string response.  If we report
-     -- every failed access attempt (which also occurs even after backing off)
-     -- we'll bombard the logs.  so suppress these error messages.  the backoff
-     -- warnings will still be logged anyway
-     if length( result ) > 0 then
-        put_line( standard_error, Gnat.Source_Info.Source_Location &
-          ": get failed on key '" & to_string( name ) & "' with result '" &
-          to_string( result ) & "'" );
-     end if;
-  else
-     null;
-     pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
-       ": get succeeded on key '" & to_string( name ) & "' with result '" &
-       to_string( result ) & "'" ) );
-  end if;
-end Get;
+      end if;
+  end loop;
+  for s in 1..mc.serverCount loop
+      serverPtr := mc.server( s )'unchecked_access;
+      if fenced( s ) then
+         begin
+           if waitForReply( serverPtr, null ) = 0 then
+              put_line( standard_error, Gnat.Source_Info.Source_Location &
+                ": server " & to_string( serverPtr.host) & serverPtr.port'img & " timed out" );
+              backoffServer( serverPtr );
+           else
+              packets.readFence( serverPtr );
+           end if;
+         exception when others =>
+           backoffServer( serverPtr );
+         end;
+      end if;
+      failures := failures + serverPtr.quietFailures;
+      serverPtr.quietFailures := 0;
+  end loop;
+end Fence;
 
 
 --  STATS
@@ -876,6 +1694,7 @@ end Get;
 procedure Stats( mc : in out aMemcacheCluster; value : out unbounded_string ) is
   memcache_cmd    : unbounded_string;
   result          : unbounded_string;
+  reply           : packets.aReply;
 begin
   pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
        ": stats on all servers" ) );
@@ -886,21 +1705,31 @@ begin
 
   value := null_unbounded_string;
   for s in 1..mc.serverCount loop
-     if mc.server( s ).backoffCount > 0 then
-        handleBackoff( mc, s );
-     end if;
+     prepareServer( mc, s );
      result := null_unbounded_string;
      if mc.server( s ).backoffCount = 0 then
        begin
-         put_line( mc.server(s).fd, memcache_cmd );
          value := value & s'img & " host " & mc.server(s).host & Latin_1.LF;
          value := value & s'img & " port" & mc.server(s).port'img & Latin_1.LF;
-         loop
-           get( mc.server( s ).fd, result );
-         exit when head( result, length( memcacheResult_STAT ) ) /= memcacheResult_STAT;
+         if mc.protocol = binary_protocol then
+            -- one reply per stat, ending with an empty key
+            packets.queueRequest( mc.server( s )'unchecked_access, packets.opStat );
+            packets.sendRequests( mc.server( s )'unchecked_access );
+            loop
+              packets.readReply( mc.server( s )'unchecked_access, reply );
+              result := binaryResult( "get", reply.status );
+            exit when length( reply.key ) = 0 or reply.status /= packets.statusOK;
+              value := value & s'img & ' ' & reply.key & ' ' & reply.value & ASCII.LF;
+            end loop;
+         else
+            put_line( mc.server(s).fd, memcache_cmd );
+            loop
+              get( mc.server( s ).fd, result );
+            exit when head( result, length( memcacheResult_STAT ) ) /= memcacheResult_STAT;
  -- hack: slice
-           value := value & s'img & ' ' & unbounded_slice( result, length( memcacheResult_STAT ) + 2, length( result ) ) & ASCII.LF;
-         end loop;
+              value := value & s'img & ' ' & unbounded_slice( result, length( memcacheResult_STAT ) + 2, length( result ) ) & ASCII.LF;
+            end loop;
+         end if;
        exception when others =>
          backoffServer( mc, s );
        end;
@@ -935,6 +1764,22 @@ procedure Version( mc : in out aMemcacheCluster; value : out unbounded_string )
   secondaryResult : unbounded_string;
   primaryPtr      : aMemcacheDescriptorPtr;
   secondaryPtr    : aMemcacheDescriptorPtr;
+
+  -- a version reply from the binary protocol is only the version number
+
+  procedure binaryVersion( serverPtr : aMemcacheDescriptorPtr; result : out unbounded_string ) is
+    reply : packets.aReply;
+  begin
+    packets.queueRequest( serverPtr, packets.opVersion );
+    packets.sendRequests( serverPtr );
+    packets.readReply( serverPtr, reply );
+    if reply.status = packets.statusOK then
+       result := memcacheResult_VERSION & " " & reply.value;
+    else
+       result := binaryResult( "version", reply.status );
+    end if;
+  end binaryVersion;
+
 begin
   getRandomServers( mc, primaryServer, secondaryServer );
 
@@ -948,13 +1793,15 @@ begin
 
   primaryPtr := mc.server( primaryServer )'unchecked_access;
 
-  if primaryPtr.backoffCount > 0 then
-     handleBackoff( primaryPtr );
-  end if;
+  prepareServer( primaryPtr );
   if primaryPtr.backoffCount = 0 then
      begin
-       put_line( primaryPtr.fd, memcache_cmd );
-       get( primaryPtr.fd, primaryResult );
+       if mc.protocol = binary_protocol then
+          binaryVersion( primaryPtr, primaryResult );
+       else
+          put_line( primaryPtr.fd, memcache_cmd );
+          get( primaryPtr.fd, primaryResult );
+       end if;
      exception when others =>
        backoffServer( primaryPtr );
      end;
@@ -965,14 +1812,16 @@ begin
        result := primaryResult;
     else
        secondaryPtr := mc.server( secondaryServer )'unchecked_access;
-       if secondaryPtr.backoffCount > 0 then
-          handleBackoff( secondaryPtr );
-       end if;
+       prepareServer( secondaryPtr );
        if secondaryPtr.backoffCount = 0 then
           begin
-            put_line( secondaryPtr.fd, memcache_cmd );
-            put_line( secondaryPtr.fd, value );
-            get( secondaryPtr.fd, secondaryResult );
+            if mc.protocol = binary_protocol then
+               binaryVersion( secondaryPtr, secondaryResult );
+            else
+               put_line( secondaryPtr.fd, memcache_cmd );
+               put_line( secondaryPtr.fd, value );
+               get( secondaryPtr.fd, secondaryResult );
+            end if;
          exception when others =>
            backoffServer( secondaryPtr );
          end;
@@ -1003,6 +1852,7 @@ end Version;
 procedure Flush( mc : in out aMemcacheCluster ) is
   memcache_cmd    : unbounded_string;
   result          : unbounded_string;
+  reply           : packets.aReply;
 begin
   pragma debug( put_line( standard_error, Gnat.Source_Info.Source_Location &
        ": flush on all servers" ) );
@@ -1012,14 +1862,23 @@ begin
     ": cmd = '" & to_string( memcache_cmd ) & "'" ) );
 
   for s in 1..mc.serverCount loop
-     if mc.server( s ).backoffCount > 0 then
-        handleBackoff( mc, s );
-     end if;
+     prepareServer( mc, s );
      result := null_unbounded_string;
      if mc.server( s ).backoffCount = 0 then
        begin
-         put_line( mc.server(s).fd, memcache_cmd );
-         get( mc.server( s ).fd, result );
+         if mc.protocol = binary_protocol then
+            packets.queueRequest( mc.server( s )'unchecked_access, packets.opFlush );
+            packets.sendRequests( mc.server( s )'unchecked_access );
+            packets.readReply( mc.server( s )'unchecked_access, reply );
+            if reply.status = packets.statusOK then
+               result := memcacheResult_OK;
+            else
+               result := binaryResult( "flush_all", reply.status );
+            end if;
+         else
+            put_line( mc.server(s).fd, memcache_cmd );
+            get( mc.server( s ).fd, result );
+         end if;
        exception when others =>
          backoffServer( mc, s );
        end;
@@ -1,11 +1,26 @@
 -- A Simple, non-threading, insecure Web Server built on Tinyserve.
 -- Ken O. Burtch, May 2010
 -----------------------------------------------------------------------------
-with ada.text_io;
-use ada.text_io;
+with ada.text_io,
+     ada.strings,
+     ada.characters.handling,
+     ada.unchecked_deallocation;
+use  ada.text_io,
+     ada.strings,
+     ada.characters.handling;
 
 package body pegasock.tinyserve.http is
 
+httpEOL : constant string := ASCII.CR & ASCII.LF;
+-- HTTP lines end with a carriage return and line feed
+
+procedure free is new ada.unchecked_deallocation( aClientArray, aClientArrayPtr );
+
+function get_file_validators( path : System.Address; etag : System.Address;
+  modified : System.Address; size : System.Address ) return integer;
+pragma import( C, get_file_validators );
+-- the size, entity tag and Last-Modified date for a file
+
 
 -- HOUSEKEEPING
 
@@ -23,7 +38,9 @@ procedure startupWebServer( server : out aHTTPServer;
    socket_queue_length : integer;
    socket_linger_seconds : integer;
    timeout_secs : integer;
-   timeout_usecs : integer ) is
+   timeout_usecs : integer;
+   backend : aSocketBackend := select_backend;
+   idle_timeout_secs : positive := 15 ) is
 begin
   startupTinyServe( server.server,
     host,
@@ -33,7 +50,15 @@ begin
     socket_queue_length,
     socket_linger_seconds,
     timeout_secs,
-    timeout_usecs );
+    timeout_usecs,
+    backend );
+  setMessageFraming( server.server, http_framing );
+  server.client := new aClientArray( 1..aHttpClientID( getFDSetSize ) );
+  server.readyCount := 0;
+  server.readyPos := 0;
+  server.answered := 0;
+  server.idleTimeout := idle_timeout_secs;
+  server.lastIdleCheck := ada.calendar.clock;
 end startupWebServer;
 
 
@@ -43,57 +68,237 @@ end startupWebServer;
 -----------------------------------------------------------------------------
 
 procedure shutdownWebServer( server : aHTTPServer ) is
+  client : aClientArrayPtr := server.client;
 begin
   shutdownTinyServe( server.server );
+  free( client );
 end shutdownWebServer;
 
 
 -----------------------------------------------------------------------------
 
 
+--  C STRING
+--
+-- Return a C string from a buffer, up to the ASCII.NUL.
+-----------------------------------------------------------------------------
+
+function cString( s : string ) return string is
+begin
+  for i in s'range loop
+      if s(i) = ASCII.NUL then
+         return s( s'first..i-1 );
+      end if;
+  end loop;
+  return s;
+end cString;
+
+
+--  CONTENT TYPE
+--
+-- Return the MIME type for a response type.
+-----------------------------------------------------------------------------
+
+function contentType( responseType : aHttpResponseType ) return string is
+begin
+  case responseType is
+  when bmp  => return "image/bmp";
+  when css  => return "text/css";
+  when gif  => return "image/gif";
+  when html => return "text/html";
+  when jpeg => return "image/jpeg";
+  when png  => return "image/png";
+  when xml  => return "application/xml";
+  when others => return "text/plain";
+  end case;
+end contentType;
+
+
+--  CONNECTION FIELD
+--
+-- Return the Connection header line for a response.
+-----------------------------------------------------------------------------
+
+function connectionField( server : aHTTPServer; client : aHttpClientID ) return string is
+begin
+  if server.client(client).keepAlive then
+     return "Connection: keep-alive" & httpEOL;
+  end if;
+  return "Connection: close" & httpEOL;
+end connectionField;
+
+
+--  RESPONSE HEADER
+--
+-- Return the header for a response with a document.  extra is any
+-- additional header lines.
+-----------------------------------------------------------------------------
+
+function responseHeader( server : aHTTPServer; client : aHttpClientID;
+  status : string; responseType : aHttpResponseType; size : long;
+  extra : string := "" ) return string is
+begin
+  return "HTTP/1.1 " & status & httpEOL &
+         "Server: TinyServe" & httpEOL &
+         "Content-Type: " & contentType( responseType ) & httpEOL &
+         "Content-Length:" & long'image( size ) & httpEOL &
+         extra &
+         connectionField( server, client ) &
+         httpEOL;
+end responseHeader;
+
+
+--  FINISH RESPONSE
+--
+-- After a response is queued, close the connection or, if it is kept alive,
+-- check it for pipelined requests on the next getWebRequest.
+-----------------------------------------------------------------------------
+
+procedure finishResponse( server : in out aHTTPServer; client : aHttpClientID ) is
+begin
+  if server.client(client).keepAlive then
+     server.answered := aClientID( client );
+  else
+     close( server.server, aClientID( client ) );
+  end if;
+end finishResponse;
+
+
+--  READ REQUEST
+--
+-- Check a client for a complete request.  If there is one, split it into
+-- the header and content and decide whether to keep the connection open.
+-- Closed clients are closed on the server side too.
+-----------------------------------------------------------------------------
+
+procedure readRequest( server : in out aHTTPServer; id : aClientID; found : out boolean ) is
+  message  : unbounded_string;
+  status   : aMessageStatus;
+  client   : aHttpClientID;
+  newSize  : aHttpClientID;
+  bigger   : aClientArrayPtr;
+  pos      : positive := 1;
+  lf       : natural;
+  lineEnd  : natural;
+  bodyPos  : positive;
+  conn     : unbounded_string;
+begin
+  found := false;
+  begin
+    getMessage( server.server, id, message, status );
+  exception when data_error =>
+    -- e.g. the request is too large
+    drop( server.server, id );
+    return;
+  end;
+  if status = client_closed then
+     close( server.server, id );
+     return;
+  elsif status = partial_message then
+     return;
+  end if;
+
+  -- client IDs are file descriptors so the table grows with the server
+
+  client := aHttpClientID( id );
+  if client > server.client'last then
+     newSize := server.client'last * 2;
+     while newSize < client loop
+        newSize := newSize * 2;
+     end loop;
+     bigger := new aClientArray( 1..newSize );
+     bigger( server.client'range ) := server.client.all;
+     free( server.client );
+     server.client := bigger;
+  end if;
+
+  -- The header lines are saved with line feeds.  The content follows the
+  -- blank line.
+
+  server.client(client).header := null_unbounded_string;
+  bodyPos := length( message ) + 1;
+  loop
+     exit when pos > length( message );
+     lf := index( message, "" & ASCII.LF, pos );
+     exit when lf = 0;
+     lineEnd := lf - 1;
+     if lineEnd >= pos and then element( message, lineEnd ) = ASCII.CR then
+        lineEnd := lineEnd - 1;
+     end if;
+     if lineEnd < pos then
+        bodyPos := lf + 1;
+        exit;
+     end if;
+     append( server.client(client).header, unbounded_slice( message, pos, lineEnd ) & ASCII.LF );
+     pos := lf + 1;
+  end loop;
+  server.client(client).content := unbounded_slice( message, bodyPos, length( message ) );
+
+  if length( server.client(client).header ) < 4 then
+     server.client(client).requestType := unknown;
+  elsif slice( server.client(client).header, 1, 4 ) = "HEAD" then
+     server.client(client).requestType := head;
+  elsif slice( server.client(client).header, 1, 4 ) = "GET " then
+     server.client(client).requestType := get;
+  elsif slice( server.client(client).header, 1, 4 ) = "POST" then
+     server.client(client).requestType := post;
+  else
+     server.client(client).requestType := unknown;
+  end if;
+
+  -- HTTP/1.1 connections are kept alive unless the client says otherwise.
+  -- HTTP/1.0 connections must ask to be kept alive.
+
+  lf := index( server.client(client).header, "" & ASCII.LF );
+  server.client(client).keepAlive := lf > 8 and then
+     slice( server.client(client).header, lf-8, lf-1 ) = "HTTP/1.1";
+  conn := to_unbounded_string( to_lower( to_string( getHeaderField( server, client, "Connection" ) ) ) );
+  if index( conn, "close" ) > 0 then
+     server.client(client).keepAlive := false;
+  elsif index( conn, "keep-alive" ) > 0 then
+     server.client(client).keepAlive := true;
+  end if;
+  found := true;
+end readRequest;
+
+
 --  GET WEB REQUEST
 --
--- Check for outstanding requests and return them to the calling application
+-- Check for outstanding requests and return them to the calling application.
+-- A client that was just answered is checked first for a pipelined request.
+-- Idle clients are closed about once a second.
 -----------------------------------------------------------------------------
 
 procedure getWebRequest( server : in out aHTTPServer; client : out aHttpClientID ) is
-  foundFreeClient : boolean := false;
-  s : unbounded_string;
+  id     : aClientID;
+  found  : boolean;
+  closed : natural;
+  now    : ada.calendar.time;
+  use type ada.calendar.time;
 begin
   loop
-    getNextClient( server.server, server.serverClient );
-    if server.serverClient < 0 then
-       manageConnections( server.server, server.serverClient );
+    if server.answered > 0 then
+       id := server.answered;
+       server.answered := 0;
+    elsif server.readyPos < server.readyCount then
+       server.readyPos := server.readyPos + 1;
+       id := server.ready( server.readyPos );
+    else
+       now := ada.calendar.clock;
+       if now - server.lastIdleCheck >= 1.0 then
+          closeIdleClients( server.server, server.idleTimeout, closed );
+          server.lastIdleCheck := now;
+       end if;
+       manageConnections( server.server, server.ready, server.readyCount );
+       server.readyPos := 0;
+       id := 0;
     end if;
-    if not isTimeout( server.serverClient ) then
-       -- this loop is not necessary if the id's are fd's.
-       for i in aHttpClientID'range loop
-         if not isOpen( server.client(i).sd ) then
-            client := i;
-         end if;
-         exit;
-       end loop;
-       -- assumes we don't run out of id's
-       establish( server.client(client).sd, server.serverClient );
-       setEOL( server.client(client).sd, CRLF );
-       server.client(client).header := null_unbounded_string;
-       loop
-          get( server.client(client).sd, s );
-          if length( s ) = 0 then
-             if slice( server.client(client).header, 1, 4 ) = "HEAD" then
-                server.client(client).requestType := head;
-             elsif slice( server.client(client).header, 1, 4 ) = "GET " then
-                server.client(client).requestType := get;
-             elsif slice( server.client(client).header, 1, 4 ) = "POST" then
-                server.client(client).requestType := post;
-             else
-                server.client(client).requestType := unknown;
-             end if;
-             --put_line( "returning = " & to_string( server.client(client).header ) );
-             return;
-          end if;
-          server.client(client).header := server.client(client).header & s & ASCII.LF;
-       end loop;
+    if id > 0 then
+       readRequest( server, id, found );
+       if found then
+          client := aHttpClientID( id );
+          return;
+       end if;
     end if;
   end loop;
 end getWebRequest;
@@ -101,50 +306,99 @@ end getWebRequest;
 
 --  PUT WEB RESPONSE
 --
--- Send a document back to the web client and close the connection.
+-- Send a document back to the web client.  The header and document are
+-- queued together and the connection is closed unless it is kept alive.
 -----------------------------------------------------------------------------
 
 procedure putWebResponse( server : in out aHTTPServer; client : aHttpClientID; response : unbounded_string; responseType : aHttpResponseType := html ) is
+  header : constant string := responseHeader( server, client, "200 OK",
+     responseType, long( length( response ) ) );
 begin
-  put_line( server.client(client).sd, to_unbounded_string( "HTTP/1.0 200 OK" ) );
-  put_line( server.client(client).sd, to_unbounded_string( "Server: TinyServe" ) );
-  case responseType is
-  when bmp =>
-     put_line( server.client(client).sd, to_unbounded_string( "Content-type: image/bmp" ) );
-  when css =>
-     put_line( server.client(client).sd, to_unbounded_string( "Content-type: text/css" ) );
-  when gif =>
-     put_line( server.client(client).sd, to_unbounded_string( "Content-type: image/gif" ) );
-  when html =>
-     put_line( server.client(client).sd, to_unbounded_string( "Content-type: text/html" ) );
-  when jpeg =>
-     put_line( server.client(client).sd, to_unbounded_string( "Content-type: image/jpeg" ) );
-  when png =>
-     put_line( server.client(client).sd, to_unbounded_string( "Content-type: image/png" ) );
-  when xml =>
-     put_line( server.client(client).sd, to_unbounded_string( "Content-type: application/xml" ) );
-  when others => 
-     put_line( server.client(client).sd, to_unbounded_string( "Content-type: text/plain" ) );
-  end case;
-  put_line( server.client(client).sd, "Content-length:" & integer'image( length( response ) ) );
-  new_line( server.client(client).sd );
-  if server.client(client).requestType /= head then
-     put( server.client(client).sd, response );
+  if server.client(client).requestType = head then
+     putMessage( server.server, aClientID( client ), header );
+  else
+     putMessage( server.server, aClientID( client ), header & to_string( response ) );
   end if;
-  close( server.server, server.client(client).sd );
+  finishResponse( server, client );
+exception when data_error =>
+  -- the client has gone away
+  drop( server.server, aClientID( client ) );
 end putWebResponse;
 
 
+--  PUT WEB FILE
+--
+-- Send a file back to the web client.  The file is not read into memory.
+-- If the client's copy is current, only "304 Not Modified" is sent.
+-----------------------------------------------------------------------------
+
+procedure putWebFile( server : in out aHTTPServer; client : aHttpClientID; path : string; responseType : aHttpResponseType := html ) is
+  c_path       : constant string := path & ASCII.NUL;
+  etagBuffer   : string( 1..48 ) := ( others => ASCII.NUL );
+  dateBuffer   : string( 1..32 ) := ( others => ASCII.NUL );
+  size         : aliased long := 0;
+  ifNoneMatch  : unbounded_string;
+  notModified  : boolean;
+begin
+  if get_file_validators( c_path'address, etagBuffer'address,
+     dateBuffer'address, size'address ) < 0 then
+     putNotFound( server, client );
+     return;
+  end if;
+  declare
+    etag         : constant string := cString( etagBuffer );
+    lastModified : constant string := cString( dateBuffer );
+    validators   : constant string := "ETag: " & etag & httpEOL &
+                                      "Last-Modified: " & lastModified & httpEOL;
+  begin
+    -- If-Modified-Since is ignored when there is an If-None-Match
+
+    ifNoneMatch := getHeaderField( server, client, "If-None-Match" );
+    if length( ifNoneMatch ) > 0 then
+       notModified := to_string( ifNoneMatch ) = "*" or index( ifNoneMatch, etag ) > 0;
+    else
+       notModified := to_string( getHeaderField( server, client, "If-Modified-Since" ) ) = lastModified;
+    end if;
+    if notModified then
+       putMessage( server.server, aClientID( client ),
+          "HTTP/1.1 304 Not Modified" & httpEOL &
+          "Server: TinyServe" & httpEOL &
+          validators &
+          connectionField( server, client ) &
+          httpEOL );
+    else
+       putMessage( server.server, aClientID( client ), responseHeader( server,
+          client, "200 OK", responseType, size, validators ) );
+       if server.client(client).requestType /= head then
+          putFile( server.server, aClientID( client ), path, size );
+       end if;
+    end if;
+  end;
+  finishResponse( server, client );
+exception when data_error =>
+  -- the client has gone away or the file has changed
+  drop( server.server, aClientID( client ) );
+end putWebFile;
+
+
 --  PUT NOT FOUND
 --
--- Return a document not found message to the web client and close the
--- connection.
+-- Return a document not found message to the web client.
 -----------------------------------------------------------------------------
 
 procedure putNotFound( server : in out aHTTPServer; client : aHttpClientID ) is
+  message : constant string := "404 Not Found";
 begin
-  put_line( server.client(client).sd, to_unbounded_string( "HTTP/1.0 404 Not Found" ) );
-  put_line( server.client(client).sd, to_unbounded_string( "Server: TinyServe" ) );
+  if server.client(client).requestType = head then
+     putMessage( server.server, aClientID( client ), responseHeader( server,
+        client, message, text, message'length ) );
+  else
+     putMessage( server.server, aClientID( client ), responseHeader( server,
+        client, message, text, message'length ) & message );
+  end if;
+  finishResponse( server, client );
+exception when data_error =>
+  drop( server.server, aClientID( client ) );
 end putNotFound;
 
 
@@ -159,14 +413,39 @@ begin
 end getHeader;
 
 
+-- GET HEADER FIELD
+--
+-- Return the value of a field in the client's request header.
+-----------------------------------------------------------------------------
+
+function getHeaderField( server : aHTTPServer; client : aHttpClientID; name : string ) return unbounded_string is
+  header : unbounded_string renames server.client(client).header;
+  key    : constant string := to_lower( name ) & ":";
+  pos    : positive := 1;
+  lf     : natural;
+begin
+  loop
+     exit when pos > length( header );
+     lf := index( header, "" & ASCII.LF, pos );
+     exit when lf = 0;
+     if lf - pos > key'length and then
+        to_lower( slice( header, pos, pos + key'length - 1 ) ) = key then
+        return trim( unbounded_slice( header, pos + key'length, lf - 1 ), both );
+     end if;
+     pos := lf + 1;
+  end loop;
+  return null_unbounded_string;
+end getHeaderField;
+
+
 -- GET CONTENT
 --
--- Return the content/document of the last GET.
+-- Return the content/document of the last POST.
 -----------------------------------------------------------------------------
 
---function getContent( server : aHTTPServer; client : aHttpClientID ) return unbounded_string is
---begin
---  return server.client(client).content;
---end getContent;
+function getContent( server : aHTTPServer; client : aHttpClientID ) return unbounded_string is
+begin
+  return server.client(client).content;
+end getContent;
 
 end pegasock.tinyserve.http;
@@ -19,13 +19,31 @@ package body pegasock.tinyserve is
 function initialize_server( port : integer;
   min_recv_buffer_size : integer; min_send_buffer_size : integer;
   socket_queue_length : integer; socket_linger_seconds : integer;
-  timeout_secs : integer; timeout_usecs : integer ) return aSocketServer;
+  timeout_secs : integer; timeout_usecs : integer;
+  backend : integer; workers : integer ) return aSocketServer;
 pragma import( C, initialize_server );
 
+function start_workers( socket_data : aSocketServer; workers : integer ) return integer;
+pragma import( C, start_workers );
+-- fork the workers: worker number in a worker, 0 in the parent when done
+
+function get_worker_number( socket_data : aSocketServer ) return integer;
+pragma import( C, get_worker_number );
+
+function count_worker_clients( socket_data : aSocketServer; worker : integer ) return integer;
+pragma import( C, count_worker_clients );
+
+function count_worker_accepts( socket_data : aSocketServer; worker : integer ) return integer;
+pragma import( C, count_worker_accepts );
+
 function manageConnections( socket_data : aSocketServer ) return int;
 pragma import( C, manageConnections, "manageConnections" );
 -- check connections and return the first waiting client with data
 
+function manageConnectionsBatch( socket_data : aSocketServer; clients : System.Address; max_clients : int ) return int;
+pragma import( C, manageConnectionsBatch, "manageConnectionsBatch" );
+-- check connections and return all waiting clients
+
 function getNextClient( socket_data : aSocketServer; last_client : aSocketFD ) return aSocketFD;
 pragma import( C, getNextClient, "getNextClient" );
 -- get the next waiting client (or -1 for none)
@@ -54,6 +72,28 @@ pragma import( C, send_client_message );
 procedure shutdown_server( socket_data : aSocketServer );
 pragma import( C, shutdown_server );
 
+procedure setMessageFraming( socket_data : aSocketServer; framing : integer; fixed_size : integer );
+pragma import( C, setMessageFraming, "setMessageFraming" );
+
+function get_framed_message( socket_data : aSocketServer; socket_client : aSocketFD ) return integer;
+pragma import( C, get_framed_message );
+-- the length of the next message, -1 (incomplete), -2 (closed), -3 (error)
+
+procedure take_framed_message( socket_data : aSocketServer; socket_client : aSocketFD; message : System.Address );
+pragma import( C, take_framed_message );
+
+function put_framed_message( socket_data : aSocketServer; socket_client : aSocketFD; message : System.Address; len : integer ) return integer;
+pragma import( C, put_framed_message );
+
+function put_file_message( socket_data : aSocketServer; socket_client : aSocketFD; path : System.Address; len : long ) return integer;
+pragma import( C, put_file_message );
+
+function has_pending_output( socket_data : aSocketServer; socket_client : aSocketFD ) return integer;
+pragma import( C, has_pending_output );
+
+function close_idle_clients( socket_data : aSocketServer; idle_secs : integer ) return integer;
+pragma import( C, close_idle_clients );
+
 -- These are C global variables shared with Ada.
 
 min_recv_buffer_size : integer;
@@ -80,8 +120,8 @@ pragma import( C, socket_buffer );
 --
 -- Monitor all client connections and return the first one that needs to be
 -- serviced (that is, has data waiting to be read).  Performed using
--- operating system select syscall.  0 is returned on a timeout.  Errors
--- will throw a data_error exception.
+-- operating system select or epoll syscall.  0 is returned on a timeout.
+-- Errors will throw a data_error exception.
 -----------------------------------------------------------------------------
 
 procedure manageConnections( socket_data : aSocketServer; id : out aClientID ) is
@@ -94,6 +134,27 @@ begin
 end manageConnections;
 
 
+--  MANAGE CONNECTIONS (BATCH)
+--
+-- Monitor all client connections and return all that need to be serviced
+-- at once.  All clients waiting to connect are accepted.  Errors will
+-- throw a data_error exception.
+-----------------------------------------------------------------------------
+
+procedure manageConnections( socket_data : aSocketServer; ids : out aClientIDList; count : out natural ) is
+  res : int;
+begin
+  count := 0;
+  if ids'length > 0 then
+     res := manageConnectionsBatch( socket_data, ids( ids'first )'address, int( ids'length ) );
+     if res < 0 then
+        raise data_error with OSError( socket_error );
+     end if;
+     count := natural( res );
+  end if;
+end manageConnections;
+
+
 --  GET NEXT CLIENT
 --
 -- If there are multiple clients waiting for servicing (has data waiting
@@ -161,6 +222,125 @@ begin
 end drop;
 
 
+--  SET MESSAGE FRAMING
+--
+-- Choose how getMessage and putMessage separate messages.
+-----------------------------------------------------------------------------
+
+procedure setMessageFraming( socket_data : aSocketServer; framing : aMessageFraming; size : natural := 0 ) is
+begin
+  setMessageFraming( socket_data, aMessageFraming'pos( framing ), size );
+  if socket_error /= 0 then
+     raise data_error with OSError( socket_error );
+  end if;
+end setMessageFraming;
+
+
+--  GET MESSAGE
+--
+-- Return the next complete message from a client.  The message is copied
+-- out of the C read buffer in one call.  Errors will throw a data_error
+-- exception.
+-----------------------------------------------------------------------------
+
+procedure getMessage( socket_data : aSocketServer; id : aClientID;
+  message : out unbounded_string; status : out aMessageStatus ) is
+  len    : integer;
+  buffer : readBufferPtr;
+begin
+  message := null_unbounded_string;
+  len := get_framed_message( socket_data, aSocketFD( id ) );
+  if len >= 0 then
+     buffer := new string( 1..len );
+     take_framed_message( socket_data, aSocketFD( id ), buffer.all'address );
+     message := to_unbounded_string( buffer.all );
+     free( buffer );
+     status := complete_message;
+  elsif len = -1 then
+     status := partial_message;
+  elsif len = -2 then
+     status := client_closed;
+  else
+     raise data_error with OSError( socket_error );
+  end if;
+end getMessage;
+
+
+--  PUT MESSAGE
+--
+-- Queue a message for a client.  Errors will throw a data_error exception.
+-----------------------------------------------------------------------------
+
+procedure putMessage( socket_data : aSocketServer; id : aClientID; message : string ) is
+begin
+  if put_framed_message( socket_data, aSocketFD( id ), message'address, message'length ) < 0 then
+     raise data_error with OSError( socket_error );
+  end if;
+end putMessage;
+
+
+--  PUT FILE
+--
+-- Queue part of a file for a client.  Errors will throw a data_error
+-- exception.
+-----------------------------------------------------------------------------
+
+procedure putFile( socket_data : aSocketServer; id : aClientID; path : string; size : long ) is
+  c_path : constant string := path & ASCII.NUL;
+begin
+  if put_file_message( socket_data, aSocketFD( id ), c_path'address, size ) < 0 then
+     raise data_error with OSError( socket_error );
+  end if;
+end putFile;
+
+
+--  HAS PENDING OUTPUT
+--
+-- True if putMessage or putFile output has not been sent yet.
+-----------------------------------------------------------------------------
+
+function hasPendingOutput( socket_data : aSocketServer; id : aClientID ) return boolean is
+begin
+  return has_pending_output( socket_data, aSocketFD( id ) ) /= 0;
+end hasPendingOutput;
+
+
+--  CLOSE IDLE CLIENTS
+--
+-- Close the clients using getMessage and putMessage that have been idle
+-- for idle_secs seconds.  Clients still being sent output are not idle.
+-----------------------------------------------------------------------------
+
+procedure closeIdleClients( socket_data : aSocketServer; idle_secs : positive; count : out natural ) is
+begin
+  count := natural( close_idle_clients( socket_data, idle_secs ) );
+end closeIdleClients;
+
+
+--  CLOSE
+--
+-- Gracefully close a client connection that uses getMessage and
+-- putMessage.  Waiting messages are sent first.
+-----------------------------------------------------------------------------
+
+procedure close( socket_data : aSocketServer; id : aClientID ) is
+begin
+  closeClient( socket_data, aSocketFD( id ) );
+end close;
+
+
+--  DROP
+--
+-- Forcefully close a client connection that uses getMessage and
+-- putMessage.  Waiting messages are discarded.
+-----------------------------------------------------------------------------
+
+procedure drop( socket_data : aSocketServer; id : aClientID ) is
+begin
+  abortClient( socket_data, aSocketFD( id ) );
+end drop;
+
+
 --  GET LISTENER SOCKET
 --
 -- Return the client ID of the socket listening for new connections.
@@ -214,7 +394,9 @@ end isTimeout;
 -- buffer sizes (as set by setsockopt).  queue length is how many clients
 -- may queue before getting errors.  linger is how long to leave the socket
 -- open while the client hasn't finished reading data.  timeout is the
--- select syscall timeout.  Use 0 for default values.
+-- select syscall timeout.  backend is select or epoll.  Use 0 for default
+-- values.  workers is the number of pre-forked worker processes (0 for
+-- none).
 ------------------------------------------------------------------------------
 
 procedure startupTinyServe( socket_data : out aSocketServer;
@@ -225,7 +407,9 @@ procedure startupTinyServe( socket_data : out aSocketServer;
   socket_queue_length : integer;
   socket_linger_seconds : integer;
   timeout_secs : integer;
-  timeout_usecs : integer ) is
+  timeout_usecs : integer;
+  backend : aSocketBackend := select_backend;
+  workers : natural := 0 ) is
   c_host : constant string := host & ASCII.NUL;
 begin
   for i in 1..host'length loop
@@ -233,10 +417,50 @@ begin
   end loop;
   socket_data := initialize_server( port, min_recv_buffer_size,
     min_send_buffer_size, socket_queue_length, socket_linger_seconds,
-    timeout_secs, timeout_usecs );
+    timeout_secs, timeout_usecs, aSocketBackend'pos( backend ), workers );
+  if workers > 0 and socket_data /= aSocketServer( Null_Address ) then
+     if start_workers( socket_data, workers ) < 0 then
+        raise data_error with OSError( socket_error );
+     end if;
+  end if;
 end startupTinyServe;
 
 
+--  GET WORKER NUMBER
+--
+-- Return the worker process number, or 0 for the parent or a server
+-- without workers.
+------------------------------------------------------------------------------
+
+function getWorkerNumber( socket_data : aSocketServer ) return natural is
+begin
+  return natural( get_worker_number( socket_data ) );
+end getWorkerNumber;
+
+
+--  COUNT WORKER CLIENTS
+--
+-- Return the clients open in one worker or all workers.  The counts are
+-- kept in memory shared by the workers and the parent.
+------------------------------------------------------------------------------
+
+function countWorkerClients( socket_data : aSocketServer; worker : natural := 0 ) return natural is
+begin
+  return natural( count_worker_clients( socket_data, worker ) );
+end countWorkerClients;
+
+
+--  COUNT WORKER ACCEPTS
+--
+-- Return the clients accepted by one worker or all workers.
+------------------------------------------------------------------------------
+
+function countWorkerAccepts( socket_data : aSocketServer; worker : natural := 0 ) return natural is
+begin
+  return natural( count_worker_accepts( socket_data, worker ) );
+end countWorkerAccepts;
+
+
 --  SHUTDOWN TINYSERVER
 --
 -- Shutdown the server by releasing the sockets and freeing memory.
@@ -860,9 +860,10 @@ end get;
 
 --  GET
 --
--- Read a specific number of bytes.  Errors will raise data_error
--- exception.  fileutils_wouldblock is raised if writing would cause the
--- process to block a non-blocking descriptor.
+-- Read a specific number of bytes.  Errors, or the connection closing
+-- before all the bytes arrive, will raise data_error exception.
+-- fileutils_wouldblock is raised if writing would cause the process to
+-- block a non-blocking descriptor.
 -----------------------------------------------------------------------------
 
 procedure get( fd : in out aBufferedSocket; bytes : positive; s : out unbounded_string ) is
@@ -880,6 +881,9 @@ begin
           amountToRead := fd.readBuffer'length;
        end if;
        fillReadBuffer( fd, amountToRead );
+       if fd.amountRead = 0 then
+          raise data_error with "connection closed after" & totalRead'img & " of" & bytes'img & " bytes";
+       end if;
     end if;
     s := s & fd.readBuffer(fd.readPos..integer(fd.amountRead));
     fd.readpos := fd.readPos + integer( fd.amountRead );
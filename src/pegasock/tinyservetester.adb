@@ -1,10 +1,22 @@
 -- telnet localhost 11215
+--
+-- tinyservetester bench [page|file] [connections] [requests] [depth]
+--
+-- runs a local HTTP benchmark (like ab or wrk) instead: a client task
+-- sends requests for a page or a file (sent with sendfile) on keep-alive
+-- connections, depth requests at a time (pipelined), and reports the
+-- request and transfer rates.
 
 with ada.text_io,
+     ada.command_line,
+     ada.calendar,
+     ada.directories,
      ada.strings.unbounded,
      pegasock.tinyserve,
      pegasock.tinyserve.http;
 use  ada.text_io,
+     ada.command_line,
+     ada.calendar,
      ada.strings.unbounded,
      pegasock,
      pegasock.tinyserve,
@@ -16,7 +28,218 @@ procedure tinyservetester is
   server : aSocketServer;
   sd     : aBufferedSocket;
   s      : unbounded_string;
+
+  -- HTTP BENCHMARK
+  --
+  -- Serve requests from a load generator task and report how long they
+  -- took.
+
+  procedure httpBenchmark is
+    port        : constant integer := 11216;
+    benchFile   : constant string := "tinyservebench.html";
+    fileSize    : constant positive := 16384;
+    useFile     : boolean := false;
+    connections : positive := 50;
+    requests    : positive := 1000;                 -- per connection
+    depth       : positive := 1;                    -- pipelined requests
+    crlf_eol    : constant string := ASCII.CR & ASCII.LF;
+    page        : constant unbounded_string := to_unbounded_string(
+                  "<html><head><title>TinyServe</title></head><body><p>TinyServe Benchmark</p></body></html>" );
+
+    type aSocketList is array( positive range <> ) of aBufferedSocket;
+    type aSocketListPtr is access aSocketList;
+
+    -- results from the load generator
+
+    failed      : boolean := false;
+    total       : natural := 0;
+    bytes       : long_float := 0.0;
+    elapsed     : duration := 0.0;
+
+    -- READ HEADER
+    --
+    -- Read a response header a byte at a time up to the blank line.
+
+    procedure readHeader( client : in out aBufferedSocket; header : out unbounded_string ) is
+      ch : unbounded_string;
+    begin
+      header := null_unbounded_string;
+      loop
+        get( client, 1, ch );
+        append( header, ch );
+        exit when length( header ) >= 4 and then
+           slice( header, length( header ) - 3, length( header ) ) = crlf_eol & crlf_eol;
+      end loop;
+    end readHeader;
+
+    -- FIELD
+    --
+    -- Return the value of a response header field.
+
+    function field( header : unbounded_string; name : string ) return string is
+      first : natural := index( header, name & ": " );
+      last  : natural;
+    begin
+      if first = 0 then
+         return "";
+      end if;
+      first := first + name'length + 2;
+      last := index( header, crlf_eol, first );
+      return slice( header, first, last - 1 );
+    end field;
+
+    task type aLoadGenerator is
+      entry start;
+    end aLoadGenerator;
+
+    task body aLoadGenerator is
+      clients      : aSocketListPtr;
+      stopper      : aBufferedSocket;
+      request      : unbounded_string;
+      batch        : unbounded_string;
+      header       : unbounded_string;
+      reply        : unbounded_string;
+      responseSize : positive;
+      rounds       : positive;
+      startTime    : time;
+    begin
+      accept start;
+      begin
+        if useFile then
+           request := to_unbounded_string( "GET /file HTTP/1.1" & crlf_eol );
+        else
+           request := to_unbounded_string( "GET / HTTP/1.1" & crlf_eol );
+        end if;
+        request := request & "Host: localhost" & crlf_eol & crlf_eol;
+        clients := new aSocketList( 1..connections );
+        for i in clients'range loop
+            establish( clients(i), to_unbounded_string( "localhost" ), port );
+        end loop;
+
+        -- Every response is the same size so, after the first, they are
+        -- read in one call
+
+        put( clients(1), request );
+        readHeader( clients(1), header );
+        get( clients(1), positive'value( field( header, "Content-Length" ) ), reply );
+        responseSize := length( header ) + length( reply );
+
+        -- A file should not be sent again if the client has it
+
+        if useFile then
+           put( clients(1), "GET /file HTTP/1.1" & crlf_eol &
+              "If-None-Match: " & field( header, "ETag" ) & crlf_eol & crlf_eol );
+           readHeader( clients(1), header );
+           put_line( "Conditional: " & slice( header, 1, index( header, crlf_eol ) - 1 ) );
+        end if;
+
+        for i in 1..depth loop
+            append( batch, request );
+        end loop;
+        rounds := positive'max( 1, requests / depth );
+        startTime := clock;
+        for r in 1..rounds loop
+            for i in clients'range loop
+                put( clients(i), batch );
+            end loop;
+            for i in clients'range loop
+                get( clients(i), responseSize * depth, reply );
+            end loop;
+        end loop;
+        elapsed := clock - startTime;
+        total := rounds * depth * connections;
+        bytes := long_float( total ) * long_float( responseSize );
+        for i in clients'range loop
+            close( clients(i) );
+        end loop;
+      exception when others =>
+        put_line( standard_error, "load generator failed" );
+        failed := true;
+      end;
+
+      -- always stop the server
+
+      establish( stopper, to_unbounded_string( "localhost" ), port );
+      put( stopper, "GET /stop HTTP/1.1" & crlf_eol & "Connection: close" & crlf_eol & crlf_eol );
+      close( stopper );
+    end aLoadGenerator;
+
+    hs     : aHTTPServer;
+    id     : aHTTPClientID;
+    f      : file_type;
+    header : unbounded_string;
+  begin
+    if argument_count >= 2 then
+       if argument( 2 ) = "file" then
+          useFile := true;
+       elsif argument( 2 ) /= "page" then
+          put_line( standard_error, "usage: tinyservetester bench [page|file] [connections] [requests] [depth]" );
+          return;
+       end if;
+    end if;
+    if argument_count >= 3 then
+       connections := positive'value( argument( 3 ) );
+    end if;
+    if argument_count >= 4 then
+       requests := positive'value( argument( 4 ) );
+    end if;
+    if argument_count >= 5 then
+       depth := positive'value( argument( 5 ) );
+    end if;
+
+    if useFile then
+       create( f, out_file, benchFile );
+       for i in 1..fileSize / 64 loop
+           put_line( f, "<p>TinyServe sendfile benchmark......................</p>" );
+       end loop;
+       close( f );
+       put_line( "Document:    " & benchFile & " (sendfile)" );
+    else
+       put_line( "Document:    page" );
+    end if;
+    put_line( "Connections: " & connections'img );
+    put_line( "Requests:    " & requests'img & " per connection" );
+    put_line( "Pipelined:   " & depth'img );
+
+    startupWebServer( hs, "localhost", port, 0, 0, 4096, 0, 1, 0, epoll_backend );
+    declare
+      generator : aLoadGenerator;
+    begin
+      generator.start;
+      loop
+        getWebRequest( hs, id );
+        header := getHeader( hs, id );
+        if index( header, "GET /stop " ) = 1 then
+           putWebResponse( hs, id, to_unbounded_string( "stopped" ), text );
+           exit;
+        elsif useFile then
+           putWebFile( hs, id, benchFile );
+        else
+           putWebResponse( hs, id, page );
+        end if;
+      end loop;
+    end;
+    shutdownWebServer( hs );
+    if useFile then
+       ada.directories.delete_file( benchFile );
+    end if;
+
+    if not failed then
+       put_line( "Requests:    " & total'img );
+       put_line( "Seconds:     " & elapsed'img );
+       if elapsed > 0.0 then
+          put_line( "Requests/s:  " & integer'image( integer( float( total ) / float( elapsed ) ) ) );
+          put_line( "MB/s:        " & integer'image( integer( bytes / long_float( elapsed ) / 1048576.0 ) ) );
+       end if;
+    end if;
+  end httpBenchmark;
+
 begin
+  if argument_count >= 1 and then argument( 1 ) = "bench" then
+     httpBenchmark;
+     return;
+  end if;
+
   put_line( "Creating Server on Port locahost:11215" );
   startupTinyServe( server,
      "localhost",
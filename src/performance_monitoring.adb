@@ -128,6 +128,41 @@ begin
      put( "Throughput: " );
      put( rate'img );
      put_line( " Lines/Sec" );
+
+     -- Berkeley DB Stats
+     --
+     -- Only shown if btree_io or hash_io files were used.  The hit ratio
+     -- shows whether the cache is big enough.
+
+     if perfStats.bdbFiles > 0 then
+        new_line;
+        put_line( "Berkeley DB Stats" );
+        new_line;
+        put( "Files:      " );
+        put_line( perfStats.bdbFiles'img );
+        put( "Cache Hits: " );
+        put_line( long_long_integer( perfStats.bdbCacheHits )'img );
+        put( "Cache Miss: " );
+        put_line( long_long_integer( perfStats.bdbCacheMisses )'img );
+        put( "Hit Ratio:  " );
+        if perfStats.bdbCacheHits + perfStats.bdbCacheMisses > 0.0 then
+           put( natural( 100.0 * perfStats.bdbCacheHits /
+              ( perfStats.bdbCacheHits + perfStats.bdbCacheMisses ) )'img );
+           put_line( " %" );
+        else
+           put_line( " N/A" );
+        end if;
+        put( "Pages Read: " );
+        put_line( long_long_integer( perfStats.bdbPagesRead )'img );
+        put( "Pages Out:  " );
+        put_line( long_long_integer( perfStats.bdbPagesWritten )'img );
+        put( "Lock Waits: " );
+        put_line( long_long_integer( perfStats.bdbLockWaits )'img );
+        put( "Deadlocks:  " );
+        put_line( long_long_integer( perfStats.bdbDeadlocks )'img );
+        put( "Log Bytes:  " );
+        put_line( long_long_integer( perfStats.bdbLogBytes )'img );
+     end if;
   end if;
 end put_perf_summary;
 
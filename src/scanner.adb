@@ -32,6 +32,7 @@ with system,
     ada.strings.fixed,
     ada.strings.unbounded.text_io,
     ada.characters.handling,
+    ada.unchecked_conversion,
     gnat.source_info,
     spar_os.tty,
     pegasock.memcache,
@@ -82,7 +83,10 @@ with system,
     parser_hash_io,
     parser_templates,
     parser_tinyserve,
-    parser_logs;
+    parser_logs,
+    parser_digest,
+    parser_ordered,
+    parser_decimal;
 use ada.text_io,
     ada.command_line,
     ada.command_line.environment,
@@ -138,7 +142,10 @@ use ada.text_io,
     parser_hash_io,
     parser_templates,
     parser_tinyserve,
-    parser_logs;
+    parser_logs,
+    parser_digest,
+    parser_ordered,
+    parser_decimal;
 
 package body scanner is
 
@@ -2422,6 +2429,9 @@ end dumpSymbolTable;
 
 procedure shutdownScanner is
 begin
+  ShutdownOrdered;
+  ShutdownDecimal;
+  ShutdownDigest;
   ShutdownLogs;
   ShutdownTemplates;
   ShutdownTinyServe;
@@ -3160,6 +3170,9 @@ begin
   StartupTinyServe;
   StartupTemplates;
   StartupLogs;
+  StartupDigest;
+  StartupDecimal;
+  StartupOrdered;
 
   -- Declare all Environment Variables
   --
@@ -5340,6 +5353,373 @@ begin
 end DoJsonToRecord;
 
 
+-----------------------------------------------------------------------------
+-- BINARY ENCODING
+--
+-- A compact alternative to JSON for storing records and arrays in files.
+-- The layout (version 1) is
+--
+--   SOH 'B' version kind count item...
+--
+-- where kind is 'R' (record) or 'A' (array) and count is the number of
+-- items as a 4-byte little-endian length.  Each item is either 'N' followed
+-- by the 8 bytes of a native long_float (numbers, enumerateds and booleans)
+-- or 'S' followed by a 4-byte length and the bytes of the string.  Record
+-- fields are stored by position, not by name.
+-----------------------------------------------------------------------------
+
+binaryMagic   : constant string := ASCII.SOH & 'B';
+binaryVersion : constant character := character'val( 1 );
+
+subtype binaryNumberString is string( 1..long_float'size / 8 );
+
+function toBinaryNumber is new ada.unchecked_conversion( long_float, binaryNumberString );
+function fromBinaryNumber is new ada.unchecked_conversion( binaryNumberString, long_float );
+
+binary_error : exception;
+-- raised when a binary string is truncated or malformed
+
+
+-----------------------------------------------------------------------------
+--  TO BINARY LENGTH
+--
+-- Encode a length as 4 little-endian bytes.
+-----------------------------------------------------------------------------
+
+function toBinaryLength( len : natural ) return string is
+  result : string( 1..4 );
+  n      : natural := len;
+begin
+  for i in result'range loop
+      result( i ) := character'val( n mod 256 );
+      n := n / 256;
+  end loop;
+  return result;
+end toBinaryLength;
+
+
+-----------------------------------------------------------------------------
+--  FROM BINARY LENGTH
+--
+-- Decode a 4 byte little-endian length at position pos and advance pos.
+-----------------------------------------------------------------------------
+
+procedure fromBinaryLength( s : string; pos : in out positive; len : out natural ) is
+  n : long_integer := 0;
+begin
+  if pos + 3 > s'last then
+     raise binary_error;
+  end if;
+  for i in reverse pos..pos+3 loop
+      n := n * 256 + character'pos( s( i ) );
+  end loop;
+  if n > long_integer( natural'last ) then
+     raise binary_error;
+  end if;
+  len := natural( n );
+  pos := pos + 4;
+end fromBinaryLength;
+
+
+-----------------------------------------------------------------------------
+--  APPEND BINARY ITEM
+--
+-- Encode a single value of the given type and append it to result.
+-----------------------------------------------------------------------------
+
+procedure appendBinaryItem( result : in out unbounded_string;
+  val : unbounded_string; kind : identifier ) is
+  uniType : constant identifier := getUniType( kind );
+begin
+  if uniType = uni_numeric_t or uniType = root_enumerated_t then
+     append( result, 'N' );
+     append( result, toBinaryNumber( to_numeric( val ) ) );
+  elsif uniType = uni_string_t or uniType = universal_t then
+     append( result, 'S' );
+     append( result, toBinaryLength( length( val ) ) );
+     append( result, val );
+  else
+     -- private types are unique types extending variable_t
+     err( "private type values cannot be binary encoded" );
+  end if;
+end appendBinaryItem;
+
+
+-----------------------------------------------------------------------------
+--  PARSE BINARY ITEM
+--
+-- Decode the single value at position pos, advance pos and return the
+-- value in the representation SparForte uses for the given type.
+-----------------------------------------------------------------------------
+
+procedure parseBinaryItem( s : string; pos : in out positive;
+  kind : identifier; val : out unbounded_string ) is
+  uniType : constant identifier := getUniType( kind );
+  len     : natural;
+  lf      : long_float;
+begin
+  val := null_unbounded_string;
+  if pos > s'last then
+     raise binary_error;
+  end if;
+  if s( pos ) = 'N' then
+     if pos + binaryNumberString'length > s'last then
+        raise binary_error;
+     end if;
+     lf := fromBinaryNumber( s( pos+1..pos+binaryNumberString'length ) );
+     pos := pos + 1 + binaryNumberString'length;
+     if getBaseType( kind ) = boolean_t then
+        val := to_bush_boolean( lf /= 0.0 );
+     elsif uniType = root_enumerated_t then
+        val := to_unbounded_string( lf );
+     elsif uniType = uni_numeric_t then
+        val := castToType( lf, kind );
+     else
+        err( optional_bold( "binary string value" ) & " expected but found number" );
+     end if;
+  elsif s( pos ) = 'S' then
+     pos := pos + 1;
+     fromBinaryLength( s, pos, len );
+     if pos + len - 1 > s'last then
+        raise binary_error;
+     end if;
+     if uniType = uni_string_t or uniType = universal_t then
+        val := to_unbounded_string( s( pos..pos+len-1 ) );
+     else
+        err( optional_bold( "binary number value" ) & " expected but found string" );
+     end if;
+     pos := pos + len;
+  else
+     raise binary_error;
+  end if;
+end parseBinaryItem;
+
+
+-----------------------------------------------------------------------------
+--  PARSE BINARY HEADER
+--
+-- Check the header of a binary string for the expected kind of aggregate,
+-- return the item count and the position of the first item.
+-----------------------------------------------------------------------------
+
+procedure parseBinaryHeader( s : string; aggregate : character;
+  count : out natural; pos : out positive ) is
+begin
+  pos := s'first;
+  if s'length < binaryMagic'length + 6 then
+     raise binary_error;
+  elsif s( pos..pos+1 ) /= binaryMagic then
+     raise binary_error;
+  elsif s( pos+2 ) /= binaryVersion then
+     err( "unsupported binary encoding version" & character'pos( s( pos+2 ) )'img );
+     count := 0;
+     return;
+  elsif s( pos+3 ) /= aggregate then
+     if aggregate = 'R' then
+        err( "binary record expected but found array" );
+     else
+        err( "binary array expected but found record" );
+     end if;
+     count := 0;
+     return;
+  end if;
+  pos := pos + 4;
+  fromBinaryLength( s, pos, count );
+end parseBinaryHeader;
+
+
+-----------------------------------------------------------------------------
+--  FIND BINARY RECORD FIELD
+--
+-- Return the field of a record variable at the given position, or eof_t.
+-- The fields of a record type are declared immediately after the type, and
+-- the fields of a variable immediately after the variable, so search
+-- forward from there rather than the whole symbol table.
+-----------------------------------------------------------------------------
+
+function findBinaryRecordField( record_var_id : identifier; position : positive ) return identifier is
+  recordType : constant identifier := identifiers( record_var_id ).kind;
+  typeField  : identifier := eof_t;
+  field_t    : identifier := eof_t;
+  fieldName  : unbounded_string;
+  dotPos     : natural;
+begin
+  for j in recordType+1..identifiers_top-1 loop
+      if identifiers( j ).field_of = recordType then
+         if integer'value( to_string( identifiers( j ).value.all ) ) = position then
+            typeField := j;
+            exit;
+         end if;
+      end if;
+  end loop;
+  if typeField /= eof_t then
+     fieldName := identifiers( typeField ).name;
+     dotPos := length( fieldName );
+     while dotPos > 1 loop
+        exit when element( fieldName, dotPos ) = '.';
+        dotPos := dotPos - 1;
+     end loop;
+     fieldName := identifiers( record_var_id ).name & "." & delete( fieldName, 1, dotPos );
+     for j in record_var_id+1..identifiers_top-1 loop
+         if identifiers( j ).field_of = record_var_id then
+            if identifiers( j ).name = fieldName then
+               field_t := j;
+               exit;
+            end if;
+         end if;
+     end loop;
+     -- not in the usual place?  Fall back to a full search.
+     if field_t = eof_t then
+        findIdent( fieldName, field_t );
+     end if;
+  end if;
+  return field_t;
+end findBinaryRecordField;
+
+
+-----------------------------------------------------------------------------
+--  IS BINARY ENCODED
+--
+-- True if the value was created by DoArrayToBinary or DoRecordToBinary.
+-- JSON values never begin with a control character.
+-----------------------------------------------------------------------------
+
+function isBinaryEncoded( val : unbounded_string ) return boolean is
+begin
+  return length( val ) >= binaryMagic'length and then
+    slice( val, 1, binaryMagic'length ) = binaryMagic;
+end isBinaryEncoded;
+
+
+-----------------------------------------------------------------------------
+--  DO ARRAY TO BINARY
+--
+-- Convert an array to a binary string.  Params are not checked.
+-----------------------------------------------------------------------------
+
+procedure DoArrayToBinary( result : out unbounded_string; source_var_id : identifier ) is
+  source_first : constant long_integer := identifiers( source_var_id ).avalue'first;
+  source_last  : constant long_integer := identifiers( source_var_id ).avalue'last;
+  elementKind  : constant identifier := getBaseType( identifiers( identifiers( source_var_id ).kind ).kind );
+begin
+  result := to_unbounded_string( binaryMagic & binaryVersion & 'A' );
+  append( result, toBinaryLength( natural( source_last - source_first + 1 ) ) );
+  for arrayElementPos in source_first..source_last loop
+      appendBinaryItem( result, identifiers( source_var_id ).avalue( arrayElementPos ), elementKind );
+      exit when error_found;
+  end loop;
+exception when CONSTRAINT_ERROR =>
+  err( "unable to binary encode array " &
+       optional_bold( to_string( identifiers( source_var_id ).name ) ) );
+end DoArrayToBinary;
+
+
+-----------------------------------------------------------------------------
+--  DO BINARY TO ARRAY
+--
+-- Convert a binary string and store in an array.  Params are not checked.
+-----------------------------------------------------------------------------
+
+procedure DoBinaryToArray( target_var_id : identifier; source_val : unbounded_string ) is
+  s            : constant string := to_string( source_val );
+  target_first : constant long_integer := identifiers( target_var_id ).avalue'first;
+  target_last  : constant long_integer := identifiers( target_var_id ).avalue'last;
+  target_len   : constant long_integer := target_last - target_first + 1;
+  elementKind  : constant identifier := getBaseType( identifiers( identifiers( target_var_id ).kind ).kind );
+  sourceLen    : natural;
+  pos          : positive;
+  item         : unbounded_string;
+begin
+  parseBinaryHeader( s, 'A', sourceLen, pos );
+  if error_found then
+     null;
+  elsif long_integer( sourceLen ) /= target_len then
+     err( "array has" &
+          target_len'img &
+          " item(s) but binary string has" &
+          sourceLen'img );
+  else
+     for arrayElementPos in target_first..target_last loop
+         parseBinaryItem( s, pos, elementKind, item );
+         exit when error_found;
+         identifiers( target_var_id ).avalue( arrayElementPos ) := item;
+     end loop;
+  end if;
+exception when binary_error | CONSTRAINT_ERROR =>
+  err( "binary string is truncated or corrupt" );
+end DoBinaryToArray;
+
+
+-----------------------------------------------------------------------------
+--  DO RECORD TO BINARY
+--
+-- Convert a record to a binary string.  Params are not checked.
+-----------------------------------------------------------------------------
+
+procedure DoRecordToBinary( result : out unbounded_string; source_var_id : identifier ) is
+  numFields : constant natural := natural'value( to_string(
+     identifiers( identifiers( source_var_id ).kind ).value.all ) );
+  field_t   : identifier;
+begin
+  result := to_unbounded_string( binaryMagic & binaryVersion & 'R' );
+  append( result, toBinaryLength( numFields ) );
+  for i in 1..numFields loop
+      field_t := findBinaryRecordField( source_var_id, i );
+      if field_t = eof_t then
+         err( gnat.source_info.source_location &
+              ": internal error: record field not found" );
+         exit;
+      end if;
+      appendBinaryItem( result, identifiers( field_t ).value.all, identifiers( field_t ).kind );
+      exit when error_found;
+  end loop;
+exception when CONSTRAINT_ERROR =>
+  err( "unable to binary encode record " &
+       optional_bold( to_string( identifiers( source_var_id ).name ) ) );
+end DoRecordToBinary;
+
+
+-----------------------------------------------------------------------------
+--  DO BINARY TO RECORD
+--
+-- Convert a binary string and store in a record.  Params are not checked.
+-----------------------------------------------------------------------------
+
+procedure DoBinaryToRecord( target_var_id : identifier; source_val : unbounded_string ) is
+  s         : constant string := to_string( source_val );
+  numFields : constant natural := natural'value( to_string(
+     identifiers( identifiers( target_var_id ).kind ).value.all ) );
+  sourceLen : natural;
+  pos       : positive;
+  field_t   : identifier;
+  item      : unbounded_string;
+begin
+  parseBinaryHeader( s, 'R', sourceLen, pos );
+  if error_found then
+     null;
+  elsif sourceLen /= numFields then
+     err( "record has" &
+          numFields'img &
+          " field(s) but binary string has" &
+          sourceLen'img );
+  else
+     for i in 1..numFields loop
+         field_t := findBinaryRecordField( target_var_id, i );
+         if field_t = eof_t then
+            err( gnat.source_info.source_location &
+                 ": internal error: record field not found" );
+            exit;
+         end if;
+         parseBinaryItem( s, pos, identifiers( field_t ).kind, item );
+         exit when error_found;
+         identifiers( field_t ).value.all := item;
+     end loop;
+  end if;
+exception when binary_error | CONSTRAINT_ERROR =>
+  err( "binary string is truncated or corrupt" );
+end DoBinaryToRecord;
+
+
 -----------------------------------------------------------------------------
 --  DO STRING TO JSON
 --
@@ -27,9 +27,13 @@ pragma suppress( range_check );
 
 --with text_io; use text_io;
 
-with spar_os, Ada.Characters.Handling;
+with spar_os,
+     Interfaces,
+     Ada.Characters.Handling,
+     Ada.Unchecked_Conversion;
 with world;
-use  Ada.Characters.Handling,
+use  Interfaces,
+     Ada.Characters.Handling,
      world;
 
 package body string_util is
@@ -128,137 +132,167 @@ end TypoOf;
 
 
 ------------------------------------------------------------------------------
--- Basic String Testing
+-- Character Class Kernels
+--
+-- The string tests and case conversions work directly on the buffer of the
+-- unbounded string using lookup tables built when this package elaborates,
+-- rather than calling Element once per character.  Case conversion of pure
+-- 7-bit text is done eight characters at a time.
 ------------------------------------------------------------------------------
 
-function Is_Control( s : unbounded_string ) return boolean is
--- true if string is completely control characters
-  flag : boolean := true;
+type aCharClass is ( control_class, graphic_class, letter_class, lower_class,
+  upper_class, basic_class, digit_class, hex_digit_class, alphanumeric_class,
+  special_class );
+
+type aCharClassSet is array( aCharClass ) of boolean;
+pragma pack( aCharClassSet );
+
+type aCharMap is array( character ) of character;
+
+charClasses  : array( character ) of aCharClassSet;
+upperMap     : aCharMap;
+lowerMap     : aCharMap;
+basicMap     : aCharMap;
+properBreaks : array( character ) of boolean := ( others => false );
+escapedLength: array( character ) of positive;
+
+subtype aWordString is string( 1..8 );
+
+function toWord is new Ada.Unchecked_Conversion( aWordString, Unsigned_64 );
+function toWordString is new Ada.Unchecked_Conversion( Unsigned_64, aWordString );
+
+ones     : constant Unsigned_64 := 16#0101_0101_0101_0101#;
+highBits : constant Unsigned_64 := 16#8080_8080_8080_8080#;
+
+-- Adding these to a 7-bit character sets the high bit when the character
+-- is at or above the lower bound (LoBias) or above the upper bound (HiBias)
+-- of the letters to be converted.
+
+upperLoBias : constant Unsigned_64 := ones * Unsigned_64( 128 - character'pos( 'a' ) );
+upperHiBias : constant Unsigned_64 := ones * Unsigned_64( 127 - character'pos( 'z' ) );
+lowerLoBias : constant Unsigned_64 := ones * Unsigned_64( 128 - character'pos( 'A' ) );
+lowerHiBias : constant Unsigned_64 := ones * Unsigned_64( 127 - character'pos( 'Z' ) );
+
+chunkSize : constant positive := 65_536;
+-- the most characters of a string copied to the stack at a time, so long
+-- strings stay on the heap
+
+function allInClass( s : unbounded_string; charClass : aCharClass ) return boolean is
+-- true if every character in s belongs to the class.  Stops on the first
+-- character that does not.
 begin
   for i in 1..length( s ) loop
-      if not Is_Control( Element( s, i ) ) then
-         flag := false;
-         exit;
+      if not charClasses( element( s, i ) )( charClass ) then
+         return false;
       end if;
   end loop;
-  return flag;
+  return true;
+end allInClass;
+
+procedure mapCase( s : unbounded_string; newstr : out unbounded_string;
+  map : aCharMap; loBias, hiBias : Unsigned_64 ) is
+-- Translate s through a case map, a chunk at a time.  Groups of eight 7-bit
+-- characters flip the case bit of the letters in the range given by the
+-- biases all at once.  Groups containing 8-bit characters, and any
+-- remainder, use the map.
+  len   : constant natural := length( s );
+  first : positive := 1;
+  last  : natural;
+  w     : Unsigned_64;
+  mask  : Unsigned_64;
+begin
+  newstr := null_unbounded_string;
+  while first <= len loop
+     last := natural'min( first + chunkSize - 1, len );
+     declare
+        buf    : constant string( 1..last-first+1 ) := slice( s, first, last );
+        newbuf : string( buf'range );
+        i      : positive := 1;
+     begin
+        while i + 7 <= buf'last loop
+           w := toWord( buf( i..i+7 ) );
+           if ( w and highBits ) = 0 then
+              mask := ( w + loBias ) and not ( w + hiBias ) and highBits;
+              newbuf( i..i+7 ) := toWordString( w xor Shift_Right( mask, 2 ) );
+           else
+              for j in i..i+7 loop
+                  newbuf( j ) := map( buf( j ) );
+              end loop;
+           end if;
+           i := i + 8;
+        end loop;
+        for j in i..buf'last loop
+            newbuf( j ) := map( buf( j ) );
+        end loop;
+        append( newstr, newbuf );
+     end;
+     first := last + 1;
+  end loop;
+end mapCase;
+
+
+------------------------------------------------------------------------------
+-- Basic String Testing
+------------------------------------------------------------------------------
+
+function Is_Control( s : unbounded_string ) return boolean is
+-- true if string is completely control characters
+begin
+  return allInClass( s, control_class );
 end Is_Control;
 
 function Is_Graphic( s : unbounded_string ) return boolean is
 -- true if string is completely printable characters
-  flag : boolean := true;
 begin
-  for i in 1..length( s ) loop
-      if not Is_Graphic( Element( s, i ) ) then
-         flag := false;
-         exit;
-      end if;
-  end loop;
-  return flag;
+  return allInClass( s, graphic_class );
 end Is_Graphic;
 
 function Is_Letter( s : unbounded_string ) return boolean is
 -- true if string is completely letter characters
-  flag : boolean := true;
 begin
-  for i in 1..length( s ) loop
-      if not Is_Letter( Element( s, i ) ) then
-         flag := false;
-         exit;
-      end if;
-  end loop;
-  return flag;
+  return allInClass( s, letter_class );
 end Is_Letter;
 
 function Is_Lower( s : unbounded_string ) return boolean is
 -- true if string is completely lower-case characters
-  flag : boolean := true;
 begin
-  for i in 1..length( s ) loop
-      if not Is_Lower( Element( s, i ) ) then
-         flag := false;
-         exit;
-      end if;
-  end loop;
-  return flag;
+  return allInClass( s, lower_class );
 end Is_Lower;
 
 function Is_Upper( s : unbounded_string ) return boolean is
 -- true if string is completely Upper-case characters
-  flag : boolean := true;
 begin
-  for i in 1..length( s ) loop
-      if not Is_Upper( Element( s, i ) ) then
-         flag := false;
-         exit;
-      end if;
-  end loop;
-  return flag;
+  return allInClass( s, upper_class );
 end Is_Upper;
 
 function Is_Basic( s : unbounded_string ) return boolean is
 -- true if string is completely basic characters
-  flag : boolean := true;
 begin
-  for i in 1..length( s ) loop
-      if not Is_Basic( Element( s, i ) ) then
-         flag := false;
-         exit;
-      end if;
-  end loop;
-  return flag;
+  return allInClass( s, basic_class );
 end Is_Basic;
 
 function Is_Digit( s : unbounded_string ) return boolean is
 -- true if string is completely digit characters
-  flag : boolean := true;
 begin
-  for i in 1..length( s ) loop
-      if not Is_Digit( Element( s, i ) ) then
-         flag := false;
-         exit;
-      end if;
-  end loop;
-  return flag;
+  return allInClass( s, digit_class );
 end Is_Digit;
 
 function Is_Hexadecimal_Digit( s : unbounded_string ) return boolean is
 -- true if string is completely hexadecimal digit characters
-  flag : boolean := true;
 begin
-  for i in 1..length( s ) loop
-      if not Is_Hexadecimal_Digit( Element( s, i ) ) then
-         flag := false;
-         exit;
-      end if;
-  end loop;
-  return flag;
+  return allInClass( s, hex_digit_class );
 end Is_Hexadecimal_Digit;
 
 function Is_Alphanumeric( s : unbounded_string ) return boolean is
 -- true if string is completely hexadecimal digit characters
-  flag : boolean := true;
 begin
-  for i in 1..length( s ) loop
-      if not Is_Alphanumeric( Element( s, i ) ) then
-         flag := false;
-         exit;
-      end if;
-  end loop;
-  return flag;
+  return allInClass( s, alphanumeric_class );
 end Is_Alphanumeric;
 
 function Is_Special( s : unbounded_string ) return boolean is
 -- true if string is completely hexadecimal digit characters
-  flag : boolean := true;
 begin
-  for i in 1..length( s ) loop
-      if not Is_Special( Element( s, i ) ) then
-         flag := false;
-         exit;
-      end if;
-  end loop;
-  return flag;
+  return allInClass( s, special_class );
 end Is_Special;
 
 function Is_Date( s : unbounded_string ) return boolean is
@@ -332,86 +366,112 @@ end Is_Fixed;
 ------------------------------------------------------------------------------
 
 function ToLower( s : unbounded_string ) return unbounded_string is
-  ch : character;
   newstr : unbounded_string;
 begin
-  newstr := s;
-  for i in 1..length( s ) loop
-      ch := Element( s, i );
-      if ch >= 'A' and ch <= 'Z' then
-         ch := character'val( character'pos( ch ) + 32 );
-         Replace_Element( newstr, i, ch );
-      end if;
-  end loop;
+  mapCase( s, newstr, lowerMap, lowerLoBias, lowerHiBias );
   return newstr;
 end ToLower;
 
 function ToUpper( s : unbounded_string ) return unbounded_string is
-  ch : character;
   newstr : unbounded_string;
 begin
-  newstr := s;
-  for i in 1..length( s ) loop
-      ch := Element( s, i );
-      if ch >= 'a' and ch <= 'z' then
-         ch := character'val( character'pos( ch ) - 32 );
-         Replace_Element( newstr, i, ch );
-      end if;
-  end loop;
+  mapCase( s, newstr, upperMap, upperLoBias, upperHiBias );
   return newstr;
 end ToUpper;
 
 function ToProper( s : unbounded_string ) return unbounded_string is
-  ch        : character;
+  len       : constant natural := length( s );
   newstr    : unbounded_string;
+  first     : positive := 1;
+  last      : natural;
+  ch        : character;
   upperFlag : boolean := true;
 begin
-  newstr := s;
-  for i in 1..length( s ) loop
-      ch := Element( s, i );
-      if upperFlag then
-         if ch >= 'a' and ch <= 'z' then
-            ch := character'val( character'pos( ch ) - 32 );
-            Replace_Element( newstr, i, ch );
-         end if;
-      elsif ch >= 'A' and ch <= 'Z' then
-         ch := character'val( character'pos( ch ) + 32 );
-         Replace_Element( newstr, i, ch );
-      end if;
-      upperFlag := (ch = ' ') or (ch = '(') or
-                   (ch = '-') or (ch = '[') or
-                   (ch = '+') or (ch = '{') or
-                   (ch = '/'); -- for C's benefit, not on underscore
+  while first <= len loop
+     last := natural'min( first + chunkSize - 1, len );
+     declare
+        newbuf : string( 1..last-first+1 ) := slice( s, first, last );
+     begin
+        for i in newbuf'range loop
+            if upperFlag then
+               ch := upperMap( newbuf( i ) );
+            else
+               ch := lowerMap( newbuf( i ) );
+            end if;
+            newbuf( i ) := ch;
+            -- for C's benefit, not on underscore
+            upperFlag := properBreaks( ch );
+        end loop;
+        append( newstr, newbuf );
+     end;
+     first := last + 1;
   end loop;
   return newstr;
 end ToProper;
 
 function ToBasic( s : unbounded_string ) return unbounded_string is
-  ch : character;
+  len    : constant natural := length( s );
   newstr : unbounded_string;
-begin
-  newstr := s;
-  for i in 1..length( s ) loop
-      ch := To_Basic( Element( s, i ) );
-      Replace_Element( newstr, i, ch );
+  first  : positive := 1;
+  last   : natural;
+begin
+  while first <= len loop
+     last := natural'min( first + chunkSize - 1, len );
+     declare
+        newbuf : string( 1..last-first+1 ) := slice( s, first, last );
+     begin
+        for i in newbuf'range loop
+            newbuf( i ) := basicMap( newbuf( i ) );
+        end loop;
+        append( newstr, newbuf );
+     end;
+     first := last + 1;
   end loop;
   return newstr;
 end ToBasic;
 
 function ToEscaped( s : unbounded_string ) return unbounded_string is
 -- Create a printable string by marking unprintable characters with
--- "[# ascii-code]"
-  ch : character;
-  newstr : unbounded_string;
-begin
-  for i in 1..length( s ) loop
-      ch := Element( s, i );
-      if ch < ' ' or ch > '~' then
-         newstr := newstr & "[#" & character'pos( ch )'img & "]";
-      else
-         newstr := newstr & ch;
+-- "[# ascii-code]".  If nothing needs marking, s is returned as-is.
+-- Otherwise it is copied a chunk at a time, with printable runs appended
+-- as slices.
+  len     : constant natural := length( s );
+  escaped : boolean := false;
+  newstr  : unbounded_string;
+  first   : positive := 1;
+  last    : natural;
+  run     : positive;
+begin
+  for i in 1..len loop
+      if escapedLength( element( s, i ) ) > 1 then
+         escaped := true;
+         exit;
       end if;
   end loop;
+  if not escaped then
+     return s;
+  end if;
+  while first <= len loop
+     last := natural'min( first + chunkSize - 1, len );
+     declare
+        buf : constant string( 1..last-first+1 ) := slice( s, first, last );
+     begin
+        run := 1;
+        for i in buf'range loop
+            if escapedLength( buf( i ) ) > 1 then
+               if run < i then
+                  append( newstr, buf( run..i-1 ) );
+               end if;
+               append( newstr, "[#" & character'pos( buf( i ) )'img & "]" );
+               run := i+1;
+            end if;
+        end loop;
+        if run <= buf'last then
+           append( newstr, buf( run..buf'last ) );
+        end if;
+     end;
+     first := last + 1;
+  end loop;
   return newstr;
 end ToEscaped;
 
@@ -882,5 +942,45 @@ begin
   return "<secured data>";
 end toSecureData;
 
+begin
+  -- Build the character class and conversion tables
+
+  for ch in character loop
+      charClasses( ch ) := (
+         control_class      => Is_Control( ch ),
+         graphic_class      => Is_Graphic( ch ),
+         letter_class       => Is_Letter( ch ),
+         lower_class        => Is_Lower( ch ),
+         upper_class        => Is_Upper( ch ),
+         basic_class        => Is_Basic( ch ),
+         digit_class        => Is_Digit( ch ),
+         hex_digit_class    => Is_Hexadecimal_Digit( ch ),
+         alphanumeric_class => Is_Alphanumeric( ch ),
+         special_class      => Is_Special( ch ) );
+      upperMap( ch ) := ch;
+      lowerMap( ch ) := ch;
+      basicMap( ch ) := To_Basic( ch );
+      if ch < ' ' or ch > '~' then
+         declare
+            code : constant string := character'pos( ch )'img;
+         begin
+            escapedLength( ch ) := code'length + 3;
+         end;
+      else
+         escapedLength( ch ) := 1;
+      end if;
+  end loop;
+  for ch in 'a'..'z' loop
+      upperMap( ch ) := character'val( character'pos( ch ) - 32 );
+  end loop;
+  for ch in 'A'..'Z' loop
+      lowerMap( ch ) := character'val( character'pos( ch ) + 32 );
+  end loop;
+  properBreaks( ' ' ) := true;
+  properBreaks( '(' ) := true;
+  properBreaks( '-' ) := true;
+  properBreaks( '[' ) := true;
+  properBreaks( '+' ) := true;
+  properBreaks( '{' ) := true;
+  properBreaks( '/' ) := true;
 end string_util;
-
@@ -100,6 +100,25 @@ else
 fi
 }
 
+do_tinyserve_good_test() {
+TESTSET="tinyserve_good_test.sp"
+if [ ! -f "$TESTSET" ] ; then
+   echo "Failed - $TESTSET is missing"
+fi
+RESULT=`../../spar --test --debug ./$TESTSET 2>&1`
+if [ $? -ne 0 ] ; then
+   echo "Failed - $TESTSET Failed"
+   echo "$RESULT"
+   exit 192
+elif [ -n "$RESULT" ] ; then
+   echo "Failed - $TESTSET Failed"
+   echo "$RESULT"
+   exit 192
+else
+   echo "OK - $TESTSET"
+fi
+}
+
 # A minimal test of SDL using example programs in an
 # X virtual frame buffer
 # Doesn't check the output because "Press Return" is sent
@@ -131,6 +150,7 @@ do_cgi_good_test
 do_btree_good_test
 do_hash_good_test
 do_memcache_good_test
+do_tinyserve_good_test
 do_sdl_xvfb_test
 
 # ---------------------------------------------------------------------------